@@ -23,7 +23,7 @@
 #define print_error(result, msg, ...) stderr_message("ast", ERROR, (result), (msg),##__VA_ARGS__)
 #endif
 
-ASTError ast_error = AST_NO_ERROR;
+_Thread_local ASTError ast_error = AST_NO_ERROR;
 
 ASTNode *ast_node(ASTNodeType nodeType) {
     ASTNode *node = calloc(1, sizeof(ASTNode));
@@ -33,8 +33,40 @@ ASTNode *ast_node(ASTNodeType nodeType) {
     return node;
 }
 
+// Frees the targets of an assignment. Unlike variable reads, they aren't counted as references of their variables.
+static void clean_assignment_targets(ASTNode *assignment) {
+    ASTNode *targets = assignment->left;
+    if (targets == NULL) return;
+
+    STSymbol *compoundTarget = NULL;
+    if (targets->actionType == AST_LIST) {
+        for (unsigned i = 0; i < targets->dataCount; i++) {
+            free(targets->data[i].astPtr);
+        }
+    } else {
+        compoundTarget = targets->data[0].symbolTableItemPtr;
+    }
+    free(targets);
+    assignment->left = NULL;
+
+    // A compound assignment (a += b) reads its target without counting the reference either
+    ASTNode *value = assignment->right;
+    if (compoundTarget == NULL || value == NULL) return;
+    if (value->actionType == AST_ID && value->data[0].symbolTableItemPtr == compoundTarget) {
+        free(value);
+        assignment->right = NULL;
+    } else if (value->left != NULL && value->left->actionType == AST_ID
+               && value->left->data[0].symbolTableItemPtr == compoundTarget) {
+        free(value->left);
+        value->left = NULL;
+    }
+}
+
 void clean_ast(ASTNode *node) {
     if (node == NULL) return;
+    if (node->actionType == AST_ASSIGN || node->actionType == AST_DEFINE) {
+        clean_assignment_targets(node);
+    }
     clean_ast(node->left);
     clean_ast(node->right);
 
@@ -49,7 +81,7 @@ void clean_ast(ASTNode *node) {
             break;
         case AST_ID:
             if (node->inheritedDataType != CF_BLACK_HOLE) {
-                node->data[0].symbolTableItemPtr->reference_counter--;
+                symtable_symbol_unref(node->data[0].symbolTableItemPtr);
             }
     }
     free(node);
@@ -181,7 +213,9 @@ unsigned ast_push_to_list(ASTNode *astList, ASTNode *node) {
     return astList->dataPointerIndex++;
 }
 
-static bool strictInference = false;
+// Kept per thread like ast_error, as the inference turns it off temporarily while the functions
+// are optimised in parallel.
+static _Thread_local bool strictInference = false;
 
 #define ast_uninferrable(node) (node)->inheritedDataType = CF_UNKNOWN_UNINFERRABLE; return false
 
@@ -221,12 +255,12 @@ bool ast_infer_leaf_type(ASTNode *node) {
                 return !strictInference;
             }
 
-            STParam *retType = symb->data.func_data.ret_types;
+            unsigned retTypesCount = symb->data.func_data.ret_types_count;
 
-            if (retType == NULL) {
+            if (retTypesCount == 0) {
                 node->inheritedDataType = CF_NIL;
-            } else if (retType->next == NULL) {
-                node->inheritedDataType = retType->type;
+            } else if (retTypesCount == 1) {
+                node->inheritedDataType = symb->data.func_data.ret_types[0].type;
             } else {
                 node->inheritedDataType = CF_MULTIPLE;
             }
@@ -446,9 +480,9 @@ bool assignment_inference_list_func_call(ASTNode *node) {
         ast_uninferrable(node);
     }
 
-    STParam *funcRetType = funcSymb->data.func_data.ret_types;
     for (unsigned i = 0; i < leftIdListNode->dataCount; i++) {
         ASTNode *leftIdNode = leftIdListNode->data[i].astPtr;
+        STParam *funcRetType = &funcSymb->data.func_data.ret_types[i];
 
         bool strictInferenceState = strictInference;
         strictInference = false;
@@ -462,7 +496,6 @@ bool assignment_inference_list_func_call(ASTNode *node) {
         strictInference = strictInferenceState;
 
         if (leftIdNode->inheritedDataType == CF_BLACK_HOLE) {
-            funcRetType = funcRetType->next;
             continue;
         }
 
@@ -479,8 +512,6 @@ bool assignment_inference_list_func_call(ASTNode *node) {
         } else if (leftIdNode->inheritedDataType != CF_UNKNOWN && funcRetType->type == CF_UNKNOWN) {
             funcRetType->type = leftIdNode->inheritedDataType;
         } // if both are unknown, move on
-
-        funcRetType = funcRetType->next;
     }
 
     node->inheritedDataType = CF_NIL;
@@ -611,14 +642,14 @@ bool func_call_inference_semantic_checks(ASTNode *node) {
     node->inheritedDataType = leftFuncIdNode->inheritedDataType;
 
     if (rightFuncParamsNode != NULL && rightFuncParamsNode->actionType == AST_LIST) {
-        STParam *par = funcData->params;
         for (unsigned i = 0; i < rightFuncParamsNode->dataCount; i++) {
-            if (par == NULL) {
+            if (i >= funcData->params_count) {
                 print_error(COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                             "Too many arguments in function '%s' call.\n", funcSymbol->identifier);
                 ast_uninferrable(node);
             }
 
+            STParam *par = &funcData->params[i];
             ASTNode *parAst = rightFuncParamsNode->data[i].astPtr;
             if (!ast_infer_node_type(parAst)) {
                 print_error(COMPILER_RESULT_ERROR_TYPE_INCOMPATIBILITY_IN_EXPRESSION,
@@ -642,11 +673,9 @@ bool func_call_inference_semantic_checks(ASTNode *node) {
                     ast_uninferrable(node);
                 }
             }
-
-            par = par->next;
         }
 
-        if (par != NULL) {
+        if (rightFuncParamsNode->dataCount < funcData->params_count) {
             print_error(COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                         "Not enough arguments in function '%s' call.\n", funcSymbol->identifier);
             ast_uninferrable(node);
@@ -654,7 +683,7 @@ bool func_call_inference_semantic_checks(ASTNode *node) {
 
         return true;
     } else {
-        STParam *par = funcData->params;
+        STParam *par = funcData->params_count > 0 ? &funcData->params[0] : NULL;
 
         if (rightFuncParamsNode == NULL && par == NULL) {
             // Call has no arguments, function expects none
@@ -675,7 +704,7 @@ bool func_call_inference_semantic_checks(ASTNode *node) {
             ast_uninferrable(node);
         }
 
-        if (par != NULL && par->next != NULL) {
+        if (funcData->params_count > 1) {
             // Call has one argument, function has more
             print_error(COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                         "Unexpected number of arguments in function '%s' call.\n", funcSymbol->identifier);
@@ -70,6 +70,9 @@ typedef struct ast_node {
     struct ast_node *right;
 
     bool hasInnerFuncCalls;
+    bool divisorNonZero; // AST_DIVIDE only: the divisor was proven not to be zero, so no check is generated.
+    bool divisorChecked; // AST_DIVIDE only: the divisor only became a zero constant by transforming the code,
+                         // so it's left to the runtime check instead of being reported.
     unsigned dataCount;
     unsigned dataPointerIndex;
     ASTNodeData data[];
@@ -90,13 +93,18 @@ typedef enum ast_error {
 
 // Holds the current error state. The "no error" state is guaranteed to be a zero,
 // so an error check may be performed using `if (cf_error)`.
-extern ASTError ast_error;
+// The state is kept per thread, as ASTs of different functions may be optimised in parallel.
+#ifdef __cplusplus
+extern thread_local ASTError ast_error;
+#else
+extern _Thread_local ASTError ast_error;
+#endif
 
 // Allocates and returns a new empty AST node.
 // Does NOT run type inference.
 ASTNode *ast_node(ASTNodeType nodeType);
 
-// Clears memory allocated by ASTNode
+// Clears memory allocated by ASTNode and drops the references of the variables it reads.
 void clean_ast(ASTNode *node);
 
 // Checks whether an AST has no effect.
@@ -211,6 +219,7 @@ bool ast_infer_node_type(ASTNode *node);
 
 // Turns strict inference on or off. When strict inference is on, CF_UNKNOWN inference result is considered erroneous.
 // This is used in the second pass of semantic checks, when all function definitions are available.
+// The state is kept per thread (see ast_error).
 void ast_set_strict_inference_state(bool state);
 
 ASTDataType ast_data_type_for_node_type(ASTNodeType nodeType);
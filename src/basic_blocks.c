@@ -0,0 +1,458 @@
+/** @file basic_blocks.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the lowering of functions to basic blocks, construction of dominator trees and loop detection.
+ */
+
+#include <stdlib.h>
+#include "basic_blocks.h"
+#include "stderr_message.h"
+#include "transform.h"
+
+static BBBlock *bb_new_block(BBGraph *graph) {
+    if (!tf_reserve((void **) &graph->blocks, &graph->blocksCapacity, graph->blocksCount, sizeof(BBBlock *))) {
+        return NULL;
+    }
+
+    BBBlock *block = calloc(1, sizeof(BBBlock));
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->id = graph->blocksCount;
+    block->rpoIndex = BB_UNREACHABLE;
+    graph->blocks[graph->blocksCount++] = block;
+    return block;
+}
+
+static bool bb_add_instruction(BBBlock *block, CFStatement *stat, CFASTTarget target, ASTNode **ast) {
+    if (!tf_reserve((void **) &block->instructions, &block->instructionsCapacity, block->instructionsCount,
+                    sizeof(BBInstruction))) {
+        return false;
+    }
+
+    block->instructions[block->instructionsCount++] = (BBInstruction) {.statement = stat, .target = target, .ast = ast};
+    return true;
+}
+
+static bool bb_add_edge(BBBlock *from, BBBlock *to) {
+    if (!tf_reserve((void **) &to->predecessors, &to->predecessorsCapacity, to->predecessorsCount,
+                    sizeof(BBBlock *))) {
+        return false;
+    }
+
+    from->successors[from->successorsCount++] = to;
+    to->predecessors[to->predecessorsCount++] = from;
+    return true;
+}
+
+// Lowers a list of statements, starting in the current block.
+// Returns the block the control flow continues in after the last statement, NULL if memory couldn't be allocated.
+static BBBlock *bb_lower_statements(BBGraph *graph, CFStatement *stat, BBBlock *current) {
+    for (; stat != NULL && current != NULL; stat = stat->followingStatement) {
+        if (is_statement_empty(stat)) {
+            continue;
+        }
+
+        switch (stat->statementType) {
+            case CF_BASIC:
+                if (stat->data.bodyAst != NULL
+                    && !bb_add_instruction(current, stat, CF_STATEMENT_BODY, &stat->data.bodyAst)) {
+                    return NULL;
+                }
+                break;
+            case CF_RETURN:
+                if (!bb_add_instruction(current, stat, CF_RETURN_LIST, &stat->data.bodyAst)
+                    || !bb_add_edge(current, graph->exit)) {
+                    return NULL;
+                }
+                // Anything following the return can't be reached
+                current = bb_new_block(graph);
+                break;
+            case CF_IF: {
+                CFStatementIf *ifData = stat->data.ifData;
+                if (!bb_add_instruction(current, stat, CF_IF_CONDITIONAL, &ifData->conditionalAst)) {
+                    return NULL;
+                }
+
+                BBBlock *thenBlock = bb_new_block(graph);
+                BBBlock *joinBlock = bb_new_block(graph);
+                if (thenBlock == NULL || joinBlock == NULL || !bb_add_edge(current, thenBlock)) {
+                    return NULL;
+                }
+
+                BBBlock *thenEnd = bb_lower_statements(graph, ifData->thenStatement, thenBlock);
+                if (thenEnd == NULL) {
+                    return NULL;
+                }
+
+                if (!is_statement_empty(ifData->elseStatement)) {
+                    BBBlock *elseBlock = bb_new_block(graph);
+                    if (elseBlock == NULL || !bb_add_edge(current, elseBlock)) {
+                        return NULL;
+                    }
+
+                    BBBlock *elseEnd = bb_lower_statements(graph, ifData->elseStatement, elseBlock);
+                    if (elseEnd == NULL || !bb_add_edge(thenEnd, joinBlock) || !bb_add_edge(elseEnd, joinBlock)) {
+                        return NULL;
+                    }
+                } else if (!bb_add_edge(current, joinBlock) || !bb_add_edge(thenEnd, joinBlock)) {
+                    return NULL;
+                }
+
+                current = joinBlock;
+                break;
+            }
+            case CF_FOR: {
+                CFStatementFor *forData = stat->data.forData;
+                if (forData->definitionAst != NULL
+                    && !bb_add_instruction(current, stat, CF_FOR_DEFINITION, &forData->definitionAst)) {
+                    return NULL;
+                }
+
+                BBBlock *header = bb_new_block(graph);
+                BBBlock *body = bb_new_block(graph);
+                BBBlock *after = bb_new_block(graph);
+                if (header == NULL || body == NULL || after == NULL || !bb_add_edge(current, header)
+                    || !bb_add_instruction(header, stat, CF_FOR_CONDITIONAL, &forData->conditionalAst)
+                    || !bb_add_edge(header, body) || !bb_add_edge(header, after)) {
+                    return NULL;
+                }
+
+                BBBlock *bodyEnd = bb_lower_statements(graph, forData->bodyStatement, body);
+                if (bodyEnd == NULL) {
+                    return NULL;
+                }
+                if (forData->afterthoughtAst != NULL
+                    && !bb_add_instruction(bodyEnd, stat, CF_FOR_AFTERTHOUGHT, &forData->afterthoughtAst)) {
+                    return NULL;
+                }
+                if (!bb_add_edge(bodyEnd, header)) {
+                    return NULL;
+                }
+
+                current = after;
+                break;
+            }
+        }
+    }
+
+    return current;
+}
+
+// Numbers the blocks reachable from the entry block in reverse postorder, using an explicit DFS stack.
+static bool bb_compute_rpo(BBGraph *graph) {
+    BBBlock **stack = malloc(graph->blocksCount * sizeof(BBBlock *));
+    unsigned *nextSuccessor = calloc(graph->blocksCount, sizeof(unsigned));
+    bool *visited = calloc(graph->blocksCount, sizeof(bool));
+    BBBlock **postorder = malloc(graph->blocksCount * sizeof(BBBlock *));
+    if (stack == NULL || nextSuccessor == NULL || visited == NULL || postorder == NULL) {
+        free(stack);
+        free(nextSuccessor);
+        free(visited);
+        free(postorder);
+        return false;
+    }
+
+    unsigned top = 0;
+    unsigned count = 0;
+    stack[top++] = graph->entry;
+    visited[graph->entry->id] = true;
+
+    while (top > 0) {
+        BBBlock *block = stack[top - 1];
+        if (nextSuccessor[block->id] < block->successorsCount) {
+            BBBlock *succ = block->successors[nextSuccessor[block->id]++];
+            if (!visited[succ->id]) {
+                visited[succ->id] = true;
+                stack[top++] = succ;
+            }
+        } else {
+            postorder[count++] = block;
+            top--;
+        }
+    }
+
+    // Reverse the postorder in place
+    for (unsigned i = 0; i < count / 2; i++) {
+        BBBlock *tmp = postorder[i];
+        postorder[i] = postorder[count - i - 1];
+        postorder[count - i - 1] = tmp;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        postorder[i]->rpoIndex = i;
+    }
+
+    graph->reversePostorder = postorder;
+    graph->reachableCount = count;
+    free(stack);
+    free(nextSuccessor);
+    free(visited);
+    return true;
+}
+
+// Finds the nearest common dominator of two blocks with already known dominators.
+static BBBlock *bb_intersect(BBBlock *a, BBBlock *b) {
+    while (a != b) {
+        while (a->rpoIndex > b->rpoIndex) {
+            a = a->idom;
+        }
+        while (b->rpoIndex > a->rpoIndex) {
+            b = b->idom;
+        }
+    }
+    return a;
+}
+
+// Computes the immediate dominators using "A Simple, Fast Dominance Algorithm" by Cooper, Harvey and Kennedy,
+// then links the dominator tree and numbers it so that dominance can be checked in constant time.
+static bool bb_compute_dominators(BBGraph *graph) {
+    BBBlock *entry = graph->entry;
+    entry->idom = entry;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned i = 1; i < graph->reachableCount; i++) {
+            BBBlock *block = graph->reversePostorder[i];
+            BBBlock *newIdom = NULL;
+            for (unsigned p = 0; p < block->predecessorsCount; p++) {
+                BBBlock *pred = block->predecessors[p];
+                if (pred->idom == NULL) {
+                    // Not processed yet or unreachable
+                    continue;
+                }
+                newIdom = newIdom == NULL ? pred : bb_intersect(pred, newIdom);
+            }
+            if (block->idom != newIdom) {
+                block->idom = newIdom;
+                changed = true;
+            }
+        }
+    }
+    entry->idom = NULL;
+
+    // Link the children in reverse so that they end up in reverse postorder
+    for (unsigned i = graph->reachableCount; i-- > 1;) {
+        BBBlock *block = graph->reversePostorder[i];
+        block->domSibling = block->idom->domChild;
+        block->idom->domChild = block;
+    }
+
+    BBBlock **stack = malloc(graph->reachableCount * sizeof(BBBlock *));
+    BBBlock **nextChild = malloc(graph->blocksCount * sizeof(BBBlock *));
+    if (stack == NULL || nextChild == NULL) {
+        free(stack);
+        free(nextChild);
+        return false;
+    }
+
+    // Preorder and postorder numbers of the dominator tree: a dominates b iff b's interval is nested in a's
+    unsigned top = 0;
+    unsigned preCounter = 0;
+    unsigned postCounter = 0;
+    stack[top++] = entry;
+    entry->domPre = preCounter++;
+    nextChild[entry->id] = entry->domChild;
+    while (top > 0) {
+        BBBlock *block = stack[top - 1];
+        BBBlock *child = nextChild[block->id];
+        if (child != NULL) {
+            nextChild[block->id] = child->domSibling;
+            child->domPre = preCounter++;
+            nextChild[child->id] = child->domChild;
+            stack[top++] = child;
+        } else {
+            block->domPost = postCounter++;
+            top--;
+        }
+    }
+
+    free(stack);
+    free(nextChild);
+    return true;
+}
+
+static bool bb_loop_add_block(BBLoop *loop, BBBlock *block) {
+    if (!tf_reserve((void **) &loop->blocks, &loop->blocksCapacity, loop->blocksCount, sizeof(BBBlock *))) {
+        return false;
+    }
+    loop->blocks[loop->blocksCount++] = block;
+    return true;
+}
+
+// Builds the natural loop of the header from all its back edges.
+static BBLoop *bb_make_loop(BBGraph *graph, BBBlock *header, bool *inLoop, BBBlock **stack) {
+    BBLoop *loop = calloc(1, sizeof(BBLoop));
+    if (loop == NULL || !tf_reserve((void **) &graph->loops, &graph->loopsCapacity, graph->loopsCount,
+                                    sizeof(BBLoop *))) {
+        free(loop);
+        return NULL;
+    }
+    graph->loops[graph->loopsCount++] = loop;
+
+    loop->header = header;
+    // Outer loops are processed first, so the header still belongs to the loop enclosing this one
+    loop->parent = header->loop;
+    loop->depth = loop->parent == NULL ? 1 : loop->parent->depth + 1;
+
+    // The loop condition is the last instruction of the header
+    if (header->instructionsCount > 0
+        && header->instructions[header->instructionsCount - 1].target == CF_FOR_CONDITIONAL) {
+        loop->statement = header->instructions[header->instructionsCount - 1].statement;
+    }
+
+    // Walk backwards from the sources of the back edges, the header stops the walk
+    unsigned top = 0;
+    inLoop[header->id] = true;
+    if (!bb_loop_add_block(loop, header)) {
+        return NULL;
+    }
+    for (unsigned p = 0; p < header->predecessorsCount; p++) {
+        BBBlock *pred = header->predecessors[p];
+        if (bb_dominates(header, pred) && !inLoop[pred->id]) {
+            inLoop[pred->id] = true;
+            stack[top++] = pred;
+        }
+    }
+    while (top > 0) {
+        BBBlock *block = stack[--top];
+        if (!bb_loop_add_block(loop, block)) {
+            return NULL;
+        }
+        for (unsigned p = 0; p < block->predecessorsCount; p++) {
+            BBBlock *pred = block->predecessors[p];
+            if (bb_is_reachable(pred) && !inLoop[pred->id]) {
+                inLoop[pred->id] = true;
+                stack[top++] = pred;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < loop->blocksCount; i++) {
+        loop->blocks[i]->loop = loop;
+        inLoop[loop->blocks[i]->id] = false;
+    }
+
+    // The preheader is the only predecessor from outside of the loop, if it has no other successor
+    for (unsigned p = 0; p < header->predecessorsCount; p++) {
+        BBBlock *pred = header->predecessors[p];
+        if (bb_is_reachable(pred) && !bb_dominates(header, pred)) {
+            if (loop->preheader != NULL) {
+                loop->preheader = NULL;
+                break;
+            }
+            loop->preheader = pred;
+        }
+    }
+    if (loop->preheader != NULL && loop->preheader->successorsCount != 1) {
+        loop->preheader = NULL;
+    }
+
+    return loop;
+}
+
+// Finds the natural loops. Headers are visited in reverse postorder, so outer loops are found before inner ones
+// and the innermost loop is the last one assigned to a block.
+static bool bb_compute_loops(BBGraph *graph) {
+    bool *inLoop = calloc(graph->blocksCount, sizeof(bool));
+    BBBlock **stack = malloc(graph->blocksCount * sizeof(BBBlock *));
+    if (inLoop == NULL || stack == NULL) {
+        free(inLoop);
+        free(stack);
+        return false;
+    }
+
+    bool success = true;
+    for (unsigned i = 0; i < graph->reachableCount && success; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        for (unsigned p = 0; p < block->predecessorsCount; p++) {
+            if (bb_dominates(block, block->predecessors[p])) {
+                success = bb_make_loop(graph, block, inLoop, stack) != NULL;
+                break;
+            }
+        }
+    }
+
+    free(inLoop);
+    free(stack);
+    return success;
+}
+
+BBGraph *bb_build(CFFunction *function) {
+    BBGraph *graph = calloc(1, sizeof(BBGraph));
+    if (graph == NULL) {
+        stderr_message("basic_blocks", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return NULL;
+    }
+    graph->function = function;
+
+    graph->entry = bb_new_block(graph);
+    graph->exit = bb_new_block(graph);
+    if (graph->entry == NULL || graph->exit == NULL) {
+        bb_free(graph);
+        stderr_message("basic_blocks", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return NULL;
+    }
+
+    // The end of the function body returns implicitly
+    BBBlock *end = bb_lower_statements(graph, function->rootStatement, graph->entry);
+    if (end == NULL || !bb_add_edge(end, graph->exit) || !bb_compute_rpo(graph) || !bb_compute_dominators(graph)
+        || !bb_compute_loops(graph)) {
+        bb_free(graph);
+        stderr_message("basic_blocks", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return NULL;
+    }
+
+    return graph;
+}
+
+void bb_free(BBGraph *graph) {
+    if (graph == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < graph->blocksCount; i++) {
+        free(graph->blocks[i]->instructions);
+        free(graph->blocks[i]->predecessors);
+        free(graph->blocks[i]);
+    }
+    for (unsigned i = 0; i < graph->loopsCount; i++) {
+        free(graph->loops[i]->blocks);
+        free(graph->loops[i]);
+    }
+    free(graph->blocks);
+    free(graph->reversePostorder);
+    free(graph->loops);
+    free(graph);
+}
+
+bool bb_dominates(const BBBlock *a, const BBBlock *b) {
+    if (!bb_is_reachable(a) || !bb_is_reachable(b)) {
+        return false;
+    }
+    return a->domPre <= b->domPre && b->domPost <= a->domPost;
+}
+
+bool bb_is_reachable(const BBBlock *block) {
+    return block->rpoIndex != BB_UNREACHABLE;
+}
+
+bool bb_loop_contains(const BBLoop *loop, const BBBlock *block) {
+    for (const BBLoop *l = block->loop; l != NULL; l = l->parent) {
+        if (l == loop) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BBLoop *bb_find_loop(const BBGraph *graph, const CFStatement *forStatement) {
+    for (unsigned i = 0; i < graph->loopsCount; i++) {
+        if (graph->loops[i]->statement == forStatement) {
+            return graph->loops[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,113 @@
+/** @file basic_blocks.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions and data types for the basic block representation of functions,
+ *        their dominator trees and loops.
+ */
+
+#ifndef _BASIC_BLOCKS_H
+#define _BASIC_BLOCKS_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+// Reverse postorder index of blocks that can't be reached from the entry block.
+#define BB_UNREACHABLE ((unsigned) -1)
+
+struct bb_loop;
+
+// A single step of a basic block: one of the ASTs of a statement.
+// The AST is referenced through the slot of the statement that holds it, so that passes may replace it.
+typedef struct bb_instruction {
+    CFStatement *statement;
+    CFASTTarget target; // Which of the statement's ASTs this is.
+    ASTNode **ast;
+} BBInstruction;
+
+typedef struct bb_block {
+    unsigned id; // Index of the block in BBGraph.blocks.
+
+    BBInstruction *instructions;
+    unsigned instructionsCount;
+    unsigned instructionsCapacity;
+
+    struct bb_block **predecessors;
+    unsigned predecessorsCount;
+    unsigned predecessorsCapacity;
+
+    // A block ending with an IF or FOR condition has two successors: [0] is taken when the condition holds,
+    // [1] when it doesn't. Other blocks have at most one successor.
+    struct bb_block *successors[2];
+    unsigned successorsCount;
+
+    unsigned rpoIndex; // Position in the reverse postorder or BB_UNREACHABLE.
+
+    // Dominator tree
+    struct bb_block *idom;       // Immediate dominator, NULL for the entry block and unreachable blocks.
+    struct bb_block *domChild;   // First block immediately dominated by this block.
+    struct bb_block *domSibling; // Next block with the same immediate dominator.
+    unsigned domPre;             // Preorder number in the dominator tree.
+    unsigned domPost;            // Postorder number in the dominator tree.
+
+    struct bb_loop *loop; // The innermost loop containing the block, NULL if it's not in a loop.
+} BBBlock;
+
+typedef struct bb_loop {
+    BBBlock *header;          // The block evaluating the loop condition, it dominates the whole loop.
+    BBBlock *preheader;       // The only block entering the loop from outside, NULL if there isn't a single one.
+    CFStatement *statement;   // The FOR statement the loop comes from.
+    struct bb_loop *parent;   // The innermost loop containing this loop, NULL for outermost loops.
+    unsigned depth;           // Nesting depth, 1 for outermost loops.
+
+    BBBlock **blocks;         // Blocks of the loop (including the header), in no particular order.
+    unsigned blocksCount;
+    unsigned blocksCapacity;
+} BBLoop;
+
+typedef struct bb_graph {
+    CFFunction *function;
+
+    BBBlock **blocks; // All blocks, in the order of their creation.
+    unsigned blocksCount;
+    unsigned blocksCapacity;
+
+    BBBlock *entry; // The block the function starts in.
+    BBBlock *exit;  // An empty block all returns (and the end of the function body) lead to.
+
+    BBBlock **reversePostorder; // Blocks reachable from the entry block, in reverse postorder.
+    unsigned reachableCount;
+
+    BBLoop **loops; // Loops ordered so that each loop follows the loops containing it.
+    unsigned loopsCount;
+    unsigned loopsCapacity;
+} BBGraph;
+
+/* Lowers the statement tree of a function to basic blocks and analyses them.
+ *  - Each statement's ASTs become instructions: the body of a basic statement, the return list, the IF condition
+ *    and the FOR definition, condition and afterthought. Empty statements are skipped, as they don't generate code.
+ *  - An IF condition ends its block; the block continues to the THEN branch and to the ELSE branch (or after the IF).
+ *  - The FOR definition ends the loop preheader; the condition makes up the loop header, which continues to the body
+ *    and after the loop. The afterthought ends the body and jumps back to the header.
+ *  - A return jumps to the exit block; statements following it are placed to an unreachable block.
+ * Then computes the reverse postorder, the dominator tree (using the Cooper–Harvey–Kennedy algorithm) and natural loops.
+ * Returns NULL if memory couldn't be allocated.
+ */
+BBGraph *bb_build(CFFunction *function);
+
+// Frees the graph. The statements and ASTs it refers to are not affected.
+void bb_free(BBGraph *graph);
+
+// Checks whether block a dominates block b (every block dominates itself). False if either of them is unreachable.
+bool bb_dominates(const BBBlock *a, const BBBlock *b);
+
+// Checks whether the block can be reached from the entry block.
+bool bb_is_reachable(const BBBlock *block);
+
+// Checks whether the block belongs to the loop (or to a loop nested in it).
+bool bb_loop_contains(const BBLoop *loop, const BBBlock *block);
+
+// Returns the loop the specified FOR statement was lowered to, NULL if there's no such loop.
+BBLoop *bb_find_loop(const BBGraph *graph, const CFStatement *forStatement);
+
+#endif // _BASIC_BLOCKS_H
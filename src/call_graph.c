@@ -0,0 +1,217 @@
+/** @file call_graph.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the call graph of the program.
+ */
+
+#include <stdlib.h>
+#include "call_graph.h"
+#include "transform.h"
+
+/** State of Tarjan's algorithm finding the strongly connected components of the graph. */
+typedef struct cg_tarjan {
+    CallGraph *graph;
+    unsigned *discovery; /**< Discovery time of each node, counted from 1 (0 if it hasn't been visited). */
+    unsigned *lowLink;
+    unsigned *stack;
+    unsigned stackCount;
+    bool *onStack;
+    unsigned time;
+    unsigned ordered;
+} CGTarjan;
+
+/** @brief Adds the callee to the node (once), returns false if memory couldn't be allocated. */
+static bool cg_add_callee(CGNode *node, unsigned callee) {
+    for (unsigned i = 0; i < node->calleesCount; i++) {
+        if (node->callees[i] == callee) {
+            return true;
+        }
+    }
+
+    if (!tf_reserve((void **) &node->callees, &node->calleesCapacity, node->calleesCount, sizeof(unsigned))) {
+        return false;
+    }
+    node->callees[node->calleesCount++] = callee;
+    return true;
+}
+
+/** @brief Adds the calls in the AST to the node of its function. */
+static bool cg_add_ast_calls(CallGraph *graph, CGNode *node, const ASTNode *ast) {
+    if (ast == NULL) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!cg_add_ast_calls(graph, node, ast->data[i].astPtr)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (ast->actionType == AST_FUNC_CALL) {
+        CGNode *callee = cg_find(graph, ast->left->data[0].symbolTableItemPtr->data.func_data.cf_function);
+        if (callee != NULL) {
+            callee->callSites++;
+            if (!cg_add_callee(node, (unsigned) (callee - graph->nodes))) {
+                return false;
+            }
+        }
+        return cg_add_ast_calls(graph, node, ast->right);
+    }
+    return cg_add_ast_calls(graph, node, ast->left) && cg_add_ast_calls(graph, node, ast->right);
+}
+
+/** @brief Adds the calls in the statement chain to the node of its function. */
+static bool cg_add_statement_calls(CallGraph *graph, CGNode *node, const CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        bool added = true;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                added = cg_add_ast_calls(graph, node, stat->data.bodyAst);
+                break;
+            case CF_IF:
+                added = cg_add_ast_calls(graph, node, stat->data.ifData->conditionalAst)
+                        && cg_add_statement_calls(graph, node, stat->data.ifData->thenStatement)
+                        && cg_add_statement_calls(graph, node, stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                added = cg_add_ast_calls(graph, node, stat->data.forData->definitionAst)
+                        && cg_add_ast_calls(graph, node, stat->data.forData->conditionalAst)
+                        && cg_add_ast_calls(graph, node, stat->data.forData->afterthoughtAst)
+                        && cg_add_statement_calls(graph, node, stat->data.forData->bodyStatement);
+                break;
+        }
+        if (!added) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @brief Visits the node in Tarjan's algorithm. Its component is added to the order once it's complete,
+ *         which happens after the components of all the nodes it calls. */
+static void cg_strong_connect(CGTarjan *tarjan, unsigned index) {
+    CallGraph *graph = tarjan->graph;
+    CGNode *node = &graph->nodes[index];
+    tarjan->discovery[index] = tarjan->lowLink[index] = ++tarjan->time;
+    tarjan->stack[tarjan->stackCount++] = index;
+    tarjan->onStack[index] = true;
+
+    for (unsigned i = 0; i < node->calleesCount; i++) {
+        unsigned callee = node->callees[i];
+        if (callee == index) {
+            node->recursive = true;
+        }
+        if (tarjan->discovery[callee] == 0) {
+            cg_strong_connect(tarjan, callee);
+            if (tarjan->lowLink[callee] < tarjan->lowLink[index]) {
+                tarjan->lowLink[index] = tarjan->lowLink[callee];
+            }
+        } else if (tarjan->onStack[callee] && tarjan->discovery[callee] < tarjan->lowLink[index]) {
+            tarjan->lowLink[index] = tarjan->discovery[callee];
+        }
+    }
+
+    if (tarjan->lowLink[index] != tarjan->discovery[index]) {
+        return;
+    }
+
+    // The node is the root of a component, which consists of the nodes above it on the stack
+    unsigned first = tarjan->stackCount;
+    do {
+        first--;
+    } while (tarjan->stack[first] != index);
+
+    bool cycle = tarjan->stackCount - first > 1;
+    for (unsigned i = first; i < tarjan->stackCount; i++) {
+        unsigned member = tarjan->stack[i];
+        tarjan->onStack[member] = false;
+        graph->nodes[member].recursive |= cycle;
+        graph->order[tarjan->ordered++] = member;
+    }
+    tarjan->stackCount = first;
+}
+
+/** @brief Orders the nodes bottom-up and finds the recursive functions. */
+static bool cg_order(CallGraph *graph) {
+    if (graph->count == 0) {
+        return true;
+    }
+
+    CGTarjan tarjan = {.graph = graph};
+    tarjan.discovery = calloc(graph->count, sizeof(unsigned));
+    tarjan.lowLink = calloc(graph->count, sizeof(unsigned));
+    tarjan.stack = calloc(graph->count, sizeof(unsigned));
+    tarjan.onStack = calloc(graph->count, sizeof(bool));
+
+    bool ordered = tarjan.discovery != NULL && tarjan.lowLink != NULL && tarjan.stack != NULL
+                   && tarjan.onStack != NULL;
+    for (unsigned i = 0; ordered && i < graph->count; i++) {
+        if (tarjan.discovery[i] == 0) {
+            cg_strong_connect(&tarjan, i);
+        }
+    }
+
+    free(tarjan.discovery);
+    free(tarjan.lowLink);
+    free(tarjan.stack);
+    free(tarjan.onStack);
+    return ordered;
+}
+
+bool cg_build(CFProgram *program, CallGraph *graph) {
+    graph->count = program->functionsCount;
+    graph->nodes = calloc(graph->count, sizeof(CGNode));
+    graph->order = calloc(graph->count, sizeof(unsigned));
+    im_init(&graph->indices);
+    if (graph->count > 0 && (graph->nodes == NULL || graph->order == NULL)) {
+        cg_free(graph);
+        return false;
+    }
+
+    for (unsigned i = 0; i < graph->count; i++) {
+        graph->nodes[i].function = program->functions[i];
+        if (!im_insert(&graph->indices, program->functions[i], i)) {
+            cg_free(graph);
+            return false;
+        }
+    }
+
+    for (unsigned i = 0; i < graph->count; i++) {
+        if (!cg_add_statement_calls(graph, &graph->nodes[i], graph->nodes[i].function->rootStatement)) {
+            cg_free(graph);
+            return false;
+        }
+    }
+
+    if (!cg_order(graph)) {
+        cg_free(graph);
+        return false;
+    }
+    return true;
+}
+
+CGNode *cg_find(const CallGraph *graph, const CFFunction *function) {
+    unsigned index;
+    if (function == NULL || !im_find(&graph->indices, function, &index)) {
+        return NULL;
+    }
+    return &graph->nodes[index];
+}
+
+void cg_free(CallGraph *graph) {
+    if (graph->nodes != NULL) {
+        for (unsigned i = 0; i < graph->count; i++) {
+            free(graph->nodes[i].callees);
+        }
+    }
+    free(graph->nodes);
+    free(graph->order);
+    im_free(&graph->indices);
+    graph->nodes = NULL;
+    graph->order = NULL;
+    graph->count = 0;
+}
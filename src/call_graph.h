@@ -0,0 +1,44 @@
+/** @file call_graph.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions and data types for the call graph of the program, used by
+ *        the interprocedural optimisations.
+ */
+
+#ifndef _CALL_GRAPH_H
+#define _CALL_GRAPH_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+#include "index_map.h"
+
+/** A function of the program and the functions it calls. */
+typedef struct cg_node {
+    CFFunction *function;
+    unsigned *callees;        /**< Indices of the called functions, each one only once. */
+    unsigned calleesCount;
+    unsigned calleesCapacity;
+    unsigned callSites;       /**< Number of calls of the function in the program. */
+    bool recursive;           /**< Whether the function may call itself (directly or through other functions). */
+} CGNode;
+
+/** The call graph of the program. Calls of built-in functions aren't included. */
+typedef struct call_graph {
+    CGNode *nodes;   /**< Nodes in the order of the functions of the program. */
+    unsigned count;
+    unsigned *order; /**< Indices of the nodes ordered bottom-up: the callees before their callers, except for
+                      *   the calls between mutually recursive functions. */
+    IndexMap indices; /**< Indices of the nodes of the functions. */
+} CallGraph;
+
+/** @brief Builds the call graph of the program. Returns false if memory couldn't be allocated. */
+bool cg_build(CFProgram *program, CallGraph *graph);
+
+/** @brief Returns the node of the function, NULL if it isn't in the graph. */
+CGNode *cg_find(const CallGraph *graph, const CFFunction *function);
+
+/** @brief Destroys the call graph. */
+void cg_free(CallGraph *graph);
+
+#endif // _CALL_GRAPH_H
@@ -15,19 +15,22 @@
 #include "mutable_string.h"
 #include "symtable.h"
 #include "stacks.h"
+#include "call_graph.h"
 
 #define TCG_DEBUG 1
 #define UINT_DIGITS 21
 
-#define out_s(s) puts((s))
-#define out(...) printf(__VA_ARGS__); putchar('\n')
-#define out_nnl(...) printf(__VA_ARGS__)
-#define out_nl() putchar('\n')
+// The output is disabled while generating the functions that are never called, see tcg_generate()
+#define out_s(s) do { if (outputEnabled) puts((s)); } while (0)
+#define out(...) do { if (outputEnabled) { printf(__VA_ARGS__); putchar('\n'); } } while (0)
+#define out_nnl(...) do { if (outputEnabled) printf(__VA_ARGS__); } while (0)
+#define out_nl() do { if (outputEnabled) putchar('\n'); } while (0)
 
 #define is_direct_ast(ast) ((ast)->actionType > AST_VALUE)
 
 #if TCG_DEBUG
-#define dbg(msg, ...) printf("# --> "); printf((msg),##__VA_ARGS__); putchar('\n'); fflush(stdout)
+#define dbg(msg, ...) do { if (outputEnabled) { printf("# --> "); printf((msg),##__VA_ARGS__); putchar('\n'); \
+                            fflush(stdout); } } while (0)
 #else
 #define dbg(msg, ...)
 #endif
@@ -49,9 +52,7 @@ struct {
 
     bool isMain;
     bool generateMainAsFunction;
-    bool isInBranch;
     bool terminated;
-    bool terminatedInBranch;
 
     SymtableStack stStack;
 } currentFunction;
@@ -74,6 +75,9 @@ struct {
 } symbs;
 
 bool onlyFindDefinedSymbols = false;
+bool outputEnabled = true;
+
+TCGStats tcgStats;
 
 void generate_statement(CFStatement *stat);
 
@@ -339,7 +343,7 @@ void generate_internal_len(ASTNode *argAst) {
     } else {
         generate_expression_ast_result(argAst);
         out("POPS %s", REG_1);
-        out_nnl("STRLEN %s %s", REG_1, REG_1);
+        out("STRLEN %s %s", REG_1, REG_1);
         out("PUSHS %s", REG_1);
     }
 }
@@ -622,7 +626,7 @@ void generate_func_call(ASTNode *funcCallAst) {
     }
 
     STSymbol *targetFuncSymb = funcCallAst->left->data[0].symbolTableItemPtr;
-    CFFunction *targetFunc = cf_get_function(targetFuncSymb->identifier, false);
+    CFFunction *targetFunc = targetFuncSymb->data.func_data.cf_function;
     dbg("Generating func call to '%s'", targetFuncSymb->identifier);
 
     ASTNode *argAstList = funcCallAst->right;
@@ -656,38 +660,32 @@ void generate_func_call(ASTNode *funcCallAst) {
             onlyFindDefinedSymbols = false;
 
             out("CREATEFRAME");
-            STParam *argN = targetFuncSymb->data.func_data.params;
-            while (argN != NULL) {
-                MutableString varName = make_var_name(argN->id, true);
+            STFunctionData *funcData = &targetFuncSymb->data.func_data;
+            for (unsigned i = 0; i < funcData->params_count; i++) {
+                MutableString varName = make_var_name(funcData->params[i].id, true);
 
                 out("DEFVAR %s", mstr_content(&varName));
                 out("POPS %s", mstr_content(&varName));
 
                 mstr_free(&varName);
-
-                argN = argN->next;
             }
         } else {
             // No inner func calls, this is one of the inner-most calls
             // Evaluate arguments normally
 
             out("CREATEFRAME");
-            STParam *argN = targetFuncSymb->data.func_data.params;
-            ASTNodeData *argContainer = argAstList->data;
+            STFunctionData *funcData = &targetFuncSymb->data.func_data;
 
             // Setting this flag here is ok, because make_var_name doesn't perform scope lookup for TF vars
             onlyFindDefinedSymbols = true;
-            while (argN != NULL) {
-                MutableString varName = make_var_name(argN->id, true);
+            for (unsigned i = 0; i < funcData->params_count; i++) {
+                MutableString varName = make_var_name(funcData->params[i].id, true);
 
-                ASTNode *argData = argContainer->astPtr;
+                ASTNode *argData = argAstList->data[i].astPtr;
                 out("DEFVAR %s", mstr_content(&varName));
                 generate_assignment_for_varname(mstr_content(&varName), argData);
 
                 mstr_free(&varName);
-
-                argN = argN->next;
-                argContainer++;
             }
             onlyFindDefinedSymbols = false;
         }
@@ -733,17 +731,23 @@ void generate_expression_ast(ASTNode *exprAst) {
         out("MULS");
             break;
         case AST_DIVIDE:
-            symbs.divUsed = true;
-
-            if (exprAst->right->actionType == AST_ID) {
-                out_nnl("JUMPIFEQ $$zero_div %s ", exprAst->inheritedDataType == CF_INT ? "int@0" : "float@0x0p+0");
-                print_var_name(exprAst->right);
-                out_nl();
-            } else {
-                out("POPS %s", REG_1);
-                out("JUMPIFEQ $$zero_div %s %s", REG_1,
-                    exprAst->inheritedDataType == CF_INT ? "int@0" : "float@0x0p+0");
-                out("PUSHS %s", REG_1);
+            // Divisors proven not to be zero by the optimiser and non-zero constants aren't checked
+            if (!exprAst->divisorNonZero && !(exprAst->right->actionType == AST_CONST_INT
+                                              && exprAst->right->data[0].intConstantValue != 0)
+                && !(exprAst->right->actionType == AST_CONST_FLOAT
+                     && exprAst->right->data[0].floatConstantValue != 0)) {
+                symbs.divUsed = true;
+                if (exprAst->right->actionType == AST_ID) {
+                    out_nnl("JUMPIFEQ $$zero_div %s ",
+                            exprAst->inheritedDataType == CF_INT ? "int@0" : "float@0x0p+0");
+                    print_var_name(exprAst->right);
+                    out_nl();
+                } else {
+                    out("POPS %s", REG_1);
+                    out("JUMPIFEQ $$zero_div %s %s", REG_1,
+                        exprAst->inheritedDataType == CF_INT ? "int@0" : "float@0x0p+0");
+                    out("PUSHS %s", REG_1);
+                }
             }
 
             if (exprAst->inheritedDataType == CF_INT) {
@@ -1097,10 +1101,17 @@ bool generate_logic_expression_assignment(ASTNode *exprAst, const char *targetVa
     return true;
 }
 
+// Checks whether the node can be used directly as an operand of an instruction (it's a CONST or an ID).
+bool is_simple_operand(ASTNode *node) {
+    return node->actionType == AST_ID || node->actionType == AST_CONST_INT || node->actionType == AST_CONST_FLOAT
+           || node->actionType == AST_CONST_BOOL || node->actionType == AST_CONST_STRING;
+}
+
 // Evaluates the *value AST and generates an instruction to move the result into variable *varName.
 // *varName must contain a target variable name (e.g. LF@var).
 // When *varName is NULL, generates an assignment into REG_1 (GF@$r1).
 // Optimisation: when the *value AST is a constant or an ID, generates a MOVE instead of evaluating the constant on stack.
+// Arithmetic on two constants or IDs generates a single ADD, SUB or MUL instruction.
 void generate_assignment_for_varname(const char *varName, ASTNode *value) {
     if (varName == NULL) {
         if (value->actionType >= AST_LOGIC && value->actionType < AST_CONTROL) {
@@ -1136,6 +1147,21 @@ void generate_assignment_for_varname(const char *varName, ASTNode *value) {
             print_var_name(value);
             out_nl();
             break;
+        case AST_ADD:
+        case AST_SUBTRACT:
+        case AST_MULTIPLY:
+            if (value->inheritedDataType != CF_STRING && is_simple_operand(value->left)
+                && is_simple_operand(value->right)) {
+                // Both operands are CONSTs or IDs, use the three-address instruction instead of the stack
+                out_nnl("%s %s ", value->actionType == AST_ADD ? "ADD"
+                                  : value->actionType == AST_SUBTRACT ? "SUB" : "MUL", varName);
+                print_var_name_or_const(value->left);
+                out_nnl(" ");
+                print_var_name_or_const(value->right);
+                out_nl();
+                break;
+            }
+            // fall through
         default:
             if (value->actionType >= AST_LOGIC && value->actionType < AST_CONTROL) {
                 generate_logic_expression_assignment(value, varName);
@@ -1217,12 +1243,16 @@ void generate_multi_assignment(ASTNode *asgAst) {
                 continue;
             }
 
+            // The values may only read the variables defined before, not the ones this statement defines
+            // (the flag is reset by the calls, so it's set for each value)
+            onlyFindDefinedSymbols = true;
             if (valNode->actionType >= AST_LOGIC && valNode->actionType < AST_CONTROL) {
                 generate_logic_expression_assignment(valNode, NULL);
             } else {
                 generate_expression_ast_result(valNode);
             }
         }
+        onlyFindDefinedSymbols = false;
 
         for (unsigned i = 0; i < asgAst->left->dataCount; i++) {
             unsigned currentVarIndex = asgAst->left->dataCount - i - 1;
@@ -1298,6 +1328,213 @@ void generate_assignment(ASTNode *asgAst) {
     }
 }
 
+// Generates a MOVE of the zero value of the variable's type into the variable *varName (a named return value).
+void generate_zero_value(const char *varName, STSymbol *symb) {
+    switch (symb->data.var_data.type) {
+        case CF_INT:
+        out("MOVE %s int@0", varName);
+            break;
+        case CF_FLOAT:
+        out("MOVE %s float@%a", varName, 0.0);
+            break;
+        case CF_STRING:
+        out("MOVE %s string@", varName);
+            break;
+        case CF_BOOL:
+        out("MOVE %s bool@false", varName);
+            break;
+        default:
+            stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                           "Unexpected return value '%s' type.\n", symb->identifier);
+            break;
+    }
+}
+
+// Checks whether the return statement returns the result of a call of the current function unchanged
+// (return f(...) in function f). Such call is generated as a jump to the beginning of the function's body.
+bool is_tail_self_call(ASTNode *retAstList) {
+    if (currentFunction.isMain || retAstList == NULL || retAstList->actionType != AST_LIST
+        || retAstList->dataCount != 1) {
+        return false;
+    }
+
+    ASTNode *call = retAstList->data[0].astPtr;
+    if (call == NULL || call->actionType != AST_FUNC_CALL || call->left == NULL) {
+        return false;
+    }
+
+    STSymbol *funcSymb = call->left->data[0].symbolTableItemPtr;
+    if (funcSymb->data.func_data.cf_function != currentFunction.function
+        || currentFunction.function->returnValuesCount != 1) {
+        return false;
+    }
+
+    unsigned argCount = call->right == NULL ? 0 : call->right->dataCount;
+    return argCount == funcSymb->data.func_data.params_count;
+}
+
+// Recursively checks whether the statements contain a return statement with a tail self-call.
+bool has_tail_self_call(CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        if (is_statement_empty(stat)) {
+            continue;
+        }
+
+        switch (stat->statementType) {
+            case CF_RETURN:
+                if (is_tail_self_call(stat->data.bodyAst)) {
+                    return true;
+                }
+                break;
+            case CF_IF:
+                if (has_tail_self_call(stat->data.ifData->thenStatement)
+                    || has_tail_self_call(stat->data.ifData->elseStatement)) {
+                    return true;
+                }
+                break;
+            case CF_FOR:
+                if (has_tail_self_call(stat->data.forData->bodyStatement)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return false;
+}
+
+// Checks whether the AST reads the variable.
+bool reads_variable(ASTNode *ast, STSymbol *variable) {
+    if (ast == NULL) {
+        return false;
+    }
+
+    if (ast->actionType == AST_ID) {
+        return ast->data[0].symbolTableItemPtr == variable;
+    }
+
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (reads_variable(ast->data[i].astPtr, variable)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    return reads_variable(ast->left, variable) || reads_variable(ast->right, variable);
+}
+
+// Generates a call of the current function in tail position. Instead of creating a new frame, the arguments
+// are assigned to the parameters and the body of the function is entered again by a jump.
+// The parameters are assigned directly, in an order in which no argument reads a parameter that has already been
+// overwritten (arguments that are the parameter itself are skipped). If there's no such order (e.g. f(b, a))
+// or an argument contains a function call, the arguments are evaluated on stack first.
+void generate_tail_self_call(ASTNode *funcCallAst) {
+    CFFunction *fun = currentFunction.function;
+    STFunctionData *funcData = &funcCallAst->left->data[0].symbolTableItemPtr->data.func_data;
+    ASTNode *argAstList = funcCallAst->right;
+    unsigned count = funcData->params_count;
+    dbg("Generating tail call to '%s'", fun->name);
+
+    STSymbol **params = calloc(count, sizeof(STSymbol *));
+    unsigned *order = calloc(count, sizeof(unsigned));
+    bool *assigned = calloc(count, sizeof(bool));
+    if (count > 0 && (params == NULL || order == NULL || assigned == NULL)) {
+        free(params);
+        free(order);
+        free(assigned);
+        stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return;
+    }
+
+    // The parameters are always in the top-level symtable of the function
+    bool direct = !funcCallAst->hasInnerFuncCalls;
+    unsigned ordered = 0;
+    for (unsigned i = 0; i < count; i++) {
+        STItem *it = symtable_find(fun->symbolTable, funcData->params[i].id);
+        params[i] = it == NULL ? NULL : &it->data;
+        ASTNode *argData = argAstList->data[i].astPtr;
+
+        if (params[i] == NULL) {
+            direct = false;
+        } else if (argData->actionType == AST_ID && argData->data[0].symbolTableItemPtr == params[i]) {
+            // The parameter keeps its value
+            assigned[i] = true;
+        }
+    }
+
+    // Find an order of the assignments, each parameter is assigned after all the other arguments reading it
+    bool progress = direct;
+    while (progress) {
+        progress = false;
+        for (unsigned i = 0; i < count; i++) {
+            if (assigned[i]) {
+                continue;
+            }
+
+            bool read = false;
+            for (unsigned j = 0; j < count && !read; j++) {
+                read = j != i && !assigned[j] && reads_variable(argAstList->data[j].astPtr, params[i]);
+            }
+
+            if (!read) {
+                assigned[i] = true;
+                order[ordered++] = i;
+                progress = true;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < count && direct; i++) {
+        direct = assigned[i];
+    }
+
+    if (direct) {
+        for (unsigned i = 0; i < ordered; i++) {
+            MutableString varName;
+            mstr_make(&varName, 2, "LF@$1_", funcData->params[order[i]].id);
+            generate_assignment_for_varname(mstr_content(&varName), argAstList->data[order[i]].astPtr);
+            mstr_free(&varName);
+        }
+    } else {
+        // Evaluate the arguments on stack in last-to-first order and pop them into the parameters
+        for (unsigned i = count; i > 0; i--) {
+            ASTNode *argData = argAstList->data[i - 1].astPtr;
+
+            if (argData->actionType >= AST_LOGIC && argData->actionType < AST_CONTROL) {
+                generate_logic_expression_assignment(argData, NULL);
+            } else {
+                generate_expression_ast_result(argData);
+            }
+        }
+
+        for (unsigned i = 0; i < count; i++) {
+            out("POPS LF@$1_%s", funcData->params[i].id);
+        }
+    }
+
+    free(params);
+    free(order);
+    free(assigned);
+
+    // The named return values start with zero values in each call
+    for (unsigned i = 0; i < fun->returnValuesCount && fun->returnValues[0].name != NULL; i++) {
+        STItem *it = symtable_find(fun->symbolTable, fun->returnValues[i].name);
+        if (it != NULL && it->data.reference_counter > 0) {
+            MutableString varName;
+            mstr_make(&varName, 2, "LF@$1_", fun->returnValues[i].name);
+            generate_zero_value(mstr_content(&varName), &it->data);
+            mstr_free(&varName);
+        }
+    }
+
+    out("JUMP $%s_body", fun->name);
+    tcgStats.tailCalls++;
+}
+
 // Generates a return statement. All CF_RETURN statements must have an AST_LIST as their body,
 // passing NULL is considered equal to passing an AST_LIST with no data. (This is used when generating implict returns.)
 void generate_return_statement(ASTNode *retAstList) {
@@ -1315,8 +1552,8 @@ void generate_return_statement(ASTNode *retAstList) {
         return;
     }
 
-    bool hasNamedReturnValues = currentFunction.function->returnValues != NULL
-                                && currentFunction.function->returnValues->variable.name != NULL;
+    bool hasNamedReturnValues = currentFunction.function->returnValuesCount > 0
+                                && currentFunction.function->returnValues[0].name != NULL;
 
     if (currentFunction.function->returnValuesCount == 0) {
         // Function should have no return values, this statement has some values
@@ -1353,7 +1590,8 @@ void generate_return_statement(ASTNode *retAstList) {
         }
     }
 
-    CFVarListNode *argNode = currentFunction.function->returnValues;
+    CFVariable *returnValues = currentFunction.function->returnValues;
+    bool tailCall = is_tail_self_call(retAstList);
     if (retAstList != NULL && retAstList->dataCount > 0) {
         // Evaluate return values ASTs on stack
         // The first return value will be generated last (it will be on top of stack)
@@ -1368,51 +1606,75 @@ void generate_return_statement(ASTNode *retAstList) {
                 return;
             }
 
-            if (ast->inheritedDataType != argNode->variable.dataType) {
+            if (ast->inheritedDataType != returnValues[retAstList->dataCount - i - 1].dataType) {
                 stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                "Function '%s': Invalid return value type (return value on index %u).\n",
                                currentFunction.function->name, retAstList->dataCount - i - 1);
                 return;
             }
 
-            if (ast->actionType >= AST_LOGIC && ast->actionType < AST_CONTROL) {
+            if (tailCall) {
+                generate_tail_self_call(ast);
+            } else if (ast->actionType >= AST_LOGIC && ast->actionType < AST_CONTROL) {
                 generate_logic_expression_assignment(ast, NULL);
             } else {
                 generate_expression_ast_result(ast);
             }
-
-            argNode = argNode->next;
         }
     } else {
         // The function has named return values, so they're local variables -> push their values on stack
-        for (unsigned i = 0; i < currentFunction.function->returnValuesCount; i++) {
+        for (unsigned i = currentFunction.function->returnValuesCount; i > 0; i--) {
             out_nnl("PUSHS ");
-            print_var_name_id(argNode->variable.name);
+            print_var_name_id(returnValues[i - 1].name);
             out_nl();
-
-            argNode = argNode->next;
         }
     }
 
-    // Delete the local frame
-    out("POPFRAME");
-    out("RETURN");
+    // Delete the local frame (a tail call has jumped to the beginning of the function instead)
+    if (!tailCall) {
+        out("POPFRAME");
+        out("RETURN");
+    }
 
-    // Set the flags signalising that current function has had a return statement and whether
-    // it's been found in a branched statement. If a return statement has been found before in a branch
-    // and this one is not, set the terminatedInBranch flag back to false. This is used to determine
-    // whether an implicit return should be generated at the end of the function (to make sure the interpret
-    // will always return from the function).
-    if (!currentFunction.terminated) {
-        currentFunction.terminated = true;
-        currentFunction.terminatedInBranch = currentFunction.isInBranch;
-    } else {
-        if (currentFunction.terminatedInBranch && !currentFunction.isInBranch) {
-            currentFunction.terminatedInBranch = false;
+    // Set the flag signalising that current function has had a return statement
+    currentFunction.terminated = true;
+}
+
+bool statements_terminate(CFStatement *first);
+
+// Checks whether the execution never continues after the statement: it's a return statement, an IF whose both
+// branches terminate or an infinite FOR loop (the language has no break statement).
+bool statement_terminates(CFStatement *stat) {
+    if (is_statement_empty(stat)) {
+        return false;
+    }
+
+    switch (stat->statementType) {
+        case CF_RETURN:
+            return true;
+        case CF_IF:
+            return statements_terminate(stat->data.ifData->thenStatement)
+                   && statements_terminate(stat->data.ifData->elseStatement);
+        case CF_FOR: {
+            ASTNode *condition = stat->data.forData->conditionalAst;
+            return condition == NULL
+                   || (condition->actionType == AST_CONST_BOOL && condition->data[0].boolConstantValue);
         }
+        default:
+            return false;
     }
 }
 
+// Checks whether the execution never continues after the chain of statements: one of them terminates.
+bool statements_terminate(CFStatement *first) {
+    for (CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        if (statement_terminates(stat)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Generates a statement of CF_IF type, recursively generates the bodies of its THEN and ELSE blocks.
 // Increases the current function's IF-counter.
 void generate_if_statement(CFStatement *stat) {
@@ -1440,13 +1702,13 @@ void generate_if_statement(CFStatement *stat) {
     // If this IF statement doesn't have an ELSE block, jump directly to its end when the conditional expression is false
     mstr_make(&falseLabelStr, 5, "$", stat->parentFunction->name, "_if", i, hasElse ? "_else" : "_end");
 
-    generate_logic_expression_tree(stat->data.ifData->conditionalAst, mstr_content(&trueLabelStr),
-                                   mstr_content(&falseLabelStr));
+    // The THEN block follows the condition, so there's nothing to jump over when it's always true (the optimiser
+    // leaves such IFs behind when it removes a dead ELSE branch)
+    ASTNode *condition = stat->data.ifData->conditionalAst;
+    if (condition->actionType != AST_CONST_BOOL || !condition->data[0].boolConstantValue) {
+        generate_logic_expression_tree(condition, mstr_content(&trueLabelStr), mstr_content(&falseLabelStr));
+    }
 
-    // Backup the current state of the flag specifying whether we're inside of a branch
-    // and set it to true. (Used in return statements.)
-    bool originalBranchState = currentFunction.isInBranch;
-    currentFunction.isInBranch = true;
     out("LABEL %s", mstr_content(&trueLabelStr));
 
     // Push the THEN statement's symbol table, generate the statement (recursively) and pop the table.
@@ -1455,15 +1717,15 @@ void generate_if_statement(CFStatement *stat) {
     symtable_stack_pop(&currentFunction.stStack);
 
     if (hasElse) {
-        out("JUMP $%s_if%i_end", stat->parentFunction->name, counter);
+        if (!statements_terminate(stat->data.ifData->thenStatement)) {
+            out("JUMP $%s_if%i_end", stat->parentFunction->name, counter);
+        }
         out("LABEL %s", mstr_content(&falseLabelStr));
         symtable_stack_push(&currentFunction.stStack, stat->data.ifData->elseStatement->localSymbolTable);
         generate_statement(stat->data.ifData->elseStatement);
         symtable_stack_pop(&currentFunction.stStack);
     }
 
-    currentFunction.isInBranch = originalBranchState;
-
     out("LABEL $%s_if%i_end", stat->parentFunction->name, counter);
 
     mstr_free(&trueLabelStr);
@@ -1512,17 +1774,10 @@ void generate_for_statement(CFStatement *stat) {
         mstr_free(&falseLabelStr);
     }
 
-    // Backup the current state of the flag specifying whether we're inside of a branch
-    // and set it to true. (Used in return statements.)
-    bool originalBranchState = currentFunction.isInBranch;
-    currentFunction.isInBranch = true;
-
     // The FOR body has another symbol table, push it.
     symtable_stack_push(&currentFunction.stStack, stat->data.forData->bodyStatement->localSymbolTable);
     generate_statement(stat->data.forData->bodyStatement);
     symtable_stack_pop(&currentFunction.stStack);
-    currentFunction.isInBranch = originalBranchState;
-
     if (stat->data.forData->afterthoughtAst != NULL) {
         ast_infer_node_type(stat->data.forData->afterthoughtAst);
         generate_assignment(stat->data.forData->afterthoughtAst);
@@ -1591,7 +1846,18 @@ void generate_statement(CFStatement *stat) {
         }
     }
 
-    if (stat->followingStatement != NULL) {
+    if (stat->followingStatement != NULL && outputEnabled && statement_terminates(stat)) {
+        // The following statements are unreachable, they're only checked with the output disabled
+        dbg("Omitting unreachable statements");
+        for (CFStatement *next = stat->followingStatement; next != NULL; next = next->followingStatement) {
+            tcgStats.unreachableStatements += !is_statement_empty(next);
+        }
+        bool divUsed = symbs.divUsed;
+        outputEnabled = false;
+        generate_statement(stat->followingStatement);
+        outputEnabled = true;
+        symbs.divUsed = divUsed;
+    } else if (stat->followingStatement != NULL) {
         generate_statement(stat->followingStatement);
     }
 }
@@ -1617,24 +1883,7 @@ void generate_definitions(CFStatement *stat) {
                         out("DEFVAR %s", varNameP);
 
                         if (symb->data.var_data.is_return_val_variable) {
-                            switch (symb->data.var_data.type) {
-                                case CF_INT:
-                                out("MOVE %s int@0", varNameP);
-                                    break;
-                                case CF_FLOAT:
-                                out("MOVE %s float@%a", varNameP, 0.0);
-                                    break;
-                                case CF_STRING:
-                                out("MOVE %s string@", varNameP);
-                                    break;
-                                case CF_BOOL:
-                                out("MOVE %s bool@false", varNameP);
-                                    break;
-                                default:
-                                    stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
-                                                   "Unexpected return value '%s' type.\n", symb->identifier);
-                                    break;
-                            }
+                            generate_zero_value(varNameP, symb);
                         }
 
                         mstr_free(&varName);
@@ -1663,20 +1912,10 @@ void generate_definitions(CFStatement *stat) {
 void generate_function(CFFunction *fun) {
     dbg("Function '%s'", fun->name);
 
-    struct cfgraph_program_structure *prog = get_program();
-    STItem *funcSymbol = symtable_find(prog->globalSymtable, fun->name);
-    if (funcSymbol->data.reference_counter == 0) {
-        dbg("Function not used");
-        stderr_message("codegen", WARNING, COMPILER_RESULT_SUCCESS, "Function '%s' is not used anywhere.\n",
-                       fun->name);
-        // An unused function generation may not be omitted, because codegen might be the on running certain semantic checks (if optimisation is off).
-        // return;
-    }
-
     if (is_statement_empty(fun->rootStatement)) {
         stderr_message("codegen", WARNING, COMPILER_RESULT_SUCCESS, "Function '%s' is empty.\n", fun->name);
 
-        if (fun->returnValuesCount > 0 && fun->returnValues->variable.name == NULL) {
+        if (fun->returnValuesCount > 0 && fun->returnValues[0].name == NULL) {
             stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                            "Empty function with parameters is missing a return statement.\n");
             return;
@@ -1692,8 +1931,6 @@ void generate_function(CFFunction *fun) {
     currentFunction.scopeCounter = 1;
     currentFunction.jumpingExprCounter = 0;
     currentFunction.ifCounter = 0;
-    currentFunction.isInBranch = false;
-    currentFunction.terminatedInBranch = false;
     currentFunction.terminated = false;
 
     symtable_stack_push(&currentFunction.stStack, fun->symbolTable);
@@ -1709,34 +1946,40 @@ void generate_function(CFFunction *fun) {
     out("PUSHFRAME");
 
     generate_definitions(fun->rootStatement);
+
+    // Tail calls of the function jump here after assigning the parameters
+    if (has_tail_self_call(fun->rootStatement)) {
+        out("LABEL $%s_body", fun->name);
+    }
+
     generate_statement(fun->rootStatement);
 
-    // Return from the function will be generated from the first RETURN statement.
-    // If it hasn't been generated, we must generate it explicitly.
-    if (!currentFunction.terminated) {
+    // Return from the function is generated by its RETURN statements. If the end of the function is reachable,
+    // it must return there too (the interpret would continue executing the following function).
+    if (!statements_terminate(fun->rootStatement)) {
         if (fun->returnValuesCount == 0) {
             generate_return_statement(NULL);
-        } else {
+        } else if (!currentFunction.terminated) {
+            // A function with results (named or not) must return them explicitly
             stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                            "Function '%s' is missing a return statement.\n", fun->name);
             return;
-        }
-    }
-
-    // If all return statements were found in branches (inside IFs or FORs), the terminated flag will be set to true,
-    // but there would still not be a return statement generated at the end of the function and the interpret would
-    // continue executing the following function. To prevent this, generate an implicit return statement with default
-    // return values. This might be redundant in many cases and might be improved significantly by implementing a better
-    // static analysis of code branches.
-    if (currentFunction.terminatedInBranch) {
-        if (fun->returnValuesCount != 0 && fun->returnValues->variable.name == NULL) {
+        } else if (fun->returnValues[0].name != NULL) {
+            // All the return statements were found in branches (inside IFs or FORs) and some path doesn't
+            // reach any of them, return the named return values there.
+            stderr_message("codegen", WARNING, COMPILER_RESULT_SUCCESS,
+                           "Function '%s' has no return statements outside branches. Generated a return statement with the named return values.\n",
+                           fun->name);
+            generate_return_statement(NULL);
+        } else {
+            // All the return statements were found in branches (inside IFs or FORs) and some path doesn't
+            // reach any of them, generate an implicit return statement with default return values.
             stderr_message("codegen", WARNING, COMPILER_RESULT_SUCCESS,
                            "Function '%s' has no return statements outside branches. Generated a return statement with default values.\n",
                            fun->name);
 
-            CFVarListNode *n = fun->returnValues;
-            while (n != NULL) {
-                switch (n->variable.dataType) {
+            for (unsigned i = fun->returnValuesCount; i > 0; i--) {
+                switch (fun->returnValues[i - 1].dataType) {
                     case CF_BOOL:
                     out("PUSHS bool@false");
                         break;
@@ -1752,18 +1995,61 @@ void generate_function(CFFunction *fun) {
                     default:
                         break;
                 }
-                n = n->next;
             }
-        }
 
-        out("POPFRAME");
-        out("RETURN");
+            out("POPFRAME");
+            out("RETURN");
+        }
     }
 
     dbg("Function '%s' end", fun->name);
 }
 
+// Finds the functions that may be called from main (directly or through other functions) using the call graph,
+// stores whether main itself is called by one of them. If the graph can't be built, all the functions are kept.
+// Returns NULL if memory couldn't be allocated.
+bool *find_reachable_functions(CFProgram *prog, bool *mainCalled) {
+    bool *reachable = calloc(prog->functionsCount + 1, sizeof(bool));
+    unsigned *stack = calloc(prog->functionsCount + 1, sizeof(unsigned));
+    CallGraph graph;
+    if (reachable == NULL || stack == NULL || !cg_build(prog, &graph)) {
+        free(stack);
+        if (reachable != NULL) {
+            for (unsigned i = 0; i < prog->functionsCount; i++) {
+                reachable[i] = true;
+            }
+        }
+        STItem *mainSym = symtable_find(prog->globalSymtable, "main");
+        *mainCalled = mainSym->data.reference_counter > 1;
+        return reachable;
+    }
+
+    // Depth-first search from main, so that dead groups of functions calling each other aren't reached
+    unsigned main = cg_find(&graph, prog->mainFunc) - graph.nodes;
+    unsigned stackCount = 0;
+    reachable[main] = true;
+    stack[stackCount++] = main;
+    *mainCalled = false;
+    while (stackCount > 0) {
+        CGNode *node = &graph.nodes[stack[--stackCount]];
+        for (unsigned i = 0; i < node->calleesCount; i++) {
+            unsigned callee = node->callees[i];
+            *mainCalled = *mainCalled || callee == main;
+            if (!reachable[callee]) {
+                reachable[callee] = true;
+                stack[stackCount++] = callee;
+            }
+        }
+    }
+
+    cg_free(&graph);
+    free(stack);
+    return reachable;
+}
+
 void tcg_generate() {
+    tcgStats = (TCGStats) {0};
+
     if (cf_error) {
         stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
                        "Target code generator called on an erroneous CFG (error code %i).\n", cf_error);
@@ -1780,7 +2066,6 @@ void tcg_generate() {
     ast_set_strict_inference_state(true);
 
     CFProgram *prog = get_program();
-    CFFuncListNode *n = prog->functionList;
 
     STItem *mainSym = symtable_find(prog->globalSymtable, "main");
     if (prog->mainFunc == NULL || mainSym == NULL) {
@@ -1791,7 +2076,16 @@ void tcg_generate() {
 
     // When main is called from the code, it must be generated as a function (ended using POPFRAME/RETURN);
     // otherwise, it can be ended using EXIT directly.
-    bool generateMainAsFunc = mainSym->data.reference_counter > 1;
+    bool generateMainAsFunc = false;
+    bool *reachable = find_reachable_functions(prog, &generateMainAsFunc);
+    if (reachable == NULL) {
+        stderr_message("codegen", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return;
+    }
+    unsigned firstReachable = 0;
+    while (!reachable[firstReachable]) {
+        firstReachable++;
+    }
 
     out(".IFJcode20");
 
@@ -1816,26 +2110,44 @@ void tcg_generate() {
         out("CREATEFRAME");
         out("CALL main");
         out("EXIT int@0");
-    } else if (&n->fun != prog->mainFunc) {
+    } else if (prog->functions[firstReachable] != prog->mainFunc) {
         out("JUMP main");
     }
 
-    while (n != NULL) {
-        currentFunction.isMain = &n->fun == prog->mainFunc;
+    for (unsigned i = 0; i < prog->functionsCount; i++) {
+        CFFunction *fun = prog->functions[i];
+        currentFunction.isMain = fun == prog->mainFunc;
         currentFunction.generateMainAsFunction = generateMainAsFunc;
 
-        generate_function(&n->fun);
+        // The functions main never calls are omitted from the output. They must still be generated,
+        // because the code generator runs some of the semantic checks.
+        bool divUsed = symbs.divUsed;
+        outputEnabled = reachable[i];
+        generate_function(fun);
+        outputEnabled = true;
+        if (!reachable[i]) {
+            symbs.divUsed = divUsed;
+            tcgStats.droppedFunctions++;
+        }
 
         // This should alawys only pop one ST, the function's top-level one
         while (currentFunction.stStack.top != NULL) {
             symtable_stack_pop(&currentFunction.stStack);
         }
-
-        n = n->next;
     }
 
     if (symbs.divUsed) {
         out("LABEL $$zero_div");
         out("EXIT int@9");
     }
+
+    if (tcgStats.droppedFunctions > 0) {
+        stderr_message("codegen", WARNING, COMPILER_RESULT_SUCCESS,
+                       "Omitted %u function(s) not reachable from main.\n", tcgStats.droppedFunctions);
+    }
+    free(reachable);
+}
+
+const TCGStats *tcg_get_stats() {
+    return &tcgStats;
 }
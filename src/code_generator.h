@@ -12,6 +12,17 @@
 
 #include "control_flow.h"
 
+// Statistics of the last code generation.
+typedef struct tcg_stats {
+    unsigned droppedFunctions; // Number of functions not reachable from main that were omitted from the output.
+    unsigned tailCalls; // Number of recursive calls in tail position generated as jumps.
+    unsigned unreachableStatements; // Number of statements following a return (or a terminating statement) omitted.
+} TCGStats;
+
+// Generates the target code of the program. Only the functions that may be called from main are emitted.
 void tcg_generate();
 
+// Returns the statistics of the last tcg_generate() call.
+const TCGStats *tcg_get_stats();
+
 #endif // _CODE_GENERATOR_H
@@ -8,7 +8,11 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include "compiler.h"
+#include "stderr_message.h"
 #include "parser.h"
 #include "optimiser.h"
 #include "control_flow.h"
@@ -16,6 +20,9 @@
 
 CompilerResult compiler_result = COMPILER_RESULT_SUCCESS;
 
+// Whether the statistics of the passes should be printed after the compilation.
+static bool printPassStats = false;
+
 int get_char_internal(int *feofi, int *ferrori) {
     int res = getchar();
     *feofi = feof(stdin);
@@ -24,13 +31,145 @@ int get_char_internal(int *feofi, int *ferrori) {
     return res;
 }
 
-int main() {
+// Maximum number of optimiser threads accepted by the -j option.
+#define MAX_JOBS 256
+// Maximum loop unswitching budget accepted by the -s option.
+#define MAX_UNSWITCH_BUDGET 100000
+// Maximum loop unrolling budget accepted by the -u option.
+#define MAX_UNROLL_BUDGET 100000
+// Maximum function specialisation budget accepted by the -c option.
+#define MAX_CLONE_BUDGET 100000
+// Maximum compile-time evaluation budget accepted by the -e option.
+#define MAX_EVALUATION_BUDGET 100000000
+
+// Parses the number given to the option at the index as -xN or -x N, moving the index past it.
+// Returns false if it's missing or it's not a number between min and max.
+static bool parse_number_option(int argc, char *argv[], int *index, long min, long max, long *number) {
+    const char *option = argv[*index];
+    const char *value = option[2] != '\0' ? option + 2 : (*index + 1 < argc ? argv[++*index] : NULL);
+    char *end = NULL;
+    *number = value != NULL ? strtol(value, &end, 10) : 0;
+    return value != NULL && *value != '\0' && *end == '\0' && *number >= min && *number <= max;
+}
+
+// Parses the command line options. Returns false if they're invalid.
+static bool parse_arguments(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        long number;
+        if (strcmp(argv[i], "-O0") == 0) {
+            // -O0, -O1, -O2 or -Os: optimisation level, enables its set of passes (the later options override it)
+            optimiser_set_level(OPTIMISER_LEVEL_NONE);
+        } else if (strcmp(argv[i], "-O1") == 0) {
+            optimiser_set_level(OPTIMISER_LEVEL_BASIC);
+        } else if (strcmp(argv[i], "-O2") == 0) {
+            optimiser_set_level(OPTIMISER_LEVEL_FULL);
+        } else if (strcmp(argv[i], "-Os") == 0) {
+            optimiser_set_level(OPTIMISER_LEVEL_SIZE);
+        } else if (strncmp(argv[i], "-f", 2) == 0) {
+            // -fNAME or -fno-NAME: enables or disables the optimiser pass
+            bool enabled = strncmp(argv[i], "-fno-", 5) != 0;
+            const char *name = argv[i] + (enabled ? 2 : 5);
+            if (!optimiser_set_pass_enabled(name, enabled)) {
+                stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Unknown optimiser pass '%s'.\n",
+                               name);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--pass-stats") == 0) {
+            // --pass-stats: prints the statistics of the passes to stderr
+            printPassStats = true;
+        } else if (strncmp(argv[i], "-j", 2) == 0) {
+            // -j N or -jN: number of threads used by the optimiser
+            if (!parse_number_option(argc, argv, &i, 1, MAX_JOBS, &number)) {
+                stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                               "Option -j expects a number of jobs between 1 and %d.\n", MAX_JOBS);
+                return false;
+            }
+            optimiser_set_jobs((unsigned) number);
+        } else if (strncmp(argv[i], "-s", 2) == 0) {
+            // -s N or -sN: maximum size of the loop copies created by unswitching (in AST nodes), 0 disables it
+            if (!parse_number_option(argc, argv, &i, 0, MAX_UNSWITCH_BUDGET, &number)) {
+                stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                               "Option -s expects a loop unswitching budget between 0 and %d.\n", MAX_UNSWITCH_BUDGET);
+                return false;
+            }
+            optimiser_set_unswitch_budget((unsigned) number);
+        } else if (strncmp(argv[i], "-u", 2) == 0) {
+            // -u N or -uN: maximum size of the unrolled loops (in AST nodes), 0 disables the unrolling
+            if (!parse_number_option(argc, argv, &i, 0, MAX_UNROLL_BUDGET, &number)) {
+                stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                               "Option -u expects a loop unrolling budget between 0 and %d.\n", MAX_UNROLL_BUDGET);
+                return false;
+            }
+            optimiser_set_unroll_budget((unsigned) number);
+        } else if (strncmp(argv[i], "-c", 2) == 0) {
+            // -c N or -cN: maximum size of the functions specialised for constant arguments (in AST nodes)
+            if (!parse_number_option(argc, argv, &i, 0, MAX_CLONE_BUDGET, &number)) {
+                stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                               "Option -c expects a function specialisation budget between 0 and %d.\n",
+                               MAX_CLONE_BUDGET);
+                return false;
+            }
+            optimiser_set_clone_budget((unsigned) number);
+        } else if (strncmp(argv[i], "-e", 2) == 0) {
+            // -e N or -eN: maximum number of steps of the compile-time evaluation of calls, 0 disables it
+            if (!parse_number_option(argc, argv, &i, 0, MAX_EVALUATION_BUDGET, &number)) {
+                stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                               "Option -e expects a compile-time evaluation budget between 0 and %d.\n",
+                               MAX_EVALUATION_BUDGET);
+                return false;
+            }
+            optimiser_set_evaluation_budget((unsigned long) number);
+        } else {
+            stderr_message("compiler", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Unknown option '%s'.\n", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Prints the statistics of the optimiser passes and the times of the compilation phases to stderr.
+static void print_pass_stats(const double phaseSeconds[3]) {
+    const OptimiserStats *stats = optimiser_get_stats();
+    fprintf(stderr, "%-10s %8s %10s %10s %10s\n", "pass", "runs", "visited", "rewritten", "time [ms]");
+    for (unsigned i = 0; i < OPTIMISER_PASS_COUNT; i++) {
+        const OptimiserPassStats *pass = &stats->passes[i];
+        fprintf(stderr, "%-10s %8lu %10lu %10lu %10.3f\n", optimiser_pass_name((OptimiserPass) i), pass->runs,
+                pass->visitedNodes, pass->rewrittenNodes, pass->seconds * 1000);
+    }
+
+    fprintf(stderr, "fold: %lu rounds of constant propagation, %lu foldings stopped at the cap of %d rounds\n",
+            stats->propagationRounds, stats->roundCapHits, OPTIMISER_MAX_ROUNDS);
+
+    const TCGStats *tcgStats = tcg_get_stats();
+    fprintf(stderr, "codegen: %u tail calls, %u unreachable statements, %u dropped functions\n",
+            tcgStats->tailCalls, tcgStats->unreachableStatements, tcgStats->droppedFunctions);
+    fprintf(stderr, "phases [ms]: parse %.3f, optimise %.3f, generate %.3f\n", phaseSeconds[0] * 1000,
+            phaseSeconds[1] * 1000, phaseSeconds[2] * 1000);
+}
+
+int main(int argc, char *argv[]) {
+    if (!parse_arguments(argc, argv)) {
+        return compiler_result;
+    }
+
+    // The times of parsing, optimisation and code generation
+    double phaseSeconds[3] = {0, 0, 0};
+    double start = optimiser_current_time();
     parser_parse();
+    phaseSeconds[0] = optimiser_current_time() - start;
     if (compiler_result == COMPILER_RESULT_SUCCESS) {
+        start = optimiser_current_time();
         optimiser_optimise();
+        phaseSeconds[1] = optimiser_current_time() - start;
     }
     if (compiler_result == COMPILER_RESULT_SUCCESS) {
+        start = optimiser_current_time();
         tcg_generate();
+        phaseSeconds[2] = optimiser_current_time() - start;
+    }
+    if (printPassStats) {
+        print_pass_stats(phaseSeconds);
     }
 
     cf_clean_all();
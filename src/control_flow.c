@@ -19,6 +19,7 @@
 #define CF_ACT_STAT_CHECK_RN() do { if (activeStat == NULL) { cf_error = CF_ERROR_NO_ACTIVE_STATEMENT; return NULL; } } while(0)
 #define CF_ACT_AST_CHECK() do { if (activeAst == NULL) { cf_error = CF_ERROR_NO_ACTIVE_AST; return; } } while(0)
 #define CF_ACT_AST_CHECK_RN() do { if (activeAst == NULL) { cf_error = CF_ERROR_NO_ACTIVE_AST; return NULL; } } while(0)
+#define CF_VAR_ARRAY_CHUNK 4
 
 extern ASTNode *cf_ast_init(ASTNewNodeTarget target, ASTNodeType type); // NOLINT(readability-redundant-declaration)
 extern ASTNode *cf_ast_init_for_list(ASTNodeType type, int listDataIndex); // NOLINT(readability-redundant-declaration)
@@ -49,33 +50,50 @@ void cf_assign_global_symtable(SymbolTable *symbolTable) {
 }
 
 CFFunction *cf_get_function(const char *name, bool setActive) {
-    CFFuncListNode *n = program->functionList;
-    while (n != NULL) {
-        if (strcmp(n->fun.name, name) == 0) {
-            return &n->fun;
-        }
-        n = n->next;
+    if (program->globalSymtable == NULL) {
+        return NULL;
+    }
+
+    STItem *item = symtable_find(program->globalSymtable, name);
+    if (item == NULL || item->data.type != ST_SYMBOL_FUNC) {
+        return NULL;
     }
 
-    return NULL;
+    CFFunction *fun = item->data.data.func_data.cf_function;
+    if (setActive && fun != NULL) {
+        activeStat = NULL;
+        activeFunc = fun;
+    }
+
+    return fun;
 }
 
 CFFunction *cf_make_function(const char *name) {
-    CFFuncListNode *n = program->functionList;
-    CFFuncListNode *newNode = calloc(1, sizeof(CFFuncListNode));
-    CF_ALLOC_CHECK_RN(newNode);
+    if (program->functionsCount == program->functionsCapacity) {
+        unsigned newCapacity = program->functionsCapacity == 0 ? 8 : program->functionsCapacity * 2;
+        CFFunction **newArray = realloc(program->functions, newCapacity * sizeof(CFFunction *));
+        CF_ALLOC_CHECK_RN(newArray);
 
-    program->functionList = newNode;
-    if (n != NULL) n->previous = newNode;
+        program->functions = newArray;
+        program->functionsCapacity = newCapacity;
+    }
 
-    newNode->next = n;
-    newNode->previous = NULL;
-    CFFunction *newFunctionNode = &newNode->fun;
+    CFFunction *newFunctionNode = calloc(1, sizeof(CFFunction));
+    CF_ALLOC_CHECK_RN(newFunctionNode);
+    program->functions[program->functionsCount++] = newFunctionNode;
 
     newFunctionNode->name = malloc(strlen(name) + 1);
     CF_ALLOC_CHECK_RN(newFunctionNode->name);
     strcpy((char *) newFunctionNode->name, name);
 
+    if (program->globalSymtable != NULL) {
+        STItem *item = symtable_find(program->globalSymtable, name);
+        if (item != NULL && item->data.type == ST_SYMBOL_FUNC) {
+            newFunctionNode->symbol = &item->data;
+            item->data.data.func_data.cf_function = newFunctionNode;
+        }
+    }
+
     if (strcmp(name, "main") == 0) {
         if (program->mainFunc == NULL) {
             program->mainFunc = newFunctionNode;
@@ -91,6 +109,30 @@ CFFunction *cf_make_function(const char *name) {
     return newFunctionNode;
 }
 
+// Appends a variable to an array of variables, growing it by CF_VAR_ARRAY_CHUNK items when it's full.
+// Returns a pointer to the new variable or NULL if the allocation failed.
+static CFVariable *append_variable(CFVariable **array, unsigned *count, const char *name, CFDataType type) {
+    if (*count % CF_VAR_ARRAY_CHUNK == 0) {
+        CFVariable *newArray = realloc(*array, (*count + CF_VAR_ARRAY_CHUNK) * sizeof(CFVariable));
+        if (newArray == NULL) return NULL;
+        *array = newArray;
+    }
+
+    CFVariable *var = &(*array)[*count];
+    if (name == NULL) {
+        var->name = NULL;
+    } else {
+        var->name = malloc(strlen(name) + 1);
+        if (var->name == NULL) return NULL;
+        strcpy((char *) var->name, name);
+    }
+
+    var->dataType = type;
+    var->position = *count;
+    (*count)++;
+    return var;
+}
+
 void cf_add_argument(const char *name, CFDataType type) {
     CF_ACT_FUN_CHECK();
     if (program->mainFunc == activeFunc) {
@@ -98,21 +140,8 @@ void cf_add_argument(const char *name, CFDataType type) {
         return;
     }
 
-    CFVarListNode *n = activeFunc->arguments;
-    CFVarListNode *newNode = malloc(sizeof(CFVarListNode));
-    CF_ALLOC_CHECK(newNode);
-
-    activeFunc->arguments = newNode;
-    if (n != NULL) n->previous = newNode;
-    newNode->next = n;
-    newNode->previous = NULL;
-
-    newNode->variable.name = malloc(strlen(name) + 1);
-    strcpy((char *) newNode->variable.name, name);
-
-    newNode->variable.dataType = type;
-    newNode->variable.position = activeFunc->argumentsCount;
-    activeFunc->argumentsCount++;
+    CFVariable *var = append_variable(&activeFunc->arguments, &activeFunc->argumentsCount, name, type);
+    CF_ALLOC_CHECK(var);
 }
 
 void cf_add_return_value(const char *name, CFDataType type) {
@@ -122,33 +151,16 @@ void cf_add_return_value(const char *name, CFDataType type) {
         return;
     }
 
-    CFVarListNode *n = activeFunc->returnValues;
-
-    if (n != NULL) {
-        if (n->variable.name != NULL && name == NULL || n->variable.name == NULL && name != NULL) {
+    if (activeFunc->returnValuesCount > 0) {
+        const char *firstName = activeFunc->returnValues[0].name;
+        if ((firstName != NULL && name == NULL) || (firstName == NULL && name != NULL)) {
             cf_error = CF_ERROR_RETURN_VALUES_NAMING_MISMATCH;
             return;
         }
     }
 
-    CFVarListNode *newNode = malloc(sizeof(CFVarListNode));
-    CF_ALLOC_CHECK(newNode);
-
-    activeFunc->returnValues = newNode;
-    if (n != NULL) n->previous = newNode;
-    newNode->next = n;
-    newNode->previous = NULL;
-
-    if (name == NULL) {
-        newNode->variable.name = NULL;
-    } else {
-        newNode->variable.name = malloc(strlen(name) + 1);
-        strcpy((char *) newNode->variable.name, name);
-    }
-
-    newNode->variable.dataType = type;
-    newNode->variable.position = activeFunc->returnValuesCount;
-    activeFunc->returnValuesCount++;
+    CFVariable *var = append_variable(&activeFunc->returnValues, &activeFunc->returnValuesCount, name, type);
+    CF_ALLOC_CHECK(var);
 }
 
 CFStatement *cf_make_next_statement(CFStatementType statementType) {
@@ -504,33 +516,31 @@ void clean_stat(CFStatement *stat, SymbolTable *parentTable) {
     free(stat);
 }
 
-static void clean_varlist(CFVarListNode *begin) {
-    while (begin != NULL) {
-        CFVarListNode *next = begin->next;
-        free((void *) begin->variable.name);
-        free(begin);
-        begin = next;
+static void clean_variables(CFVariable *array, unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        free((void *) array[i].name);
     }
+
+    free(array);
 }
 
 void cf_clean_all() {
     if (program == NULL) return;
 
-    CFFuncListNode *n = program->functionList;
-
-    while (n != NULL) {
-        clean_stat(n->fun.rootStatement, n->fun.symbolTable);
-        if (n->fun.symbolTable != NULL) {
-            symtable_free(n->fun.symbolTable);
+    for (unsigned i = 0; i < program->functionsCount; i++) {
+        CFFunction *fun = program->functions[i];
+        clean_stat(fun->rootStatement, fun->symbolTable);
+        if (fun->symbolTable != NULL) {
+            symtable_free(fun->symbolTable);
         }
-        clean_varlist(n->fun.arguments);
-        clean_varlist(n->fun.returnValues);
-        CFFuncListNode *toFree = n;
-        n = n->next;
-        free((void *) toFree->fun.name);
-        free(toFree);
+        clean_variables(fun->arguments, fun->argumentsCount);
+        clean_variables(fun->returnValues, fun->returnValuesCount);
+        free((void *) fun->name);
+        free(fun);
     }
 
+    free(program->functions);
+
     if (program->globalSymtable != NULL) {
         symtable_free(program->globalSymtable);
     }
@@ -63,34 +63,25 @@ typedef struct cfgraph_statement {
     } data;
 } CFStatement;
 
-typedef struct cfgraph_variable_list_node {
-    struct cfgraph_variable_list_node *previous;
-    struct cfgraph_variable_list_node *next;
-    CFVariable variable;
-} CFVarListNode;
-
 typedef struct cfgraph_function {
     const char *name;
+    STSymbol *symbol; // The function's symbol in the global symbol table (NULL if it hasn't been found).
     unsigned argumentsCount;
     unsigned returnValuesCount;
 
-    struct cfgraph_variable_list_node *arguments;
-    struct cfgraph_variable_list_node *returnValues;
+    CFVariable *arguments;    // Array of argumentsCount arguments.
+    CFVariable *returnValues; // Array of returnValuesCount return values.
     CFStatement *rootStatement;
 
     SymbolTable *symbolTable;
 } CFFunction;
 
-typedef struct cfgraph_functions_list_node {
-    struct cfgraph_functions_list_node *previous;
-    struct cfgraph_functions_list_node *next;
-    CFFunction fun;
-} CFFuncListNode;
-
 typedef struct cfgraph_program_structure {
     CFFunction *mainFunc;
     SymbolTable *globalSymtable;
-    struct cfgraph_functions_list_node *functionList;
+    CFFunction **functions; // Functions in the order of their definition.
+    unsigned functionsCount;
+    unsigned functionsCapacity;
 } CFProgram;
 
 typedef enum cfgraph_ast_target {
@@ -150,11 +141,13 @@ void cf_clean_all();
 void cf_assign_global_symtable(SymbolTable *symbolTable);
 
 // Finds a function, that is already present in the CF graph, and returns a pointer to it.
+// The lookup goes through the function's symbol in the global symbol table, which holds a pointer to the function.
 // If setActive is true, sets it as the active function.
 CFFunction *cf_get_function(const char *name, bool setActive);
 
 // Creates a function and sets it as the active function.
 // Clears the active statement.
+// If the global symbol table contains a symbol for the function, the function and the symbol are linked together.
 CFFunction *cf_make_function(const char *name);
 
 // Assigns a pointer to a symbol table to the active function.
@@ -0,0 +1,521 @@
+/** @file copyprop.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the copy propagation and the coalescing of variables.
+ */
+
+#include <stdlib.h>
+#include "copyprop.h"
+#include "basic_blocks.h"
+#include "dataflow.h"
+#include "transform.h"
+
+// An assignment of a variable to another one.
+typedef struct cp_copy {
+    STSymbol *target;
+    STSymbol *source;
+} CPCopy;
+
+typedef struct cp_context {
+    BBGraph *graph;
+    DFVariables variables;
+
+    CPCopy *copies; // Copies in the order of the blocks (reverse postorder) and their instructions.
+    unsigned copiesCount;
+    unsigned copiesCapacity;
+
+    Bitset available; // Copies available at the current instruction.
+    unsigned propagated;
+    bool failed;
+} CPContext;
+
+// Checks whether the target of the assignment at the index is a copy of a variable the assignment doesn't assign.
+static bool cp_get_copy(ASTNode *ast, unsigned index, CPCopy *copy) {
+    DFTarget target;
+    if (!df_get_target(ast, index, &target) || target.resultIndex != 0 || !df_is_variable(target.source)) {
+        return false;
+    }
+
+    copy->target = target.target->data[0].symbolTableItemPtr;
+    copy->source = target.source->data[0].symbolTableItemPtr;
+    if (copy->target == copy->source) {
+        return false;
+    }
+    for (unsigned t = 0; t < df_targets_count(ast); t++) {
+        DFTarget other;
+        if (df_get_target(ast, t, &other) && other.target->data[0].symbolTableItemPtr == copy->source) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool cp_add_copy(CPContext *ctx, const CPCopy *copy) {
+    if (!tf_reserve((void **) &ctx->copies, &ctx->copiesCapacity, ctx->copiesCount, sizeof(CPCopy))) {
+        return false;
+    }
+    ctx->copies[ctx->copiesCount++] = *copy;
+    return true;
+}
+
+// Finds the copies of the reachable blocks.
+static bool cp_collect_copies(CPContext *ctx) {
+    for (unsigned i = 0; i < ctx->graph->reachableCount; i++) {
+        BBBlock *block = ctx->graph->reversePostorder[i];
+        for (unsigned j = 0; j < block->instructionsCount; j++) {
+            ASTNode *ast = *block->instructions[j].ast;
+            CPCopy copy;
+            for (unsigned t = 0; t < df_targets_count(ast); t++) {
+                if (cp_get_copy(ast, t, &copy) && !cp_add_copy(ctx, &copy)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Updates the available copies after the instruction: the copies of the variables it assigns are killed, its own
+// copies are generated. next is the number of the instruction's first copy, it's moved past them.
+static void cp_transfer(CPContext *ctx, ASTNode *ast, Bitset *gen, Bitset *kill, unsigned *next) {
+    DFTarget target;
+    for (unsigned t = 0; t < df_targets_count(ast); t++) {
+        if (!df_get_target(ast, t, &target)) {
+            continue;
+        }
+        STSymbol *variable = target.target->data[0].symbolTableItemPtr;
+        for (unsigned c = 0; c < ctx->copiesCount; c++) {
+            if (ctx->copies[c].target == variable || ctx->copies[c].source == variable) {
+                bs_clear(gen, c);
+                if (kill != NULL) {
+                    bs_set(kill, c);
+                }
+            }
+        }
+    }
+
+    CPCopy copy;
+    for (unsigned t = 0; t < df_targets_count(ast); t++) {
+        if (cp_get_copy(ast, t, &copy)) {
+            bs_set(gen, (*next)++);
+        }
+    }
+}
+
+// The instruction whose reads are replaced.
+typedef struct cp_instruction {
+    CPContext *ctx;
+    BBInstruction *instruction;
+} CPInstruction;
+
+static void cp_replace_use(ASTNode **slot, STSymbol *symbol, void *data) {
+    CPInstruction *ins = data;
+    CPContext *ctx = ins->ctx;
+    if (slot == NULL || ctx->failed) {
+        return;
+    }
+
+    // At most one copy of the variable is available, any other one would have been killed by it
+    for (unsigned c = bs_next(&ctx->available, 0); c < ctx->copiesCount; c = bs_next(&ctx->available, c + 1)) {
+        if (ctx->copies[c].target != symbol) {
+            continue;
+        }
+        if (tf_is_visible(ins->instruction->statement, ctx->copies[c].source)) {
+            ASTNode *read = tf_read(ctx->copies[c].source);
+            if (read == NULL) {
+                ctx->failed = true;
+                return;
+            }
+            tf_replace(*ins->instruction->ast, slot, read);
+            ctx->propagated++;
+        }
+        return;
+    }
+}
+
+// Replaces the reads of the copies available in the blocks.
+static void cp_propagate(CPContext *ctx, const DFResult *availability) {
+    unsigned next = 0;
+    for (unsigned i = 0; i < ctx->graph->reachableCount && !ctx->failed; i++) {
+        BBBlock *block = ctx->graph->reversePostorder[i];
+        bs_copy(&ctx->available, &availability->in[block->id]);
+        for (unsigned j = 0; j < block->instructionsCount && !ctx->failed; j++) {
+            CPInstruction ins = {.ctx = ctx, .instruction = &block->instructions[j]};
+            df_visit_uses(&ctx->variables, ins.instruction, cp_replace_use, &ins);
+            cp_transfer(ctx, *ins.instruction->ast, &ctx->available, NULL, &next);
+        }
+    }
+}
+
+bool copyprop_run(CFFunction *fun, unsigned *propagated) {
+    *propagated = 0;
+    CPContext ctx = {.graph = bb_build(fun)};
+    if (ctx.graph == NULL) {
+        return false;
+    }
+    if (!df_collect_variables(ctx.graph, &ctx.variables)) {
+        bb_free(ctx.graph);
+        return false;
+    }
+
+    ctx.failed = !cp_collect_copies(&ctx);
+    unsigned blocksCount = ctx.graph->blocksCount;
+    Bitset *gen = NULL;
+    Bitset *kill = NULL;
+    if (!ctx.failed && ctx.copiesCount > 0) {
+        gen = df_alloc_sets(blocksCount, ctx.copiesCount);
+        kill = df_alloc_sets(blocksCount, ctx.copiesCount);
+        ctx.failed = gen == NULL || kill == NULL || !bs_init(&ctx.available, ctx.copiesCount);
+    }
+
+    if (!ctx.failed && ctx.copiesCount > 0) {
+        unsigned next = 0;
+        for (unsigned i = 0; i < ctx.graph->reachableCount; i++) {
+            BBBlock *block = ctx.graph->reversePostorder[i];
+            for (unsigned j = 0; j < block->instructionsCount; j++) {
+                cp_transfer(&ctx, *block->instructions[j].ast, &gen[block->id], &kill[block->id], &next);
+            }
+        }
+
+        // A copy is available if it's available at the ends of all the predecessors
+        DFProblem problem = {.direction = DF_FORWARD, .meet = DF_INTERSECTION, .size = ctx.copiesCount,
+                             .gen = gen, .kill = kill, .boundary = NULL};
+        DFResult availability;
+        ctx.failed = !df_solve(ctx.graph, &problem, &availability);
+        if (!ctx.failed) {
+            cp_propagate(&ctx, &availability);
+            df_free_result(&availability);
+        }
+    }
+
+    df_free_sets(gen, blocksCount);
+    df_free_sets(kill, blocksCount);
+    bs_free(&ctx.available);
+    free(ctx.copies);
+    df_free_variables(&ctx.variables);
+    bb_free(ctx.graph);
+    *propagated = ctx.propagated;
+    return !ctx.failed;
+}
+
+// ---- Coalescing ----
+
+// A statement accessing a variable.
+typedef struct cp_occurrence {
+    unsigned variable;
+    CFStatement *statement;
+} CPOccurrence;
+
+typedef struct cp_coalescing {
+    CFFunction *fun;
+    BBGraph *graph;
+    DFVariables variables;
+    Bitset *interference; // Variables interfering with each variable (and the ones merged into it).
+    unsigned *merged;     // The variable each variable is merged into, itself if it's not merged.
+    bool *hasMerged;      // Whether other variables are merged into the variable.
+
+    CPOccurrence *occurrences; // Sorted by the variables.
+    unsigned occurrencesCount;
+    unsigned occurrencesCapacity;
+    unsigned *firstOccurrences; // Index of the first occurrence of each variable (and of the end).
+
+    CFStatement **selfCopies;   // Assignments of variables to themselves left by the merging.
+    unsigned selfCopiesCount;
+    unsigned selfCopiesCapacity;
+    bool failed;
+} CPCoalescing;
+
+static void cp_interfere(CPCoalescing *co, unsigned a, unsigned b) {
+    if (a != b) {
+        bs_set(&co->interference[a], b);
+        bs_set(&co->interference[b], a);
+    }
+}
+
+// The live variables at the current instruction.
+typedef struct cp_liveness {
+    CPCoalescing *co;
+    Bitset *live;
+} CPLiveness;
+
+static void cp_live_use(ASTNode **slot, STSymbol *symbol, void *data) {
+    (void) slot;
+    CPLiveness *liveness = data;
+    unsigned index = df_variable_index(&liveness->co->variables, symbol);
+    if (index != DF_NO_VARIABLE) {
+        bs_set(liveness->live, index);
+    }
+}
+
+// Finds the interfering variables: the targets of an instruction interfere with each other and with the variables
+// live after it, except for the source of a copy.
+static void cp_build_interference(CPCoalescing *co, const DFResult *liveness, Bitset *live) {
+    const DFVariables *variables = &co->variables;
+    for (unsigned i = 0; i < co->graph->reachableCount; i++) {
+        BBBlock *block = co->graph->reversePostorder[i];
+        bs_copy(live, &liveness->out[block->id]);
+        for (unsigned j = block->instructionsCount; j > 0; j--) {
+            BBInstruction *instruction = &block->instructions[j - 1];
+            ASTNode *ast = *instruction->ast;
+            unsigned targetsCount = df_targets_count(ast);
+            CPCopy copy;
+            unsigned copySource = targetsCount == 1 && cp_get_copy(ast, 0, &copy)
+                                  ? df_variable_index(variables, copy.source) : DF_NO_VARIABLE;
+
+            DFTarget target;
+            for (unsigned t = 0; t < targetsCount; t++) {
+                if (!df_get_target(ast, t, &target)) {
+                    continue;
+                }
+                unsigned index = df_variable_index(variables, target.target->data[0].symbolTableItemPtr);
+                for (unsigned v = bs_next(live, 0); v < live->size; v = bs_next(live, v + 1)) {
+                    if (v != copySource) {
+                        cp_interfere(co, index, v);
+                    }
+                }
+                for (unsigned u = 0; u < targetsCount; u++) {
+                    DFTarget other;
+                    if (df_get_target(ast, u, &other)) {
+                        cp_interfere(co, index, df_variable_index(variables,
+                                                                  other.target->data[0].symbolTableItemPtr));
+                    }
+                }
+            }
+            for (unsigned t = 0; t < targetsCount; t++) {
+                if (df_get_target(ast, t, &target)) {
+                    bs_clear(live, df_variable_index(variables, target.target->data[0].symbolTableItemPtr));
+                }
+            }
+            CPLiveness data = {.co = co, .live = live};
+            df_visit_uses(variables, instruction, cp_live_use, &data);
+        }
+    }
+
+    // The values of the variables live at the start of the function (the arguments) are all needed
+    const Bitset *entry = &liveness->in[co->graph->entry->id];
+    for (unsigned v = bs_next(entry, 0); v < entry->size; v = bs_next(entry, v + 1)) {
+        bs_union(&co->interference[v], entry);
+        bs_clear(&co->interference[v], v);
+    }
+}
+
+static void cp_add_occurrence(CPCoalescing *co, unsigned variable, CFStatement *stat) {
+    if (!tf_reserve((void **) &co->occurrences, &co->occurrencesCapacity, co->occurrencesCount, sizeof(CPOccurrence))) {
+        co->failed = true;
+        return;
+    }
+    co->occurrences[co->occurrencesCount++] = (CPOccurrence) {.variable = variable, .statement = stat};
+}
+
+// Visits the variables accessed by the AST. If rename is set, they're replaced with the variables they're merged
+// into, otherwise their occurrences are recorded.
+static void cp_visit_ast(CPCoalescing *co, ASTNode *ast, CFStatement *stat, bool rename) {
+    if (ast == NULL || co->failed) {
+        return;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            cp_visit_ast(co, ast->data[i].astPtr, stat, rename);
+        }
+        return;
+    }
+    if (df_is_variable(ast)) {
+        unsigned index = df_variable_index(&co->variables, ast->data[0].symbolTableItemPtr);
+        if (index != DF_NO_VARIABLE && rename) {
+            ast->data[0].symbolTableItemPtr = co->variables.symbols[co->merged[index]];
+        } else if (index != DF_NO_VARIABLE) {
+            cp_add_occurrence(co, index, stat);
+        }
+        return;
+    }
+    if (ast->actionType != AST_FUNC_CALL) {
+        cp_visit_ast(co, ast->left, stat, rename);
+    }
+    cp_visit_ast(co, ast->right, stat, rename);
+}
+
+// Visits the variables accessed by the statement chain, including the unreachable statements.
+static void cp_visit_statements(CPCoalescing *co, CFStatement *stat, bool rename) {
+    for (; stat != NULL && !co->failed; stat = stat->followingStatement) {
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                cp_visit_ast(co, stat->data.bodyAst, stat, rename);
+                break;
+            case CF_IF:
+                cp_visit_ast(co, stat->data.ifData->conditionalAst, stat, rename);
+                cp_visit_statements(co, stat->data.ifData->thenStatement, rename);
+                cp_visit_statements(co, stat->data.ifData->elseStatement, rename);
+                break;
+            case CF_FOR:
+                cp_visit_ast(co, stat->data.forData->definitionAst, stat, rename);
+                cp_visit_ast(co, stat->data.forData->conditionalAst, stat, rename);
+                cp_visit_ast(co, stat->data.forData->afterthoughtAst, stat, rename);
+                cp_visit_statements(co, stat->data.forData->bodyStatement, rename);
+                break;
+        }
+    }
+}
+
+static int cp_compare_occurrences(const void *a, const void *b) {
+    const CPOccurrence *x = a;
+    const CPOccurrence *y = b;
+    return (x->variable > y->variable) - (x->variable < y->variable);
+}
+
+// Records the statements accessing each variable.
+static void cp_collect_occurrences(CPCoalescing *co) {
+    cp_visit_statements(co, co->fun->rootStatement, false);
+    co->firstOccurrences = calloc(co->variables.count + 1, sizeof(unsigned));
+    if (co->failed || co->firstOccurrences == NULL) {
+        co->failed = true;
+        return;
+    }
+
+    if (co->occurrencesCount > 0) {
+        qsort(co->occurrences, co->occurrencesCount, sizeof(CPOccurrence), cp_compare_occurrences);
+    }
+    unsigned o = 0;
+    for (unsigned v = 0; v <= co->variables.count; v++) {
+        while (o < co->occurrencesCount && co->occurrences[o].variable < v) {
+            o++;
+        }
+        co->firstOccurrences[v] = o;
+    }
+}
+
+// Tries to merge the variable into the other one.
+static bool cp_try_merge(CPCoalescing *co, unsigned variable, unsigned into) {
+    STSymbol *symbol = co->variables.symbols[variable];
+    STSymbol *intoSymbol = co->variables.symbols[into];
+    const STVariableData *data = &symbol->data.var_data;
+    const STVariableData *intoData = &intoSymbol->data.var_data;
+    if (variable == into || co->merged[variable] != variable || co->hasMerged[variable] || co->merged[into] != into
+        || data->is_argument_variable || data->is_return_val_variable || symbol->reference_counter == 0
+        || intoData->is_return_val_variable || (!intoData->is_argument_variable && intoSymbol->reference_counter == 0)
+        || data->type != intoData->type || bs_test(&co->interference[into], variable)) {
+        return false;
+    }
+    for (unsigned o = co->firstOccurrences[variable]; o < co->firstOccurrences[variable + 1]; o++) {
+        if (!tf_is_visible(co->occurrences[o].statement, intoSymbol)) {
+            return false;
+        }
+    }
+
+    co->merged[variable] = into;
+    co->hasMerged[into] = true;
+    bs_union(&co->interference[into], &co->interference[variable]);
+    for (unsigned v = bs_next(&co->interference[variable], 0); v < co->variables.count;
+         v = bs_next(&co->interference[variable], v + 1)) {
+        bs_set(&co->interference[v], into);
+    }
+    return true;
+}
+
+static void cp_add_self_copy(CPCoalescing *co, CFStatement *stat) {
+    if (!tf_reserve((void **) &co->selfCopies, &co->selfCopiesCapacity, co->selfCopiesCount, sizeof(CFStatement *))) {
+        co->failed = true;
+        return;
+    }
+    co->selfCopies[co->selfCopiesCount++] = stat;
+}
+
+// Merges the variables, the ones related by copies first.
+static unsigned cp_merge(CPCoalescing *co) {
+    unsigned coalesced = 0;
+    for (unsigned i = 0; i < co->graph->reachableCount && !co->failed; i++) {
+        BBBlock *block = co->graph->reversePostorder[i];
+        for (unsigned j = 0; j < block->instructionsCount; j++) {
+            ASTNode *ast = *block->instructions[j].ast;
+            CPCopy copy;
+            if (df_targets_count(ast) != 1 || !cp_get_copy(ast, 0, &copy)) {
+                continue;
+            }
+            unsigned target = df_variable_index(&co->variables, copy.target);
+            unsigned source = df_variable_index(&co->variables, copy.source);
+            if (cp_try_merge(co, target, co->merged[source]) || cp_try_merge(co, source, co->merged[target])) {
+                coalesced++;
+            }
+            if (co->merged[target] == co->merged[source] && block->instructions[j].target == CF_STATEMENT_BODY
+                && block->instructions[j].statement->statementType == CF_BASIC) {
+                cp_add_self_copy(co, block->instructions[j].statement);
+            }
+        }
+    }
+
+    for (unsigned v = 0; v < co->variables.count; v++) {
+        for (unsigned into = 0; into < co->variables.count; into++) {
+            if (cp_try_merge(co, v, into)) {
+                coalesced++;
+                break;
+            }
+        }
+    }
+    return coalesced;
+}
+
+bool copyprop_coalesce(CFFunction *fun, unsigned *coalesced) {
+    *coalesced = 0;
+    CPCoalescing co = {.fun = fun, .graph = bb_build(fun)};
+    if (co.graph == NULL) {
+        return false;
+    }
+    if (!df_collect_variables(co.graph, &co.variables)) {
+        bb_free(co.graph);
+        return false;
+    }
+
+    unsigned count = co.variables.count;
+    if (count == 0) {
+        df_free_variables(&co.variables);
+        bb_free(co.graph);
+        return true;
+    }
+    DFResult liveness = {0};
+    Bitset live = {0};
+    co.interference = df_alloc_sets(count, count);
+    co.merged = calloc(count + 1, sizeof(unsigned));
+    co.hasMerged = calloc(count + 1, sizeof(bool));
+    co.failed = co.interference == NULL || co.merged == NULL || co.hasMerged == NULL || !bs_init(&live, count)
+                || !df_liveness(co.graph, &co.variables, &liveness);
+
+    if (!co.failed) {
+        for (unsigned v = 0; v < count; v++) {
+            co.merged[v] = v;
+        }
+        cp_build_interference(&co, &liveness, &live);
+        cp_collect_occurrences(&co);
+    }
+    if (!co.failed) {
+        *coalesced = cp_merge(&co);
+    }
+    if (!co.failed && *coalesced > 0) {
+        cp_visit_statements(&co, fun->rootStatement, true);
+        for (unsigned v = 0; v < count; v++) {
+            if (co.merged[v] != v) {
+                co.variables.symbols[co.merged[v]]->reference_counter += co.variables.symbols[v]->reference_counter;
+                co.variables.symbols[v]->reference_counter = 0;
+            }
+        }
+    }
+
+    df_free_result(&liveness);
+    bs_free(&live);
+    df_free_sets(co.interference, count);
+    free(co.merged);
+    free(co.hasMerged);
+    free(co.occurrences);
+    free(co.firstOccurrences);
+    df_free_variables(&co.variables);
+    bb_free(co.graph);
+
+    // The copies between the merged variables assign the variable to itself
+    for (unsigned i = 0; i < co.selfCopiesCount && !co.failed; i++) {
+        if (tf_can_remove_statement(co.selfCopies[i])) {
+            tf_remove_statement(co.selfCopies[i]);
+        }
+    }
+    free(co.selfCopies);
+    return !co.failed;
+}
@@ -0,0 +1,34 @@
+/** @file copyprop.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the copy propagation and the coalescing of variables.
+ */
+
+#ifndef _COPYPROP_H
+#define _COPYPROP_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Replaces the reads of copied variables with reads of the variables they were copied from.
+ *  - A copy is an assignment of a variable to another one (b := a), also as a part of a multi-assignment
+ *    unless the source is assigned by the same statement (a, b = b, a).
+ *  - A read of b is replaced if the copy is available: it's on every path to the read and neither of the variables
+ *    is assigned after it (found by the dataflow solver) and the name of a refers to the same variable at the read.
+ * The copies themselves become dead stores if all the reads were replaced. Stores the number of replaced reads,
+ * returns false if memory couldn't be allocated.
+ */
+bool copyprop_run(CFFunction *fun, unsigned *propagated);
+
+/* Merges the variables whose values are never needed at the same time, so that the function has fewer variables.
+ *  - Two variables interfere if one is assigned while the other one is live (except for a copy between them).
+ *  - A variable is merged into another one of the same type that doesn't interfere with it (nor with the variables
+ *    already merged into it) and whose name refers to it everywhere the merged variable is accessed. The variables
+ *    related by copies are merged first, the copies between them are then removed.
+ *  - The arguments and named return values are never merged into other variables, arguments may be merged into.
+ * Stores the number of merged variables, returns false if memory couldn't be allocated.
+ */
+bool copyprop_coalesce(CFFunction *fun, unsigned *coalesced);
+
+#endif // _COPYPROP_H
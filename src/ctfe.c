@@ -0,0 +1,947 @@
+/** @file ctfe.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the compile-time evaluation of function calls.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ctfe.h"
+#include "compiler.h"
+#include "call_graph.h"
+#include "index_map.h"
+#include "transform.h"
+
+// Maximum depth of the nested calls of an evaluation.
+#define CTFE_MAX_DEPTH 256
+// Maximum length of a string computed by an evaluation.
+#define CTFE_MAX_STRING_LENGTH 1024
+
+// A constant computed by the evaluation.
+typedef struct ctfe_value {
+    ASTNodeType type; // AST_CONST_INT, AST_CONST_FLOAT, AST_CONST_STRING or AST_CONST_BOOL.
+    ASTNodeData data;
+} CTFEValue;
+
+// The variables of an evaluated call.
+typedef struct ctfe_frame {
+    const CFFunction *function;
+    IndexMap indices;   // Indices of the variables in values.
+    CTFEValue *values;
+    unsigned count;
+    unsigned capacity;
+    CTFEValue *results; // The values returned by the call.
+    unsigned resultsCount;
+} CTFEFrame;
+
+typedef enum ctfe_outcome {
+    CTFE_NEXT,     // The statements finished, the execution continues after them.
+    CTFE_RETURNED, // A return statement was executed.
+    CTFE_ABANDONED // The evaluation can't continue.
+} CTFEOutcome;
+
+typedef struct ctfe_evaluator {
+    CFProgram *program;
+    CallGraph graph;
+    bool *pure;          // Whether the function may be evaluated, indexed like the nodes of the call graph.
+    unsigned long steps; // Steps left.
+    unsigned depth;
+    char **strings;      // Strings created by the current evaluation.
+    unsigned stringsCount;
+    unsigned stringsCapacity;
+    bool failed;         // Whether memory couldn't be allocated.
+} CTFEEvaluator;
+
+static bool ctfe_call(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *call, CTFEValue *results, unsigned count);
+
+// Consumes a step, returns false if there are none left.
+static bool ctfe_step(CTFEEvaluator *e) {
+    if (e->steps == 0) {
+        return false;
+    }
+    e->steps--;
+    return true;
+}
+
+// Returns the number of arguments of the call.
+static unsigned ctfe_arguments_count(const ASTNode *call) {
+    const ASTNode *arguments = call->right;
+    if (arguments == NULL) {
+        return 0;
+    }
+    return arguments->actionType == AST_LIST ? arguments->dataCount : 1;
+}
+
+// Returns the argument of the call at the index.
+static const ASTNode *ctfe_argument(const ASTNode *call, unsigned index) {
+    const ASTNode *arguments = call->right;
+    return arguments->actionType == AST_LIST ? arguments->data[index].astPtr : arguments;
+}
+
+// Checks whether the node is a constant.
+static bool ctfe_is_constant(const ASTNode *node) {
+    return node->actionType >= AST_CONST_INT && node->actionType <= AST_CONST_BOOL;
+}
+
+static CTFEValue ctfe_int(int64_t value) {
+    return (CTFEValue) {AST_CONST_INT, {.intConstantValue = value}};
+}
+
+static CTFEValue ctfe_bool(bool value) {
+    return (CTFEValue) {AST_CONST_BOOL, {.boolConstantValue = value}};
+}
+
+// Creates a string value owning the allocated string. Returns false if it's too long or it's NULL.
+static bool ctfe_string(CTFEEvaluator *e, char *string, CTFEValue *value) {
+    if (string == NULL) {
+        e->failed = true;
+        return false;
+    }
+    if (strlen(string) > CTFE_MAX_STRING_LENGTH) {
+        free(string);
+        return false;
+    }
+    if (!tf_reserve((void **) &e->strings, &e->stringsCapacity, e->stringsCount, sizeof(char *))) {
+        free(string);
+        e->failed = true;
+        return false;
+    }
+    e->strings[e->stringsCount++] = string;
+    *value = (CTFEValue) {AST_CONST_STRING, {.stringConstantValue = string}};
+    return true;
+}
+
+// Checks whether the string only contains ASCII characters, so its bytes are the characters of the generated code.
+static bool ctfe_is_ascii(const char *string) {
+    for (; *string != '\0'; string++) {
+        if ((unsigned char) *string >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the zero value of the type.
+static CTFEValue ctfe_zero(STDataType type) {
+    switch (type) {
+        case CF_FLOAT:
+            return (CTFEValue) {AST_CONST_FLOAT, {.floatConstantValue = 0.0}};
+        case CF_STRING:
+            return (CTFEValue) {AST_CONST_STRING, {.stringConstantValue = ""}};
+        case CF_BOOL:
+            return ctfe_bool(false);
+        default:
+            return ctfe_int(0);
+    }
+}
+
+// Checks whether the value is of the type. The optimiser runs before the types of the calls are checked,
+// so the evaluation must not hide a mismatch.
+static bool ctfe_has_type(const CTFEValue *value, STDataType type) {
+    switch (type) {
+        case CF_INT:
+            return value->type == AST_CONST_INT;
+        case CF_FLOAT:
+            return value->type == AST_CONST_FLOAT;
+        case CF_STRING:
+            return value->type == AST_CONST_STRING;
+        case CF_BOOL:
+            return value->type == AST_CONST_BOOL;
+        default:
+            return false;
+    }
+}
+
+// Reads the variable of the frame, returns false if it hasn't been assigned.
+static bool ctfe_read(const CTFEFrame *frame, const STSymbol *variable, CTFEValue *value) {
+    unsigned index;
+    if (!im_find(&frame->indices, variable, &index)) {
+        return false;
+    }
+    *value = frame->values[index];
+    return true;
+}
+
+// Assigns the value to the variable of the frame.
+static bool ctfe_write(CTFEEvaluator *e, CTFEFrame *frame, const STSymbol *variable, CTFEValue value) {
+    unsigned index;
+    if (im_find(&frame->indices, variable, &index)) {
+        frame->values[index] = value;
+        return true;
+    }
+
+    if (!tf_reserve((void **) &frame->values, &frame->capacity, frame->count, sizeof(CTFEValue))) {
+        e->failed = true;
+        return false;
+    }
+    if (!im_insert(&frame->indices, variable, frame->count)) {
+        e->failed = true;
+        return false;
+    }
+    frame->values[frame->count++] = value;
+    return true;
+}
+
+// Compares two values of the same type, only == and != are defined for bools.
+static bool ctfe_compare(ASTNodeType operator, const CTFEValue *left, const CTFEValue *right, CTFEValue *value) {
+    int cmp;
+    switch (left->type) {
+        case AST_CONST_INT:
+            cmp = (left->data.intConstantValue > right->data.intConstantValue)
+                  - (left->data.intConstantValue < right->data.intConstantValue);
+            break;
+        case AST_CONST_FLOAT: {
+            double l = left->data.floatConstantValue;
+            double r = right->data.floatConstantValue;
+            cmp = (l > r) - (l < r);
+            break;
+        }
+        case AST_CONST_STRING:
+            cmp = strcmp(left->data.stringConstantValue, right->data.stringConstantValue);
+            break;
+        case AST_CONST_BOOL:
+            if (operator != AST_LOG_EQ && operator != AST_LOG_NEQ) {
+                return false;
+            }
+            cmp = left->data.boolConstantValue != right->data.boolConstantValue;
+            break;
+        default:
+            return false;
+    }
+
+    switch (operator) {
+        case AST_LOG_EQ:
+            *value = ctfe_bool(cmp == 0);
+            return true;
+        case AST_LOG_NEQ:
+            *value = ctfe_bool(cmp != 0);
+            return true;
+        case AST_LOG_GT:
+            *value = ctfe_bool(cmp > 0);
+            return true;
+        case AST_LOG_LT:
+            *value = ctfe_bool(cmp < 0);
+            return true;
+        case AST_LOG_GTE:
+            *value = ctfe_bool(cmp >= 0);
+            return true;
+        case AST_LOG_LTE:
+            *value = ctfe_bool(cmp <= 0);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Applies an arithmetic operator to two values of the same type. Integers wrap around like in the generated code,
+// division by zero and float results that can't be written as constants abandon the evaluation.
+static bool ctfe_arithmetic(CTFEEvaluator *e, ASTNodeType operator, const CTFEValue *left, const CTFEValue *right,
+                            CTFEValue *value) {
+    if (left->type == AST_CONST_INT) {
+        uint64_t l = (uint64_t) left->data.intConstantValue;
+        uint64_t r = (uint64_t) right->data.intConstantValue;
+        switch (operator) {
+            case AST_ADD:
+                *value = ctfe_int((int64_t) (l + r));
+                return true;
+            case AST_SUBTRACT:
+                *value = ctfe_int((int64_t) (l - r));
+                return true;
+            case AST_MULTIPLY:
+                *value = ctfe_int((int64_t) (l * r));
+                return true;
+            case AST_DIVIDE:
+                if (right->data.intConstantValue == 0
+                    || (left->data.intConstantValue == INT64_MIN && right->data.intConstantValue == -1)) {
+                    return false;
+                }
+                *value = ctfe_int(left->data.intConstantValue / right->data.intConstantValue);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    if (left->type == AST_CONST_FLOAT) {
+        double l = left->data.floatConstantValue;
+        double r = right->data.floatConstantValue;
+        double result;
+        switch (operator) {
+            case AST_ADD:
+                result = l + r;
+                break;
+            case AST_SUBTRACT:
+                result = l - r;
+                break;
+            case AST_MULTIPLY:
+                result = l * r;
+                break;
+            case AST_DIVIDE:
+                if (tf_is_float_zero(r)) {
+                    return false;
+                }
+                result = l / r;
+                break;
+            default:
+                return false;
+        }
+        *value = (CTFEValue) {AST_CONST_FLOAT, {.floatConstantValue = result}};
+        return isfinite(result);
+    }
+
+    if (left->type == AST_CONST_STRING && operator == AST_ADD) {
+        const char *l = left->data.stringConstantValue;
+        const char *r = right->data.stringConstantValue;
+        char *result = malloc(strlen(l) + strlen(r) + 1);
+        if (result != NULL) {
+            strcpy(result, l);
+            strcat(result, r);
+        }
+        return ctfe_string(e, result, value);
+    }
+    return false;
+}
+
+// Evaluates an expression with a single value.
+static bool ctfe_expression(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *ast, CTFEValue *value) {
+    if (!ctfe_step(e)) {
+        return false;
+    }
+
+    switch (ast->actionType) {
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_STRING:
+        case AST_CONST_BOOL:
+            *value = (CTFEValue) {ast->actionType, ast->data[0]};
+            return true;
+        case AST_ID:
+            return ast->data[0].symbolTableItemPtr != NULL && ctfe_read(frame, ast->data[0].symbolTableItemPtr, value);
+        case AST_AR_NEGATE:
+            if (!ctfe_expression(e, frame, ast->left, value)) {
+                return false;
+            }
+            if (value->type == AST_CONST_INT) {
+                value->data.intConstantValue = (int64_t) (0 - (uint64_t) value->data.intConstantValue);
+                return true;
+            }
+            value->data.floatConstantValue = -value->data.floatConstantValue;
+            return value->type == AST_CONST_FLOAT;
+        case AST_LOG_NOT:
+            if (!ctfe_expression(e, frame, ast->left, value) || value->type != AST_CONST_BOOL) {
+                return false;
+            }
+            value->data.boolConstantValue = !value->data.boolConstantValue;
+            return true;
+        case AST_LOG_AND:
+        case AST_LOG_OR:
+            // The right operand is only evaluated if the left one doesn't decide the result
+            if (!ctfe_expression(e, frame, ast->left, value) || value->type != AST_CONST_BOOL) {
+                return false;
+            }
+            if (value->data.boolConstantValue == (ast->actionType == AST_LOG_OR)) {
+                return true;
+            }
+            return ctfe_expression(e, frame, ast->right, value) && value->type == AST_CONST_BOOL;
+        case AST_ADD:
+        case AST_SUBTRACT:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_LOG_EQ:
+        case AST_LOG_NEQ:
+        case AST_LOG_LT:
+        case AST_LOG_GT:
+        case AST_LOG_LTE:
+        case AST_LOG_GTE: {
+            CTFEValue left;
+            CTFEValue right;
+            if (!ctfe_expression(e, frame, ast->left, &left) || !ctfe_expression(e, frame, ast->right, &right)
+                || left.type != right.type) {
+                return false;
+            }
+            if (ast->actionType >= AST_LOG_EQ && ast->actionType <= AST_LOG_GTE) {
+                return ctfe_compare(ast->actionType, &left, &right, value);
+            }
+            return ctfe_arithmetic(e, ast->actionType, &left, &right, value);
+        }
+        case AST_FUNC_CALL:
+            return ctfe_call(e, frame, ast, value, 1);
+        default:
+            return false;
+    }
+}
+
+// Evaluates the value list (or a single value) into count values. A single call may return all of them.
+static bool ctfe_values(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *list, CTFEValue *values,
+                        unsigned count) {
+    unsigned listCount = list->actionType == AST_LIST ? list->dataCount : 1;
+    const ASTNode *first = list->actionType == AST_LIST ? (listCount > 0 ? list->data[0].astPtr : NULL) : list;
+    if (listCount == 1 && count > 1) {
+        return first->actionType == AST_FUNC_CALL && ctfe_call(e, frame, first, values, count);
+    }
+    if (listCount != count) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        const ASTNode *item = list->actionType == AST_LIST ? list->data[i].astPtr : list;
+        if (!ctfe_expression(e, frame, item, &values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Evaluates a call of a built-in function with the evaluated arguments. Only the pure ones may be evaluated,
+// and only if the generated code would produce the same values.
+static bool ctfe_builtin(CTFEEvaluator *e, const char *name, const CTFEValue *arguments, unsigned argumentsCount,
+                         CTFEValue *results, unsigned count) {
+    if (strcmp(name, "int2float") == 0 && argumentsCount == 1 && count == 1
+        && arguments[0].type == AST_CONST_INT) {
+        results[0] = (CTFEValue) {AST_CONST_FLOAT, {.floatConstantValue = (double) arguments[0].data.intConstantValue}};
+        return true;
+    }
+    if (strcmp(name, "float2int") == 0 && argumentsCount == 1 && count == 1
+        && arguments[0].type == AST_CONST_FLOAT) {
+        // Values out of the range of integers stop the generated code
+        double value = arguments[0].data.floatConstantValue;
+        if (!(value > -9.2e18 && value < 9.2e18)) {
+            return false;
+        }
+        results[0] = ctfe_int((int64_t) value);
+        return true;
+    }
+    if (strcmp(name, "len") == 0 && argumentsCount == 1 && count == 1 && arguments[0].type == AST_CONST_STRING
+        && ctfe_is_ascii(arguments[0].data.stringConstantValue)) {
+        results[0] = ctfe_int((int64_t) strlen(arguments[0].data.stringConstantValue));
+        return true;
+    }
+    if (strcmp(name, "ord") == 0 && argumentsCount == 2 && count == 2 && arguments[0].type == AST_CONST_STRING
+        && arguments[1].type == AST_CONST_INT && ctfe_is_ascii(arguments[0].data.stringConstantValue)) {
+        // The generated code doesn't return an integer for an index out of the string
+        const char *string = arguments[0].data.stringConstantValue;
+        int64_t index = arguments[1].data.intConstantValue;
+        if (index < 0 || index >= (int64_t) strlen(string)) {
+            return false;
+        }
+        results[0] = ctfe_int((unsigned char) string[index]);
+        results[1] = ctfe_int(0);
+        return true;
+    }
+    if (strcmp(name, "chr") == 0 && argumentsCount == 1 && count == 2 && arguments[0].type == AST_CONST_INT) {
+        int64_t code = arguments[0].data.intConstantValue;
+        if (code < 0 || code > 255) {
+            results[0] = ctfe_zero(CF_STRING);
+            results[1] = ctfe_int(1);
+            return true;
+        }
+        if (code == 0 || code >= 0x80) {
+            // Not representable by a string constant of the compiler
+            return false;
+        }
+        char *string = malloc(2);
+        if (string != NULL) {
+            string[0] = (char) code;
+            string[1] = '\0';
+        }
+        results[1] = ctfe_int(0);
+        return ctfe_string(e, string, &results[0]);
+    }
+    if (strcmp(name, "substr") == 0 && argumentsCount == 3 && count == 2 && arguments[0].type == AST_CONST_STRING
+        && arguments[1].type == AST_CONST_INT && arguments[2].type == AST_CONST_INT
+        && ctfe_is_ascii(arguments[0].data.stringConstantValue)) {
+        const char *string = arguments[0].data.stringConstantValue;
+        int64_t length = (int64_t) strlen(string);
+        int64_t begin = arguments[1].data.intConstantValue;
+        int64_t n = arguments[2].data.intConstantValue;
+        if (begin < 0 || begin >= length || n < 0) {
+            results[0] = ctfe_zero(CF_STRING);
+            results[1] = ctfe_int(1);
+            return true;
+        }
+        int64_t end = n > length - begin ? length : begin + n;
+        char *substring = malloc((size_t) (end - begin) + 1);
+        if (substring != NULL) {
+            memcpy(substring, string + begin, (size_t) (end - begin));
+            substring[end - begin] = '\0';
+        }
+        results[1] = ctfe_int(0);
+        return ctfe_string(e, substring, &results[0]);
+    }
+    return false;
+}
+
+// Executes the statement chain of the frame's function.
+static CTFEOutcome ctfe_statements(CTFEEvaluator *e, CTFEFrame *frame, const CFStatement *stat);
+
+// Evaluates a call returning count values, the arguments are evaluated in the frame of the caller.
+static bool ctfe_call(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *call, CTFEValue *results,
+                      unsigned count) {
+    const STSymbol *symbol = call->left->data[0].symbolTableItemPtr;
+    const STFunctionData *funcData = &symbol->data.func_data;
+    CFFunction *fun = funcData->cf_function;
+    CGNode *node = cg_find(&e->graph, fun);
+    unsigned argumentsCount = ctfe_arguments_count(call);
+    if (funcData->ret_types_count != count || (fun != NULL && (node == NULL || !e->pure[node - e->graph.nodes]))
+        || (fun != NULL && argumentsCount != fun->argumentsCount) || e->depth >= CTFE_MAX_DEPTH) {
+        return false;
+    }
+
+    CTFEValue *arguments = malloc((argumentsCount + 1) * sizeof(CTFEValue));
+    if (arguments == NULL) {
+        e->failed = true;
+        return false;
+    }
+    bool evaluated = true;
+    for (unsigned i = 0; evaluated && i < argumentsCount; i++) {
+        evaluated = ctfe_expression(e, frame, ctfe_argument(call, i), &arguments[i]);
+    }
+    if (!evaluated || fun == NULL) {
+        evaluated = evaluated && ctfe_builtin(e, symbol->identifier, arguments, argumentsCount, results, count);
+        free(arguments);
+        return evaluated;
+    }
+
+    // The parameters and the named return values are the first variables of the new frame
+    CTFEFrame callee = {.function = fun, .results = results, .resultsCount = count};
+    im_init(&callee.indices);
+    for (unsigned i = 0; evaluated && i < fun->argumentsCount; i++) {
+        STItem *item = symtable_find(fun->symbolTable, fun->arguments[i].name);
+        evaluated = ctfe_has_type(&arguments[i], fun->arguments[i].dataType)
+                    && (item == NULL || ctfe_write(e, &callee, &item->data, arguments[i]));
+    }
+    for (unsigned i = 0; evaluated && i < fun->returnValuesCount; i++) {
+        const char *name = fun->returnValues[i].name;
+        STItem *item = name == NULL ? NULL : symtable_find(fun->symbolTable, name);
+        evaluated = item == NULL || ctfe_write(e, &callee, &item->data, ctfe_zero(fun->returnValues[i].dataType));
+    }
+    free(arguments);
+
+    if (evaluated) {
+        e->depth++;
+        CTFEOutcome outcome = ctfe_statements(e, &callee, fun->rootStatement);
+        e->depth--;
+        // A function with return values must end with a return statement
+        evaluated = outcome == CTFE_RETURNED || (outcome == CTFE_NEXT && count == 0);
+    }
+    for (unsigned i = 0; evaluated && i < count; i++) {
+        evaluated = ctfe_has_type(&results[i], fun->returnValues[i].dataType);
+    }
+    im_free(&callee.indices);
+    free(callee.values);
+    return evaluated;
+}
+
+// Executes a return statement of the frame's function.
+static bool ctfe_return(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *values) {
+    if (values->dataCount > 0) {
+        return ctfe_values(e, frame, values, frame->results, frame->resultsCount);
+    }
+
+    // The named return values are returned
+    const CFFunction *fun = frame->function;
+    for (unsigned i = 0; i < frame->resultsCount; i++) {
+        const char *name = fun->returnValues[i].name;
+        STItem *item = name == NULL ? NULL : symtable_find(fun->symbolTable, name);
+        if (item == NULL || !ctfe_read(frame, &item->data, &frame->results[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Executes an instruction: an assignment, a definition or a call.
+static bool ctfe_instruction(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *ast) {
+    if (ast == NULL) {
+        return true;
+    }
+
+    if (ast->actionType == AST_FUNC_CALL) {
+        unsigned count = ast->left->data[0].symbolTableItemPtr->data.func_data.ret_types_count;
+        CTFEValue *results = malloc((count + 1) * sizeof(CTFEValue));
+        bool evaluated = results != NULL && ctfe_call(e, frame, ast, results, count);
+        e->failed |= results == NULL;
+        free(results);
+        return evaluated;
+    }
+    if (ast->actionType != AST_ASSIGN && ast->actionType != AST_DEFINE) {
+        return false;
+    }
+
+    // All the values are evaluated before they're assigned
+    const ASTNode *targets = ast->left;
+    unsigned count = targets->actionType == AST_LIST ? targets->dataCount : 1;
+    CTFEValue *values = malloc((count + 1) * sizeof(CTFEValue));
+    if (values == NULL) {
+        e->failed = true;
+        return false;
+    }
+    bool executed = ctfe_values(e, frame, ast->right, values, count);
+    for (unsigned i = 0; executed && i < count; i++) {
+        const ASTNode *target = targets->actionType == AST_LIST ? targets->data[i].astPtr : targets;
+        const STSymbol *variable = target->data[0].symbolTableItemPtr;
+        if (variable != NULL && target->inheritedDataType != CF_BLACK_HOLE) {
+            executed = ctfe_write(e, frame, variable, values[i]);
+        }
+    }
+    free(values);
+    return executed;
+}
+
+// Evaluates the condition of an IF or a FOR.
+static bool ctfe_condition(CTFEEvaluator *e, CTFEFrame *frame, const ASTNode *ast, bool *condition) {
+    CTFEValue value;
+    if (!ctfe_expression(e, frame, ast, &value) || value.type != AST_CONST_BOOL) {
+        return false;
+    }
+    *condition = value.data.boolConstantValue;
+    return true;
+}
+
+static CTFEOutcome ctfe_statements(CTFEEvaluator *e, CTFEFrame *frame, const CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        if (!ctfe_step(e)) {
+            return CTFE_ABANDONED;
+        }
+
+        CTFEOutcome outcome = CTFE_NEXT;
+        bool condition;
+        switch (stat->statementType) {
+            case CF_BASIC:
+                outcome = ctfe_instruction(e, frame, stat->data.bodyAst) ? CTFE_NEXT : CTFE_ABANDONED;
+                break;
+            case CF_RETURN:
+                outcome = ctfe_return(e, frame, stat->data.bodyAst) ? CTFE_RETURNED : CTFE_ABANDONED;
+                break;
+            case CF_IF:
+                if (!ctfe_condition(e, frame, stat->data.ifData->conditionalAst, &condition)) {
+                    return CTFE_ABANDONED;
+                }
+                outcome = ctfe_statements(e, frame, condition ? stat->data.ifData->thenStatement
+                                                              : stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR: {
+                const CFStatementFor *forData = stat->data.forData;
+                if (!ctfe_instruction(e, frame, forData->definitionAst)) {
+                    return CTFE_ABANDONED;
+                }
+                while (outcome == CTFE_NEXT) {
+                    if (!ctfe_condition(e, frame, forData->conditionalAst, &condition)) {
+                        return CTFE_ABANDONED;
+                    }
+                    if (!condition) {
+                        break;
+                    }
+                    outcome = ctfe_statements(e, frame, forData->bodyStatement);
+                    if (outcome == CTFE_NEXT && !ctfe_instruction(e, frame, forData->afterthoughtAst)) {
+                        return CTFE_ABANDONED;
+                    }
+                }
+                break;
+            }
+        }
+        if (outcome != CTFE_NEXT) {
+            return outcome;
+        }
+    }
+    return CTFE_NEXT;
+}
+
+// Finds the functions that may be evaluated: the ones that don't call impure built-in functions, directly
+// or through the functions they call.
+static void ctfe_find_pure(CTFEEvaluator *e);
+
+// Checks whether the AST only calls pure built-in functions and functions that are pure so far.
+static bool ctfe_calls_pure(const CTFEEvaluator *e, const ASTNode *ast) {
+    if (ast == NULL) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!ctfe_calls_pure(e, ast->data[i].astPtr)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (ast->actionType == AST_FUNC_CALL) {
+        CGNode *node = cg_find(&e->graph, ast->left->data[0].symbolTableItemPtr->data.func_data.cf_function);
+        bool pure = node != NULL ? e->pure[node - e->graph.nodes] : tf_is_pure_builtin_call(ast);
+        return pure && ctfe_calls_pure(e, ast->right);
+    }
+    return ctfe_calls_pure(e, ast->left) && ctfe_calls_pure(e, ast->right);
+}
+
+// Checks whether the statement chain only calls pure functions.
+static bool ctfe_statements_pure(const CTFEEvaluator *e, const CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        bool pure = true;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                pure = ctfe_calls_pure(e, stat->data.bodyAst);
+                break;
+            case CF_IF:
+                pure = ctfe_calls_pure(e, stat->data.ifData->conditionalAst)
+                       && ctfe_statements_pure(e, stat->data.ifData->thenStatement)
+                       && ctfe_statements_pure(e, stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                pure = ctfe_calls_pure(e, stat->data.forData->definitionAst)
+                       && ctfe_calls_pure(e, stat->data.forData->conditionalAst)
+                       && ctfe_calls_pure(e, stat->data.forData->afterthoughtAst)
+                       && ctfe_statements_pure(e, stat->data.forData->bodyStatement);
+                break;
+        }
+        if (!pure) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void ctfe_find_pure(CTFEEvaluator *e) {
+    for (unsigned i = 0; i < e->graph.count; i++) {
+        e->pure[i] = e->graph.nodes[i].function != e->program->mainFunc;
+    }
+
+    // The impurity spreads to the callers until nothing changes (the bottom-up order only needs another pass
+    // for recursive functions)
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned i = 0; i < e->graph.count; i++) {
+            unsigned index = e->graph.order[i];
+            if (e->pure[index] && !ctfe_statements_pure(e, e->graph.nodes[index].function->rootStatement)) {
+                e->pure[index] = false;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Creates a constant node of the value.
+static ASTNode *ctfe_constant(const CTFEValue *value) {
+    switch (value->type) {
+        case AST_CONST_INT:
+            return tf_const_int(value->data.intConstantValue);
+        case AST_CONST_FLOAT:
+            return ast_leaf_constf(value->data.floatConstantValue);
+        case AST_CONST_STRING:
+            return ast_leaf_consts(value->data.stringConstantValue);
+        default:
+            return ast_leaf_constb(value->data.boolConstantValue);
+    }
+}
+
+// Creates a constant node of a single value, or a list of the constants of multiple values.
+static ASTNode *ctfe_constants(const CTFEValue *values, unsigned count) {
+    if (count == 1) {
+        return ctfe_constant(&values[0]);
+    }
+    ASTNode *constants = ast_node_list(count);
+    for (unsigned i = 0; constants != NULL && i < count; i++) {
+        ASTNode *constant = ctfe_constant(&values[i]);
+        if (constant == NULL) {
+            clean_ast(constants);
+            return NULL;
+        }
+        ast_push_to_list(constants, constant);
+    }
+    if (constants != NULL) {
+        ast_infer_node_type(constants);
+    }
+    return constants;
+}
+
+// Evaluates the call returning count values. Returns false if it can't be evaluated.
+static bool ctfe_evaluate(CTFEEvaluator *e, const ASTNode *call, CTFEValue *results, unsigned count) {
+    const CFFunction *fun = call->left->data[0].symbolTableItemPtr->data.func_data.cf_function;
+    CGNode *node = cg_find(&e->graph, fun);
+    if (node == NULL || !e->pure[node - e->graph.nodes] || count == 0) {
+        return false;
+    }
+    for (unsigned i = 0; i < ctfe_arguments_count(call); i++) {
+        if (!ctfe_is_constant(ctfe_argument(call, i))) {
+            return false;
+        }
+    }
+
+    // The arguments are constants, so the frame of the caller isn't needed
+    CTFEFrame frame = {0};
+    im_init(&frame.indices);
+    bool evaluated = ctfe_call(e, &frame, call, results, count);
+    im_free(&frame.indices);
+    for (unsigned i = 0; i < count; i++) {
+        if (evaluated && results[i].type == AST_CONST_STRING && !ctfe_is_ascii(results[i].data.stringConstantValue)) {
+            evaluated = false;
+        }
+    }
+    return evaluated && !e->failed;
+}
+
+// Frees the strings created by the last evaluation.
+static void ctfe_free_strings(CTFEEvaluator *e) {
+    for (unsigned i = 0; i < e->stringsCount; i++) {
+        free(e->strings[i]);
+    }
+    e->stringsCount = 0;
+}
+
+// Replaces the calls in the subtree in the slot with their results, the nested calls first. root is the AST
+// of the instruction. Returns the number of replaced calls.
+static unsigned ctfe_replace_calls(CTFEEvaluator *e, ASTNode *root, ASTNode **slot) {
+    ASTNode *ast = *slot;
+    if (ast == NULL || e->failed) {
+        return 0;
+    }
+
+    unsigned replaced = 0;
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            replaced += ctfe_replace_calls(e, root, &ast->data[i].astPtr);
+            if (*slot != ast) {
+                // The whole list was replaced with the results of a call
+                break;
+            }
+        }
+        return replaced;
+    }
+    if (ast->actionType != AST_FUNC_CALL) {
+        if (ast->actionType != AST_ASSIGN && ast->actionType != AST_DEFINE) {
+            replaced += ctfe_replace_calls(e, root, &ast->left);
+        }
+        return replaced + ctfe_replace_calls(e, root, &ast->right);
+    }
+
+    replaced += ctfe_replace_calls(e, root, &ast->right);
+    if (ast == root) {
+        // The results of a call statement are discarded
+        return replaced;
+    }
+    unsigned count = ast->left->data[0].symbolTableItemPtr->data.func_data.ret_types_count;
+    ASTNode **target = slot;
+    if (count > 1) {
+        // Multiple values can only be assigned
+        if ((root->actionType != AST_ASSIGN && root->actionType != AST_DEFINE) || root->right->actionType != AST_LIST
+            || root->right->dataCount != 1 || &root->right->data[0].astPtr != slot) {
+            return replaced;
+        }
+        target = &root->right;
+    }
+
+    CTFEValue *results = malloc((count + 1) * sizeof(CTFEValue));
+    if (results == NULL) {
+        e->failed = true;
+        return replaced;
+    }
+    ASTNode *constants = NULL;
+    if (ctfe_evaluate(e, ast, results, count)) {
+        constants = ctfe_constants(results, count);
+        e->failed |= constants == NULL;
+    }
+    ctfe_free_strings(e);
+    free(results);
+
+    if (constants == NULL) {
+        return replaced;
+    }
+    tf_replace(root, target, constants);
+    return replaced + 1;
+}
+
+// Replaces the calls in the AST of an instruction (in the slot root).
+static unsigned ctfe_replace_instruction_calls(CTFEEvaluator *e, ASTNode **root) {
+    if (*root == NULL) {
+        return 0;
+    }
+    unsigned replaced = ctfe_replace_calls(e, *root, root);
+    if (replaced > 0) {
+        tf_update_calls(*root);
+    }
+    return replaced;
+}
+
+// Replaces the calls in the statement chain.
+static unsigned ctfe_replace_statement_calls(CTFEEvaluator *e, CFStatement *stat) {
+    unsigned replaced = 0;
+    for (; stat != NULL && !e->failed; stat = stat->followingStatement) {
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                replaced += ctfe_replace_instruction_calls(e, &stat->data.bodyAst);
+                break;
+            case CF_IF:
+                replaced += ctfe_replace_instruction_calls(e, &stat->data.ifData->conditionalAst)
+                            + ctfe_replace_statement_calls(e, stat->data.ifData->thenStatement)
+                            + ctfe_replace_statement_calls(e, stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                replaced += ctfe_replace_instruction_calls(e, &stat->data.forData->definitionAst)
+                            + ctfe_replace_instruction_calls(e, &stat->data.forData->conditionalAst)
+                            + ctfe_replace_instruction_calls(e, &stat->data.forData->afterthoughtAst)
+                            + ctfe_replace_statement_calls(e, stat->data.forData->bodyStatement);
+                break;
+        }
+    }
+    return replaced;
+}
+
+bool ctfe_run(CFProgram *program, unsigned long budget, bool *changed, unsigned *evaluated) {
+    CTFEEvaluator e = {.program = program, .steps = budget};
+    *evaluated = 0;
+    if (!cg_build(program, &e.graph)) {
+        return false;
+    }
+    e.pure = calloc(e.graph.count + 1, sizeof(bool));
+    e.failed = e.pure == NULL;
+    if (!e.failed) {
+        ctfe_find_pure(&e);
+    }
+
+    for (unsigned i = 0; i < program->functionsCount && !e.failed && compiler_result == COMPILER_RESULT_SUCCESS; i++) {
+        unsigned replaced = ctfe_replace_statement_calls(&e, program->functions[i]->rootStatement);
+        changed[i] = replaced > 0;
+        *evaluated += replaced;
+    }
+
+    ctfe_free_strings(&e);
+    free(e.strings);
+    free(e.pure);
+    cg_free(&e.graph);
+    return !e.failed;
+}
+
+ASTNode *ctfe_fold_builtin(const ASTNode *call, bool *failed) {
+    const STSymbol *symbol = call->left->data[0].symbolTableItemPtr;
+    if (symbol == NULL || symbol->type != ST_SYMBOL_FUNC || symbol->data.func_data.cf_function != NULL) {
+        return NULL;
+    }
+    unsigned count = symbol->data.func_data.ret_types_count;
+    unsigned argumentsCount = ctfe_arguments_count(call);
+    CTFEValue arguments[3];
+    CTFEValue results[2];
+    if (count == 0 || count > 2 || argumentsCount > 3) {
+        return NULL;
+    }
+    for (unsigned i = 0; i < argumentsCount; i++) {
+        const ASTNode *argument = ctfe_argument(call, i);
+        if (!ctfe_is_constant(argument)) {
+            return NULL;
+        }
+        arguments[i] = (CTFEValue) {argument->actionType, argument->data[0]};
+    }
+
+    CTFEEvaluator e = {0};
+    ASTNode *constants = NULL;
+    if (ctfe_builtin(&e, symbol->identifier, arguments, argumentsCount, results, count)) {
+        constants = ctfe_constants(results, count);
+        e.failed |= constants == NULL;
+    }
+    ctfe_free_strings(&e);
+    free(e.strings);
+    *failed = e.failed;
+    return constants;
+}
@@ -0,0 +1,36 @@
+/** @file ctfe.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the compile-time evaluation of function calls.
+ */
+
+#ifndef _CTFE_H
+#define _CTFE_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Evaluates the calls of pure functions with constant arguments and replaces them with the returned constants.
+ *  - A function is pure if it doesn't call print or the input functions, even through the functions it calls.
+ *    The purity is found on the call graph, the functions are pure unless proven otherwise.
+ *  - A call is evaluated if all its arguments are constants. Its statements are interpreted with the same
+ *    semantics as the generated code (integers wrap around). The evaluation is abandoned if the result can't be
+ *    represented by a constant or the generated code would stop with an error (e.g. division by zero).
+ *  - A call of a function with a single return value is replaced in any expression, a call returning multiple
+ *    values only if it's the value list of an assignment (or a definition).
+ *  - The calls are evaluated in the order of the statements, the nested calls first. Each evaluated statement
+ *    and AST node is a step, the evaluations of the whole program may take at most budget steps.
+ * The changed functions are flagged in the changed array (indexed like the functions of the program).
+ * Stores the number of replaced calls, returns false if memory couldn't be allocated.
+ */
+bool ctfe_run(CFProgram *program, unsigned long budget, bool *changed, unsigned *evaluated);
+
+/* Evaluates a call of a pure built-in function (int2float, float2int, len, ord, chr or substr) whose arguments are
+ * constants, with the same semantics as the generated code. Returns a new constant of the result, or a list of
+ * the constants of the value and the error code for the functions returning both. Returns NULL if the call can't
+ * be evaluated, failed is set if memory couldn't be allocated.
+ */
+ASTNode *ctfe_fold_builtin(const ASTNode *call, bool *failed);
+
+#endif // _CTFE_H
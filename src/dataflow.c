@@ -0,0 +1,449 @@
+/** @file dataflow.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements bit sets, the generic dataflow analysis solver and the access to variables in basic blocks.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dataflow.h"
+#include "stderr_message.h"
+#include "transform.h"
+
+#define BS_WORD_BITS 64
+#define BS_WORDS(size) (((size) + BS_WORD_BITS - 1) / BS_WORD_BITS)
+
+bool bs_init(Bitset *set, unsigned size) {
+    set->size = size;
+    // Allocate at least one word so that empty sets can be told apart from failed allocations
+    set->words = calloc(BS_WORDS(size) == 0 ? 1 : BS_WORDS(size), sizeof(uint64_t));
+    return set->words != NULL;
+}
+
+void bs_free(Bitset *set) {
+    free(set->words);
+    set->words = NULL;
+    set->size = 0;
+}
+
+void bs_set(Bitset *set, unsigned element) {
+    set->words[element / BS_WORD_BITS] |= UINT64_C(1) << (element % BS_WORD_BITS);
+}
+
+void bs_clear(Bitset *set, unsigned element) {
+    set->words[element / BS_WORD_BITS] &= ~(UINT64_C(1) << (element % BS_WORD_BITS));
+}
+
+bool bs_test(const Bitset *set, unsigned element) {
+    return (set->words[element / BS_WORD_BITS] >> (element % BS_WORD_BITS)) & 1u;
+}
+
+void bs_reset(Bitset *set) {
+    memset(set->words, 0, BS_WORDS(set->size) * sizeof(uint64_t));
+}
+
+void bs_fill(Bitset *set) {
+    unsigned words = BS_WORDS(set->size);
+    if (words == 0) {
+        return;
+    }
+    memset(set->words, 0xFF, words * sizeof(uint64_t));
+    // Keep the bits above the size cleared so that comparisons work on whole words
+    if (set->size % BS_WORD_BITS != 0) {
+        set->words[words - 1] = (UINT64_C(1) << (set->size % BS_WORD_BITS)) - 1;
+    }
+}
+
+unsigned bs_next(const Bitset *set, unsigned from) {
+    if (from >= set->size) {
+        return set->size;
+    }
+
+    unsigned word = from / BS_WORD_BITS;
+    uint64_t bits = set->words[word] & (~UINT64_C(0) << (from % BS_WORD_BITS));
+    while (bits == 0) {
+        if (++word >= BS_WORDS(set->size)) {
+            return set->size;
+        }
+        bits = set->words[word];
+    }
+    return word * BS_WORD_BITS + (unsigned) __builtin_ctzll(bits);
+}
+
+void bs_copy(Bitset *dst, const Bitset *src) {
+    memcpy(dst->words, src->words, BS_WORDS(src->size) * sizeof(uint64_t));
+}
+
+bool bs_union(Bitset *dst, const Bitset *src) {
+    bool changed = false;
+    for (unsigned i = 0; i < BS_WORDS(dst->size); i++) {
+        uint64_t word = dst->words[i] | src->words[i];
+        changed |= word != dst->words[i];
+        dst->words[i] = word;
+    }
+    return changed;
+}
+
+bool bs_intersect(Bitset *dst, const Bitset *src) {
+    bool changed = false;
+    for (unsigned i = 0; i < BS_WORDS(dst->size); i++) {
+        uint64_t word = dst->words[i] & src->words[i];
+        changed |= word != dst->words[i];
+        dst->words[i] = word;
+    }
+    return changed;
+}
+
+void bs_difference(Bitset *dst, const Bitset *src) {
+    for (unsigned i = 0; i < BS_WORDS(dst->size); i++) {
+        dst->words[i] &= ~src->words[i];
+    }
+}
+
+bool bs_equals(const Bitset *a, const Bitset *b) {
+    return memcmp(a->words, b->words, BS_WORDS(a->size) * sizeof(uint64_t)) == 0;
+}
+
+// ---- Solver ----
+
+Bitset *df_alloc_sets(unsigned count, unsigned size) {
+    Bitset *sets = calloc(count, sizeof(Bitset));
+    if (sets == NULL) {
+        return NULL;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        if (!bs_init(&sets[i], size)) {
+            for (unsigned j = 0; j < i; j++) {
+                bs_free(&sets[j]);
+            }
+            free(sets);
+            return NULL;
+        }
+    }
+    return sets;
+}
+
+void df_free_sets(Bitset *sets, unsigned count) {
+    if (sets == NULL) {
+        return;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        bs_free(&sets[i]);
+    }
+    free(sets);
+}
+
+bool df_solve(const BBGraph *graph, const DFProblem *problem, DFResult *result) {
+    bool forward = problem->direction == DF_FORWARD;
+    result->blocksCount = graph->blocksCount;
+    result->iterations = 0;
+    result->in = df_alloc_sets(graph->blocksCount, problem->size);
+    result->out = df_alloc_sets(graph->blocksCount, problem->size);
+
+    Bitset meet;
+    if (result->in == NULL || result->out == NULL || !bs_init(&meet, problem->size)) {
+        df_free_result(result);
+        stderr_message("dataflow", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return false;
+    }
+
+    // The facts flow from the "before" sets through the transfer function to the "after" sets
+    Bitset *before = forward ? result->in : result->out;
+    Bitset *after = forward ? result->out : result->in;
+    BBBlock *boundaryBlock = forward ? graph->entry : graph->exit;
+
+    // Must problems start from the full set everywhere but at the boundary, so that the fixed point is the greatest one
+    for (unsigned i = 0; i < graph->reachableCount; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        if (problem->meet == DF_INTERSECTION) {
+            bs_fill(&after[block->id]);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        result->iterations++;
+
+        for (unsigned i = 0; i < graph->reachableCount; i++) {
+            BBBlock *block = graph->reversePostorder[forward ? i : graph->reachableCount - i - 1];
+
+            // Meet over the neighbours the facts come from
+            bool any = false;
+            unsigned neighboursCount = forward ? block->predecessorsCount : block->successorsCount;
+            for (unsigned n = 0; n < neighboursCount; n++) {
+                BBBlock *neighbour = forward ? block->predecessors[n] : block->successors[n];
+                if (!bb_is_reachable(neighbour)) {
+                    continue;
+                }
+                if (!any) {
+                    bs_copy(&meet, &after[neighbour->id]);
+                    any = true;
+                } else if (problem->meet == DF_UNION) {
+                    bs_union(&meet, &after[neighbour->id]);
+                } else {
+                    bs_intersect(&meet, &after[neighbour->id]);
+                }
+            }
+            if (block == boundaryBlock) {
+                if (problem->boundary != NULL) {
+                    bs_copy(&meet, problem->boundary);
+                } else {
+                    bs_reset(&meet);
+                }
+            } else if (!any) {
+                bs_reset(&meet);
+            }
+            bs_copy(&before[block->id], &meet);
+
+            // Transfer: gen ∪ (before − kill)
+            bs_difference(&meet, &problem->kill[block->id]);
+            bs_union(&meet, &problem->gen[block->id]);
+            if (!bs_equals(&meet, &after[block->id])) {
+                bs_copy(&after[block->id], &meet);
+                changed = true;
+            }
+        }
+    }
+
+    bs_free(&meet);
+    return true;
+}
+
+void df_free_result(DFResult *result) {
+    df_free_sets(result->in, result->blocksCount);
+    df_free_sets(result->out, result->blocksCount);
+    result->in = NULL;
+    result->out = NULL;
+}
+
+// ---- Variables ----
+
+bool df_is_variable(const ASTNode *ast) {
+    return ast != NULL && ast->actionType == AST_ID && ast->inheritedDataType != CF_BLACK_HOLE
+           && ast->data[0].symbolTableItemPtr != NULL && ast->data[0].symbolTableItemPtr->type == ST_SYMBOL_VAR;
+}
+
+unsigned df_targets_count(const ASTNode *ast) {
+    if (ast == NULL || (ast->actionType != AST_ASSIGN && ast->actionType != AST_DEFINE)) {
+        return 0;
+    }
+    // Modifying assignments (e.g. +=) have a single AST_ID on the left
+    return ast->left->actionType == AST_LIST ? ast->left->dataCount : 1;
+}
+
+bool df_get_target(ASTNode *ast, unsigned index, DFTarget *target) {
+    if (ast->left->actionType != AST_LIST) {
+        target->target = ast->left;
+        target->source = ast->right;
+        target->resultIndex = 0;
+    } else {
+        target->target = ast->left->data[index].astPtr;
+        if (ast->right->dataCount == ast->left->dataCount) {
+            target->source = ast->right->data[index].astPtr;
+            target->resultIndex = 0;
+        } else {
+            // All the values are returned by a single function call
+            target->source = ast->right->data[0].astPtr;
+            target->resultIndex = index;
+        }
+    }
+    return df_is_variable(target->target);
+}
+
+static void df_visit_expression(ASTNode **ast, DFUseVisitor visitor, void *data) {
+    if (*ast == NULL) {
+        return;
+    }
+
+    if (df_is_variable(*ast)) {
+        visitor(ast, (*ast)->data[0].symbolTableItemPtr, data);
+    } else if ((*ast)->actionType == AST_LIST) {
+        for (unsigned i = 0; i < (*ast)->dataCount; i++) {
+            df_visit_expression(&(*ast)->data[i].astPtr, visitor, data);
+        }
+    } else if ((*ast)->actionType == AST_FUNC_CALL) {
+        // The left child identifies the function
+        df_visit_expression(&(*ast)->right, visitor, data);
+    } else if ((*ast)->actionType != AST_ID) {
+        df_visit_expression(&(*ast)->left, visitor, data);
+        df_visit_expression(&(*ast)->right, visitor, data);
+    }
+}
+
+void df_visit_uses(const DFVariables *variables, BBInstruction *instruction, DFUseVisitor visitor, void *data) {
+    ASTNode **ast = instruction->ast;
+    if (*ast == NULL) {
+        return;
+    }
+
+    if ((*ast)->actionType == AST_ASSIGN || (*ast)->actionType == AST_DEFINE) {
+        df_visit_expression(&(*ast)->right, visitor, data);
+    } else if (instruction->target == CF_RETURN_LIST && (*ast)->dataCount == 0) {
+        for (unsigned i = 0; i < variables->namedReturnsCount; i++) {
+            visitor(NULL, variables->namedReturns[i], data);
+        }
+    } else {
+        df_visit_expression(ast, visitor, data);
+    }
+}
+
+static bool df_add_variable(DFVariables *variables, STSymbol *symbol) {
+    unsigned index;
+    if (im_find(&variables->indices, symbol, &index)) {
+        return true;
+    }
+
+    if (!tf_reserve((void **) &variables->symbols, &variables->capacity, variables->count, sizeof(STSymbol *))) {
+        return false;
+    }
+
+    if (!im_insert(&variables->indices, symbol, variables->count)) {
+        return false;
+    }
+    variables->symbols[variables->count++] = symbol;
+    return true;
+}
+
+// State of the variables collection passed to the use visitor.
+typedef struct df_collection {
+    DFVariables *variables;
+    bool failed;
+} DFCollection;
+
+static void df_collect_use(ASTNode **slot, STSymbol *symbol, void *data) {
+    (void) slot;
+    DFCollection *collection = data;
+    if (!collection->failed && !df_add_variable(collection->variables, symbol)) {
+        collection->failed = true;
+    }
+}
+
+bool df_collect_variables(const BBGraph *graph, DFVariables *variables) {
+    variables->symbols = NULL;
+    variables->count = 0;
+    variables->capacity = 0;
+    variables->namedReturns = NULL;
+    variables->namedReturnsCount = 0;
+    im_init(&variables->indices);
+
+    CFFunction *fun = graph->function;
+    DFCollection collection = {.variables = variables, .failed = false};
+    bool success = true;
+
+    // Arguments and named return values are variables even if they're never accessed
+    if (fun->symbolTable != NULL) {
+        for (unsigned i = 0; i < fun->argumentsCount && success; i++) {
+            STItem *item = symtable_find(fun->symbolTable, fun->arguments[i].name);
+            if (item != NULL) {
+                success = df_add_variable(variables, &item->data);
+            }
+        }
+
+        if (fun->returnValuesCount > 0 && fun->returnValues[0].name != NULL) {
+            variables->namedReturns = calloc(fun->returnValuesCount, sizeof(STSymbol *));
+            success = success && variables->namedReturns != NULL;
+            for (unsigned i = 0; i < fun->returnValuesCount && success; i++) {
+                STItem *item = symtable_find(fun->symbolTable, fun->returnValues[i].name);
+                if (item != NULL) {
+                    variables->namedReturns[variables->namedReturnsCount++] = &item->data;
+                    success = df_add_variable(variables, &item->data);
+                }
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < graph->reachableCount && success; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        for (unsigned j = 0; j < block->instructionsCount && success; j++) {
+            BBInstruction *instruction = &block->instructions[j];
+            df_visit_uses(variables, instruction, df_collect_use, &collection);
+            success = !collection.failed;
+
+            DFTarget target;
+            for (unsigned t = 0; t < df_targets_count(*instruction->ast) && success; t++) {
+                if (df_get_target(*instruction->ast, t, &target)) {
+                    success = df_add_variable(variables, target.target->data[0].symbolTableItemPtr);
+                }
+            }
+        }
+    }
+
+    if (!success) {
+        df_free_variables(variables);
+        stderr_message("dataflow", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+    }
+    return success;
+}
+
+unsigned df_variable_index(const DFVariables *variables, const STSymbol *symbol) {
+    unsigned index;
+    return im_find(&variables->indices, symbol, &index) ? index : DF_NO_VARIABLE;
+}
+
+void df_free_variables(DFVariables *variables) {
+    free(variables->symbols);
+    free(variables->namedReturns);
+    im_free(&variables->indices);
+    variables->symbols = NULL;
+    variables->namedReturns = NULL;
+    variables->count = 0;
+    variables->capacity = 0;
+    variables->namedReturnsCount = 0;
+}
+
+// ---- Liveness ----
+
+typedef struct df_liveness_block {
+    const DFVariables *variables;
+    Bitset *gen;
+    Bitset *kill;
+} DFLivenessBlock;
+
+static void df_liveness_use(ASTNode **slot, STSymbol *symbol, void *data) {
+    (void) slot;
+    DFLivenessBlock *block = data;
+    unsigned index = df_variable_index(block->variables, symbol);
+    // A read is upward exposed if the variable hasn't been written before in the block
+    if (index != DF_NO_VARIABLE && !bs_test(block->kill, index)) {
+        bs_set(block->gen, index);
+    }
+}
+
+bool df_liveness(const BBGraph *graph, const DFVariables *variables, DFResult *result) {
+    Bitset *gen = df_alloc_sets(graph->blocksCount, variables->count);
+    Bitset *kill = df_alloc_sets(graph->blocksCount, variables->count);
+    if (gen == NULL || kill == NULL) {
+        df_free_sets(gen, gen == NULL ? 0 : graph->blocksCount);
+        df_free_sets(kill, kill == NULL ? 0 : graph->blocksCount);
+        stderr_message("dataflow", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return false;
+    }
+
+    for (unsigned i = 0; i < graph->reachableCount; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        DFLivenessBlock data = {.variables = variables, .gen = &gen[block->id], .kill = &kill[block->id]};
+        for (unsigned j = 0; j < block->instructionsCount; j++) {
+            BBInstruction *instruction = &block->instructions[j];
+            df_visit_uses(variables, instruction, df_liveness_use, &data);
+
+            DFTarget target;
+            for (unsigned t = 0; t < df_targets_count(*instruction->ast); t++) {
+                if (df_get_target(*instruction->ast, t, &target)) {
+                    unsigned index = df_variable_index(variables, target.target->data[0].symbolTableItemPtr);
+                    if (index != DF_NO_VARIABLE) {
+                        bs_set(&kill[block->id], index);
+                    }
+                }
+            }
+        }
+    }
+
+    DFProblem problem = {.direction = DF_BACKWARD, .meet = DF_UNION, .size = variables->count, .gen = gen,
+                         .kill = kill, .boundary = NULL};
+    bool success = df_solve(graph, &problem, result);
+    df_free_sets(gen, graph->blocksCount);
+    df_free_sets(kill, graph->blocksCount);
+    return success;
+}
@@ -0,0 +1,158 @@
+/** @file dataflow.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions and data types for bit sets, the generic dataflow analysis solver
+ *        and the access to variables in basic blocks.
+ */
+
+#ifndef _DATAFLOW_H
+#define _DATAFLOW_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "basic_blocks.h"
+#include "index_map.h"
+
+/** Returned by df_variable_index() for symbols that aren't variables of the function. */
+#define DF_NO_VARIABLE ((unsigned) -1)
+
+/** A set of integers from 0 to size - 1. */
+typedef struct bitset {
+    uint64_t *words;
+    unsigned size;
+} Bitset;
+
+/** @brief Initializes an empty set for the given number of elements. Returns false if memory couldn't be allocated. */
+bool bs_init(Bitset *set, unsigned size);
+
+/** @brief Destroys the set. */
+void bs_free(Bitset *set);
+
+/** @brief Adds the element to the set. */
+void bs_set(Bitset *set, unsigned element);
+
+/** @brief Removes the element from the set. */
+void bs_clear(Bitset *set, unsigned element);
+
+/** @brief Checks whether the element is in the set. */
+bool bs_test(const Bitset *set, unsigned element);
+
+/** @brief Removes all the elements from the set. */
+void bs_reset(Bitset *set);
+
+/** @brief Adds all the elements to the set. */
+void bs_fill(Bitset *set);
+
+/** @brief Returns the smallest element of the set that is at least from, or the size of the set if there's none.
+ *         Used to iterate over the set: for (i = bs_next(s, 0); i < s->size; i = bs_next(s, i + 1)). */
+unsigned bs_next(const Bitset *set, unsigned from);
+
+/** @brief Copies src into dst, both must have the same size. */
+void bs_copy(Bitset *dst, const Bitset *src);
+
+/** @brief Adds the elements of src to dst. Returns true if dst changed. */
+bool bs_union(Bitset *dst, const Bitset *src);
+
+/** @brief Removes the elements not present in src from dst. Returns true if dst changed. */
+bool bs_intersect(Bitset *dst, const Bitset *src);
+
+/** @brief Removes the elements of src from dst. */
+void bs_difference(Bitset *dst, const Bitset *src);
+
+/** @brief Checks whether both sets contain the same elements. */
+bool bs_equals(const Bitset *a, const Bitset *b);
+
+/** @brief Allocates an array of count empty sets for the given number of elements. Returns NULL if memory couldn't
+ *         be allocated. */
+Bitset *df_alloc_sets(unsigned count, unsigned size);
+
+/** @brief Destroys the array of count sets, it may be NULL. */
+void df_free_sets(Bitset *sets, unsigned count);
+
+typedef enum df_direction {
+    DF_FORWARD,  /**< Facts flow from predecessors to successors (e.g. reaching definitions). */
+    DF_BACKWARD  /**< Facts flow from successors to predecessors (e.g. liveness). */
+} DFDirection;
+
+typedef enum df_meet {
+    DF_UNION,       /**< A fact holds if it holds on any path ("may" problems). */
+    DF_INTERSECTION /**< A fact holds if it holds on all paths ("must" problems). */
+} DFMeet;
+
+/** A dataflow problem in the gen/kill form, the transfer function of a block is gen ∪ (x − kill). */
+typedef struct df_problem {
+    DFDirection direction;
+    DFMeet meet;
+    unsigned size;          /**< Number of facts. */
+    const Bitset *gen;      /**< Facts generated by each block, indexed by block ids. */
+    const Bitset *kill;     /**< Facts killed by each block, indexed by block ids. */
+    const Bitset *boundary; /**< Facts at the entry (forward) or exit (backward) block, NULL for none. */
+} DFProblem;
+
+/** Solution of a dataflow problem. The sets are indexed by block ids, unreachable blocks have empty sets. */
+typedef struct df_result {
+    Bitset *in;            /**< Facts holding at the start of each block. */
+    Bitset *out;           /**< Facts holding at the end of each block. */
+    unsigned blocksCount;
+    unsigned iterations;   /**< Number of passes over the blocks until the fixed point was reached. */
+} DFResult;
+
+/** @brief Solves the problem on the reachable blocks of the graph by iterating to the fixed point.
+ *
+ * The blocks are visited in reverse postorder for forward problems and in postorder for backward ones.
+ * Returns false if memory couldn't be allocated.
+ */
+bool df_solve(const BBGraph *graph, const DFProblem *problem, DFResult *result);
+
+/** @brief Destroys the result. */
+void df_free_result(DFResult *result);
+
+/** Variables of a function, numbered so that they can be used as facts of dataflow problems. */
+typedef struct df_variables {
+    STSymbol **symbols;       /**< Symbols of the variables, indexed by their numbers. */
+    unsigned count;
+    unsigned capacity;
+    IndexMap indices;         /**< Numbers of the variables keyed by their symbols. */
+    STSymbol **namedReturns;  /**< Symbols of the named return values, which an empty return statement returns. */
+    unsigned namedReturnsCount;
+} DFVariables;
+
+/** @brief Numbers all variables accessed in the reachable blocks of the graph, including arguments and named
+ *         return values. Returns false if memory couldn't be allocated. */
+bool df_collect_variables(const BBGraph *graph, DFVariables *variables);
+
+/** @brief Returns the number of the variable or DF_NO_VARIABLE. */
+unsigned df_variable_index(const DFVariables *variables, const STSymbol *symbol);
+
+/** @brief Destroys the variables. */
+void df_free_variables(DFVariables *variables);
+
+/** @brief Checks whether the AST is an AST_ID node referring to a variable (not a function or the black hole). */
+bool df_is_variable(const ASTNode *ast);
+
+/** Called for each read of a variable. The slot holds the AST_ID node; it's NULL for the implicit reads of named
+ *  return values by an empty return statement. */
+typedef void (*DFUseVisitor)(ASTNode **slot, STSymbol *symbol, void *data);
+
+/** @brief Visits the reads of variables in the instruction in the order of evaluation. */
+void df_visit_uses(const DFVariables *variables, BBInstruction *instruction, DFUseVisitor visitor, void *data);
+
+/** A variable written by an assignment or a definition. */
+typedef struct df_target {
+    ASTNode *target;      /**< The AST_ID node on the left side. */
+    ASTNode *source;      /**< The assigned expression or the function call returning the value. */
+    unsigned resultIndex; /**< Which of the values returned by the source function call is assigned. */
+} DFTarget;
+
+/** @brief Returns the number of targets (including black holes) of an assignment or a definition, zero for
+ *         other ASTs. */
+unsigned df_targets_count(const ASTNode *ast);
+
+/** @brief Describes the index-th target of an assignment or a definition. Returns false for a black hole. */
+bool df_get_target(ASTNode *ast, unsigned index, DFTarget *target);
+
+/** @brief Computes which variables are live at the start and at the end of each block. */
+bool df_liveness(const BBGraph *graph, const DFVariables *variables, DFResult *result);
+
+#endif
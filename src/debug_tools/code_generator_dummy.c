@@ -158,19 +158,18 @@ void print_stat_rec(CFStatement *stat) {
     }
 }
 
-void print_arg_list(CFVarListNode *first) {
-    while (first != NULL) {
-        printf("   - #%u: Name: '%s', Type: '%i'\n", first->variable.position,
-               first->variable.name, first->variable.dataType);
-        first = first->next;
+void print_arg_list(CFVariable *vars, unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        printf("   - #%u: Name: '%s', Type: '%i'\n", vars[i].position,
+               vars[i].name, vars[i].dataType);
     }
 }
 
 void print_fun(CFFunction *fun) {
     printf("-- Arguments:\n");
-    print_arg_list(fun->arguments);
+    print_arg_list(fun->arguments, fun->argumentsCount);
     printf("-- Return values:\n");
-    print_arg_list(fun->returnValues);
+    print_arg_list(fun->returnValues, fun->returnValuesCount);
     printf("-- Control flow:\n");
     print_stat_rec(fun->rootStatement);
     putchar('\n');
@@ -178,13 +177,11 @@ void print_fun(CFFunction *fun) {
 
 void tcg_generate() {
     CFProgram *prog = get_program();
-    CFFuncListNode *n = prog->functionList;
     printf("-- Start --\n");
-    while (n != NULL) {
-        printf("-- Function '%s' --\n", n->fun.name);
-        print_fun(&n->fun);
+    for (unsigned i = 0; i < prog->functionsCount; i++) {
+        printf("-- Function '%s' --\n", prog->functions[i]->name);
+        print_fun(prog->functions[i]);
         putchar('\n');
-        n = n->next;
     }
     printf("-- End --");
 }
@@ -0,0 +1,183 @@
+/** @file dse.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the liveness analysis and the dead store elimination.
+ */
+
+#include <stdlib.h>
+#include "dse.h"
+#include "basic_blocks.h"
+#include "dataflow.h"
+#include "transform.h"
+
+typedef struct dse_context {
+    BBGraph *graph;
+    DFVariables variables;
+    Bitset *in;  // Variables live at the start of each block, indexed by block ids.
+    Bitset *out; // Variables live at the end of each block.
+    Bitset live; // Variables live at the current instruction.
+    Bitset named; // Variables read by unreachable statements.
+
+    CFStatement **dead; // Statements to remove.
+    unsigned deadCount;
+    unsigned deadCapacity;
+    bool failed;
+} DSEContext;
+
+static void dse_use(ASTNode **slot, STSymbol *symbol, void *data) {
+    (void) slot;
+    DSEContext *ctx = data;
+    unsigned index = df_variable_index(&ctx->variables, symbol);
+    if (index != DF_NO_VARIABLE) {
+        bs_set(&ctx->live, index);
+    }
+}
+
+// Checks whether the instruction is a basic statement that can be removed if its targets are dead.
+static bool dse_is_removable(const BBInstruction *instruction) {
+    const ASTNode *ast = *instruction->ast;
+    return instruction->target == CF_STATEMENT_BODY && instruction->statement->statementType == CF_BASIC
+           && df_targets_count(ast) > 0 && !tf_has_impure_call(ast->right) && !tf_may_fail(ast->right);
+}
+
+// Checks whether the instruction assigns a live variable.
+static bool dse_assigns_live(DSEContext *ctx, BBInstruction *instruction) {
+    DFTarget target;
+    for (unsigned t = 0; t < df_targets_count(*instruction->ast); t++) {
+        if (df_get_target(*instruction->ast, t, &target)) {
+            unsigned index = df_variable_index(&ctx->variables, target.target->data[0].symbolTableItemPtr);
+            if (index == DF_NO_VARIABLE || bs_test(&ctx->live, index) || bs_test(&ctx->named, index)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Updates the live variables from after the instruction to before it. Returns true if the instruction is dead.
+static bool dse_transfer(DSEContext *ctx, BBInstruction *instruction) {
+    if (dse_is_removable(instruction) && !dse_assigns_live(ctx, instruction)) {
+        // The values read by a dead instruction aren't needed
+        return true;
+    }
+
+    DFTarget target;
+    for (unsigned t = 0; t < df_targets_count(*instruction->ast); t++) {
+        if (df_get_target(*instruction->ast, t, &target)) {
+            unsigned index = df_variable_index(&ctx->variables, target.target->data[0].symbolTableItemPtr);
+            if (index != DF_NO_VARIABLE) {
+                bs_clear(&ctx->live, index);
+            }
+        }
+    }
+    df_visit_uses(&ctx->variables, instruction, dse_use, ctx);
+    return false;
+}
+
+// Computes the variables live at the start of the block from the ones live at its end.
+static void dse_transfer_block(DSEContext *ctx, BBBlock *block) {
+    bs_reset(&ctx->live);
+    for (unsigned s = 0; s < block->successorsCount; s++) {
+        bs_union(&ctx->live, &ctx->in[block->successors[s]->id]);
+    }
+    bs_copy(&ctx->out[block->id], &ctx->live);
+
+    for (unsigned j = block->instructionsCount; j > 0; j--) {
+        dse_transfer(ctx, &block->instructions[j - 1]);
+    }
+}
+
+// Collects the variables read by the unreachable blocks. Their values are never needed, but the code generator
+// still checks the unreachable statements, so the definitions of the variables they read must be kept.
+static void dse_collect_named(DSEContext *ctx) {
+    bs_reset(&ctx->live);
+    for (unsigned i = 0; i < ctx->graph->blocksCount; i++) {
+        BBBlock *block = ctx->graph->blocks[i];
+        for (unsigned j = 0; j < block->instructionsCount && !bb_is_reachable(block); j++) {
+            df_visit_uses(&ctx->variables, &block->instructions[j], dse_use, ctx);
+        }
+    }
+    bs_copy(&ctx->named, &ctx->live);
+}
+
+// Solves the liveness of the variables. It isn't a gen/kill problem (whether an instruction reads its variables
+// depends on whether it assigns a live one), so the blocks are iterated here in postorder until nothing changes.
+static void dse_liveness(DSEContext *ctx) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned i = ctx->graph->reachableCount; i > 0; i--) {
+            BBBlock *block = ctx->graph->reversePostorder[i - 1];
+            dse_transfer_block(ctx, block);
+            if (!bs_equals(&ctx->in[block->id], &ctx->live)) {
+                bs_copy(&ctx->in[block->id], &ctx->live);
+                changed = true;
+            }
+        }
+    }
+}
+
+static void dse_add_dead(DSEContext *ctx, CFStatement *stat) {
+    if (!tf_reserve((void **) &ctx->dead, &ctx->deadCapacity, ctx->deadCount, sizeof(CFStatement *))) {
+        ctx->failed = true;
+        return;
+    }
+    ctx->dead[ctx->deadCount++] = stat;
+}
+
+// Finds the dead statements using the solved liveness.
+static void dse_find_dead(DSEContext *ctx) {
+    for (unsigned i = 0; i < ctx->graph->reachableCount && !ctx->failed; i++) {
+        BBBlock *block = ctx->graph->reversePostorder[i];
+        bs_copy(&ctx->live, &ctx->out[block->id]);
+        for (unsigned j = block->instructionsCount; j > 0 && !ctx->failed; j--) {
+            BBInstruction *instruction = &block->instructions[j - 1];
+            if (dse_transfer(ctx, instruction)) {
+                dse_add_dead(ctx, instruction->statement);
+            }
+        }
+    }
+}
+
+bool dse_run(CFFunction *fun, unsigned *removed) {
+    *removed = 0;
+    DSEContext ctx = {.graph = bb_build(fun)};
+    if (ctx.graph == NULL) {
+        return false;
+    }
+    if (!df_collect_variables(ctx.graph, &ctx.variables)) {
+        bb_free(ctx.graph);
+        return false;
+    }
+
+    unsigned blocksCount = ctx.graph->blocksCount;
+    ctx.in = df_alloc_sets(blocksCount, ctx.variables.count);
+    ctx.out = df_alloc_sets(blocksCount, ctx.variables.count);
+    bool liveInitialised = bs_init(&ctx.live, ctx.variables.count);
+    bool namedInitialised = bs_init(&ctx.named, ctx.variables.count);
+    ctx.failed = ctx.in == NULL || ctx.out == NULL || !liveInitialised || !namedInitialised;
+
+    if (!ctx.failed) {
+        dse_collect_named(&ctx);
+        dse_liveness(&ctx);
+        dse_find_dead(&ctx);
+    }
+
+    // The graph refers to the statements, so they're only removed once it's freed
+    df_free_sets(ctx.in, blocksCount);
+    df_free_sets(ctx.out, blocksCount);
+    bs_free(&ctx.live);
+    bs_free(&ctx.named);
+    df_free_variables(&ctx.variables);
+    bb_free(ctx.graph);
+
+    for (unsigned i = 0; i < ctx.deadCount && !ctx.failed; i++) {
+        if (tf_can_remove_statement(ctx.dead[i])) {
+            tf_remove_statement(ctx.dead[i]);
+            (*removed)++;
+        }
+    }
+    free(ctx.dead);
+    return !ctx.failed;
+}
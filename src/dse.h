@@ -0,0 +1,26 @@
+/** @file dse.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the dead store elimination.
+ */
+
+#ifndef _DSE_H
+#define _DSE_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Removes the assignments and definitions whose values are never read.
+ *  - A variable is live at a point if its value may be read later by a statement that isn't removed itself,
+ *    so a variable that is only read to compute its own dead values (e.g. a sum updated in a loop and never read
+ *    afterwards) is dead as well.
+ *  - Only the basic statements are removed, if none of their targets is live and computing the values has no side
+ *    effects: it doesn't call functions other than the pure built-ins and it can't fail at runtime. The statements
+ *    calling functions are kept for their effects.
+ * The variables that are no longer read have no references left, so the code generator doesn't define them.
+ * Stores the number of removed statements, returns false if memory couldn't be allocated.
+ */
+bool dse_run(CFFunction *fun, unsigned *removed);
+
+#endif // _DSE_H
@@ -0,0 +1,651 @@
+/** @file gvn.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the elimination of common subexpressions using value numbering over the SSA form.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gvn.h"
+#include "transform.h"
+
+#define GVN_NONE ((unsigned) -1)
+#define GVN_MAX_OPERANDS 3
+#define GVN_MAX_RESULTS 2
+// Estimated number of instructions of a call of ord, chr or substr.
+#define GVN_CALL_COST 8
+// Minimal cost of a computation that is worth moving into a temporary to be reused once outside of a loop.
+// The definition of the temporary takes an instruction and the first computation needs one more to read it.
+#define GVN_MIN_REUSE_COST 4
+
+// An expression that identifies a value number: an operator applied to value numbers,
+// a variable value (AST_ID with the SSA value id as its operand) or a constant.
+typedef struct gvn_key {
+    ASTNodeType op;
+    const STSymbol *function;            // The called built-in function (AST_FUNC_CALL only).
+    ASTNodeData constant;                // The value (constants only).
+    unsigned operands[GVN_MAX_OPERANDS];
+    unsigned operandsCount;
+} GVNKey;
+
+// A computation that may be reused by the following computations of the same value.
+typedef struct gvn_occurrence {
+    ASTNode **slot;                       // The slot holding the computation.
+    ASTNode *root;                        // The AST of the instruction containing the slot.
+    CFStatement *statement;               // The statement of the instruction.
+    unsigned loopDepth;                   // Number of loops the computation is evaluated in.
+    struct gvn_occurrence *parent;        // The closest occurrence containing this one.
+
+    unsigned resultsCount;                // 1 for expressions, 2 for the definitions by ord, chr and substr.
+    STDataType types[GVN_MAX_RESULTS];
+    STSymbol *temporaries[GVN_MAX_RESULTS];
+    CFStatement *definition;              // The statement defining the temporaries, NULL until it's reused.
+} GVNOccurrence;
+
+// An occurrence hidden by an occurrence made available in a dominated block.
+typedef struct gvn_undo {
+    unsigned number;
+    GVNOccurrence *previous;
+} GVNUndo;
+
+// The instruction being processed.
+typedef struct gvn_instruction {
+    BBBlock *block;
+    BBInstruction *instruction;
+    bool canDefine;     // Whether the computations of the instruction may be moved before its statement.
+    bool canDefineTrap; // The same for computations that may fail at runtime.
+    BBLoop *loop;       // The loop of a FOR condition, whose computations must be invariant in it.
+} GVNInstruction;
+
+typedef struct gvn_context {
+    SSAForm *ssa;
+
+    GVNKey *keys; // Keys of the value numbers, indexed by the numbers.
+    unsigned keysCount;
+    unsigned keysCapacity;
+
+    unsigned *table; // Hash table of the value numbers (GVN_NONE marks an empty slot).
+    unsigned tableCapacity;
+
+    IndexMap nodeNumbers; // Value numbers of the nodes of the current instruction.
+
+    GVNOccurrence **available; // The available occurrence of each value number (NULL if there's none).
+    unsigned availableCapacity;
+
+    GVNUndo *undo;
+    unsigned undoCount;
+    unsigned undoCapacity;
+
+    GVNOccurrence **occurrences; // All occurrences, owned by the context.
+    unsigned occurrencesCount;
+    unsigned occurrencesCapacity;
+
+    unsigned eliminated;
+    bool failed;
+} GVNContext;
+
+static uint64_t gvn_hash_constant(ASTNodeType type, ASTNodeData constant) {
+    uint64_t hash = 0;
+    switch (type) {
+        case AST_CONST_STRING:
+            // FNV-1a
+            hash = 14695981039346656037u;
+            for (const char *c = constant.stringConstantValue; *c != '\0'; c++) {
+                hash = (hash ^ (unsigned char) *c) * 1099511628211u;
+            }
+            break;
+        case AST_CONST_FLOAT:
+            memcpy(&hash, &constant.floatConstantValue, sizeof(double));
+            break;
+        case AST_CONST_INT:
+            hash = (uint64_t) constant.intConstantValue;
+            break;
+        case AST_CONST_BOOL:
+            hash = constant.boolConstantValue;
+            break;
+        default:
+            break;
+    }
+    return hash;
+}
+
+static unsigned gvn_hash(const GVNKey *key) {
+    uint64_t hash = (uint64_t) key->op * 31 + (uintptr_t) key->function;
+    hash = hash * 1099511628211u + gvn_hash_constant(key->op, key->constant);
+    for (unsigned i = 0; i < key->operandsCount; i++) {
+        hash = hash * 1099511628211u + key->operands[i];
+    }
+    return (unsigned) (hash ^ (hash >> 32));
+}
+
+static bool gvn_keys_equal(const GVNKey *a, const GVNKey *b) {
+    if (a->op != b->op || a->function != b->function || a->operandsCount != b->operandsCount) {
+        return false;
+    }
+    for (unsigned i = 0; i < a->operandsCount; i++) {
+        if (a->operands[i] != b->operands[i]) {
+            return false;
+        }
+    }
+    switch (a->op) {
+        case AST_CONST_INT:
+            return a->constant.intConstantValue == b->constant.intConstantValue;
+        case AST_CONST_FLOAT:
+            return memcmp(&a->constant.floatConstantValue, &b->constant.floatConstantValue, sizeof(double)) == 0;
+        case AST_CONST_STRING:
+            return strcmp(a->constant.stringConstantValue, b->constant.stringConstantValue) == 0;
+        case AST_CONST_BOOL:
+            return a->constant.boolConstantValue == b->constant.boolConstantValue;
+        default:
+            return true;
+    }
+}
+
+static bool gvn_grow_table(GVNContext *ctx) {
+    unsigned newCapacity = ctx->tableCapacity == 0 ? 64 : ctx->tableCapacity * 2;
+    unsigned *newTable = malloc(newCapacity * sizeof(unsigned));
+    if (newTable == NULL) {
+        return false;
+    }
+    for (unsigned i = 0; i < newCapacity; i++) {
+        newTable[i] = GVN_NONE;
+    }
+    for (unsigned number = 0; number < ctx->keysCount; number++) {
+        unsigned slot = gvn_hash(&ctx->keys[number]) & (newCapacity - 1);
+        while (newTable[slot] != GVN_NONE) {
+            slot = (slot + 1) & (newCapacity - 1);
+        }
+        newTable[slot] = number;
+    }
+    free(ctx->table);
+    ctx->table = newTable;
+    ctx->tableCapacity = newCapacity;
+    return true;
+}
+
+// Returns the value number of the key, assigning a new one if it hasn't been seen yet.
+static unsigned gvn_lookup(GVNContext *ctx, const GVNKey *key) {
+    if ((ctx->keysCount + 1) * 2 > ctx->tableCapacity && !gvn_grow_table(ctx)) {
+        ctx->failed = true;
+        return GVN_NONE;
+    }
+
+    unsigned slot = gvn_hash(key) & (ctx->tableCapacity - 1);
+    while (ctx->table[slot] != GVN_NONE) {
+        if (gvn_keys_equal(&ctx->keys[ctx->table[slot]], key)) {
+            return ctx->table[slot];
+        }
+        slot = (slot + 1) & (ctx->tableCapacity - 1);
+    }
+
+    if (!tf_reserve((void **) &ctx->keys, &ctx->keysCapacity, ctx->keysCount, sizeof(GVNKey))) {
+        ctx->failed = true;
+        return GVN_NONE;
+    }
+    ctx->keys[ctx->keysCount] = *key;
+    if (key->op == AST_CONST_STRING) {
+        // The constant may be freed with its AST, the key keeps its own copy
+        char *copy = malloc(strlen(key->constant.stringConstantValue) + 1);
+        if (copy == NULL) {
+            ctx->failed = true;
+            return GVN_NONE;
+        }
+        strcpy(copy, key->constant.stringConstantValue);
+        ctx->keys[ctx->keysCount].constant.stringConstantValue = copy;
+    }
+    ctx->table[slot] = ctx->keysCount;
+    return ctx->keysCount++;
+}
+
+static unsigned gvn_number(GVNContext *ctx, const ASTNode *node);
+
+// Computes the value number of the node.
+static unsigned gvn_compute_number(GVNContext *ctx, const ASTNode *node) {
+    GVNKey key = {.op = node->actionType};
+
+    switch (node->actionType) {
+        case AST_ID: {
+            SSAValue *value = ssa_value_of(ctx->ssa, node);
+            if (value == NULL) {
+                return GVN_NONE;
+            }
+            key.operands[0] = value->id;
+            key.operandsCount = 1;
+            return gvn_lookup(ctx, &key);
+        }
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_STRING:
+        case AST_CONST_BOOL:
+            key.constant = node->data[0];
+            return gvn_lookup(ctx, &key);
+        case AST_FUNC_CALL: {
+            const ASTNode *arguments = node->right;
+            unsigned count = arguments == NULL ? 0 : arguments->dataCount;
+            if (!tf_is_pure_builtin_call(node) || count > GVN_MAX_OPERANDS) {
+                return GVN_NONE;
+            }
+            key.function = node->left->data[0].symbolTableItemPtr;
+            for (unsigned i = 0; i < count; i++) {
+                key.operands[i] = gvn_number(ctx, arguments->data[i].astPtr);
+                if (key.operands[i] == GVN_NONE) {
+                    return GVN_NONE;
+                }
+            }
+            key.operandsCount = count;
+            return gvn_lookup(ctx, &key);
+        }
+        case AST_AR_NEGATE:
+        case AST_LOG_NOT:
+            key.operands[0] = gvn_number(ctx, node->left);
+            if (key.operands[0] == GVN_NONE) {
+                return GVN_NONE;
+            }
+            key.operandsCount = 1;
+            return gvn_lookup(ctx, &key);
+        default:
+            break;
+    }
+
+    if (node->actionType >= AST_CONTROL) {
+        return GVN_NONE;
+    }
+
+    // Binary operators
+    unsigned left = gvn_number(ctx, node->left);
+    unsigned right = gvn_number(ctx, node->right);
+    if (left == GVN_NONE || right == GVN_NONE) {
+        return GVN_NONE;
+    }
+
+    key.operands[0] = left;
+    key.operands[1] = right;
+    key.operandsCount = 2;
+
+    // Commutative operators get their operands ordered by the value numbers, a > b is turned into b < a
+    bool commutative = node->actionType == AST_MULTIPLY || node->actionType == AST_LOG_EQ
+                       || node->actionType == AST_LOG_NEQ
+                       || (node->actionType == AST_ADD && node->inheritedDataType != CF_STRING);
+    bool swappable = node->actionType >= AST_LOG_LT && node->actionType <= AST_LOG_GTE;
+    if (left > right && (commutative || swappable)) {
+        key.operands[0] = right;
+        key.operands[1] = left;
+        if (swappable) {
+            static const ASTNodeType swapped[] = {AST_LOG_GT, AST_LOG_LT, AST_LOG_GTE, AST_LOG_LTE};
+            key.op = swapped[node->actionType - AST_LOG_LT];
+        }
+    }
+    return gvn_lookup(ctx, &key);
+}
+
+// Returns the value number of the node (GVN_NONE if it can't be numbered), the numbers are cached for the nodes
+// of the current instruction.
+static unsigned gvn_number(GVNContext *ctx, const ASTNode *node) {
+    if (node == NULL) {
+        return GVN_NONE;
+    }
+
+    unsigned number;
+    if (im_find(&ctx->nodeNumbers, node, &number)) {
+        return number;
+    }
+    number = gvn_compute_number(ctx, node);
+    if (!im_insert(&ctx->nodeNumbers, node, number)) {
+        ctx->failed = true;
+    }
+    return number;
+}
+
+// Returns the estimated number of instructions evaluating the computation on the stack takes.
+static unsigned gvn_cost(const ASTNode *node) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->actionType == AST_LIST) {
+        unsigned cost = 0;
+        for (unsigned i = 0; i < node->dataCount; i++) {
+            cost += gvn_cost(node->data[i].astPtr);
+        }
+        return cost;
+    }
+    if (node->actionType == AST_FUNC_CALL) {
+        // ord, chr and substr check their arguments, the other built-ins are a single instruction
+        const STFunctionData *function = &node->left->data[0].symbolTableItemPtr->data.func_data;
+        return (function->ret_types_count > 1 ? GVN_CALL_COST : 2) + gvn_cost(node->right);
+    }
+    return 1 + gvn_cost(node->left) + gvn_cost(node->right);
+}
+
+// Returns the number of loops the instruction is evaluated in.
+static unsigned gvn_loop_depth(const GVNInstruction *ins) {
+    return ins->block->loop == NULL ? 0 : ins->block->loop->depth;
+}
+
+static GVNOccurrence *gvn_new_occurrence(GVNContext *ctx, GVNInstruction *ins, ASTNode **slot,
+                                         GVNOccurrence *parent) {
+    if (!tf_reserve((void **) &ctx->occurrences, &ctx->occurrencesCapacity, ctx->occurrencesCount,
+                     sizeof(GVNOccurrence *))) {
+        ctx->failed = true;
+        return NULL;
+    }
+    GVNOccurrence *occurrence = calloc(1, sizeof(GVNOccurrence));
+    if (occurrence == NULL) {
+        ctx->failed = true;
+        return NULL;
+    }
+    occurrence->slot = slot;
+    occurrence->root = *ins->instruction->ast;
+    occurrence->statement = ins->instruction->statement;
+    // The computations moved out of a FOR condition are evaluated before the loop
+    occurrence->loopDepth = gvn_loop_depth(ins) - (ins->loop != NULL);
+    occurrence->parent = parent;
+    ctx->occurrences[ctx->occurrencesCount++] = occurrence;
+    return occurrence;
+}
+
+// Makes the occurrence available for the following computations of the value number.
+static void gvn_make_available(GVNContext *ctx, unsigned number, GVNOccurrence *occurrence) {
+    unsigned oldCapacity = ctx->availableCapacity;
+    if (!tf_reserve((void **) &ctx->available, &ctx->availableCapacity, number, sizeof(GVNOccurrence *))
+        || !tf_reserve((void **) &ctx->undo, &ctx->undoCapacity, ctx->undoCount, sizeof(GVNUndo))) {
+        ctx->failed = true;
+        return;
+    }
+    for (unsigned i = oldCapacity; i < ctx->availableCapacity; i++) {
+        ctx->available[i] = NULL;
+    }
+
+    ctx->undo[ctx->undoCount++] = (GVNUndo) {number, ctx->available[number]};
+    ctx->available[number] = occurrence;
+}
+
+static GVNOccurrence *gvn_available(GVNContext *ctx, unsigned number) {
+    return number < ctx->availableCapacity ? ctx->available[number] : NULL;
+}
+
+// Moves the computation of the occurrence into a definition of new temporaries, placed right before the statement
+// containing it (which is the definition of an enclosing occurrence if that one has been moved already).
+static bool gvn_materialise(GVNContext *ctx, GVNOccurrence *occurrence) {
+    if (occurrence->definition != NULL) {
+        return true;
+    }
+
+    CFStatement *statement = occurrence->statement;
+    ASTNode *root = occurrence->root;
+    for (GVNOccurrence *parent = occurrence->parent; parent != NULL; parent = parent->parent) {
+        if (parent->definition != NULL) {
+            statement = parent->definition;
+            root = parent->definition->data.bodyAst;
+            break;
+        }
+    }
+
+    CFFunction *function = ctx->ssa->graph->function;
+    for (unsigned i = 0; i < occurrence->resultsCount; i++) {
+        occurrence->temporaries[i] = tf_new_temporary(function, "cse", occurrence->types[i]);
+        if (occurrence->temporaries[i] == NULL) {
+            ctx->failed = true;
+            return false;
+        }
+    }
+
+    // A single value is read directly, the values of a call of ord, chr or substr replace the call's list
+    bool single = occurrence->resultsCount == 1;
+    ASTNode *replacement = single ? tf_read(occurrence->temporaries[0]) : ast_node_list(occurrence->resultsCount);
+    ASTNode *values = single ? ast_node_list(1) : NULL;
+    if (replacement == NULL || (single && values == NULL)) {
+        clean_ast(replacement);
+        clean_ast(values);
+        ctx->failed = true;
+        return false;
+    }
+    for (unsigned i = 0; !single && i < occurrence->resultsCount; i++) {
+        ASTNode *read = tf_read(occurrence->temporaries[i]);
+        if (read == NULL) {
+            clean_ast(replacement);
+            ctx->failed = true;
+            return false;
+        }
+        ast_push_to_list(replacement, read);
+    }
+
+    ASTNode *computation = tf_detach(root, occurrence->slot, replacement);
+    if (single) {
+        ast_push_to_list(values, computation);
+    } else {
+        values = computation;
+    }
+
+    ASTNode *definition = tf_define(occurrence->temporaries, occurrence->resultsCount, values);
+    occurrence->definition = definition == NULL ? NULL : tf_insert_before(statement, definition);
+    if (occurrence->definition == NULL) {
+        clean_ast(definition);
+        ctx->failed = true;
+        return false;
+    }
+    tf_update_calls(root);
+    return true;
+}
+
+// Checks whether reading a temporary instead of the computation in the instruction pays off.
+static bool gvn_is_profitable(GVNInstruction *ins, GVNOccurrence *available, const ASTNode *node) {
+    unsigned cost = gvn_cost(node);
+    if (available->definition != NULL || cost >= GVN_MIN_REUSE_COST) {
+        return cost > 1;
+    }
+    // Computations in loops are reused in each iteration
+    return gvn_loop_depth(ins) > available->loopDepth;
+}
+
+// Checks whether the computation in the instruction may be moved before the instruction's statement.
+static bool gvn_can_define(GVNContext *ctx, GVNInstruction *ins, const ASTNode *node) {
+    if (!ins->canDefine || (!ins->canDefineTrap && tf_may_fail(node))) {
+        return false;
+    }
+    return ins->loop == NULL || ssa_is_invariant(ctx->ssa, node, ins->loop);
+}
+
+// Replaces the computation in the slot if its value is available, otherwise makes it available
+// and processes the computations inside it. Conditional computations (the right operands of && and ||)
+// are never made available.
+static void gvn_visit(GVNContext *ctx, GVNInstruction *ins, ASTNode **slot, GVNOccurrence *parent,
+                      bool conditional) {
+    ASTNode *node = *slot;
+    if (node == NULL || ctx->failed) {
+        return;
+    }
+
+    if (tf_is_computation(node)) {
+        unsigned number = gvn_number(ctx, node);
+        GVNOccurrence *available = number == GVN_NONE ? NULL : gvn_available(ctx, number);
+
+        if (available != NULL && available->resultsCount == 1 && gvn_is_profitable(ins, available, node)) {
+            if (gvn_materialise(ctx, available)) {
+                tf_replace(*ins->instruction->ast, slot, tf_read(available->temporaries[0]));
+                if (*slot == NULL) {
+                    ctx->failed = true;
+                } else {
+                    ctx->eliminated++;
+                }
+            }
+            return;
+        }
+
+        if (number != GVN_NONE && available == NULL && !conditional && gvn_can_define(ctx, ins, node)) {
+            GVNOccurrence *occurrence = gvn_new_occurrence(ctx, ins, slot, parent);
+            if (occurrence == NULL) {
+                return;
+            }
+            occurrence->resultsCount = 1;
+            occurrence->types[0] = node->inheritedDataType;
+            gvn_make_available(ctx, number, occurrence);
+            parent = occurrence;
+        }
+    }
+
+    switch (node->actionType) {
+        case AST_LIST:
+            for (unsigned i = 0; i < node->dataCount; i++) {
+                gvn_visit(ctx, ins, &node->data[i].astPtr, parent, conditional);
+            }
+            break;
+        case AST_FUNC_CALL:
+            gvn_visit(ctx, ins, &node->right, parent, conditional);
+            break;
+        case AST_LOG_AND:
+        case AST_LOG_OR:
+            gvn_visit(ctx, ins, &node->left, parent, conditional);
+            gvn_visit(ctx, ins, &node->right, parent, true);
+            break;
+        case AST_ID:
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_STRING:
+        case AST_CONST_BOOL:
+            break;
+        default:
+            gvn_visit(ctx, ins, &node->left, parent, conditional);
+            gvn_visit(ctx, ins, &node->right, parent, conditional);
+            break;
+    }
+}
+
+// Processes a definition of two variables by a call of ord, chr or substr. If the same call has been made already,
+// its results are moved into temporaries and read by both definitions. Returns false if the instruction isn't
+// such a definition.
+static bool gvn_visit_results(GVNContext *ctx, GVNInstruction *ins, ASTNode *root) {
+    if ((root->actionType != AST_ASSIGN && root->actionType != AST_DEFINE) || root->left->actionType != AST_LIST
+        || root->right->actionType != AST_LIST || root->right->dataCount != 1) {
+        return false;
+    }
+    ASTNode *call = root->right->data[0].astPtr;
+    if (call->actionType != AST_FUNC_CALL || !tf_is_pure_builtin_call(call)) {
+        return false;
+    }
+    const STFunctionData *function = &call->left->data[0].symbolTableItemPtr->data.func_data;
+    if (function->ret_types_count != GVN_MAX_RESULTS || root->left->dataCount != GVN_MAX_RESULTS) {
+        return false;
+    }
+
+    unsigned number = gvn_number(ctx, call);
+    GVNOccurrence *available = number == GVN_NONE ? NULL : gvn_available(ctx, number);
+    if (available != NULL && available->resultsCount == GVN_MAX_RESULTS) {
+        if (gvn_materialise(ctx, available)) {
+            ASTNode *reads = ast_node_list(GVN_MAX_RESULTS);
+            for (unsigned i = 0; reads != NULL && i < GVN_MAX_RESULTS; i++) {
+                ASTNode *read = tf_read(available->temporaries[i]);
+                if (read == NULL) {
+                    clean_ast(reads);
+                    reads = NULL;
+                    break;
+                }
+                ast_push_to_list(reads, read);
+            }
+            if (reads == NULL) {
+                ctx->failed = true;
+                return true;
+            }
+            tf_replace(root, &root->right, reads);
+            ctx->eliminated++;
+        }
+        return true;
+    }
+
+    GVNOccurrence *occurrence = NULL;
+    if (number != GVN_NONE && ins->canDefine) {
+        occurrence = gvn_new_occurrence(ctx, ins, &root->right, NULL);
+        if (occurrence == NULL) {
+            return true;
+        }
+        occurrence->resultsCount = GVN_MAX_RESULTS;
+        for (unsigned i = 0; i < GVN_MAX_RESULTS; i++) {
+            occurrence->types[i] = function->ret_types[i].type;
+        }
+        gvn_make_available(ctx, number, occurrence);
+    }
+    gvn_visit(ctx, ins, &call->right, occurrence, false);
+    return true;
+}
+
+static void gvn_visit_instruction(GVNContext *ctx, BBBlock *block, BBInstruction *instruction) {
+    GVNInstruction ins = {.block = block, .instruction = instruction};
+    CFStatement *statement = instruction->statement;
+    ASTNode *root = *instruction->ast;
+
+    switch (instruction->target) {
+        case CF_STATEMENT_BODY:
+        case CF_RETURN_LIST:
+        case CF_FOR_DEFINITION:
+            ins.canDefine = true;
+            break;
+        case CF_IF_CONDITIONAL:
+            ins.canDefine = tf_can_insert_before(statement);
+            break;
+        case CF_FOR_CONDITIONAL:
+            // Computed once before the loop instead of in each iteration
+            ins.loop = bb_find_loop(ctx->ssa->graph, statement);
+            ins.canDefine = ins.loop != NULL && ins.loop->preheader != NULL;
+            break;
+        case CF_FOR_AFTERTHOUGHT:
+            break;
+    }
+    ins.canDefineTrap = ins.canDefine && !tf_has_impure_call(root)
+                        && (instruction->target != CF_FOR_CONDITIONAL
+                            || !tf_has_impure_call(statement->data.forData->definitionAst));
+
+    im_init(&ctx->nodeNumbers);
+    if (root->actionType == AST_ASSIGN || root->actionType == AST_DEFINE) {
+        if (!gvn_visit_results(ctx, &ins, root)) {
+            gvn_visit(ctx, &ins, &root->right, NULL, false);
+        }
+    } else if (root->actionType == AST_FUNC_CALL) {
+        // A call statement, its result isn't used
+        gvn_visit(ctx, &ins, &root->right, NULL, false);
+    } else {
+        gvn_visit(ctx, &ins, instruction->ast, NULL, false);
+    }
+    im_free(&ctx->nodeNumbers);
+
+    tf_update_calls(*instruction->ast);
+}
+
+// Processes the blocks of the dominator subtree, the computations of a block are available in the blocks it dominates.
+static void gvn_visit_block(GVNContext *ctx, BBBlock *block) {
+    unsigned undoMark = ctx->undoCount;
+
+    for (unsigned i = 0; i < block->instructionsCount && !ctx->failed; i++) {
+        gvn_visit_instruction(ctx, block, &block->instructions[i]);
+    }
+    for (BBBlock *child = block->domChild; child != NULL && !ctx->failed; child = child->domSibling) {
+        gvn_visit_block(ctx, child);
+    }
+
+    while (ctx->undoCount > undoMark) {
+        GVNUndo *undo = &ctx->undo[--ctx->undoCount];
+        ctx->available[undo->number] = undo->previous;
+    }
+}
+
+bool gvn_run(SSAForm *ssa, unsigned *eliminated) {
+    GVNContext ctx = {.ssa = ssa};
+    gvn_visit_block(&ctx, ssa->graph->entry);
+
+    for (unsigned i = 0; i < ctx.occurrencesCount; i++) {
+        free(ctx.occurrences[i]);
+    }
+    free(ctx.occurrences);
+    free(ctx.undo);
+    free(ctx.available);
+    free(ctx.table);
+    for (unsigned i = 0; i < ctx.keysCount; i++) {
+        if (ctx.keys[i].op == AST_CONST_STRING) {
+            free((void *) ctx.keys[i].constant.stringConstantValue);
+        }
+    }
+    free(ctx.keys);
+
+    *eliminated = ctx.eliminated;
+    return !ctx.failed;
+}
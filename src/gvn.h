@@ -0,0 +1,32 @@
+/** @file gvn.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the elimination of common subexpressions using value numbering.
+ */
+
+#ifndef _GVN_H
+#define _GVN_H 1
+
+#include "ssa.h"
+
+/* Eliminates repeated computations of pure expressions in the function the SSA form was built for.
+ *  - Expressions get value numbers based on their operators and the value numbers of their operands; variable
+ *    reads are numbered by their SSA values, so expressions reading the same definitions get the same number.
+ *    Addition, multiplication, (in)equality and the swapped relational operators are normalised first.
+ *  - Arithmetic, logic and calls of the pure built-in functions (len, ord, chr, substr, int2float, float2int) are
+ *    candidates; calls of other functions are never reused and expressions containing them aren't candidates.
+ *  - The blocks are walked in the preorder of the dominator tree, so an expression computed earlier in a statement
+ *    or in a dominating block is available. When it's computed again, the first computation is moved into
+ *    a new temporary variable defined right before its statement and both computations read the temporary.
+ *  - Only expressions evaluated unconditionally by their statement may define a temporary (not the right operands
+ *    of && and ||, not FOR afterthoughts; FOR conditions only if the loop doesn't change their operands).
+ *    Expressions that may fail at runtime (division, float2int) are only moved if their statement doesn't call
+ *    other functions, so that the order of the side effects and the failure is kept.
+ *  - A definition of two variables by ord, chr or substr is reused as a whole.
+ * The SSA form is invalid afterwards. Stores the number of eliminated computations, returns false if memory
+ * couldn't be allocated.
+ */
+bool gvn_run(SSAForm *ssa, unsigned *eliminated);
+
+#endif // _GVN_H
@@ -0,0 +1,88 @@
+/** @file index_map.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains definitions of the index map functions.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "index_map.h"
+
+/** @brief Returns the home slot of the given key. */
+static unsigned im_slot(const IndexMap *map, const void *key) {
+    // Fibonacci hashing of the pointer, the lowest bits are dropped as they're always zero due to alignment
+    uint64_t hash = ((uint64_t) (uintptr_t) key >> 3) * UINT64_C(0x9E3779B97F4A7C15);
+    return (unsigned) (hash >> 32) & (map->capacity - 1);
+}
+
+/** @brief Returns the slot the key occupies, or the empty slot where it would be inserted. */
+static IndexMapEntry *im_probe(const IndexMap *map, const void *key) {
+    unsigned i = im_slot(map, key);
+    while (map->entries[i].key != NULL && map->entries[i].key != key) {
+        i = (i + 1) & (map->capacity - 1);
+    }
+    return &map->entries[i];
+}
+
+/** @brief Reallocates the map to the new capacity, re-inserting all the entries. */
+static bool im_resize(IndexMap *map, unsigned capacity) {
+    IndexMapEntry *old = map->entries;
+    unsigned oldCapacity = map->capacity;
+
+    map->entries = calloc(capacity, sizeof(IndexMapEntry));
+    if (map->entries == NULL) {
+        map->entries = old;
+        return false;
+    }
+    map->capacity = capacity;
+
+    for (unsigned i = 0; i < oldCapacity; i++) {
+        if (old[i].key != NULL) {
+            *im_probe(map, old[i].key) = old[i];
+        }
+    }
+    free(old);
+    return true;
+}
+
+void im_init(IndexMap *map) {
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+bool im_insert(IndexMap *map, const void *key, unsigned index) {
+    // Keep the load factor at most 1/2 so that probe sequences stay short
+    if ((map->count + 1) * 2 > map->capacity) {
+        if (!im_resize(map, map->capacity == 0 ? IM_INITIAL_CAPACITY : map->capacity * 2)) {
+            return false;
+        }
+    }
+
+    IndexMapEntry *slot = im_probe(map, key);
+    if (slot->key == NULL) {
+        map->count++;
+    }
+    slot->key = key;
+    slot->index = index;
+    return true;
+}
+
+bool im_find(const IndexMap *map, const void *key, unsigned *index) {
+    if (map->count == 0) {
+        return false;
+    }
+
+    IndexMapEntry *slot = im_probe(map, key);
+    if (slot->key == NULL) {
+        return false;
+    }
+    *index = slot->index;
+    return true;
+}
+
+void im_free(IndexMap *map) {
+    free(map->entries);
+    im_init(map);
+}
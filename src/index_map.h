@@ -0,0 +1,42 @@
+/** @file index_map.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions and data types for the map assigning indices to pointers
+ *        (e.g. numbers of variables to their symbols) used by the optimiser analyses.
+ */
+
+#ifndef _INDEX_MAP_H
+#define _INDEX_MAP_H 1
+
+#include <stdbool.h>
+
+/** Initial number of slots of an index map, must be a power of two. */
+#define IM_INITIAL_CAPACITY 16
+
+/** A slot of the map. */
+typedef struct index_map_entry {
+    const void *key; /**< The pointer (NULL if the slot is empty). */
+    unsigned index;  /**< The index assigned to the pointer. */
+} IndexMapEntry;
+
+/** An open addressing hash map (with linear probing) of indices keyed by pointers. */
+typedef struct index_map {
+    IndexMapEntry *entries; /**< Slots of the map. */
+    unsigned capacity;      /**< Number of slots, always a power of two. */
+    unsigned count;         /**< Number of occupied slots. */
+} IndexMap;
+
+/** @brief Initializes an empty map. */
+void im_init(IndexMap *map);
+
+/** @brief Assigns the index to the key, replacing the previous one. Returns false if memory couldn't be allocated. */
+bool im_insert(IndexMap *map, const void *key, unsigned index);
+
+/** @brief Finds the index assigned to the key. Returns false if the key isn't in the map. */
+bool im_find(const IndexMap *map, const void *key, unsigned *index);
+
+/** @brief Destroys the map. */
+void im_free(IndexMap *map);
+
+#endif
@@ -0,0 +1,611 @@
+/** @file induction.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the strength reduction of induction variables over the SSA form.
+ */
+
+#include <stdlib.h>
+#include "induction.h"
+#include "transform.h"
+
+// Minimal number of instructions an iteration has to save by reading the temporary instead of computing
+// the expressions, so that it pays for the addition at the end of the loop body.
+#define IV_MIN_SAVED 2
+
+// A basic induction variable of a loop.
+typedef struct iv_basic {
+    BBLoop *loop;
+    STSymbol *symbol;
+    int64_t step;        // The constant the afterthought adds to the variable.
+    ASTNode *initial;    // The value assigned by the FOR definition, NULL if the variable is defined before the loop.
+} IVBasic;
+
+// A group of equal derived expressions: factor * variable [op base].
+typedef struct iv_derived {
+    const ASTNode *factor; // An integer constant or a loop-invariant variable.
+    ASTNodeType op;        // AST_ADD or AST_SUBTRACT when there's a base.
+    const ASTNode *base;   // A loop-invariant expression, NULL if there's none.
+
+    unsigned saved;        // Number of instructions saved in each iteration.
+    bool nested;           // Whether some of the expressions are evaluated in a nested loop.
+    STSymbol *temporary;   // The temporary replacing the expressions, NULL if they're not replaced.
+} IVDerived;
+
+// A derived expression in an instruction of the loop.
+typedef struct iv_occurrence {
+    BBInstruction *instruction;
+    ASTNode **slot;
+    unsigned derived; // Index of the group in IVContext.derived.
+} IVOccurrence;
+
+typedef struct iv_context {
+    SSAForm *ssa;
+    IVBasic basic;
+
+    IVDerived *derived;
+    unsigned derivedCount;
+    unsigned derivedCapacity;
+
+    IVOccurrence *occurrences;
+    unsigned occurrencesCount;
+    unsigned occurrencesCapacity;
+
+    // Removed ASTs are only freed at the end, the SSA form refers to their nodes by address
+    ASTNode **garbage;
+    unsigned garbageCount;
+    unsigned garbageCapacity;
+
+    unsigned reduced;
+    bool failed;
+} IVContext;
+
+// Keeps the removed AST until the end of the pass.
+static void iv_discard(IVContext *ctx, ASTNode *ast) {
+    if (ast == NULL) {
+        return;
+    }
+    if (!tf_reserve((void **) &ctx->garbage, &ctx->garbageCapacity, ctx->garbageCount, sizeof(ASTNode *))) {
+        ctx->failed = true;
+        return;
+    }
+    ctx->garbage[ctx->garbageCount++] = ast;
+}
+
+static bool iv_reads(const ASTNode *node, const STSymbol *symbol) {
+    return node != NULL && node->actionType == AST_ID && node->inheritedDataType != CF_BLACK_HOLE
+           && node->data[0].symbolTableItemPtr == symbol;
+}
+
+// Matches an afterthought adding a constant to a variable: i += c, i -= c, i = i + c, i = c + i or i = i - c.
+static bool iv_match_step(ASTNode *afterthought, ASTNode **target, int64_t *step) {
+    if (afterthought == NULL || afterthought->actionType != AST_ASSIGN) {
+        return false;
+    }
+
+    ASTNode *value;
+    if (afterthought->left->actionType == AST_ID) {
+        *target = afterthought->left;
+        value = afterthought->right;
+    } else if (afterthought->left->dataCount == 1 && afterthought->right->actionType == AST_LIST
+               && afterthought->right->dataCount == 1) {
+        *target = afterthought->left->data[0].astPtr;
+        value = afterthought->right->data[0].astPtr;
+    } else {
+        return false;
+    }
+    if ((*target)->inheritedDataType == CF_BLACK_HOLE
+        || (value->actionType != AST_ADD && value->actionType != AST_SUBTRACT)) {
+        return false;
+    }
+
+    const ASTNode *variable = value->left;
+    const ASTNode *constant = value->right;
+    if (value->actionType == AST_ADD && variable->actionType == AST_CONST_INT) {
+        variable = value->right;
+        constant = value->left;
+    }
+    if (!iv_reads(variable, (*target)->data[0].symbolTableItemPtr) || constant->actionType != AST_CONST_INT
+        || constant->data[0].intConstantValue == 0 || constant->data[0].intConstantValue == INT64_MIN) {
+        return false;
+    }
+
+    *step = value->actionType == AST_ADD ? constant->data[0].intConstantValue : -constant->data[0].intConstantValue;
+    return true;
+}
+
+// Finds the basic induction variable of the loop, returns false if there isn't one.
+static bool iv_find_basic(IVContext *ctx, BBLoop *loop) {
+    CFStatementFor *forData = loop->statement->data.forData;
+    ASTNode *target;
+    int64_t step;
+    if (!iv_match_step(forData->afterthoughtAst, &target, &step)) {
+        return false;
+    }
+
+    STSymbol *symbol = target->data[0].symbolTableItemPtr;
+    SSAValue *update = ssa_value_of(ctx->ssa, target);
+    if (symbol->type != ST_SYMBOL_VAR || symbol->data.var_data.type != CF_INT || update == NULL) {
+        return false;
+    }
+
+    // The afterthought must be the only assignment of the variable in the loop
+    for (unsigned i = 0; i < ctx->ssa->valuesCount; i++) {
+        SSAValue *value = ctx->ssa->values[i];
+        if (value != update && value->variable == update->variable && value->type == SSA_VALUE_DEFINITION
+            && bb_loop_contains(loop, value->block)) {
+            return false;
+        }
+    }
+
+    ASTNode *initial = NULL;
+    ASTNode *definition = forData->definitionAst;
+    if (definition != NULL && definition->left->actionType == AST_LIST) {
+        for (unsigned i = 0; i < definition->left->dataCount; i++) {
+            if (!iv_reads(definition->left->data[i].astPtr, symbol)) {
+                continue;
+            }
+            // The initial value is computed again before the loop, so it must be a single plain value
+            if (definition->left->dataCount != 1 || definition->right->actionType != AST_LIST
+                || definition->right->dataCount != 1) {
+                return false;
+            }
+            initial = definition->right->data[0].astPtr;
+            if (tf_has_impure_call(initial) || tf_may_fail(initial)) {
+                return false;
+            }
+        }
+    }
+
+    ctx->basic = (IVBasic) {loop, symbol, step, initial};
+    return true;
+}
+
+// Checks whether the node may multiply the induction variable: an integer constant or an invariant variable.
+static bool iv_is_factor(IVContext *ctx, const ASTNode *node) {
+    if (node->actionType == AST_CONST_INT) {
+        return true;
+    }
+    return node->actionType == AST_ID && node->inheritedDataType == CF_INT
+           && !iv_reads(node, ctx->basic.symbol) && ssa_is_invariant(ctx->ssa, node, ctx->basic.loop);
+}
+
+// Returns the factor if the node multiplies the induction variable, NULL otherwise.
+static const ASTNode *iv_match_product(IVContext *ctx, const ASTNode *node) {
+    if (node->actionType != AST_MULTIPLY || node->inheritedDataType != CF_INT) {
+        return NULL;
+    }
+    if (iv_reads(node->left, ctx->basic.symbol) && iv_is_factor(ctx, node->right)) {
+        return node->right;
+    }
+    if (iv_reads(node->right, ctx->basic.symbol) && iv_is_factor(ctx, node->left)) {
+        return node->left;
+    }
+    return NULL;
+}
+
+// Checks whether the node may be added to a product: it's invariant and may be evaluated before the loop.
+static bool iv_is_base(IVContext *ctx, const ASTNode *node) {
+    return node->inheritedDataType == CF_INT && !tf_has_impure_call(node) && !tf_may_fail(node)
+           && ssa_is_invariant(ctx->ssa, node, ctx->basic.loop);
+}
+
+static unsigned iv_size(const ASTNode *node) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->actionType == AST_LIST) {
+        unsigned size = 1;
+        for (unsigned i = 0; i < node->dataCount; i++) {
+            size += iv_size(node->data[i].astPtr);
+        }
+        return size;
+    }
+    return 1 + iv_size(node->left) + iv_size(node->right);
+}
+
+static void iv_add_occurrence(IVContext *ctx, BBBlock *block, BBInstruction *instruction, ASTNode **slot,
+                              const ASTNode *factor, ASTNodeType op, const ASTNode *base, bool embedded) {
+    unsigned index = 0;
+    while (index < ctx->derivedCount) {
+        IVDerived *derived = &ctx->derived[index];
+        if (tf_equal(derived->factor, factor) && derived->op == op && tf_equal(derived->base, base)) {
+            break;
+        }
+        index++;
+    }
+
+    if (index == ctx->derivedCount) {
+        if (!tf_reserve((void **) &ctx->derived, &ctx->derivedCapacity, ctx->derivedCount, sizeof(IVDerived))) {
+            ctx->failed = true;
+            return;
+        }
+        ctx->derived[ctx->derivedCount++] = (IVDerived) {.factor = factor, .op = op, .base = base};
+    }
+    if (!tf_reserve((void **) &ctx->occurrences, &ctx->occurrencesCapacity, ctx->occurrencesCount,
+                    sizeof(IVOccurrence))) {
+        ctx->failed = true;
+        return;
+    }
+    ctx->occurrences[ctx->occurrencesCount++] = (IVOccurrence) {instruction, slot, index};
+
+    // An expression inside another one is pushed to the stack, reading the temporary instead takes a single
+    // instruction. A product assigned to a variable takes a single MUL, so it only saves something with a base.
+    IVDerived *derived = &ctx->derived[index];
+    unsigned size = iv_size(*slot);
+    unsigned saved = embedded ? size - 1 : (base != NULL ? size : 0);
+    derived->saved += saved;
+    derived->nested |= saved > 0 && block->loop != ctx->basic.loop;
+}
+
+// Finds the largest derived expressions in the subtree in the slot. The embedded flag tells whether the subtree
+// is a part of a larger expression (and not the whole value of an assignment).
+static void iv_visit(IVContext *ctx, BBBlock *block, BBInstruction *instruction, ASTNode **slot, bool embedded) {
+    ASTNode *node = *slot;
+    if (node == NULL || ctx->failed) {
+        return;
+    }
+
+    const ASTNode *factor = NULL;
+    const ASTNode *base = NULL;
+    if ((node->actionType == AST_ADD || node->actionType == AST_SUBTRACT) && node->inheritedDataType == CF_INT) {
+        if ((factor = iv_match_product(ctx, node->left)) != NULL && iv_is_base(ctx, node->right)) {
+            base = node->right;
+        } else if (node->actionType == AST_ADD && (factor = iv_match_product(ctx, node->right)) != NULL
+                   && iv_is_base(ctx, node->left)) {
+            base = node->left;
+        }
+    }
+    if (base == NULL) {
+        factor = iv_match_product(ctx, node);
+    }
+    if (factor != NULL) {
+        iv_add_occurrence(ctx, block, instruction, slot, factor, base == NULL ? AST_MULTIPLY : node->actionType, base,
+                          embedded);
+        return;
+    }
+
+    switch (node->actionType) {
+        case AST_LIST:
+            for (unsigned i = 0; i < node->dataCount; i++) {
+                iv_visit(ctx, block, instruction, &node->data[i].astPtr, embedded);
+            }
+            break;
+        case AST_ASSIGN:
+        case AST_DEFINE:
+            iv_visit(ctx, block, instruction, &node->right, node->right->actionType == AST_LIST
+                                                             && node->right->dataCount > 1);
+            break;
+        case AST_FUNC_CALL:
+            iv_visit(ctx, block, instruction, &node->right, true);
+            break;
+        case AST_ID:
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_STRING:
+        case AST_CONST_BOOL:
+            break;
+        default:
+            iv_visit(ctx, block, instruction, &node->left, true);
+            iv_visit(ctx, block, instruction, &node->right, true);
+            break;
+    }
+}
+
+// Checks whether the instruction is the afterthought updating the basic induction variable.
+static bool iv_is_update(IVContext *ctx, const BBInstruction *instruction) {
+    return instruction->statement == ctx->basic.loop->statement && instruction->target == CF_FOR_AFTERTHOUGHT;
+}
+
+// Creates a node of the binary operation. Doesn't infer its type.
+static ASTNode *iv_binary(ASTNodeType op, ASTNode *left, ASTNode *right) {
+    ASTNode *node = left == NULL || right == NULL ? NULL : ast_node(op);
+    if (node == NULL) {
+        clean_ast(left);
+        clean_ast(right);
+        return NULL;
+    }
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+// Creates the value of the derived expression when the loop is entered.
+static ASTNode *iv_initial_value(IVContext *ctx, const IVDerived *derived) {
+    const ASTNode *initial = ctx->basic.initial;
+    ASTNode *value;
+    if (initial != NULL && initial->actionType == AST_CONST_INT && derived->factor->actionType == AST_CONST_INT) {
+        // Products of constants wrap around just like the MUL instruction
+        value = tf_const_int((int64_t) ((uint64_t) initial->data[0].intConstantValue
+                                        * (uint64_t) derived->factor->data[0].intConstantValue));
+    } else {
+        ASTNode *variable = initial != NULL ? tf_copy(initial) : tf_read(ctx->basic.symbol);
+        value = iv_binary(AST_MULTIPLY, variable, tf_copy(derived->factor));
+    }
+
+    if (derived->base != NULL) {
+        value = iv_binary(derived->op, value, tf_copy(derived->base));
+    }
+    if (value != NULL) {
+        ast_infer_node_type(value);
+    }
+    return value;
+}
+
+// Creates the assignment that moves the temporary to the next iteration: temporary = temporary +- delta.
+// Returns NULL without failing if the delta isn't a constant or the factor itself.
+static ASTNode *iv_update(IVContext *ctx, const IVDerived *derived, STSymbol *temporary) {
+    ASTNodeType op = AST_ADD;
+    ASTNode *delta;
+    if (derived->factor->actionType == AST_CONST_INT) {
+        delta = tf_const_int((int64_t) ((uint64_t) ctx->basic.step
+                                        * (uint64_t) derived->factor->data[0].intConstantValue));
+    } else if (ctx->basic.step == 1 || ctx->basic.step == -1) {
+        op = ctx->basic.step == 1 ? AST_ADD : AST_SUBTRACT;
+        delta = tf_copy(derived->factor);
+    } else {
+        return NULL;
+    }
+
+    ASTNode *value = iv_binary(op, tf_read(temporary), delta);
+    if (value == NULL) {
+        ctx->failed = true;
+        return NULL;
+    }
+    ast_infer_node_type(value);
+
+    ASTNode *assign = tf_assign(temporary, value);
+    if (assign == NULL) {
+        ctx->failed = true;
+    }
+    return assign;
+}
+
+// Returns the last statement of the loop body.
+static CFStatement *iv_body_end(const IVContext *ctx) {
+    CFStatement *stat = ctx->basic.loop->statement->data.forData->bodyStatement;
+    while (stat != NULL && stat->followingStatement != NULL) {
+        stat = stat->followingStatement;
+    }
+    return stat;
+}
+
+// Replaces the expressions of the group with a temporary.
+static void iv_reduce(IVContext *ctx, unsigned index) {
+    IVDerived *derived = &ctx->derived[index];
+    CFStatement *bodyEnd = iv_body_end(ctx);
+    if (bodyEnd == NULL || (derived->saved < IV_MIN_SAVED && !derived->nested)) {
+        return;
+    }
+    if (derived->factor->actionType != AST_CONST_INT && ctx->basic.step != 1 && ctx->basic.step != -1) {
+        return;
+    }
+
+    STSymbol *temporary = tf_new_temporary(ctx->ssa->graph->function, "iv", CF_INT);
+    if (temporary == NULL) {
+        ctx->failed = true;
+        return;
+    }
+    ASTNode *update = iv_update(ctx, derived, temporary);
+    ASTNode *values = ast_node_list(1);
+    ASTNode *initial = iv_initial_value(ctx, derived);
+    if (update == NULL || values == NULL || initial == NULL) {
+        clean_ast(update);
+        clean_ast(values);
+        clean_ast(initial);
+        ctx->failed = true;
+        return;
+    }
+
+    ast_push_to_list(values, initial);
+    ASTNode *definition = tf_define(&temporary, 1, values);
+    if (definition != NULL) {
+        tf_update_calls(definition);
+    }
+    if (definition == NULL || tf_insert_before(ctx->basic.loop->statement, definition) == NULL) {
+        clean_ast(definition);
+        clean_ast(update);
+        ctx->failed = true;
+        return;
+    }
+    if (tf_insert_after(bodyEnd, update) == NULL) {
+        clean_ast(update);
+        ctx->failed = true;
+        return;
+    }
+
+    // The group refers to the first expression, it must be described before it's replaced
+    derived->temporary = temporary;
+    for (unsigned i = 0; i < ctx->occurrencesCount && !ctx->failed; i++) {
+        IVOccurrence *occurrence = &ctx->occurrences[i];
+        if (occurrence->derived != index) {
+            continue;
+        }
+        ASTNode *read = tf_read(temporary);
+        if (read == NULL) {
+            ctx->failed = true;
+            return;
+        }
+        ASTNode *root = *occurrence->instruction->ast;
+        iv_discard(ctx, tf_detach(root, occurrence->slot, read));
+        tf_update_calls(root);
+        ctx->reduced++;
+    }
+}
+
+static unsigned iv_count_reads(const ASTNode *node, const STSymbol *symbol) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->actionType == AST_LIST) {
+        unsigned count = 0;
+        for (unsigned i = 0; i < node->dataCount; i++) {
+            count += iv_count_reads(node->data[i].astPtr, symbol);
+        }
+        return count;
+    }
+    return (iv_reads(node, symbol) ? 1 : 0) + iv_count_reads(node->left, symbol) + iv_count_reads(node->right, symbol);
+}
+
+// Computes factor * value op base, returns false if it overflows.
+static bool iv_evaluate(const IVDerived *derived, int64_t value, int64_t *result) {
+    if (__builtin_mul_overflow(value, derived->factor->data[0].intConstantValue, result)) {
+        return false;
+    }
+    if (derived->base == NULL) {
+        return true;
+    }
+    int64_t base = derived->base->data[0].intConstantValue;
+    return derived->op == AST_ADD ? !__builtin_add_overflow(*result, base, result)
+                                  : !__builtin_sub_overflow(*result, base, result);
+}
+
+// Rewrites the loop condition comparing the induction variable with a constant to compare the temporary
+// of the derived expression instead. Returns false if it's not possible.
+static bool iv_replace_condition(IVContext *ctx, const IVDerived *derived) {
+    ASTNode *condition = ctx->basic.loop->statement->data.forData->conditionalAst;
+    if (derived->temporary == NULL || derived->factor->actionType != AST_CONST_INT
+        || derived->factor->data[0].intConstantValue == 0
+        || (derived->base != NULL && derived->base->actionType != AST_CONST_INT)
+        || ctx->basic.initial == NULL || ctx->basic.initial->actionType != AST_CONST_INT) {
+        return false;
+    }
+
+    ASTNodeType relation = condition->actionType;
+    ASTNode **variableSlot = &condition->left;
+    ASTNode **limitSlot = &condition->right;
+    if (iv_reads(condition->right, ctx->basic.symbol)) {
+        // Mirror the comparison so that the variable is on the left
+        variableSlot = &condition->right;
+        limitSlot = &condition->left;
+        relation = relation == AST_LOG_LT ? AST_LOG_GT : relation == AST_LOG_GT ? AST_LOG_LT
+                 : relation == AST_LOG_LTE ? AST_LOG_GTE : relation == AST_LOG_GTE ? AST_LOG_LTE : relation;
+    }
+    if (!iv_reads(*variableSlot, ctx->basic.symbol) || (*limitSlot)->actionType != AST_CONST_INT) {
+        return false;
+    }
+
+    // The variable has to move towards the limit, all the values it gets must be mapped without an overflow
+    bool increasing = relation == AST_LOG_LT || relation == AST_LOG_LTE;
+    bool decreasing = relation == AST_LOG_GT || relation == AST_LOG_GTE;
+    if (!(increasing && ctx->basic.step > 0) && !(decreasing && ctx->basic.step < 0)) {
+        return false;
+    }
+    int64_t limit = (*limitSlot)->data[0].intConstantValue;
+    int64_t beyond, mapped;
+    if (__builtin_add_overflow(limit, ctx->basic.step, &beyond)
+        || !iv_evaluate(derived, ctx->basic.initial->data[0].intConstantValue, &mapped)
+        || !iv_evaluate(derived, beyond, &mapped) || !iv_evaluate(derived, limit, &mapped)) {
+        return false;
+    }
+
+    if (derived->factor->data[0].intConstantValue < 0) {
+        relation = relation == AST_LOG_LT ? AST_LOG_GT : relation == AST_LOG_GT ? AST_LOG_LT
+                 : relation == AST_LOG_LTE ? AST_LOG_GTE : AST_LOG_LTE;
+    }
+
+    ASTNode *read = tf_read(derived->temporary);
+    ASTNode *bound = tf_const_int(mapped);
+    if (read == NULL || bound == NULL) {
+        clean_ast(read);
+        clean_ast(bound);
+        ctx->failed = true;
+        return false;
+    }
+    iv_discard(ctx, tf_detach(condition, variableSlot, read));
+    iv_discard(ctx, tf_detach(condition, limitSlot, bound));
+    if (variableSlot != &condition->left) {
+        condition->left = read;
+        condition->right = bound;
+    }
+    condition->actionType = relation;
+    return true;
+}
+
+// Removes the basic induction variable if it's only kept alive by its own update and the loop condition.
+static void iv_remove_basic(IVContext *ctx) {
+    CFStatementFor *forData = ctx->basic.loop->statement->data.forData;
+    if (ctx->basic.initial == NULL) {
+        // The variable lives on after the loop
+        return;
+    }
+
+    BBLoop *loop = ctx->basic.loop;
+    for (unsigned i = 0; i < loop->blocksCount; i++) {
+        BBBlock *block = loop->blocks[i];
+        for (unsigned j = 0; j < block->instructionsCount; j++) {
+            BBInstruction *instruction = &block->instructions[j];
+            if (iv_is_update(ctx, instruction) || (instruction->statement == loop->statement
+                                                   && instruction->target == CF_FOR_CONDITIONAL)) {
+                continue;
+            }
+            if (iv_count_reads(*instruction->ast, ctx->basic.symbol) > 0) {
+                return;
+            }
+        }
+    }
+
+    if (iv_count_reads(forData->conditionalAst, ctx->basic.symbol) > 0) {
+        bool replaced = false;
+        for (unsigned i = 0; i < ctx->derivedCount && !replaced && !ctx->failed; i++) {
+            replaced = iv_replace_condition(ctx, &ctx->derived[i]);
+        }
+        if (!replaced) {
+            return;
+        }
+    }
+
+    iv_discard(ctx, forData->definitionAst);
+    iv_discard(ctx, forData->afterthoughtAst);
+    forData->definitionAst = NULL;
+    forData->afterthoughtAst = NULL;
+}
+
+// Reduces the derived expressions of the basic induction variable of the loop.
+static void iv_process_loop(IVContext *ctx, BBLoop *loop) {
+    if (!iv_find_basic(ctx, loop)) {
+        return;
+    }
+
+    ctx->derivedCount = 0;
+    ctx->occurrencesCount = 0;
+    for (unsigned i = 0; i < loop->blocksCount && !ctx->failed; i++) {
+        BBBlock *block = loop->blocks[i];
+        for (unsigned j = 0; j < block->instructionsCount && !ctx->failed; j++) {
+            BBInstruction *instruction = &block->instructions[j];
+            if (!iv_is_update(ctx, instruction)) {
+                iv_visit(ctx, block, instruction, instruction->ast, false);
+            }
+        }
+    }
+
+    unsigned reduced = ctx->reduced;
+    for (unsigned i = 0; i < ctx->derivedCount && !ctx->failed; i++) {
+        iv_reduce(ctx, i);
+    }
+    if (ctx->reduced > reduced && !ctx->failed) {
+        iv_remove_basic(ctx);
+    }
+}
+
+bool induction_run(SSAForm *ssa, unsigned *reduced) {
+    IVContext ctx = {.ssa = ssa};
+
+    // Inner loops first, so the expressions of the outer loops moved into them are seen as well
+    for (unsigned i = ssa->graph->loopsCount; i > 0 && !ctx.failed; i--) {
+        BBLoop *loop = ssa->graph->loops[i - 1];
+        if (loop->statement != NULL && loop->statement->statementType == CF_FOR) {
+            iv_process_loop(&ctx, loop);
+        }
+    }
+
+    for (unsigned i = 0; i < ctx.garbageCount; i++) {
+        clean_ast(ctx.garbage[i]);
+    }
+    free(ctx.garbage);
+    free(ctx.derived);
+    free(ctx.occurrences);
+
+    *reduced = ctx.reduced;
+    return !ctx.failed;
+}
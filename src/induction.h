@@ -0,0 +1,30 @@
+/** @file induction.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the strength reduction of induction variables.
+ */
+
+#ifndef _INDUCTION_H
+#define _INDUCTION_H 1
+
+#include "ssa.h"
+
+/* Replaces multiplications by induction variables of FOR loops with additions carried across the iterations.
+ *  - A basic induction variable is an int variable that the loop only changes in its afterthought, by adding
+ *    or subtracting a constant (i += c, i -= c, i = i + c, i = i - c).
+ *  - A derived expression is k * i, optionally with a loop-invariant base added or subtracted (b + k * i,
+ *    k * i - b), where k is an integer constant or a loop-invariant variable.
+ *  - Equal derived expressions are replaced with reads of a new temporary variable. The temporary is assigned
+ *    the value of the expression before the FOR statement (with the initial value of the induction variable)
+ *    and the loop body ends with adding k * c to it. Expressions are only replaced when it saves more
+ *    instructions than the addition costs, or when they're inside a nested loop.
+ *  - If the induction variable defined by the FOR definition is then only read by the loop condition, the
+ *    condition is rewritten to compare the temporary instead (when all the values are constant and can't
+ *    overflow) and the induction variable is removed from the loop.
+ * The SSA form is invalid afterwards. Stores the number of replaced expressions, returns false if memory couldn't
+ * be allocated.
+ */
+bool induction_run(SSAForm *ssa, unsigned *reduced);
+
+#endif // _INDUCTION_H
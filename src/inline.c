@@ -0,0 +1,713 @@
+/** @file inline.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the inlining of function calls.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "inline.h"
+#include "compiler.h"
+#include "call_graph.h"
+#include "transform.h"
+
+// A function that may be inlined into its callers.
+typedef struct inline_callee {
+    bool eligible;
+    bool pure;          // Whether its calls have no side effects, can't fail and always finish.
+    unsigned long size; // Number of AST nodes (and statements) of the body.
+} InlineCallee;
+
+typedef struct inline_context {
+    CFProgram *program;
+    CallGraph graph;
+    InlineCallee *callees; // Indexed like the nodes of the call graph.
+    unsigned threshold;
+    CFFunction *fun;       // The function whose calls are being inlined.
+    unsigned inlined;
+    bool failed;
+} InlineContext;
+
+// A call chosen to be inlined.
+typedef struct inline_site {
+    CFFunction *callee;
+    ASTNode **slot;     // The slot of the call in the AST of the statement.
+    ASTNode **listSlot; // The slot of the value list whose only item is the call, if it has multiple return values.
+} InlineSite;
+
+// Infers the types of the ASTs of the statement chain. Returns false if they're invalid.
+static bool inline_infer_statements(CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        bool inferred = true;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                inferred = stat->data.bodyAst == NULL || ast_infer_node_type(stat->data.bodyAst);
+                break;
+            case CF_IF:
+                inferred = ast_infer_node_type(stat->data.ifData->conditionalAst)
+                           && inline_infer_statements(stat->data.ifData->thenStatement)
+                           && inline_infer_statements(stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR: {
+                CFStatementFor *forData = stat->data.forData;
+                inferred = (forData->definitionAst == NULL || ast_infer_node_type(forData->definitionAst))
+                           && ast_infer_node_type(forData->conditionalAst)
+                           && (forData->afterthoughtAst == NULL || ast_infer_node_type(forData->afterthoughtAst))
+                           && inline_infer_statements(forData->bodyStatement);
+                break;
+            }
+        }
+        if (!inferred) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks whether the statement chain contains a return statement.
+static bool inline_has_return(const CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        switch (stat->statementType) {
+            case CF_RETURN:
+                return true;
+            case CF_IF:
+                if (inline_has_return(stat->data.ifData->thenStatement)
+                    || inline_has_return(stat->data.ifData->elseStatement)) {
+                    return true;
+                }
+                break;
+            case CF_FOR:
+                if (inline_has_return(stat->data.forData->bodyStatement)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+// Checks whether the statement chain only returns at its end: by its last statement or at the ends
+// of the branches of its last IF (recursively).
+static bool inline_returns_at_end(const CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        bool last = stat->followingStatement == NULL;
+        switch (stat->statementType) {
+            case CF_RETURN:
+                if (!last) {
+                    return false;
+                }
+                break;
+            case CF_IF:
+                if (last) {
+                    return inline_returns_at_end(stat->data.ifData->thenStatement)
+                           && inline_returns_at_end(stat->data.ifData->elseStatement);
+                }
+                if (inline_has_return(stat->data.ifData->thenStatement)
+                    || inline_has_return(stat->data.ifData->elseStatement)) {
+                    return false;
+                }
+                break;
+            case CF_FOR:
+                if (inline_has_return(stat->data.forData->bodyStatement)) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+// Checks whether all the paths through the statement chain end with a return statement.
+static bool inline_always_returns(const CFStatement *stat) {
+    if (stat == NULL) {
+        return false;
+    }
+    while (stat->followingStatement != NULL) {
+        stat = stat->followingStatement;
+    }
+
+    if (stat->statementType == CF_RETURN) {
+        return true;
+    }
+    return stat->statementType == CF_IF && stat->data.ifData->elseStatement != NULL
+           && inline_always_returns(stat->data.ifData->thenStatement)
+           && inline_always_returns(stat->data.ifData->elseStatement);
+}
+
+// Checks whether the function returns named values.
+static bool inline_has_named_results(const CFFunction *callee) {
+    return callee->returnValuesCount > 0 && callee->returnValues[0].name != NULL;
+}
+
+// Checks whether the values of the return statements in the statement chain match the return types
+// of the function.
+static bool inline_valid_returns(const CFFunction *callee, const CFStatement *stat) {
+    const STFunctionData *funcData = &callee->symbol->data.func_data;
+    for (; stat != NULL; stat = stat->followingStatement) {
+        switch (stat->statementType) {
+            case CF_RETURN: {
+                const ASTNode *values = stat->data.bodyAst;
+                if (values->dataCount == 0) {
+                    if (funcData->ret_types_count > 0 && !inline_has_named_results(callee)) {
+                        return false;
+                    }
+                    break;
+                }
+
+                if (values->dataCount != funcData->ret_types_count) {
+                    return false;
+                }
+                for (unsigned i = 0; i < values->dataCount; i++) {
+                    if (values->data[i].astPtr->inheritedDataType != funcData->ret_types[i].type) {
+                        return false;
+                    }
+                }
+                break;
+            }
+            case CF_IF:
+                if (!inline_valid_returns(callee, stat->data.ifData->thenStatement)
+                    || !inline_valid_returns(callee, stat->data.ifData->elseStatement)) {
+                    return false;
+                }
+                break;
+            default:
+                // Return statements in loops are rejected by inline_returns_at_end()
+                break;
+        }
+    }
+    return true;
+}
+
+// Checks whether the statement chain has no side effects, can't fail and has no loops.
+static bool inline_is_pure(const CFStatement *stat) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        const ASTNode *ast = NULL;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                ast = stat->data.bodyAst;
+                break;
+            case CF_IF:
+                ast = stat->data.ifData->conditionalAst;
+                if (!inline_is_pure(stat->data.ifData->thenStatement)
+                    || !inline_is_pure(stat->data.ifData->elseStatement)) {
+                    return false;
+                }
+                break;
+            case CF_FOR:
+                return false;
+        }
+        if (tf_has_impure_call(ast) || tf_may_fail(ast)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the variable of the parameter or of the named return value, NULL if it isn't in the function's table.
+static STSymbol *inline_find_variable(const CFFunction *callee, const char *name) {
+    STItem *item = name == NULL ? NULL : symtable_find(callee->symbolTable, name);
+    return item == NULL || item->data.type != ST_SYMBOL_VAR ? NULL : &item->data;
+}
+
+// Decides whether the function may be inlined into its callers. Its own calls must already be inlined.
+static void inline_analyse_callee(InlineContext *ctx, unsigned index) {
+    CGNode *node = &ctx->graph.nodes[index];
+    CFFunction *callee = node->function;
+    CFStatement *root = callee->rootStatement;
+    if (callee == ctx->program->mainFunc || node->recursive || callee->symbol == NULL || root == NULL
+        || !inline_infer_statements(root)) {
+        return;
+    }
+
+    for (unsigned i = 0; i < callee->argumentsCount; i++) {
+        if (inline_find_variable(callee, callee->arguments[i].name) == NULL) {
+            return;
+        }
+    }
+    for (unsigned i = 0; inline_has_named_results(callee) && i < callee->returnValuesCount; i++) {
+        if (inline_find_variable(callee, callee->returnValues[i].name) == NULL) {
+            return;
+        }
+    }
+
+    if (!inline_returns_at_end(root) || !inline_valid_returns(callee, root)
+        || (callee->returnValuesCount > 0 && !inline_always_returns(root))) {
+        return;
+    }
+
+    ctx->callees[index].eligible = true;
+    ctx->callees[index].pure = inline_is_pure(root);
+    ctx->callees[index].size = tf_statements_size(root);
+}
+
+// Returns the number of arguments of the call and the argument at the index.
+static unsigned inline_arguments(const ASTNode *call, unsigned index, const ASTNode **argument) {
+    const ASTNode *arguments = call->right;
+    if (arguments == NULL) {
+        return 0;
+    }
+    if (arguments->actionType != AST_LIST) {
+        *argument = arguments;
+        return 1;
+    }
+    if (index < arguments->dataCount) {
+        *argument = arguments->data[index].astPtr;
+    }
+    return arguments->dataCount;
+}
+
+// Checks whether the arguments of the call match the parameters of the function.
+static bool inline_valid_call(const ASTNode *call, const CFFunction *callee) {
+    const STFunctionData *funcData = &callee->symbol->data.func_data;
+    const ASTNode *argument = NULL;
+    if (inline_arguments(call, 0, &argument) != funcData->params_count) {
+        return false;
+    }
+    for (unsigned i = 0; i < funcData->params_count; i++) {
+        inline_arguments(call, i, &argument);
+        if (argument->inheritedDataType != funcData->params[i].type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks whether the AST_FUNC_CALL node calls a function without side effects, which can't fail (see inline_is_pure()).
+static bool inline_is_pure_call(InlineContext *ctx, const ASTNode *call) {
+    const STSymbol *symbol = call->left->data[0].symbolTableItemPtr;
+    CGNode *node = cg_find(&ctx->graph, symbol->data.func_data.cf_function);
+    if (node != NULL) {
+        return ctx->callees[node - ctx->graph.nodes].pure;
+    }
+    return tf_is_pure_builtin_call(call) && strcmp(symbol->identifier, "float2int") != 0;
+}
+
+// Checks whether evaluating the AST has no side effects and can't fail, except for the call,
+// so the call may be evaluated before the rest of the AST.
+static bool inline_is_clean(InlineContext *ctx, const ASTNode *ast, const ASTNode *call) {
+    if (ast == NULL || ast == call) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!inline_is_clean(ctx, ast->data[i].astPtr, call)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    switch (ast->actionType) {
+        case AST_DIVIDE:
+            return false;
+        case AST_FUNC_CALL:
+            return inline_is_pure_call(ctx, ast) && inline_is_clean(ctx, ast->right, call);
+        case AST_ASSIGN:
+        case AST_DEFINE:
+            return inline_is_clean(ctx, ast->right, call);
+        default:
+            return inline_is_clean(ctx, ast->left, call) && inline_is_clean(ctx, ast->right, call);
+    }
+}
+
+// Checks whether the call in the slot can be inlined before the statement, root is the slot of the statement's AST.
+static bool inline_check_site(InlineContext *ctx, CFStatement *stat, ASTNode **root, ASTNode **slot,
+                              InlineSite *site) {
+    ASTNode *call = *slot;
+    CFFunction *callee = call->left->data[0].symbolTableItemPtr->data.func_data.cf_function;
+    CGNode *node = cg_find(&ctx->graph, callee);
+    if (node == NULL) {
+        return false;
+    }
+
+    const InlineCallee *info = &ctx->callees[node - ctx->graph.nodes];
+    if (!info->eligible || (info->size > ctx->threshold && callee->symbol->reference_counter != 1)
+        || !inline_valid_call(call, callee) || !inline_is_clean(ctx, *root, call)) {
+        return false;
+    }
+
+    site->callee = callee;
+    site->slot = slot;
+    site->listSlot = NULL;
+    if (callee->returnValuesCount == 0) {
+        return stat->statementType == CF_BASIC && slot == root;
+    }
+    if (callee->returnValuesCount == 1) {
+        return true;
+    }
+
+    // Multiple values can only be assigned (the code generator doesn't support returning them)
+    ASTNode **listSlot = NULL;
+    if ((*root)->actionType == AST_ASSIGN || (*root)->actionType == AST_DEFINE) {
+        listSlot = &(*root)->right;
+    }
+    if (listSlot == NULL || (*listSlot)->actionType != AST_LIST || (*listSlot)->dataCount != 1
+        || &(*listSlot)->data[0].astPtr != slot) {
+        return false;
+    }
+    site->listSlot = listSlot;
+    return true;
+}
+
+// Finds the first call in the subtree in the slot that can be inlined before the statement. The calls whose
+// evaluation is conditional (the right operands of && and ||) are skipped.
+static bool inline_find_site(InlineContext *ctx, CFStatement *stat, ASTNode **root, ASTNode **slot,
+                             bool conditional, InlineSite *site) {
+    ASTNode *ast = *slot;
+    if (ast == NULL) {
+        return false;
+    }
+
+    switch (ast->actionType) {
+        case AST_LIST:
+            for (unsigned i = 0; i < ast->dataCount; i++) {
+                if (inline_find_site(ctx, stat, root, &ast->data[i].astPtr, conditional, site)) {
+                    return true;
+                }
+            }
+            return false;
+        case AST_FUNC_CALL:
+            if (!conditional && inline_check_site(ctx, stat, root, slot, site)) {
+                return true;
+            }
+            return inline_find_site(ctx, stat, root, &ast->right, conditional, site);
+        case AST_LOG_AND:
+        case AST_LOG_OR:
+            return inline_find_site(ctx, stat, root, &ast->left, conditional, site)
+                   || inline_find_site(ctx, stat, root, &ast->right, true, site);
+        case AST_ASSIGN:
+        case AST_DEFINE:
+            return inline_find_site(ctx, stat, root, &ast->right, conditional, site);
+        default:
+            return inline_find_site(ctx, stat, root, &ast->left, conditional, site)
+                   || inline_find_site(ctx, stat, root, &ast->right, conditional, site);
+    }
+}
+
+// Creates the list of the zero values of the named return values of the function.
+static ASTNode *inline_zero_values(const CFFunction *callee) {
+    const STFunctionData *funcData = &callee->symbol->data.func_data;
+    ASTNode *values = ast_node_list(funcData->ret_types_count);
+    for (unsigned i = 0; values != NULL && i < funcData->ret_types_count; i++) {
+        ASTNode *value = NULL;
+        switch (funcData->ret_types[i].type) {
+            case CF_INT:
+                value = tf_const_int(0);
+                break;
+            case CF_FLOAT:
+                value = ast_leaf_constf(0.0);
+                break;
+            case CF_STRING:
+                value = ast_leaf_consts("");
+                break;
+            case CF_BOOL:
+                value = ast_leaf_constb(false);
+                break;
+            default:
+                break;
+        }
+        if (value == NULL) {
+            clean_ast(values);
+            return NULL;
+        }
+        ast_push_to_list(values, value);
+    }
+    return values;
+}
+
+// Replaces the return statements of the copied body with assignments of the returned values to the results.
+// The return statements without values are removed, unless they start the chain (they're emptied).
+static bool inline_replace_returns(CFStatement *stat, STSymbol **results, unsigned count) {
+    while (stat != NULL) {
+        CFStatement *next = stat->followingStatement;
+        if (stat->statementType == CF_IF) {
+            if (!inline_replace_returns(stat->data.ifData->thenStatement, results, count)
+                || !inline_replace_returns(stat->data.ifData->elseStatement, results, count)) {
+                return false;
+            }
+        } else if (stat->statementType == CF_RETURN) {
+            ASTNode *values = stat->data.bodyAst;
+            stat->statementType = CF_BASIC;
+            stat->data.bodyAst = NULL;
+            if (values->dataCount > 0) {
+                stat->data.bodyAst = tf_assign_list(results, count, values);
+                if (stat->data.bodyAst == NULL) {
+                    return false;
+                }
+                tf_update_calls(stat->data.bodyAst);
+            } else {
+                clean_ast(values);
+                CFStatement *previous = stat->parentStatement;
+                if (previous != NULL && previous->followingStatement == stat) {
+                    // The return statement is the last one of its chain
+                    previous->followingStatement = NULL;
+                    clean_stat(stat, stat->localSymbolTable);
+                }
+            }
+        }
+        stat = next;
+    }
+    return true;
+}
+
+// Frees the empty statements of the chain, returns the first remaining statement.
+static CFStatement *inline_drop_empty(CFStatement *stat) {
+    CFStatement *first = NULL;
+    CFStatement *last = NULL;
+    while (stat != NULL) {
+        CFStatement *next = stat->followingStatement;
+        stat->followingStatement = NULL;
+        if (stat->statementType == CF_BASIC && stat->data.bodyAst == NULL) {
+            free(stat);
+        } else {
+            if (first == NULL) {
+                first = stat;
+                stat->parentStatement = NULL;
+            } else {
+                last->followingStatement = stat;
+                stat->parentStatement = last;
+            }
+            last = stat;
+        }
+        stat = next;
+    }
+    return first;
+}
+
+// Finds the replacement of the variable of the callee.
+static STSymbol *inline_replacement(const TFReplacement *replacements, unsigned count, const STSymbol *variable) {
+    for (unsigned i = 0; i < count; i++) {
+        if (replacements[i].variable == variable) {
+            return replacements[i].replacement;
+        }
+    }
+    return NULL;
+}
+
+static void inline_calls(InlineContext *ctx, CFStatement *stat, ASTNode **root);
+
+// Takes the call out of the statement's AST, which reads the results instead. Returns the call.
+static ASTNode *inline_take_call(ASTNode **root, const InlineSite *site, STSymbol **results, unsigned count) {
+    if (count == 0) {
+        return tf_detach(*root, site->slot, NULL);
+    }
+
+    if (site->listSlot == NULL) {
+        ASTNode *read = tf_read(results[0]);
+        return read == NULL ? NULL : tf_detach(*root, site->slot, read);
+    }
+
+    ASTNode *reads = ast_node_list(count);
+    for (unsigned i = 0; reads != NULL && i < count; i++) {
+        ASTNode *read = tf_read(results[i]);
+        if (read == NULL) {
+            clean_ast(reads);
+            return NULL;
+        }
+        ast_push_to_list(reads, read);
+    }
+    if (reads == NULL) {
+        return NULL;
+    }
+
+    ASTNode *list = tf_detach(*root, site->listSlot, reads);
+    ASTNode *call = list->data[0].astPtr;
+    list->data[0].astPtr = NULL;
+    clean_ast(list);
+    return call;
+}
+
+// Inlines the call before the statement.
+static bool inline_call(InlineContext *ctx, CFStatement *stat, ASTNode **root, const InlineSite *site) {
+    CFFunction *callee = site->callee;
+    const STFunctionData *funcData = &callee->symbol->data.func_data;
+    SymbolTable *table = tf_scope_table(stat);
+
+    // All the variables of the callee are replaced with new temporaries
+    TFVariables variables = {0};
+    if (!tf_add_scope_variables(&variables, callee->rootStatement)) {
+        free(variables.items);
+        return false;
+    }
+    TFReplacement *replacements = malloc((variables.count + 1) * sizeof(TFReplacement));
+    STSymbol **parameters = malloc((callee->argumentsCount + 1) * sizeof(STSymbol *));
+    STSymbol **results = malloc((callee->returnValuesCount + 1) * sizeof(STSymbol *));
+    bool inlined = replacements != NULL && parameters != NULL && results != NULL;
+    for (unsigned i = 0; inlined && i < variables.count; i++) {
+        STSymbol *variable = variables.items[i];
+        replacements[i] = (TFReplacement) {variable, tf_new_temporary(ctx->fun, "i", variable->data.var_data.type),
+                                           NULL};
+        inlined = replacements[i].replacement != NULL;
+    }
+
+    for (unsigned i = 0; inlined && i < callee->argumentsCount; i++) {
+        parameters[i] = inline_replacement(replacements, variables.count,
+                                           inline_find_variable(callee, callee->arguments[i].name));
+    }
+    bool named = inline_has_named_results(callee);
+    for (unsigned i = 0; inlined && i < callee->returnValuesCount; i++) {
+        results[i] = named ? inline_replacement(replacements, variables.count,
+                                                inline_find_variable(callee, callee->returnValues[i].name))
+                           : tf_new_temporary(ctx->fun, "i", funcData->ret_types[i].type);
+        inlined = results[i] != NULL;
+    }
+
+    // The body is copied first, the statement is only changed once everything is allocated
+    CFStatement *body = NULL;
+    ASTNode *initialisation = NULL;
+    if (inlined) {
+        body = tf_copy_statements(callee->rootStatement, ctx->fun, table, replacements, variables.count);
+        inlined = body != NULL && inline_replace_returns(body, results, callee->returnValuesCount);
+        body = inline_drop_empty(body);
+    }
+    if (inlined && named) {
+        ASTNode *zeros = inline_zero_values(callee);
+        initialisation = zeros == NULL ? NULL : tf_define(results, callee->returnValuesCount, zeros);
+        inlined = initialisation != NULL;
+    }
+    ASTNode *call = inlined ? inline_take_call(root, site, results, callee->returnValuesCount) : NULL;
+    inlined = call != NULL;
+
+    ASTNode *arguments = NULL;
+    if (inlined && callee->argumentsCount > 0) {
+        // The arguments are moved to the definition of the parameters
+        arguments = call->right;
+        if (arguments->actionType != AST_LIST) {
+            arguments = ast_node_list(1);
+            if (arguments != NULL) {
+                ast_push_to_list(arguments, call->right);
+            }
+        }
+        if (arguments != NULL) {
+            call->right = NULL;
+        }
+        if (arguments != NULL && call->hasInnerFuncCalls) {
+            // The code generator evaluates such arguments from the last one, the parameters are defined
+            // in the same order, so that the side effects of the arguments keep their order
+            for (unsigned i = 0; i < callee->argumentsCount / 2; i++) {
+                unsigned j = callee->argumentsCount - i - 1;
+                STSymbol *parameter = parameters[i];
+                parameters[i] = parameters[j];
+                parameters[j] = parameter;
+                ASTNode *argument = arguments->data[i].astPtr;
+                arguments->data[i].astPtr = arguments->data[j].astPtr;
+                arguments->data[j].astPtr = argument;
+            }
+        }
+        arguments = arguments == NULL ? NULL : tf_define(parameters, callee->argumentsCount, arguments);
+        inlined = arguments != NULL;
+    }
+
+    CFStatement *definition = NULL;
+    if (inlined && arguments != NULL) {
+        definition = tf_insert_before(stat, arguments);
+        inlined = definition != NULL;
+    }
+    if (inlined && initialisation != NULL) {
+        inlined = tf_insert_before(stat, initialisation) != NULL;
+        initialisation = inlined ? NULL : initialisation;
+    }
+    if (inlined && body != NULL) {
+        tf_insert_statements_before(stat, body);
+        body = NULL;
+    }
+
+    if (!inlined && definition == NULL) {
+        clean_ast(arguments);
+    }
+    clean_ast(initialisation);
+    clean_stat(body, table);
+    clean_ast(call);
+    free(variables.items);
+    free(replacements);
+    free(parameters);
+    free(results);
+    if (!inlined) {
+        return false;
+    }
+
+    ctx->inlined++;
+    if (callee->returnValuesCount == 0) {
+        tf_remove_statement(stat);
+    } else {
+        tf_update_calls(*root);
+    }
+    if (definition != NULL) {
+        // The arguments may contain other calls to inline
+        tf_update_calls(definition->data.bodyAst);
+        inline_calls(ctx, definition, &definition->data.bodyAst);
+    }
+    return true;
+}
+
+// Inlines the calls in the AST of the statement (in the slot root) one by one.
+static void inline_calls(InlineContext *ctx, CFStatement *stat, ASTNode **root) {
+    if (*root == NULL || !ast_infer_node_type(*root)) {
+        return;
+    }
+
+    InlineSite site;
+    while (!ctx->failed && *root != NULL && inline_find_site(ctx, stat, root, root, false, &site)) {
+        bool removed = site.callee->returnValuesCount == 0;
+        ctx->failed = !inline_call(ctx, stat, root, &site);
+        if (removed) {
+            // The call was the whole statement
+            return;
+        }
+    }
+}
+
+// Inlines the calls in the statement chain.
+static void inline_statements(InlineContext *ctx, CFStatement *stat) {
+    while (stat != NULL && !ctx->failed) {
+        CFStatement *next = stat->followingStatement;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                inline_calls(ctx, stat, &stat->data.bodyAst);
+                break;
+            case CF_IF:
+                if (tf_can_insert_before(stat)) {
+                    inline_calls(ctx, stat, &stat->data.ifData->conditionalAst);
+                }
+                inline_statements(ctx, stat->data.ifData->thenStatement);
+                inline_statements(ctx, stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                inline_calls(ctx, stat, &stat->data.forData->definitionAst);
+                inline_statements(ctx, stat->data.forData->bodyStatement);
+                break;
+        }
+        stat = next;
+    }
+}
+
+bool inline_run(CFProgram *program, unsigned threshold, unsigned *inlined) {
+    InlineContext ctx = {.program = program, .threshold = threshold};
+    *inlined = 0;
+    if (!cg_build(program, &ctx.graph)) {
+        return false;
+    }
+    ctx.callees = calloc(ctx.graph.count + 1, sizeof(InlineCallee));
+    ctx.failed = ctx.callees == NULL;
+
+    // The callees are inlined into a function before it's analysed as a callee itself
+    for (unsigned i = 0; i < ctx.graph.count && !ctx.failed && compiler_result == COMPILER_RESULT_SUCCESS; i++) {
+        unsigned index = ctx.graph.order[i];
+        ctx.fun = ctx.graph.nodes[index].function;
+        inline_statements(&ctx, ctx.fun->rootStatement);
+        inline_analyse_callee(&ctx, index);
+    }
+
+    free(ctx.callees);
+    cg_free(&ctx.graph);
+    *inlined = ctx.inlined;
+    return !ctx.failed;
+}
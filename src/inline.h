@@ -0,0 +1,32 @@
+/** @file inline.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the inlining of function calls.
+ */
+
+#ifndef _INLINE_H
+#define _INLINE_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Replaces the calls of small functions and of functions called from a single place with copies of their bodies.
+ *  - The functions are processed bottom-up in the call graph, so the calls in the copied bodies are already inlined.
+ *    Recursive functions and main are never inlined.
+ *  - A function is inlined if its body has at most threshold AST nodes (and statements), or if it's only called
+ *    once. Its return statements must all be at its end (possibly in the branches of a final IF) and a function
+ *    with return values must return on all paths.
+ *  - A call of a function without return values must be a statement. Otherwise, the call is evaluated before
+ *    the statement containing it, which requires that the rest of the statement has no side effects and can't
+ *    fail, the call isn't the right operand of && or || and it isn't in the condition of an else-if or in a FOR
+ *    header (except for its definition). The values of a function with multiple return values can only be
+ *    assigned.
+ *  - The arguments are assigned to new temporaries replacing the parameters, followed by a copy of the body
+ *    with all its variables replaced by new temporaries. Its return statements assign the returned values to
+ *    temporaries, which the statement reads instead of the call.
+ * Stores the number of inlined calls, returns false if memory couldn't be allocated.
+ */
+bool inline_run(CFProgram *program, unsigned threshold, unsigned *inlined);
+
+#endif // _INLINE_H
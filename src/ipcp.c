@@ -0,0 +1,527 @@
+/** @file ipcp.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the interprocedural propagation of constant arguments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ipcp.h"
+#include "compiler.h"
+#include "call_graph.h"
+#include "index_map.h"
+#include "transform.h"
+
+// Maximum number of specialised copies of a single function.
+#define IPCP_MAX_CLONES 4
+// Weight of a call in a loop when choosing the groups of calls to specialise, a call outside loops weighs 1.
+#define IPCP_LOOP_WEIGHT 10
+// Size of the top-level symbol tables of the specialised copies.
+#define IPCP_TABLE_SIZE 32
+
+// A call of the function being specialised.
+typedef struct ipcp_site {
+    CFFunction *caller;
+    ASTNode *call;
+    bool inLoop;
+    unsigned group;
+    bool redirected; // Whether it calls a specialised copy now.
+} IPCPSite;
+
+// Calls passing the same constants to the parameters of the function.
+typedef struct ipcp_group {
+    unsigned first;       // Index of its first call.
+    unsigned long weight;
+    bool constant;        // Whether some of the parameters get a constant.
+    bool cloned;
+} IPCPGroup;
+
+typedef struct ipcp_context {
+    CFProgram *program;
+    CallGraph graph;
+    IndexMap knownIndices;  // Indices of the functions in known.
+    const ASTNode ***known; // The constants of the parameters of a function, NULL for the unknown ones.
+    unsigned knownCount;
+    unsigned knownCapacity;
+    CFFunction *fun;        // The function being specialised.
+    STSymbol **parameters;  // Variables of its parameters (NULL if not found).
+    bool *useful;           // Whether the parameter is read and never assigned by the function.
+    IPCPSite *sites;
+    unsigned sitesCount;
+    unsigned sitesCapacity;
+    IPCPGroup *groups;
+    unsigned groupsCount;
+    bool invalid;           // Whether some call doesn't match the parameters of the function.
+    unsigned long budget;
+    unsigned propagated;
+    unsigned cloned;
+    bool failed;
+} IPCPContext;
+
+// Returns the number of arguments of the call.
+static unsigned ipcp_arguments_count(const ASTNode *call) {
+    const ASTNode *arguments = call->right;
+    if (arguments == NULL) {
+        return 0;
+    }
+    return arguments->actionType == AST_LIST ? arguments->dataCount : 1;
+}
+
+// Returns the argument of the call at the index, NULL if there isn't one.
+static ASTNode *ipcp_argument(const ASTNode *call, unsigned index) {
+    ASTNode *arguments = call->right;
+    if (arguments == NULL) {
+        return NULL;
+    }
+    if (arguments->actionType != AST_LIST) {
+        return index == 0 ? arguments : NULL;
+    }
+    return index < arguments->dataCount ? arguments->data[index].astPtr : NULL;
+}
+
+// Returns the variable of the parameter of the function at the index, NULL if it isn't in the function's table.
+static STSymbol *ipcp_parameter(const CFFunction *fun, unsigned index) {
+    STItem *item = fun->arguments[index].name == NULL ? NULL
+                                                      : symtable_find(fun->symbolTable, fun->arguments[index].name);
+    return item == NULL || item->data.type != ST_SYMBOL_VAR ? NULL : &item->data;
+}
+
+// Checks whether the node is a constant of the type.
+static bool ipcp_is_constant(const ASTNode *node, STDataType type) {
+    switch (node->actionType) {
+        case AST_CONST_INT:
+            return type == CF_INT;
+        case AST_CONST_FLOAT:
+            return type == CF_FLOAT;
+        case AST_CONST_STRING:
+            return type == CF_STRING;
+        case AST_CONST_BOOL:
+            return type == CF_BOOL;
+        default:
+            return false;
+    }
+}
+
+// Returns the known constants of the parameters of the function, NULL if none are known.
+static const ASTNode **ipcp_known(const IPCPContext *ctx, const CFFunction *fun) {
+    unsigned index;
+    return im_find(&ctx->knownIndices, fun, &index) ? ctx->known[index] : NULL;
+}
+
+// Records that the parameter of the function at the index is always the constant.
+static bool ipcp_set_known(IPCPContext *ctx, const CFFunction *fun, unsigned index, const ASTNode *value) {
+    const ASTNode **known = ipcp_known(ctx, fun);
+    if (known == NULL) {
+        if (!tf_reserve((void **) &ctx->known, &ctx->knownCapacity, ctx->knownCount, sizeof(const ASTNode **))) {
+            return false;
+        }
+        known = calloc(fun->argumentsCount, sizeof(const ASTNode *));
+        if (known == NULL) {
+            return false;
+        }
+        if (!im_insert(&ctx->knownIndices, fun, ctx->knownCount)) {
+            free(known);
+            return false;
+        }
+        ctx->known[ctx->knownCount++] = known;
+    }
+    known[index] = value;
+    return true;
+}
+
+// Returns the constant the call passes as the parameter at the index, NULL if it's not known.
+static const ASTNode *ipcp_value(const IPCPContext *ctx, const IPCPSite *site, unsigned index) {
+    const ASTNode *argument = ipcp_argument(site->call, index);
+    if (argument == NULL) {
+        return NULL;
+    }
+
+    if (argument->actionType == AST_ID) {
+        // The caller may read its own parameter that is known to be constant
+        const ASTNode **known = ipcp_known(ctx, site->caller);
+        const STSymbol *variable = argument->data[0].symbolTableItemPtr;
+        for (unsigned i = 0; known != NULL && i < site->caller->argumentsCount; i++) {
+            if (known[i] != NULL && ipcp_parameter(site->caller, i) == variable) {
+                argument = known[i];
+                break;
+            }
+        }
+    }
+    return ipcp_is_constant(argument, ctx->fun->arguments[index].dataType) ? argument : NULL;
+}
+
+// Checks whether the call is a recursive call passing the parameter at the index unchanged.
+static bool ipcp_passes_own(const IPCPContext *ctx, const IPCPSite *site, unsigned index) {
+    const ASTNode *argument = ipcp_argument(site->call, index);
+    return site->caller == ctx->fun && argument != NULL && argument->actionType == AST_ID
+           && argument->data[0].symbolTableItemPtr == ctx->parameters[index];
+}
+
+// Checks whether the calls pass the same constants to the parameters read by the function.
+static bool ipcp_same_values(const IPCPContext *ctx, const IPCPSite *a, const IPCPSite *b) {
+    for (unsigned i = 0; i < ctx->fun->argumentsCount; i++) {
+        if (!ctx->useful[i]) {
+            continue;
+        }
+        const ASTNode *aValue = ipcp_value(ctx, a, i);
+        const ASTNode *bValue = ipcp_value(ctx, b, i);
+        if (aValue == NULL || bValue == NULL ? aValue != bValue : !tf_equal(aValue, bValue)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Adds the calls of the function in the AST to the call sites.
+static bool ipcp_find_ast_sites(IPCPContext *ctx, CFFunction *caller, ASTNode *ast, bool inLoop) {
+    if (ast == NULL) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!ipcp_find_ast_sites(ctx, caller, ast->data[i].astPtr, inLoop)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (ast->actionType == AST_FUNC_CALL && ast->left->data[0].symbolTableItemPtr == ctx->fun->symbol) {
+        ctx->invalid |= ipcp_arguments_count(ast) != ctx->fun->argumentsCount;
+        if (!tf_reserve((void **) &ctx->sites, &ctx->sitesCapacity, ctx->sitesCount, sizeof(IPCPSite))) {
+            return false;
+        }
+        ctx->sites[ctx->sitesCount++] = (IPCPSite) {caller, ast, inLoop, 0, false};
+    }
+    if (ast->actionType == AST_FUNC_CALL) {
+        return ipcp_find_ast_sites(ctx, caller, ast->right, inLoop);
+    }
+    return ipcp_find_ast_sites(ctx, caller, ast->left, inLoop)
+           && ipcp_find_ast_sites(ctx, caller, ast->right, inLoop);
+}
+
+// Adds the calls of the function in the statement chain to the call sites.
+static bool ipcp_find_sites(IPCPContext *ctx, CFFunction *caller, CFStatement *stat, bool inLoop) {
+    for (; stat != NULL; stat = stat->followingStatement) {
+        bool found = true;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                found = ipcp_find_ast_sites(ctx, caller, stat->data.bodyAst, inLoop);
+                break;
+            case CF_IF:
+                found = ipcp_find_ast_sites(ctx, caller, stat->data.ifData->conditionalAst, inLoop)
+                        && ipcp_find_sites(ctx, caller, stat->data.ifData->thenStatement, inLoop)
+                        && ipcp_find_sites(ctx, caller, stat->data.ifData->elseStatement, inLoop);
+                break;
+            case CF_FOR:
+                found = ipcp_find_ast_sites(ctx, caller, stat->data.forData->definitionAst, inLoop)
+                        && ipcp_find_ast_sites(ctx, caller, stat->data.forData->conditionalAst, true)
+                        && ipcp_find_ast_sites(ctx, caller, stat->data.forData->afterthoughtAst, true)
+                        && ipcp_find_sites(ctx, caller, stat->data.forData->bodyStatement, true);
+                break;
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Assigns the constant to the parameter at the start of the function. The calls passing it may never run,
+// so the divisions of the function keep checking their zero divisors at runtime.
+static bool ipcp_assign_parameter(CFFunction *fun, STSymbol *parameter, const ASTNode *value) {
+    if (fun->rootStatement == NULL) {
+        return true;
+    }
+
+    ASTNode *copy = tf_copy(value);
+    ASTNode *assignment = copy == NULL ? NULL : tf_assign(parameter, copy);
+    if (assignment == NULL) {
+        return false;
+    }
+    if (tf_insert_before(fun->rootStatement, assignment) == NULL) {
+        clean_ast(assignment);
+        return false;
+    }
+    tf_check_divisors(fun->rootStatement);
+    return true;
+}
+
+// Creates a new function with a copy of the body of the function being specialised. Its name is the name
+// of the function followed by '$' and a number. Returns NULL if memory couldn't be allocated.
+static CFFunction *ipcp_copy_function(IPCPContext *ctx) {
+    CFFunction *fun = ctx->fun;
+    const STFunctionData *funcData = &fun->symbol->data.func_data;
+    SymbolTable *globalTable = ctx->program->globalSymtable;
+
+    char *name = malloc(strlen(fun->name) + 16);
+    if (name == NULL) {
+        return NULL;
+    }
+    unsigned number = 0;
+    do {
+        sprintf(name, "%s$%u", fun->name, number++);
+    } while (symtable_find(globalTable, name) != NULL);
+
+    STItem *item = symtable_add(globalTable, name, ST_SYMBOL_FUNC);
+    bool copied = item != NULL;
+    for (unsigned i = 0; copied && i < funcData->params_count; i++) {
+        copied = symtable_add_param(item, funcData->params[i].id, funcData->params[i].type);
+    }
+    for (unsigned i = 0; copied && i < funcData->ret_types_count; i++) {
+        copied = symtable_add_ret_type(item, funcData->ret_types[i].id, funcData->ret_types[i].type);
+    }
+    if (copied) {
+        item->data.data.func_data.defined = true;
+    }
+
+    // The function is added to the program like the parsed ones
+    CFFunction *copy = copied ? cf_make_function(name) : NULL;
+    free(name);
+    SymbolTable *table = copy == NULL ? NULL : symtable_init(IPCP_TABLE_SIZE);
+    if (table == NULL) {
+        return NULL;
+    }
+    cf_assign_function_symtable(table);
+    for (unsigned i = 0; i < fun->argumentsCount; i++) {
+        cf_add_argument(fun->arguments[i].name, fun->arguments[i].dataType);
+    }
+    for (unsigned i = 0; i < fun->returnValuesCount; i++) {
+        cf_add_return_value(fun->returnValues[i].name, fun->returnValues[i].dataType);
+    }
+    if (cf_error) {
+        return NULL;
+    }
+
+    // The parameters and the named return values keep their names, the other variables are replaced
+    // with new temporaries
+    TFVariables variables = {0};
+    copied = tf_add_scope_variables(&variables, fun->rootStatement);
+    TFReplacement *replacements = malloc((variables.count + 1) * sizeof(TFReplacement));
+    copied = copied && replacements != NULL;
+    for (unsigned i = 0; copied && i < variables.count; i++) {
+        STSymbol *variable = variables.items[i];
+        const STVariableData *varData = &variable->data.var_data;
+        STSymbol *replacement;
+        if (varData->is_argument_variable || varData->is_return_val_variable) {
+            STItem *varItem = symtable_add(table, variable->identifier, ST_SYMBOL_VAR);
+            replacement = varItem == NULL ? NULL : &varItem->data;
+            if (replacement != NULL) {
+                replacement->data.var_data = *varData;
+                replacement->reference_counter = varData->is_return_val_variable ? 1 : 0;
+            }
+        } else {
+            replacement = tf_new_temporary(copy, "c", varData->type);
+        }
+        replacements[i] = (TFReplacement) {variable, replacement, NULL};
+        copied = replacement != NULL;
+    }
+
+    if (copied) {
+        copy->rootStatement = tf_copy_statements(fun->rootStatement, copy, table, replacements, variables.count);
+        copied = copy->rootStatement != NULL;
+    }
+    free(variables.items);
+    free(replacements);
+    return copied ? copy : NULL;
+}
+
+// Creates a specialised copy of the function for the group of calls.
+static bool ipcp_clone(IPCPContext *ctx, unsigned group) {
+    CFFunction *copy = ipcp_copy_function(ctx);
+    if (copy == NULL) {
+        return false;
+    }
+    ctx->cloned++;
+
+    const IPCPSite *first = &ctx->sites[ctx->groups[group].first];
+    for (unsigned i = 0; i < ctx->fun->argumentsCount; i++) {
+        const ASTNode *value = ctx->useful[i] ? ipcp_value(ctx, first, i) : NULL;
+        if (value == NULL) {
+            continue;
+        }
+        if (!ipcp_assign_parameter(copy, ipcp_parameter(copy, i), value) || !ipcp_set_known(ctx, copy, i, value)) {
+            return false;
+        }
+    }
+
+    for (unsigned i = 0; i < ctx->sitesCount; i++) {
+        IPCPSite *site = &ctx->sites[i];
+        if (site->group == group) {
+            symtable_symbol_unref(ctx->fun->symbol);
+            symtable_symbol_ref(copy->symbol);
+            site->call->left->data[0].symbolTableItemPtr = copy->symbol;
+            site->redirected = true;
+        }
+    }
+    return true;
+}
+
+// Groups the calls passing the same constants to the parameters read by the function.
+static bool ipcp_group_sites(IPCPContext *ctx) {
+    free(ctx->groups);
+    ctx->groups = malloc((ctx->sitesCount + 1) * sizeof(IPCPGroup));
+    ctx->groupsCount = 0;
+    if (ctx->groups == NULL) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < ctx->sitesCount; i++) {
+        IPCPSite *site = &ctx->sites[i];
+        unsigned group = 0;
+        while (group < ctx->groupsCount && !ipcp_same_values(ctx, &ctx->sites[ctx->groups[group].first], site)) {
+            group++;
+        }
+        if (group == ctx->groupsCount) {
+            ctx->groups[ctx->groupsCount++] = (IPCPGroup) {i, 0, false, false};
+            for (unsigned j = 0; j < ctx->fun->argumentsCount; j++) {
+                ctx->groups[group].constant |= ctx->useful[j] && ipcp_value(ctx, site, j) != NULL;
+            }
+        }
+        site->group = group;
+        ctx->groups[group].weight += site->inLoop ? IPCP_LOOP_WEIGHT : 1;
+    }
+    return true;
+}
+
+// Creates specialised copies of the function for its hot groups of calls, as long as they fit the budget.
+static bool ipcp_specialise(IPCPContext *ctx) {
+    if (!ipcp_group_sites(ctx)) {
+        return false;
+    }
+
+    // The function itself is kept for the calls without constants, or for the heaviest group
+    unsigned kept = 0;
+    for (unsigned i = 1; i < ctx->groupsCount; i++) {
+        const IPCPGroup *group = &ctx->groups[i];
+        if (!group->constant && ctx->groups[kept].constant) {
+            kept = i;
+        } else if (group->constant == ctx->groups[kept].constant && group->weight > ctx->groups[kept].weight) {
+            kept = i;
+        }
+    }
+
+    unsigned long size = tf_statements_size(ctx->fun->rootStatement);
+    for (unsigned clones = 0; clones < IPCP_MAX_CLONES && size <= ctx->budget; clones++) {
+        // A group is hot if it's called in a loop or from several places, the heaviest one goes first
+        unsigned best = ctx->groupsCount;
+        for (unsigned i = 0; i < ctx->groupsCount; i++) {
+            const IPCPGroup *group = &ctx->groups[i];
+            if (i != kept && group->constant && !group->cloned && group->weight > 1
+                && (best == ctx->groupsCount || group->weight > ctx->groups[best].weight)) {
+                best = i;
+            }
+        }
+        if (best == ctx->groupsCount) {
+            break;
+        }
+
+        ctx->groups[best].cloned = true;
+        ctx->budget -= size;
+        if (!ipcp_clone(ctx, best)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Assigns the constants passed by all the remaining calls to the parameters of the function.
+static bool ipcp_propagate(IPCPContext *ctx) {
+    for (unsigned i = 0; i < ctx->fun->argumentsCount; i++) {
+        if (!ctx->useful[i]) {
+            continue;
+        }
+
+        const ASTNode *value = NULL;
+        bool constant = true;
+        for (unsigned j = 0; constant && j < ctx->sitesCount; j++) {
+            const IPCPSite *site = &ctx->sites[j];
+            if (site->redirected || ipcp_passes_own(ctx, site, i)) {
+                continue;
+            }
+            const ASTNode *siteValue = ipcp_value(ctx, site, i);
+            constant = siteValue != NULL && (value == NULL || tf_equal(value, siteValue));
+            value = siteValue;
+        }
+        if (!constant || value == NULL) {
+            continue;
+        }
+
+        if (!ipcp_assign_parameter(ctx->fun, ctx->parameters[i], value) || !ipcp_set_known(ctx, ctx->fun, i, value)) {
+            return false;
+        }
+        ctx->propagated++;
+    }
+    return true;
+}
+
+// Propagates the constant arguments of the calls of the function into it.
+static bool ipcp_function(IPCPContext *ctx, unsigned index) {
+    const CGNode *node = &ctx->graph.nodes[index];
+    CFFunction *fun = node->function;
+    if (fun == ctx->program->mainFunc || fun->symbol == NULL || fun->rootStatement == NULL
+        || fun->argumentsCount == 0) {
+        return true;
+    }
+
+    ctx->fun = fun;
+    ctx->parameters = malloc(fun->argumentsCount * sizeof(STSymbol *));
+    ctx->useful = malloc(fun->argumentsCount * sizeof(bool));
+    bool propagated = ctx->parameters != NULL && ctx->useful != NULL;
+    bool useful = false;
+    for (unsigned i = 0; propagated && i < fun->argumentsCount; i++) {
+        STSymbol *parameter = ipcp_parameter(fun, i);
+        ctx->parameters[i] = parameter;
+        ctx->useful[i] = parameter != NULL && parameter->reference_counter > 0
+                         && !tf_statements_assign(fun->rootStatement, parameter);
+        useful |= ctx->useful[i];
+    }
+
+    ctx->sitesCount = 0;
+    ctx->invalid = false;
+    unsigned functionsCount = ctx->program->functionsCount;
+    for (unsigned i = 0; propagated && useful && i < functionsCount; i++) {
+        CFFunction *caller = ctx->program->functions[i];
+        propagated = ipcp_find_sites(ctx, caller, caller->rootStatement, false);
+    }
+
+    if (propagated && useful && ctx->sitesCount > 0 && !ctx->invalid) {
+        propagated = (node->recursive || ipcp_specialise(ctx)) && ipcp_propagate(ctx);
+    }
+
+    free(ctx->parameters);
+    free(ctx->useful);
+    ctx->parameters = NULL;
+    ctx->useful = NULL;
+    return propagated;
+}
+
+bool ipcp_run(CFProgram *program, unsigned budget, unsigned *propagated, unsigned *cloned) {
+    IPCPContext ctx = {.program = program, .budget = budget};
+    *propagated = 0;
+    *cloned = 0;
+    if (!cg_build(program, &ctx.graph)) {
+        return false;
+    }
+    im_init(&ctx.knownIndices);
+
+    // The callers are processed before their callees, so the constants of their parameters are already known
+    for (unsigned i = ctx.graph.count; i > 0 && !ctx.failed && compiler_result == COMPILER_RESULT_SUCCESS; i--) {
+        ctx.failed = !ipcp_function(&ctx, ctx.graph.order[i - 1]);
+    }
+
+    for (unsigned i = 0; i < ctx.knownCount; i++) {
+        free(ctx.known[i]);
+    }
+    free(ctx.known);
+    im_free(&ctx.knownIndices);
+    free(ctx.sites);
+    free(ctx.groups);
+    cg_free(&ctx.graph);
+    *propagated = ctx.propagated;
+    *cloned = ctx.cloned;
+    return !ctx.failed;
+}
@@ -0,0 +1,32 @@
+/** @file ipcp.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the interprocedural propagation of constant arguments.
+ */
+
+#ifndef _IPCP_H
+#define _IPCP_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Propagates the constants passed as arguments into the called functions.
+ *  - The functions are processed top-down in the call graph, so a parameter of the caller that is known to be
+ *    constant counts as a constant argument. Only the parameters the function reads and never assigns
+ *    are considered.
+ *  - If all the calls of a function pass the same constant as a parameter, the constant is assigned
+ *    to the parameter at the start of the function, the constant propagation of the function then replaces
+ *    its reads. The calls passing the parameter of a recursive function unchanged to itself are ignored.
+ *    As the calls may never run, the divisions of the function still check a zero divisor at runtime.
+ *  - Otherwise, the calls passing the same constants are grouped and a specialised copy of a non-recursive
+ *    function is created for a group called in a loop or from several places, starting with the most frequently
+ *    called ones. The calls of the group call the copy instead, which assigns the constants to its parameters.
+ *    The function itself is kept for the remaining calls (at least one group always stays). The copies are limited
+ *    by the budget: the total number of their AST nodes (and statements).
+ * Stores the number of parameters assigned a constant and the number of created copies, returns false if memory
+ * couldn't be allocated.
+ */
+bool ipcp_run(CFProgram *program, unsigned budget, unsigned *propagated, unsigned *cloned);
+
+#endif // _IPCP_H
@@ -0,0 +1,172 @@
+/** @file licm.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the loop-invariant code motion over the SSA form.
+ */
+
+#include <stdlib.h>
+#include "licm.h"
+#include "transform.h"
+
+// A computation moved before a loop.
+typedef struct licm_hoisted {
+    const CFStatement *loop;   // The FOR statement the computation has been moved before.
+    const ASTNode *computation;
+    STSymbol *temporary;
+} LICMHoisted;
+
+typedef struct licm_context {
+    SSAForm *ssa;
+
+    LICMHoisted *hoisted;
+    unsigned hoistedCount;
+    unsigned hoistedCapacity;
+
+    unsigned reused; // Number of computations replaced with an already moved one.
+    bool failed;
+} LICMContext;
+
+// The instruction being processed.
+typedef struct licm_instruction {
+    BBBlock *block;
+    BBInstruction *instruction;
+    bool canHoistTrap; // Whether the computations that may fail may be moved before the instruction's loop.
+} LICMInstruction;
+
+// Returns the outermost loop the computation is invariant in, NULL if it's not invariant in its innermost loop.
+static BBLoop *licm_target(LICMContext *ctx, LICMInstruction *ins, const ASTNode *node) {
+    BBLoop *target = NULL;
+    for (BBLoop *loop = ins->block->loop; loop != NULL; loop = loop->parent) {
+        if (loop->preheader == NULL || !ssa_is_invariant(ctx->ssa, node, loop)) {
+            break;
+        }
+        target = loop;
+    }
+    return target;
+}
+
+// Replaces the computation with a read of a temporary assigned before the loop.
+static void licm_hoist(LICMContext *ctx, LICMInstruction *ins, ASTNode **slot, BBLoop *loop) {
+    ASTNode *root = *ins->instruction->ast;
+
+    for (unsigned i = 0; i < ctx->hoistedCount; i++) {
+        LICMHoisted *hoisted = &ctx->hoisted[i];
+        if (hoisted->loop == loop->statement && tf_equal(hoisted->computation, *slot)) {
+            ASTNode *read = tf_read(hoisted->temporary);
+            if (read == NULL) {
+                ctx->failed = true;
+                return;
+            }
+            tf_replace(root, slot, read);
+            ctx->reused++;
+            return;
+        }
+    }
+
+    if (!tf_reserve((void **) &ctx->hoisted, &ctx->hoistedCapacity, ctx->hoistedCount, sizeof(LICMHoisted))) {
+        ctx->failed = true;
+        return;
+    }
+
+    STSymbol *temporary = tf_new_temporary(ctx->ssa->graph->function, "licm", (*slot)->inheritedDataType);
+    ASTNode *read = temporary == NULL ? NULL : tf_read(temporary);
+    ASTNode *values = ast_node_list(1);
+    if (read == NULL || values == NULL) {
+        clean_ast(read);
+        clean_ast(values);
+        ctx->failed = true;
+        return;
+    }
+
+    ASTNode *computation = tf_detach(root, slot, read);
+    ast_push_to_list(values, computation);
+    ASTNode *definition = tf_define(&temporary, 1, values);
+    if (definition == NULL || tf_insert_before(loop->statement, definition) == NULL) {
+        clean_ast(definition);
+        ctx->failed = true;
+        return;
+    }
+
+    ctx->hoisted[ctx->hoistedCount++] = (LICMHoisted) {loop->statement, computation, temporary};
+}
+
+// Moves the largest invariant computations of the subtree in the slot out of their loops.
+// The right operands of && and || are conditional, so the computations in them may only be moved if they can't fail.
+static void licm_visit(LICMContext *ctx, LICMInstruction *ins, ASTNode **slot, bool conditional) {
+    ASTNode *node = *slot;
+    if (node == NULL || ctx->failed) {
+        return;
+    }
+
+    if (tf_is_computation(node) && !tf_has_impure_call(node)) {
+        BBLoop *target = licm_target(ctx, ins, node);
+        if (target != NULL && tf_may_fail(node)) {
+            // Only the condition of the loop itself is sure to be evaluated after the loop is entered
+            bool ownCondition = ins->instruction->target == CF_FOR_CONDITIONAL
+                                && ins->instruction->statement == ins->block->loop->statement;
+            target = ownCondition && !conditional && ins->canHoistTrap ? ins->block->loop : NULL;
+        }
+        if (target != NULL) {
+            licm_hoist(ctx, ins, slot, target);
+            return;
+        }
+    }
+
+    switch (node->actionType) {
+        case AST_LIST:
+            for (unsigned i = 0; i < node->dataCount; i++) {
+                licm_visit(ctx, ins, &node->data[i].astPtr, conditional);
+            }
+            break;
+        case AST_FUNC_CALL:
+            licm_visit(ctx, ins, &node->right, conditional);
+            break;
+        case AST_LOG_AND:
+        case AST_LOG_OR:
+            licm_visit(ctx, ins, &node->left, conditional);
+            licm_visit(ctx, ins, &node->right, true);
+            break;
+        case AST_ASSIGN:
+        case AST_DEFINE:
+            licm_visit(ctx, ins, &node->right, conditional);
+            break;
+        case AST_ID:
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_STRING:
+        case AST_CONST_BOOL:
+            break;
+        default:
+            licm_visit(ctx, ins, &node->left, conditional);
+            licm_visit(ctx, ins, &node->right, conditional);
+            break;
+    }
+}
+
+bool licm_run(SSAForm *ssa, unsigned *hoisted) {
+    LICMContext ctx = {.ssa = ssa};
+
+    for (unsigned i = 0; i < ssa->graph->reachableCount && !ctx.failed; i++) {
+        BBBlock *block = ssa->graph->reversePostorder[i];
+        if (block->loop == NULL) {
+            continue;
+        }
+
+        for (unsigned j = 0; j < block->instructionsCount && !ctx.failed; j++) {
+            BBInstruction *instruction = &block->instructions[j];
+            LICMInstruction ins = {.block = block, .instruction = instruction};
+            if (instruction->target == CF_FOR_CONDITIONAL) {
+                ins.canHoistTrap = !tf_has_impure_call(*instruction->ast)
+                                   && !tf_has_impure_call(instruction->statement->data.forData->definitionAst);
+            }
+
+            licm_visit(&ctx, &ins, instruction->ast, false);
+            tf_update_calls(*instruction->ast);
+        }
+    }
+
+    *hoisted = ctx.hoistedCount + ctx.reused;
+    free(ctx.hoisted);
+    return !ctx.failed;
+}
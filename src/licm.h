@@ -0,0 +1,27 @@
+/** @file licm.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the loop-invariant code motion.
+ */
+
+#ifndef _LICM_H
+#define _LICM_H 1
+
+#include "ssa.h"
+
+/* Moves the computations that give the same value in each iteration of a FOR loop before the loop.
+ *  - A computation (an operation or a call of a pure built-in function) is invariant in a loop if all the variables
+ *    it reads have values defined outside the loop: the loop body, condition and afterthought never assign them.
+ *  - The largest invariant computations are moved to the outermost loop they're invariant in. They're assigned
+ *    to a new temporary variable right before the FOR statement and the loop reads the temporary instead.
+ *    The same computation moved out of a loop several times is only assigned once.
+ *  - Computations that contain calls of other functions are never moved. Computations that may fail at runtime
+ *    (division, float2int) are only moved out of the condition of their own loop, which is always evaluated
+ *    right after the FOR definition, and only if neither of them calls other functions.
+ * The SSA form is invalid afterwards. Stores the number of moved computations, returns false if memory couldn't
+ * be allocated.
+ */
+bool licm_run(SSAForm *ssa, unsigned *hoisted);
+
+#endif // _LICM_H
@@ -10,11 +10,127 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include "optimiser.h"
 #include "control_flow.h"
 #include "ast.h"
 #include "stderr_message.h"
-#include "variable_vector.h"
+#include "thread_pool.h"
+#include "basic_blocks.h"
+#include "ssa.h"
+#include "sccp.h"
+#include "licm.h"
+#include "induction.h"
+#include "unroll.h"
+#include "unswitch.h"
+#include "inline.h"
+#include "ipcp.h"
+#include "ctfe.h"
+#include "dse.h"
+#include "copyprop.h"
+#include "gvn.h"
+#include "range.h"
+#include "reassoc.h"
+#include "transform.h"
+
+// A list of statements that should be processed again.
+typedef struct statement_worklist {
+    CFStatement **statements;
+    unsigned count;
+    unsigned capacity;
+} StatementWorklist;
+
+// State of the optimisation of a single function.
+typedef struct optimiser_context {
+    StatementWorklist worklist; // Statements changed by the constant propagation.
+    unsigned long statementVisits;
+    unsigned long propagationRounds;
+    unsigned long roundCapHits;
+    unsigned long propagatedConstants;
+    unsigned long unswitchedLoops;
+    unsigned long unrolledLoops;
+    unsigned long reducedInductions;
+    unsigned long hoistedComputations;
+    unsigned long eliminatedExpressions;
+    unsigned long removedDivisionChecks;
+    unsigned long foldedComparisons;
+    unsigned long removedStores;
+    unsigned long propagatedCopies;
+    unsigned long coalescedVariables;
+    OptimiserPassStats passes[OPTIMISER_PASS_COUNT];
+    double passStarts[OPTIMISER_PASS_COUNT]; // Times when the current runs of the passes started.
+} OptimiserContext;
+
+// A transformation of a function in the SSA form, storing the number of changes it made.
+// Returns false if memory couldn't be allocated.
+typedef bool (*SSAPass)(SSAForm *ssa, unsigned *changes);
+
+// Data shared by the tasks optimising the functions in parallel.
+typedef struct parallel_optimisation {
+    CFProgram *program;
+    OptimiserStats *functionStats;
+} ParallelOptimisation;
+
+static OptimiserStats optimiserStats;
+static unsigned optimiserJobs = 1;
+static unsigned optimiserUnswitchBudget = OPTIMISER_DEFAULT_UNSWITCH_BUDGET;
+static unsigned optimiserUnrollBudget = OPTIMISER_DEFAULT_UNROLL_BUDGET;
+static unsigned optimiserCloneBudget = OPTIMISER_DEFAULT_CLONE_BUDGET;
+static unsigned long optimiserEvaluationBudget = OPTIMISER_DEFAULT_EVALUATION_BUDGET;
+static OptimiserLevel optimiserLevel = OPTIMISER_LEVEL_FULL;
+static bool optimiserPasses[OPTIMISER_PASS_COUNT] = {true, true, true, true, true, true, true, true, true, true,
+                                                     true, true, true, true, true};
+
+static const char *optimiserPassNames[OPTIMISER_PASS_COUNT] = {"inline", "ipcp", "fold", "reassoc", "sccp", "unswitch",
+                                                               "unroll", "induction", "licm", "gvn", "ranges",
+                                                               "copyprop", "dse", "coalesce", "ctfe"};
+
+double optimiser_current_time() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+// Returns the number of AST nodes and statements of the function, or of the whole program if it's NULL.
+unsigned long code_size(const CFFunction *fun) {
+    if (fun != NULL) {
+        return tf_statements_size(fun->rootStatement);
+    }
+    CFProgram *prog = get_program();
+    unsigned long size = 0;
+    for (unsigned i = 0; i < prog->functionsCount; i++) {
+        size += tf_statements_size(prog->functions[i]->rootStatement);
+    }
+    return size;
+}
+
+// Starts a run of the pass on the function (or on the whole program if it's NULL). Returns false if the pass
+// is disabled or the optimisation has failed, otherwise the run must be ended by finish_pass().
+bool start_pass(OptimiserContext *ctx, OptimiserPass pass, const CFFunction *fun) {
+    if (!optimiserPasses[pass] || thread_pool_result() != COMPILER_RESULT_SUCCESS) {
+        return false;
+    }
+    ctx->passes[pass].runs++;
+    ctx->passes[pass].visitedNodes += code_size(fun);
+    ctx->passStarts[pass] = optimiser_current_time();
+    return true;
+}
+
+// Ends the run of the pass which made the given number of changes.
+void finish_pass(OptimiserContext *ctx, OptimiserPass pass, unsigned long changes) {
+    ctx->passes[pass].rewrittenNodes += changes;
+    ctx->passes[pass].seconds += optimiser_current_time() - ctx->passStarts[pass];
+}
+
+// Adds the statistics of the passes to the totals.
+void add_pass_stats(OptimiserPassStats *total, const OptimiserPassStats *passes) {
+    for (unsigned i = 0; i < OPTIMISER_PASS_COUNT; i++) {
+        total[i].runs += passes[i].runs;
+        total[i].visitedNodes += passes[i].visitedNodes;
+        total[i].rewrittenNodes += passes[i].rewrittenNodes;
+        total[i].seconds += passes[i].seconds;
+    }
+}
 
 
 static double dabs(double x) {
@@ -137,15 +253,17 @@ void optimise_multiply(ASTNode **ast, bool *changed) {
         }
         *changed = true;
     } else {
-        // If one of the operands is 0, the operation is also constant (doesn't apply to float).
-        // If one of the operands is 1, we can remove the multiplication.
+        // If one of the operands is 0, the operation is also constant (doesn't apply to float), unless the other
+        // operand has side effects or may fail. If one of the operands is 1, we can remove the multiplication.
         ASTNode *target = NULL;
-        if ((right_op->actionType == AST_CONST_INT && right_op->data[0].intConstantValue == 0) ||
+        bool leftRemovable = !tf_has_impure_call(left_op) && !tf_may_fail(left_op);
+        bool rightRemovable = !tf_has_impure_call(right_op) && !tf_may_fail(right_op);
+        if ((right_op->actionType == AST_CONST_INT && right_op->data[0].intConstantValue == 0 && leftRemovable) ||
                 (left_op->actionType == AST_CONST_INT && left_op->data[0].intConstantValue == 1) ||
                 (left_op->actionType == AST_CONST_FLOAT && dabs(1 - left_op->data[0].floatConstantValue) < 1e-10)) {
             (*ast)->right = NULL;
             target = right_op;
-        } else if ((left_op->actionType == AST_CONST_INT && left_op->data[0].intConstantValue == 0) ||
+        } else if ((left_op->actionType == AST_CONST_INT && left_op->data[0].intConstantValue == 0 && rightRemovable) ||
                 (right_op->actionType == AST_CONST_INT && right_op->data[0].intConstantValue == 1) ||
                 (right_op->actionType == AST_CONST_FLOAT && dabs(1 - right_op->data[0].floatConstantValue) < 1e-10)) {
             (*ast)->left = NULL;
@@ -162,6 +280,11 @@ void optimise_multiply(ASTNode **ast, bool *changed) {
 void optimise_divide(ASTNode **ast, bool *changed) {
     ASTNode *left_op = (*ast)->left;
     ASTNode *right_op = (*ast)->right;
+    if ((*ast)->divisorChecked && ((right_op->actionType == AST_CONST_INT && right_op->data[0].intConstantValue == 0)
+            || (right_op->actionType == AST_CONST_FLOAT && dabs(right_op->data[0].floatConstantValue) < 1e-10))) {
+        // The division may never be executed with the zero, the generated code checks it
+        return;
+    }
     if (left_op->actionType == AST_CONST_INT && right_op->actionType == AST_CONST_INT) {
         if (right_op->data[0].intConstantValue == 0) {
             stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_DIVISION_BY_ZERO, "Division by zero\n");
@@ -176,10 +299,14 @@ void optimise_divide(ASTNode **ast, bool *changed) {
         }
         *changed = true;
     } else if (left_op->actionType == AST_CONST_FLOAT && right_op->actionType == AST_CONST_FLOAT) {
-        if (dabs(right_op->data[0].floatConstantValue) < 1e-10) {
+        if (right_op->data[0].floatConstantValue == 0) {
             stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_DIVISION_BY_ZERO, "Division by zero\n");
             return;
         }
+        if (dabs(right_op->data[0].floatConstantValue) < 1e-10) {
+            // A tiny divisor (e.g. a product of small numbers) doesn't fail, the quotient may overflow though
+            return;
+        }
         double new_val = left_op->data[0].floatConstantValue / right_op->data[0].floatConstantValue;
         clean_ast(*ast);
         *ast = ast_leaf_constf(new_val);
@@ -197,7 +324,7 @@ void optimise_divide(ASTNode **ast, bool *changed) {
             *ast = left_op;
             *changed = true;
         } else if ((right_op->actionType == AST_CONST_INT && right_op->data[0].intConstantValue == 0) ||
-                (right_op->actionType == AST_CONST_FLOAT && dabs(right_op->data[0].floatConstantValue) < 1e-10)) {
+                (right_op->actionType == AST_CONST_FLOAT && right_op->data[0].floatConstantValue == 0)) {
             stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_DIVISION_BY_ZERO, "Division by zero\n");
             return;
         }
@@ -392,6 +519,51 @@ void optimise_relational_operator(ASTNode **ast, bool *changed) {
     }
 }
 
+// Replaces a call of a built-in function returning a single value with the value if its arguments are constants.
+// The arguments may be constants propagated into the call, its value is then propagated in the next round.
+void optimise_builtin_call(ASTNode **ast, bool *changed) {
+    const STSymbol *symbol = (*ast)->left->data[0].symbolTableItemPtr;
+    if (symbol == NULL || symbol->type != ST_SYMBOL_FUNC || symbol->data.func_data.ret_types_count != 1) {
+        return;
+    }
+    bool failed = false;
+    ASTNode *constant = ctfe_fold_builtin(*ast, &failed);
+    if (failed) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return;
+    }
+    if (constant != NULL) {
+        clean_ast(*ast);
+        *ast = constant;
+        *changed = true;
+    }
+}
+
+// Replaces a call of a built-in function returning a value and an error code with the constants, if the call
+// is the value list of an assignment (or a definition) and its arguments are constants.
+void optimise_builtin_assignment(ASTNode **ast, bool *changed) {
+    ASTNode *values = (*ast)->right;
+    if (values == NULL || values->actionType != AST_LIST || values->dataCount != 1
+            || values->data[0].astPtr->actionType != AST_FUNC_CALL) {
+        return;
+    }
+    const STSymbol *symbol = values->data[0].astPtr->left->data[0].symbolTableItemPtr;
+    if (symbol == NULL || symbol->type != ST_SYMBOL_FUNC || symbol->data.func_data.ret_types_count != 2) {
+        return;
+    }
+    bool failed = false;
+    ASTNode *constants = ctfe_fold_builtin(values->data[0].astPtr, &failed);
+    if (failed) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return;
+    }
+    if (constants != NULL) {
+        clean_ast(values);
+        (*ast)->right = constants;
+        *changed = true;
+    }
+}
+
 void optimise_ast(ASTNode **ast, bool *changed) {
     // Traverse the AST using post-order traversal
     if (*ast == NULL) {
@@ -439,232 +611,211 @@ void optimise_ast(ASTNode **ast, bool *changed) {
         case AST_LOG_GTE:
             optimise_relational_operator(ast, changed);
             break;
+        case AST_FUNC_CALL:
+            optimise_builtin_call(ast, changed);
+            break;
+        case AST_ASSIGN:
+        case AST_DEFINE:
+            optimise_builtin_assignment(ast, changed);
+            break;
         default:
             break;
     }
 }
 
-void optimise_expressions(CFStatement *stat, bool *changed) {
+// A transformation of an expression of a statement, storing whether it changed the expression.
+typedef void (*ExpressionTransform)(ASTNode **ast, bool *changed, OptimiserContext *ctx);
+
+// Folds the AST of an instruction. If it contained calls, its flags are updated, as some of them may have been
+// replaced with their values.
+void fold_instruction(ASTNode **ast, bool *changed, OptimiserContext *ctx) {
+    if (*ast == NULL) {
+        return;
+    }
+    bool hadCalls = (*ast)->actionType == AST_FUNC_CALL || (*ast)->hasInnerFuncCalls;
+    bool folded = false;
+    optimise_ast(ast, &folded);
+    if (folded) {
+        ctx->passes[OPTIMISER_PASS_FOLD].rewrittenNodes++;
+        if (hadCalls && *ast != NULL) {
+            tf_update_calls(*ast);
+        }
+    }
+    *changed |= folded;
+}
+
+// Canonicalises the chains of operations of an instruction and folds it again if they changed.
+void reassociate_instruction(ASTNode **ast, bool *changed, OptimiserContext *ctx) {
+    if (*ast == NULL) {
+        return;
+    }
+    bool hadCalls = (*ast)->actionType == AST_FUNC_CALL || (*ast)->hasInnerFuncCalls;
+    bool reassociated = false;
+    if (!reassoc_ast(ast, &reassociated)) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return;
+    }
+    if (reassociated) {
+        ctx->passes[OPTIMISER_PASS_REASSOC].rewrittenNodes++;
+        optimise_ast(ast, &reassociated);
+        if (hadCalls && *ast != NULL) {
+            tf_update_calls(*ast);
+        }
+        *changed = true;
+    }
+}
+
+// Transforms the expressions that belong directly to the statement (not to its nested statements).
+// Returns false if the types of the expressions couldn't be inferred.
+bool optimise_statement_expressions(CFStatement *stat, bool *changed, OptimiserContext *ctx,
+                                    ExpressionTransform transform) {
+    ctx->statementVisits++;
+    switch (stat->statementType) {
+        case CF_BASIC:
+        case CF_RETURN:
+            if (stat->data.bodyAst != NULL && !ast_infer_node_type(stat->data.bodyAst)) return false;
+            if (stat->data.bodyAst != NULL && stat->data.bodyAst->actionType == AST_FUNC_CALL) {
+                // The results of a call statement are discarded, so only its arguments are transformed
+                bool folded = false;
+                transform(&stat->data.bodyAst->right, &folded, ctx);
+                if (folded) {
+                    tf_update_calls(stat->data.bodyAst);
+                }
+                *changed |= folded;
+            } else {
+                transform(&stat->data.bodyAst, changed, ctx);
+            }
+            break;
+        case CF_IF:
+            if (!ast_infer_node_type(stat->data.ifData->conditionalAst)) return false;
+            transform(&stat->data.ifData->conditionalAst, changed, ctx);
+            break;
+        case CF_FOR:
+            if (stat->data.forData->definitionAst != NULL &&
+                    !ast_infer_node_type(stat->data.forData->definitionAst)) return false;
+            transform(&stat->data.forData->definitionAst, changed, ctx);
+            if (!ast_infer_node_type(stat->data.forData->conditionalAst)) return false;
+            transform(&stat->data.forData->conditionalAst, changed, ctx);
+            if (stat->data.forData->afterthoughtAst != NULL &&
+                !ast_infer_node_type(stat->data.forData->afterthoughtAst)) return false;
+            transform(&stat->data.forData->afterthoughtAst, changed, ctx);
+            break;
+    }
+    return true;
+}
+
+void optimise_expressions(CFStatement *stat, bool *changed, OptimiserContext *ctx, ExpressionTransform transform) {
     if (stat != NULL && !is_statement_empty(stat)) {
+        if (!optimise_statement_expressions(stat, changed, ctx, transform)) return;
         switch (stat->statementType) {
-            case CF_BASIC:
-            case CF_RETURN:
-                if (stat->data.bodyAst != NULL && !ast_infer_node_type(stat->data.bodyAst)) return;
-                optimise_ast(&stat->data.bodyAst, changed);
-                break;
             case CF_IF:
-                if (!ast_infer_node_type(stat->data.ifData->conditionalAst)) return;
-                optimise_ast(&stat->data.ifData->conditionalAst, changed);
-                optimise_expressions(stat->data.ifData->thenStatement, changed);
-                optimise_expressions(stat->data.ifData->elseStatement, changed);
+                optimise_expressions(stat->data.ifData->thenStatement, changed, ctx, transform);
+                optimise_expressions(stat->data.ifData->elseStatement, changed, ctx, transform);
                 break;
             case CF_FOR:
-                if (stat->data.forData->definitionAst != NULL &&
-                        !ast_infer_node_type(stat->data.forData->definitionAst)) return;
-                optimise_ast(&stat->data.forData->definitionAst, changed);
-                if (!ast_infer_node_type(stat->data.forData->conditionalAst)) return;
-                optimise_ast(&stat->data.forData->conditionalAst, changed);
-                if (stat->data.forData->afterthoughtAst != NULL &&
-                    !ast_infer_node_type(stat->data.forData->afterthoughtAst)) return;
-                optimise_ast(&stat->data.forData->afterthoughtAst, changed);
-                optimise_expressions(stat->data.forData->bodyStatement, changed);
+                optimise_expressions(stat->data.forData->bodyStatement, changed, ctx, transform);
+                break;
+            default:
                 break;
         }
     }
 
     if (stat != NULL && stat->followingStatement != NULL) {
-        optimise_expressions(stat->followingStatement, changed);
+        optimise_expressions(stat->followingStatement, changed, ctx, transform);
     }
 }
 
-void fold_constants(bool *changed) {
-    CFProgram *prog = get_program();
-    CFFuncListNode *n = prog->functionList;
-    while (n != NULL) {
-        optimise_expressions(n->fun.rootStatement, changed);
-        n = n->next;
+void worklist_push(StatementWorklist *worklist, CFStatement *stat) {
+    if (!tf_reserve((void **) &worklist->statements, &worklist->capacity, worklist->count, sizeof(CFStatement *))) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return;
     }
+    worklist->statements[worklist->count++] = stat;
 }
 
-void propagate_into_expression(ASTNode **ast, bool *changed, VariableVector *vector, STSymbol *unary_symb) {
-    if (*ast == NULL) {
-        return;
+// Creates a constant leaf holding the lattice value.
+ASTNode *constant_leaf(const SCCPValue *value) {
+    switch (value->type) {
+        case AST_CONST_BOOL:
+            return ast_leaf_constb(value->data.boolConstantValue);
+        case AST_CONST_INT:
+            return ast_leaf_consti(value->data.intConstantValue);
+        case AST_CONST_FLOAT:
+            return ast_leaf_constf(value->data.floatConstantValue);
+        case AST_CONST_STRING:
+            return ast_leaf_consts(value->data.stringConstantValue);
+        default:
+            return NULL;
     }
-    if ((*ast)->actionType == AST_LIST) {
-        // Walk through all elements of the list
-        for (unsigned i = 0; i < (*ast)->dataCount; i++) {
-            propagate_into_expression(&(*ast)->data[i].astPtr, changed, vector, unary_symb);
+}
+
+// Replaces the reads of variables in executable blocks that SCCP proved constant, queueing their statements
+// for folding.
+void propagate_constant_reads(SSAForm *ssa, SCCPResult *sccp, OptimiserContext *ctx) {
+    for (unsigned i = 0; i < ssa->usesCount; i++) {
+        SSAUse *use = &ssa->uses[i];
+        SCCPValue *value = &sccp->values[use->value->id];
+        if (use->slot == NULL || value->state != SCCP_CONSTANT || !sccp_is_executable(sccp, use->block)) {
+            continue;
         }
-    } else {
-        if ((*ast)->actionType != AST_FUNC_CALL) {
-            propagate_into_expression(&(*ast)->left, changed, vector, unary_symb);
-        }
-        propagate_into_expression(&(*ast)->right, changed, vector, unary_symb);
-    }
-
-    if ((*ast)->actionType == AST_ID) {
-        Variable *found = vv_find(vector, (*ast)->data[0].symbolTableItemPtr);
-        if (found != NULL) {
-            // Replace ID with a constant
-            ASTNode *tmp = *ast;
-            switch(found->data.type) {
-                case AST_CONST_BOOL:
-                    *ast = ast_leaf_constb(found->data.data.boolConstantValue);
-                    break;
-                case AST_CONST_INT:
-                    *ast = ast_leaf_consti(found->data.data.intConstantValue);
-                    break;
-                case AST_CONST_FLOAT:
-                    *ast = ast_leaf_constf(found->data.data.floatConstantValue);
-                    break;
-                case AST_CONST_STRING:
-                    *ast = ast_leaf_consts(found->data.data.stringConstantValue);
-                    break;
-                default:
-                    return;
-            }
-            if (*ast == NULL) {
-                stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
-            }
-            *changed = true;
-            if (found->data.symbol == unary_symb) {
-                unary_symb->reference_counter++;
-            }
-            clean_ast(tmp);
+
+        ASTNode *leaf = constant_leaf(value);
+        if (leaf == NULL) {
+            stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+            return;
+        }
+        BBInstruction *instruction = &use->block->instructions[use->instruction];
+        tf_replace(*instruction->ast, use->slot, leaf);
+        ctx->propagatedConstants++;
+
+        // The uses are ordered by instructions, so a statement is only queued once for each of its ASTs
+        if (ctx->worklist.count == 0 || ctx->worklist.statements[ctx->worklist.count - 1] != instruction->statement) {
+            worklist_push(&ctx->worklist, instruction->statement);
         }
     }
 }
 
-void propagate_ast_constants(ASTNode **ast, bool remove_only, bool add_new, bool *changed, VariableVector *vector) {
-    // First try to propagate in the expression. For assignments and definitions
-    // propagate only on the right side. This covers cases such as
-    // a := 5
-    // b := a
-    if (*ast == NULL) {
+// Propagates constants through the function using the sparse conditional constant propagation on its SSA form.
+// The statements whose reads were replaced are left in the worklist.
+void propagate_function_constants(CFFunction *fun, OptimiserContext *ctx) {
+    BBGraph *graph = bb_build(fun);
+    if (graph == NULL) {
         return;
     }
-    STSymbol *symb = NULL;
-    if (!remove_only) {
-        switch ((*ast)->actionType) {
-            case AST_DEFINE:
-            case AST_ASSIGN:
-                // A bit of a hack, using unary assign operator (e.g. +=) can be determined based on actionType.
-                // Normal assignments have AST_LIST on the left, whereas unary assignments have only AST_ID (only
-                // one thing can be assigned at a time). We want to avoid reducing reference counter when cleaning
-                // the AST as the UNARY assignment doesn't count as a reference
-                if ((*ast)->left->actionType == AST_ID) {
-                    symb = (*ast)->left->data[0].symbolTableItemPtr;
-                }
-                propagate_into_expression(&(*ast)->right, changed, vector, symb);
-                break;
-            default:
-                propagate_into_expression(ast, changed, vector, NULL);
-                break;
-        }
+    SSAForm *ssa = ssa_build(graph);
+    if (ssa == NULL) {
+        bb_free(graph);
+        return;
     }
 
-    // Now introduce new constants and remove what is no longer constant
-    if ((*ast)->actionType == AST_DEFINE) {
-        // Check if a constant isn't assigned in the definition
-        if ((*ast)->left->dataCount == (*ast)->right->dataCount) {
-            for (unsigned i = 0; i < (*ast)->left->dataCount; i++) {
-                bool new_constant = false;
-                VariableData data;
-                ASTNode *current = (*ast)->right->data[i].astPtr;
-                STSymbol *symbol = (*ast)->left->data[i].astPtr->data[0].symbolTableItemPtr;
-                switch (current->actionType) {
-                    case AST_CONST_FLOAT:
-                        new_constant = true;
-                        data.data.floatConstantValue = current->data[0].floatConstantValue;
-                        data.type = AST_CONST_FLOAT;
-                        break;
-                    case AST_CONST_INT:
-                        new_constant = true;
-                        data.data.intConstantValue = current->data[0].intConstantValue;
-                        data.type = AST_CONST_INT;
-                        break;
-                    case AST_CONST_STRING:
-                        new_constant = true;
-                        data.data.stringConstantValue = current->data[0].stringConstantValue;
-                        data.type = AST_CONST_STRING;
-                        break;
-                    case AST_CONST_BOOL:
-                        new_constant = true;
-                        data.data.boolConstantValue = current->data[0].boolConstantValue;
-                        data.type = AST_CONST_BOOL;
-                        break;
-                    default:
-                        // This could be a redefinition of a symbol with a non-constant, remove it
-                        vv_remove_symbol(vector, symbol);
-                        break;
-                }
-                if (new_constant && !remove_only && add_new) {
-                    data.symbol = symbol;
-                    vv_append(vector, data);
-                }
-            }
-        } else {
-            // Function call, we can't deduce constants, just remove all variables on LHS from vector
-            for (unsigned i = 0; i < (*ast)->left->dataCount; i++) {
-                vv_remove_symbol(vector, (*ast)->left->data[i].astPtr->data[0].symbolTableItemPtr);
-            }
-        }
-    } else if ((*ast)->actionType == AST_ASSIGN) {
-        // Assignment, invalidate all assigned variables as constants
-        if ((*ast)->left->actionType == AST_ID) {
-            vv_remove_symbol(vector, (*ast)->left->data[0].symbolTableItemPtr);
-        } else {
-            for (unsigned i = 0; i < (*ast)->left->dataCount; i++) {
-                vv_remove_symbol(vector, (*ast)->left->data[i].astPtr->data[0].symbolTableItemPtr);
-            }
-        }
+    SCCPResult sccp;
+    if (sccp_run(ssa, &sccp)) {
+        propagate_constant_reads(ssa, &sccp, ctx);
+        sccp_free(&sccp);
     }
+    ssa_free(ssa);
+    bb_free(graph);
 }
 
-void propagate_function_constants(CFStatement *stat, bool remove, bool add, bool *changed, VariableVector *vector) {
-    // Handle blocks nested in for, we can't add new constants inside a for block.
-    if (stat != NULL && !is_statement_empty(stat)) {
-        switch(stat->statementType) {
-            case CF_BASIC:
-            case CF_RETURN:
-                if (stat->data.bodyAst != NULL && !ast_infer_node_type(stat->data.bodyAst)) return;
-                propagate_ast_constants(&stat->data.bodyAst, remove, add, changed, vector);
-                break;
-            case CF_IF:
-                if (!ast_infer_node_type(stat->data.ifData->conditionalAst)) return;
-                propagate_ast_constants(&stat->data.ifData->conditionalAst, remove, add, changed, vector);
-                propagate_function_constants(stat->data.ifData->thenStatement, remove, add, changed, vector);
-                propagate_function_constants(stat->data.ifData->elseStatement, remove, add, changed, vector);
-                break;
-            case CF_FOR:
-                // First invalidate all variables created in for definition, afterthought and its body
-                if (!ast_infer_node_type(stat->data.forData->definitionAst)) return;
-                propagate_ast_constants(&stat->data.forData->definitionAst, true, false, changed, vector);
-                if (!ast_infer_node_type(stat->data.forData->conditionalAst)) return;
-                propagate_ast_constants(&stat->data.forData->afterthoughtAst, true, false, changed, vector);
-                propagate_function_constants(stat->data.forData->bodyStatement, true, false, changed, vector);
-                // Now propagate whatever is constant after processing the whole loop
-                propagate_ast_constants(&stat->data.forData->conditionalAst, false, true, changed, vector);
-                propagate_function_constants(stat->data.forData->bodyStatement, false, false, changed, vector);
-                break;
-        }
+// Builds the SSA form of the function and runs the pass on it. Returns the number of changes made by the pass.
+unsigned run_ssa_pass(CFFunction *fun, SSAPass pass) {
+    BBGraph *graph = bb_build(fun);
+    if (graph == NULL) {
+        return 0;
     }
-
-    if (stat != NULL && stat->followingStatement != NULL) {
-        propagate_function_constants(stat->followingStatement, remove, add, changed, vector);
+    SSAForm *ssa = ssa_build(graph);
+    if (ssa == NULL) {
+        bb_free(graph);
+        return 0;
     }
-}
 
-void propagate_constants(bool *changed) {
-    CFProgram *prog = get_program();
-    CFFuncListNode *n = prog->functionList;
-    while (n != NULL) {
-        VariableVector vector;
-        vv_init(&vector);
-        propagate_function_constants(n->fun.rootStatement, false, true, changed, &vector);
-        n = n->next;
-        vv_free(&vector);
+    unsigned changes = 0;
+    if (!pass(ssa, &changes)) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
     }
+    ssa_free(ssa);
+    bb_free(graph);
+    return changes;
 }
 
 void rebind_adjacent_statements(CFStatement *stat, CFFunction *fun) {
@@ -681,6 +832,31 @@ void rebind_adjacent_statements(CFStatement *stat, CFFunction *fun) {
     }
 }
 
+// Replaces the IF statement whose condition is false with the else-if in its ELSE branch.
+void replace_with_else_if(CFStatement *stat) {
+    CFStatement *elseIf = stat->data.ifData->elseStatement;
+    SymbolTable *table = stat->data.ifData->thenStatement->localSymbolTable;
+    clean_stat(stat->data.ifData->thenStatement, stat->localSymbolTable);
+    if (table != stat->localSymbolTable) {
+        symtable_free(table);
+    }
+    clean_ast(stat->data.ifData->conditionalAst);
+    free(stat->data.ifData);
+
+    stat->data.ifData = elseIf->data.ifData;
+    for (CFStatement *next = stat->data.ifData->thenStatement; next != NULL; next = next->followingStatement) {
+        next->parentBranchStatement = stat;
+    }
+    stat->data.ifData->thenStatement->parentStatement = stat;
+    for (CFStatement *next = stat->data.ifData->elseStatement; next != NULL; next = next->followingStatement) {
+        next->parentBranchStatement = stat;
+    }
+    if (stat->data.ifData->elseStatement != NULL) {
+        stat->data.ifData->elseStatement->parentStatement = stat;
+    }
+    free(elseIf);
+}
+
 void remove_function_dead_code(CFStatement *stat, CFFunction *fun) {
     SymbolTable *table;
     SymbolTable *parent_table;
@@ -690,13 +866,24 @@ void remove_function_dead_code(CFStatement *stat, CFFunction *fun) {
                 if (stat->data.ifData->conditionalAst->actionType == AST_CONST_BOOL &&
                         !stat->data.ifData->conditionalAst->data[0].boolConstantValue) {
                     // If false, remove the block
-                    if (stat->data.ifData->elseStatement == NULL) {
+                    if (stat->data.ifData->elseStatement == NULL && stat->parentStatement != NULL
+                        && stat->parentStatement->followingStatement != stat) {
+                        // Else-if without else, remove it from the IF it belongs to
+                        stat->parentStatement->data.ifData->elseStatement = NULL;
+                        clean_stat(stat, stat->localSymbolTable);
+                        return;
+                    } else if (stat->data.ifData->elseStatement == NULL) {
                         // If without else, completely remove the statement
                         rebind_adjacent_statements(stat, fun);
                         stat->followingStatement = NULL;
                         CFStatement *tmp = stat;
                         stat = stat->parentStatement;
                         clean_stat(tmp, tmp->localSymbolTable);
+                    } else if (stat->data.ifData->elseStatement->statementType == CF_IF) {
+                        // Has else-if, it takes the place of the statement
+                        replace_with_else_if(stat);
+                        remove_function_dead_code(stat, fun);
+                        return;
                     } else {
                         // Has else, convert else into if true
                         table = stat->data.ifData->thenStatement->localSymbolTable;
@@ -751,21 +938,378 @@ void remove_function_dead_code(CFStatement *stat, CFFunction *fun) {
     }
 }
 
-void remove_dead_code() {
-    CFProgram *prog = get_program();
-    CFFuncListNode *n = prog->functionList;
-    while (n != NULL) {
-        remove_function_dead_code(n->fun.rootStatement, &n->fun);
-        n = n->next;
+// Removes the assignments of values that are never read.
+void remove_dead_stores(CFFunction *fun, OptimiserContext *ctx) {
+    if (!start_pass(ctx, OPTIMISER_PASS_DSE, fun)) {
+        return;
+    }
+    unsigned removed = 0;
+    if (!dse_run(fun, &removed)) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+    }
+    ctx->removedStores += removed;
+    finish_pass(ctx, OPTIMISER_PASS_DSE, removed);
+}
+
+// Replaces the reads of copied variables with the variables they were copied from.
+void propagate_copies(CFFunction *fun, OptimiserContext *ctx) {
+    if (!start_pass(ctx, OPTIMISER_PASS_COPYPROP, fun)) {
+        return;
+    }
+    unsigned propagated = 0;
+    if (!copyprop_run(fun, &propagated)) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+    }
+    ctx->propagatedCopies += propagated;
+    finish_pass(ctx, OPTIMISER_PASS_COPYPROP, propagated);
+}
+
+// Merges the variables whose values are never needed at the same time.
+void coalesce_variables(CFFunction *fun, OptimiserContext *ctx) {
+    if (!start_pass(ctx, OPTIMISER_PASS_COALESCE, fun)) {
+        return;
+    }
+    unsigned coalesced = 0;
+    if (!copyprop_coalesce(fun, &coalesced)) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+    }
+    ctx->coalescedVariables += coalesced;
+    finish_pass(ctx, OPTIMISER_PASS_COALESCE, coalesced);
+}
+
+// Folds the expressions of the function, propagates the constants and removes the dead branches.
+void fold_function(CFFunction *fun, OptimiserContext *ctx) {
+    if (!start_pass(ctx, OPTIMISER_PASS_FOLD, fun)) {
+        return;
     }
+    // All the statements are folded and their chains of operations reassociated first, then the constants found
+    // by SCCP are propagated and only the statements that changed are folded again. SCCP doesn't evaluate calls,
+    // so a call of a built-in function folded only after its arguments were propagated defines a new constant
+    // for another round.
+    bool changed = false;
+    optimise_expressions(fun->rootStatement, &changed, ctx, fold_instruction);
+    if (start_pass(ctx, OPTIMISER_PASS_REASSOC, fun)) {
+        optimise_expressions(fun->rootStatement, &changed, ctx, reassociate_instruction);
+        finish_pass(ctx, OPTIMISER_PASS_REASSOC, 0);
+    }
+
+    bool refolded = true;
+    for (unsigned round = 0; refolded; round++) {
+        if (round == OPTIMISER_MAX_ROUNDS) {
+            ctx->roundCapHits++;
+            break;
+        }
+        ctx->propagationRounds++;
+        ctx->worklist.count = 0;
+        if (start_pass(ctx, OPTIMISER_PASS_SCCP, fun)) {
+            unsigned long propagated = ctx->propagatedConstants;
+            propagate_function_constants(fun, ctx);
+            finish_pass(ctx, OPTIMISER_PASS_SCCP, ctx->propagatedConstants - propagated);
+        }
+        refolded = false;
+        for (unsigned i = 0; i < ctx->worklist.count && thread_pool_result() == COMPILER_RESULT_SUCCESS; i++) {
+            optimise_statement_expressions(ctx->worklist.statements[i], &refolded, ctx, fold_instruction);
+        }
+    }
+    remove_function_dead_code(fun->rootStatement, fun);
+    finish_pass(ctx, OPTIMISER_PASS_FOLD, 0);
+}
+
+// Proves the divisors not to be zero and folds the comparisons decided by the ranges of their operands.
+// The function is folded again if a comparison was folded, so that the dead branches are removed.
+void analyse_ranges(CFFunction *fun, OptimiserContext *ctx) {
+    if (!start_pass(ctx, OPTIMISER_PASS_RANGES, fun)) {
+        return;
+    }
+    unsigned divisions = 0;
+    unsigned comparisons = 0;
+    BBGraph *graph = bb_build(fun);
+    SSAForm *ssa = graph != NULL ? ssa_build(graph) : NULL;
+    if (ssa != NULL) {
+        if (!range_run(ssa, &divisions, &comparisons)) {
+            stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        }
+        ssa_free(ssa);
+    }
+    if (graph != NULL) {
+        bb_free(graph);
+    }
+    finish_pass(ctx, OPTIMISER_PASS_RANGES, divisions + comparisons);
+
+    ctx->removedDivisionChecks += divisions;
+    ctx->foldedComparisons += comparisons;
+    if (comparisons > 0 && thread_pool_result() == COMPILER_RESULT_SUCCESS) {
+        fold_function(fun, ctx);
+    }
+}
+
+void optimise_function(CFFunction *fun, OptimiserStats *stats) {
+    OptimiserContext ctx = {.worklist = {NULL, 0, 0}, .statementVisits = 0, .propagationRounds = 0, .roundCapHits = 0,
+                            .propagatedConstants = 0, .unswitchedLoops = 0, .unrolledLoops = 0, .reducedInductions = 0,
+                            .hoistedComputations = 0, .eliminatedExpressions = 0, .removedDivisionChecks = 0,
+                            .foldedComparisons = 0, .removedStores = 0, .propagatedCopies = 0, .coalescedVariables = 0,
+                            .passes = {{0}}};
+
+    fold_function(fun, &ctx);
+
+    // The loops are unswitched on the conditions they don't change, the constant branches in the versions
+    // of the loops are then removed
+    if (start_pass(&ctx, OPTIMISER_PASS_UNSWITCH, fun)) {
+        unsigned unswitched = 0;
+        if (!unswitch_run(fun, optimiserUnswitchBudget, &unswitched)) {
+            stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        }
+        finish_pass(&ctx, OPTIMISER_PASS_UNSWITCH, unswitched);
+        if (unswitched > 0) {
+            ctx.unswitchedLoops += unswitched;
+            fold_function(fun, &ctx);
+        }
+    }
+
+    // The loops are unrolled once their headers are folded, the constants are then propagated into the copies
+    if (start_pass(&ctx, OPTIMISER_PASS_UNROLL, fun)) {
+        unsigned unrolled = 0;
+        if (!unroll_run(fun, optimiserUnrollBudget, &unrolled)) {
+            stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        }
+        finish_pass(&ctx, OPTIMISER_PASS_UNROLL, unrolled);
+        if (unrolled > 0) {
+            ctx.unrolledLoops += unrolled;
+            fold_function(fun, &ctx);
+        }
+    }
+
+    // The remaining computations are only moved after the dead branches are gone,
+    // so that no temporaries are defined in them
+    if (start_pass(&ctx, OPTIMISER_PASS_INDUCTION, fun)) {
+        unsigned reduced = run_ssa_pass(fun, induction_run);
+        ctx.reducedInductions += reduced;
+        finish_pass(&ctx, OPTIMISER_PASS_INDUCTION, reduced);
+    }
+    if (start_pass(&ctx, OPTIMISER_PASS_LICM, fun)) {
+        unsigned hoisted = run_ssa_pass(fun, licm_run);
+        ctx.hoistedComputations += hoisted;
+        finish_pass(&ctx, OPTIMISER_PASS_LICM, hoisted);
+    }
+    if (start_pass(&ctx, OPTIMISER_PASS_GVN, fun)) {
+        unsigned eliminated = run_ssa_pass(fun, gvn_run);
+        ctx.eliminatedExpressions += eliminated;
+        finish_pass(&ctx, OPTIMISER_PASS_GVN, eliminated);
+    }
+    analyse_ranges(fun, &ctx);
+
+    // The copies (also the ones left by GVN) are propagated so that they become dead stores
+    propagate_copies(fun, &ctx);
+
+    // The stores are removed last, when no other pass can use the values anymore
+    remove_dead_stores(fun, &ctx);
+    coalesce_variables(fun, &ctx);
+
+    free(ctx.worklist.statements);
+
+    stats->functions++;
+    stats->statementVisits += ctx.statementVisits;
+    stats->propagationRounds += ctx.propagationRounds;
+    stats->roundCapHits += ctx.roundCapHits;
+    stats->propagatedConstants += ctx.propagatedConstants;
+    stats->unswitchedLoops += ctx.unswitchedLoops;
+    stats->unrolledLoops += ctx.unrolledLoops;
+    stats->reducedInductions += ctx.reducedInductions;
+    stats->hoistedComputations += ctx.hoistedComputations;
+    stats->eliminatedExpressions += ctx.eliminatedExpressions;
+    stats->removedDivisionChecks += ctx.removedDivisionChecks;
+    stats->foldedComparisons += ctx.foldedComparisons;
+    stats->removedStores += ctx.removedStores;
+    stats->propagatedCopies += ctx.propagatedCopies;
+    stats->coalescedVariables += ctx.coalescedVariables;
+    add_pass_stats(stats->passes, ctx.passes);
+}
+
+void optimise_function_task(unsigned index, void *data) {
+    ParallelOptimisation *parallel = data;
+    optimise_function(parallel->program->functions[index], &parallel->functionStats[index]);
+}
+
+// Runs the whole optimisation pipeline of each function as a separate task on the thread pool.
+// Returns false if the tasks couldn't be run.
+bool optimise_parallel(CFProgram *prog) {
+    ParallelOptimisation parallel = {.program = prog};
+    parallel.functionStats = calloc(prog->functionsCount, sizeof(OptimiserStats));
+    if (parallel.functionStats == NULL) {
+        return false;
+    }
+
+    if (!thread_pool_run(optimiserJobs, prog->functionsCount, optimise_function_task, &parallel)) {
+        free(parallel.functionStats);
+        return false;
+    }
+
+    for (unsigned i = 0; i < prog->functionsCount; i++) {
+        optimiserStats.functions += parallel.functionStats[i].functions;
+        optimiserStats.statementVisits += parallel.functionStats[i].statementVisits;
+        optimiserStats.propagationRounds += parallel.functionStats[i].propagationRounds;
+        optimiserStats.roundCapHits += parallel.functionStats[i].roundCapHits;
+        optimiserStats.propagatedConstants += parallel.functionStats[i].propagatedConstants;
+        optimiserStats.unswitchedLoops += parallel.functionStats[i].unswitchedLoops;
+        optimiserStats.unrolledLoops += parallel.functionStats[i].unrolledLoops;
+        optimiserStats.reducedInductions += parallel.functionStats[i].reducedInductions;
+        optimiserStats.hoistedComputations += parallel.functionStats[i].hoistedComputations;
+        optimiserStats.eliminatedExpressions += parallel.functionStats[i].eliminatedExpressions;
+        optimiserStats.removedDivisionChecks += parallel.functionStats[i].removedDivisionChecks;
+        optimiserStats.foldedComparisons += parallel.functionStats[i].foldedComparisons;
+        optimiserStats.removedStores += parallel.functionStats[i].removedStores;
+        optimiserStats.propagatedCopies += parallel.functionStats[i].propagatedCopies;
+        optimiserStats.coalescedVariables += parallel.functionStats[i].coalescedVariables;
+        add_pass_stats(optimiserStats.passes, parallel.functionStats[i].passes);
+    }
+
+    free(parallel.functionStats);
+    return true;
+}
+
+// Evaluates the calls of pure functions once the arguments are folded and refolds the functions
+// whose calls were replaced with constants (propagating the copies and removing the stores that became dead).
+void evaluate_calls(CFProgram *prog) {
+    OptimiserContext ctx = {.worklist = {NULL, 0, 0}};
+    if (!start_pass(&ctx, OPTIMISER_PASS_CTFE, NULL)) {
+        return;
+    }
+    bool *changed = calloc(prog->functionsCount + 1, sizeof(bool));
+    unsigned evaluated = 0;
+    if (changed == NULL || !ctfe_run(prog, optimiserEvaluationBudget, changed, &evaluated)) {
+        stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+    }
+    optimiserStats.evaluatedCalls = evaluated;
+    finish_pass(&ctx, OPTIMISER_PASS_CTFE, evaluated);
+
+    for (unsigned i = 0; i < prog->functionsCount && compiler_result == COMPILER_RESULT_SUCCESS; i++) {
+        if (changed[i]) {
+            fold_function(prog->functions[i], &ctx);
+        }
+        if (changed[i] && compiler_result == COMPILER_RESULT_SUCCESS) {
+            propagate_copies(prog->functions[i], &ctx);
+        }
+        if (changed[i] && compiler_result == COMPILER_RESULT_SUCCESS) {
+            remove_dead_stores(prog->functions[i], &ctx);
+        }
+        if (changed[i] && compiler_result == COMPILER_RESULT_SUCCESS) {
+            coalesce_variables(prog->functions[i], &ctx);
+        }
+    }
+    free(ctx.worklist.statements);
+    optimiserStats.statementVisits += ctx.statementVisits;
+    optimiserStats.propagationRounds += ctx.propagationRounds;
+    optimiserStats.roundCapHits += ctx.roundCapHits;
+    optimiserStats.propagatedConstants += ctx.propagatedConstants;
+    optimiserStats.removedStores += ctx.removedStores;
+    optimiserStats.propagatedCopies += ctx.propagatedCopies;
+    optimiserStats.coalescedVariables += ctx.coalescedVariables;
+    add_pass_stats(optimiserStats.passes, ctx.passes);
+    free(changed);
 }
 
 void optimiser_optimise() {
-    bool changed = true;
-    while (compiler_result == COMPILER_RESULT_SUCCESS && changed) {
-        changed = false;
-        fold_constants(&changed);
-        propagate_constants(&changed);
+    CFProgram *prog = get_program();
+    optimiserStats = (OptimiserStats) {0};
+
+    // The calls are inlined first, so that the copied bodies are optimised together with the rest of their callers
+    OptimiserContext ctx = {.worklist = {NULL, 0, 0}};
+    if (start_pass(&ctx, OPTIMISER_PASS_INLINE, NULL)) {
+        unsigned inlined = 0;
+        if (!inline_run(prog, OPTIMISER_INLINE_THRESHOLD, &inlined)) {
+            stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        }
+        optimiserStats.inlinedCalls = inlined;
+        finish_pass(&ctx, OPTIMISER_PASS_INLINE, inlined);
+    }
+
+    // The constant arguments are propagated before the functions are optimised, which folds the constants further.
+    // The functions aren't specialised when optimising for size, as the copies only make the calls faster.
+    if (start_pass(&ctx, OPTIMISER_PASS_IPCP, NULL)) {
+        unsigned propagated = 0;
+        unsigned cloned = 0;
+        unsigned budget = optimiserLevel == OPTIMISER_LEVEL_SIZE ? 0 : optimiserCloneBudget;
+        if (!ipcp_run(prog, budget, &propagated, &cloned)) {
+            stderr_message("optimiser", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        }
+        optimiserStats.propagatedArguments = propagated;
+        optimiserStats.specialisedFunctions = cloned;
+        finish_pass(&ctx, OPTIMISER_PASS_IPCP, propagated + cloned);
+    }
+    add_pass_stats(optimiserStats.passes, ctx.passes);
+    if (compiler_result != COMPILER_RESULT_SUCCESS) {
+        return;
+    }
+
+    if (optimiserJobs <= 1 || prog->functionsCount <= 1 || !optimise_parallel(prog)) {
+        for (unsigned i = 0; i < prog->functionsCount && compiler_result == COMPILER_RESULT_SUCCESS; i++) {
+            optimise_function(prog->functions[i], &optimiserStats);
+        }
+    }
+    if (compiler_result != COMPILER_RESULT_SUCCESS) {
+        return;
     }
-    remove_dead_code();
+
+    evaluate_calls(prog);
+}
+
+void optimiser_set_jobs(unsigned jobs) {
+    optimiserJobs = jobs == 0 ? 1 : jobs;
+}
+
+void optimiser_set_unswitch_budget(unsigned budget) {
+    optimiserUnswitchBudget = budget;
+}
+
+void optimiser_set_unroll_budget(unsigned budget) {
+    optimiserUnrollBudget = budget;
+}
+
+void optimiser_set_clone_budget(unsigned budget) {
+    optimiserCloneBudget = budget;
+}
+
+void optimiser_set_evaluation_budget(unsigned long budget) {
+    optimiserEvaluationBudget = budget;
+}
+
+void optimiser_set_level(OptimiserLevel level) {
+    optimiserLevel = level;
+    for (unsigned i = 0; i < OPTIMISER_PASS_COUNT; i++) {
+        switch (level) {
+            case OPTIMISER_LEVEL_NONE:
+                // The constant expressions are still folded, so that their division by zero is reported
+                optimiserPasses[i] = i == OPTIMISER_PASS_FOLD;
+                break;
+            case OPTIMISER_LEVEL_BASIC:
+                optimiserPasses[i] = i != OPTIMISER_PASS_INLINE && i != OPTIMISER_PASS_IPCP &&
+                                     i != OPTIMISER_PASS_UNSWITCH && i != OPTIMISER_PASS_UNROLL &&
+                                     i != OPTIMISER_PASS_CTFE;
+                break;
+            case OPTIMISER_LEVEL_FULL:
+                optimiserPasses[i] = true;
+                break;
+            case OPTIMISER_LEVEL_SIZE:
+                optimiserPasses[i] = i != OPTIMISER_PASS_UNSWITCH && i != OPTIMISER_PASS_UNROLL;
+                break;
+        }
+    }
+}
+
+bool optimiser_set_pass_enabled(const char *name, bool enabled) {
+    for (unsigned i = 0; i < OPTIMISER_PASS_COUNT; i++) {
+        if (strcmp(name, optimiserPassNames[i]) == 0) {
+            optimiserPasses[i] = enabled;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *optimiser_pass_name(OptimiserPass pass) {
+    return optimiserPassNames[pass];
+}
+
+const OptimiserStats *optimiser_get_stats() {
+    return &optimiserStats;
 }
@@ -10,6 +10,139 @@
 #ifndef _COMPILER_OPTIMISER_H
 #define _COMPILER_OPTIMISER_H 1
 
+#include <stdbool.h>
+
+// Default maximum number of AST nodes (and statements) of the copies of loops created by unswitching them
+// in a function.
+#define OPTIMISER_DEFAULT_UNSWITCH_BUDGET 256
+
+// Default maximum number of AST nodes of the copies of a loop body created by unrolling the loop.
+#define OPTIMISER_DEFAULT_UNROLL_BUDGET 128
+
+// Maximum number of AST nodes (and statements) of a function inlined at all its call sites.
+#define OPTIMISER_INLINE_THRESHOLD 40
+
+// Default maximum number of AST nodes (and statements) of all the specialised copies of functions.
+#define OPTIMISER_DEFAULT_CLONE_BUDGET 256
+
+// Default maximum number of steps of the compile-time evaluation of calls in the whole program.
+#define OPTIMISER_DEFAULT_EVALUATION_BUDGET 1000000
+
+// Maximum number of rounds of the constant propagation in a single folding of a function. Each round propagates
+// the constants found by SCCP and folds the statements that changed.
+#define OPTIMISER_MAX_ROUNDS 8
+
+// Passes of the optimiser, in the order they run. Each of them can be enabled or disabled separately.
+typedef enum optimiser_pass {
+    OPTIMISER_PASS_INLINE,    // "inline": inlining of the calls of small functions and of functions called once.
+    OPTIMISER_PASS_IPCP,      // "ipcp": propagation of constant arguments and specialisation of functions.
+    OPTIMISER_PASS_FOLD,      // "fold": folding of expressions and removal of dead branches.
+    OPTIMISER_PASS_REASSOC,   // "reassoc": reassociation of chains of operations, a part of the folding.
+    OPTIMISER_PASS_SCCP,      // "sccp": sparse conditional constant propagation, a part of the folding.
+    OPTIMISER_PASS_UNSWITCH,  // "unswitch": moving of invariant conditions out of loops.
+    OPTIMISER_PASS_UNROLL,    // "unroll": unrolling of loops with constant trip counts.
+    OPTIMISER_PASS_INDUCTION, // "induction": strength reduction of induction variables.
+    OPTIMISER_PASS_LICM,      // "licm": moving of loop-invariant computations before their loops.
+    OPTIMISER_PASS_GVN,       // "gvn": elimination of common subexpressions by global value numbering.
+    OPTIMISER_PASS_RANGES,    // "ranges": value range analysis removing division checks and folding comparisons.
+    OPTIMISER_PASS_COPYPROP,  // "copyprop": propagation of copies of variables.
+    OPTIMISER_PASS_DSE,       // "dse": removal of dead stores.
+    OPTIMISER_PASS_COALESCE,  // "coalesce": merging of variables that are never needed at the same time.
+    OPTIMISER_PASS_CTFE,      // "ctfe": compile-time evaluation of calls of pure functions.
+    OPTIMISER_PASS_COUNT
+} OptimiserPass;
+
+// Optimisation levels, each of them enables a set of passes.
+typedef enum optimiser_level {
+    OPTIMISER_LEVEL_NONE,  // -O0: only the constant expressions are folded.
+    OPTIMISER_LEVEL_BASIC, // -O1: the passes that work within a function without duplicating code.
+    OPTIMISER_LEVEL_FULL,  // -O2: all the passes (the default).
+    OPTIMISER_LEVEL_SIZE   // -Os: all the passes except the ones that duplicate code to make it faster.
+} OptimiserLevel;
+
+// Statistics of a single pass of the optimiser. The pass runs on a function (or on the whole program for inline,
+// ipcp and ctfe), some passes run more times on a function, e.g. the folding runs again after the passes that
+// expose new constants.
+typedef struct optimiser_pass_stats {
+    unsigned long runs;           // Number of times the pass ran.
+    unsigned long visitedNodes;   // Number of AST nodes (and statements) of the code the pass ran on.
+    unsigned long rewrittenNodes; // Number of changes made by the pass (rewritten instructions, moved computations...).
+    double seconds;               // Time spent in the pass (fold includes the time of reassoc and sccp).
+} OptimiserPassStats;
+
+// Statistics of the last optimiser run.
+typedef struct optimiser_stats {
+    unsigned functions;                  // Number of optimised functions.
+    unsigned long inlinedCalls;          // Number of calls replaced with copies of the called functions.
+    unsigned long propagatedArguments;   // Number of parameters assigned the constant passed by all the calls.
+    unsigned long specialisedFunctions;  // Number of copies of functions specialised for constant arguments.
+    unsigned long statementVisits;       // Number of statements visited by constant folding.
+    unsigned long propagationRounds;     // Number of rounds of the constant propagation in all the foldings.
+    unsigned long roundCapHits;          // Number of foldings stopped by OPTIMISER_MAX_ROUNDS before a fixed point.
+    unsigned long propagatedConstants;   // Number of variable reads replaced with constants.
+    unsigned long unswitchedLoops;       // Number of FOR loops duplicated for both values of an invariant condition.
+    unsigned long unrolledLoops;         // Number of FOR loops unrolled fully or partially.
+    unsigned long reducedInductions;     // Number of multiplications of induction variables replaced with additions.
+    unsigned long hoistedComputations;   // Number of loop-invariant computations moved before their loops.
+    unsigned long eliminatedExpressions; // Number of computations replaced with reads of temporaries.
+    unsigned long removedDivisionChecks; // Number of divisions whose divisor was proven not to be zero.
+    unsigned long foldedComparisons;     // Number of comparisons decided by the ranges of their operands.
+    unsigned long evaluatedCalls;        // Number of calls of pure functions replaced with their results.
+    unsigned long removedStores;         // Number of assignments of values that are never read removed.
+    unsigned long propagatedCopies;      // Number of variable reads replaced with the variables copied into them.
+    unsigned long coalescedVariables;    // Number of variables merged into other variables.
+    OptimiserPassStats passes[OPTIMISER_PASS_COUNT]; // Statistics of the passes.
+} OptimiserStats;
+
+// Optimises the program. The calls of small functions and of functions called only once are inlined first, then the
+// constant arguments of the remaining calls are propagated into the called functions or their specialised copies. Then
+// each function is optimised separately: its expressions (including the calls of the pure built-in functions with
+// constant arguments) are folded, constants are propagated by the sparse conditional constant propagation, the branches
+// it proved dead are removed, the IFs whose conditions don't change in a loop are moved out of it by duplicating the
+// loop (the constant branches of the copies are folded), the loops with constant trip counts are unrolled (and the
+// copies folded the same way), multiplications of induction variables are replaced with additions, loop-invariant
+// computations are moved before their loops, the common subexpressions are computed only once using global value
+// numbering, the ranges of the values are used to remove the checks of divisors that can't be zero and to fold the
+// comparisons they decide, the copies of variables are propagated, the assignments of values that are never read are
+// removed and the variables that are never needed at the same time are merged. Finally, the calls of pure functions
+// with constant arguments are evaluated and the functions where they were replaced are folded again and go through the
+// last three steps again. Only the enabled passes are run.
 void optimiser_optimise();
 
+// Enables the passes of the optimisation level (OPTIMISER_LEVEL_FULL by default) and disables the rest. With
+// OPTIMISER_LEVEL_SIZE, the loops are neither unswitched nor unrolled and the functions aren't specialised.
+void optimiser_set_level(OptimiserLevel level);
+
+// Enables or disables the pass with the name. Returns false if there's no such pass.
+bool optimiser_set_pass_enabled(const char *name, bool enabled);
+
+// Returns the name of the pass.
+const char *optimiser_pass_name(OptimiserPass pass);
+
+// Sets the number of threads used to optimise the functions (1 by default, which optimises them serially).
+// The generated code doesn't depend on this setting.
+void optimiser_set_jobs(unsigned jobs);
+
+// Sets the maximum number of AST nodes (and statements) of the copies of loops created by unswitching them
+// in a function. Loops whose copies wouldn't fit are not unswitched, 0 disables the unswitching.
+void optimiser_set_unswitch_budget(unsigned budget);
+
+// Sets the maximum number of AST nodes of the copies of a loop body created by unrolling the loop.
+// Loops whose copies wouldn't fit are not unrolled, 0 disables the unrolling.
+void optimiser_set_unroll_budget(unsigned budget);
+
+// Sets the maximum number of AST nodes (and statements) of all the copies of functions specialised for constant
+// arguments, 0 disables the specialisation (the constants passed by all the calls are still propagated).
+void optimiser_set_clone_budget(unsigned budget);
+
+// Sets the maximum number of steps of the compile-time evaluation of calls in the whole program,
+// 0 disables the evaluation.
+void optimiser_set_evaluation_budget(unsigned long budget);
+
+// Returns the current time in seconds, used to measure the passes and the phases of the compilation.
+double optimiser_current_time();
+
+// Returns the statistics of the last optimiser_optimise() call.
+const OptimiserStats *optimiser_get_stats();
+
 #endif // _COMPILER_OPTIMISER_H
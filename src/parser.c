@@ -200,7 +200,7 @@ int type(STDataType *data_type) {
     syntax_ok();
 }
 
-int params_n(STItem *current_function, bool ret_type, bool already_found, STParam *current_param) {
+int params_n(STItem *current_function, bool ret_type, bool already_found, unsigned param_index) {
     MutableString id;
     switch (token.type) {
         case TOKEN_RIGHT_BRACKET:
@@ -222,7 +222,6 @@ int params_n(STItem *current_function, bool ret_type, bool already_found, STPara
             check_new_token(EOL_FORBIDDEN);
             STDataType data_type;
             check_nonterminal(type(&data_type));
-            STParam *next_param = NULL;
             if (semantic_enabled) {
                 if (ret_type) {
                     check_cf(cf_add_return_value(mstr_content(&id), data_type));
@@ -232,12 +231,13 @@ int params_n(STItem *current_function, bool ret_type, bool already_found, STPara
                 } else {
                     check_cf(cf_add_argument(mstr_content(&id), data_type));
                     if (already_found) {
-                        if (current_param == NULL) {
+                        if (param_index >= current_function->data.data.func_data.params_count) {
                             stderr_message("parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                            "Line %u, col %u: unexpected parameter to function\n",
                                            prev_token.context.line_num, prev_token.context.char_num);
                             return COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE;
                         }
+                        STParam *current_param = &current_function->data.data.func_data.params[param_index];
                         if (current_param->type != CF_UNKNOWN && current_param->type != data_type) {
                             stderr_message("parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                            "Line %u, col %u: wrong param type to function\n",
@@ -252,7 +252,6 @@ int params_n(STItem *current_function, bool ret_type, bool already_found, STPara
                         strcpy(new_buffer, mstr_content(&id));
                         current_param->id = new_buffer;
                         current_param->type = data_type;
-                        next_param = current_param->next;
 
                     } else {
                         if (!symtable_add_param(current_function, mstr_content(&id), data_type)) {
@@ -276,7 +275,7 @@ int params_n(STItem *current_function, bool ret_type, bool already_found, STPara
                 }
             }
             mstr_free(&id);
-            return params_n(current_function, ret_type, already_found, next_param);
+            return params_n(current_function, ret_type, already_found, param_index + 1);
         default:
             token_error("expected ) or , when parsing parameters, got %s\n");
             syntax_error();
@@ -299,7 +298,6 @@ int params(STItem *current_function, bool ret_type, bool already_found) {
             check_new_token(EOL_FORBIDDEN);
             STDataType data_type;
             check_nonterminal(type(&data_type));
-            STParam *next_param = NULL;
             if (semantic_enabled) {
                 if (ret_type) {
                     check_cf(cf_add_return_value(mstr_content(&id), data_type));
@@ -310,13 +308,13 @@ int params(STItem *current_function, bool ret_type, bool already_found) {
                     check_cf(cf_add_argument(mstr_content(&id), data_type));
                     if (already_found) {
                         // Check the type of the first param if we predicted arguments in an expression
-                        STParam *first_param = current_function->data.data.func_data.params;
-                        if (first_param == NULL) {
+                        if (current_function->data.data.func_data.params_count == 0) {
                             stderr_message("parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                            "Line %u, col %u: unexpected parameter to function\n",
                                            prev_token.context.line_num, prev_token.context.char_num);
                             return COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE;
                         }
+                        STParam *first_param = &current_function->data.data.func_data.params[0];
                         if (first_param->type != CF_UNKNOWN && first_param->type != data_type) {
                             stderr_message("parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                            "Line %u, col %u: wrong param type to function\n",
@@ -331,7 +329,6 @@ int params(STItem *current_function, bool ret_type, bool already_found) {
                         strcpy(new_buffer, mstr_content(&id));
                         first_param->id = new_buffer;
                         first_param->type = data_type;
-                        next_param = first_param->next;
                     } else {
                         if (!symtable_add_param(current_function, mstr_content(&id), data_type)) {
                             return COMPILER_RESULT_ERROR_INTERNAL;
@@ -354,7 +351,7 @@ int params(STItem *current_function, bool ret_type, bool already_found) {
                 }
             }
             mstr_free(&id);
-            return params_n(current_function, ret_type, already_found, next_param);
+            return params_n(current_function, ret_type, already_found, 1);
         default:
             token_error("expected ) or identifier when parsing parameters, got %s\n");
             syntax_error();
@@ -556,6 +553,14 @@ int return_follow() {
         default:
             if (token.context.eol_read) {
                 // rule <return_follow> -> eps
+                if (semantic_enabled) {
+                    ASTNode *emptyList = ast_node_list(0);
+                    if (emptyList == NULL) {
+                        return COMPILER_RESULT_ERROR_INTERNAL;
+                    }
+
+                    check_cf(cf_use_ast_explicit(emptyList, CF_RETURN_LIST));
+                }
                 syntax_ok();
             }
             // rule <return_follow> -> expression
@@ -1051,7 +1056,7 @@ int program() {
             stderr_message("parser", ERROR, COMPILER_RESULT_ERROR_UNDEFINED_OR_REDEFINED_FUNCTION_OR_VARIABLE,
                            "missing function main\n");
             semantic_error_redefine();
-        } else if (main->data.data.func_data.ret_types != NULL || main->data.data.func_data.params != NULL) {
+        } else if (main->data.data.func_data.ret_types_count != 0 || main->data.data.func_data.params_count != 0) {
             stderr_message("parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                            "incorrect prototype of function main\n");
             return COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE;
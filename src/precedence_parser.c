@@ -750,22 +750,24 @@ bool reduce_function(PrecedenceStack *stack, PrecedenceNode *start) {
     } else {
         bool is_not_print = strcmp(func_name, "print") != 0;
         current = start;
-        STParam *param = function->data.data.func_data.params;
+        STFunctionData *func_data = &function->data.data.func_data;
+        unsigned param_index = 0;
         while (current->data.type != TOKEN_RIGHT_BRACKET) {
             if (current->data.type == SYMB_NONTERMINAL) {
-                if (is_not_print && param == NULL) {
+                if (is_not_print && param_index >= func_data->params_count) {
                     stderr_message("precedence_parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                    "Line %u: too many params to function call %s\n", token.context.line_num, func_name);
                     return false;
                 }
-                if (is_not_print && param->type != CF_UNKNOWN && current->data.data_type != CF_UNKNOWN &&
-                    current->data.data_type != param->type) {
+                if (is_not_print && func_data->params[param_index].type != CF_UNKNOWN &&
+                    current->data.data_type != CF_UNKNOWN &&
+                    current->data.data_type != func_data->params[param_index].type) {
                     stderr_message("precedence_parser", ERROR, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE,
                                    "Line %u: wrong param type for function %s\n", token.context.line_num, func_name);
                     return false;
                 }
                 if (is_not_print) {
-                    param = param->next;
+                    param_index++;
                 }
                 ast_push_to_list(params, current->data.ast);
             }
@@ -0,0 +1,733 @@
+/** @file range.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the value range analysis over the SSA form.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "range.h"
+#include "transform.h"
+
+// Number of times the range of a value may grow before its growing bounds are widened to the full range.
+#define RANGE_WIDENING_THRESHOLD 3
+
+typedef enum range_kind {
+    RANGE_UNDEFINED, // No definition of the value has been evaluated (yet).
+    RANGE_INT,
+    RANGE_FLOAT,
+    RANGE_OTHER      // A bool or a string, which isn't tracked.
+} RangeKind;
+
+// An interval of the possible values.
+typedef struct range {
+    RangeKind kind;
+    int64_t min;  // Bounds of an integer.
+    int64_t max;
+    double fmin;  // Bounds of a float.
+    double fmax;
+    bool nonZero; // Whether the value is never zero, even if the bounds include it.
+} Range;
+
+typedef struct range_context {
+    SSAForm *ssa;
+    Range *ranges;     // Ranges of the SSA values, indexed by their ids.
+    unsigned *updates; // Number of times the range of each value grew.
+    unsigned divisions;
+    unsigned comparisons;
+    bool failed;
+} RangeContext;
+
+typedef bool (*RangeIntOperation)(int64_t a, int64_t b, int64_t *result);
+
+typedef double (*RangeFloatOperation)(double a, double b);
+
+static Range range_int(int64_t min, int64_t max) {
+    return (Range) {.kind = RANGE_INT, .min = min, .max = max, .nonZero = min > 0 || max < 0};
+}
+
+static Range range_float(double min, double max) {
+    // NaN bounds can't be ordered, the whole range is used instead
+    if (isnan(min) || isnan(max)) {
+        min = -INFINITY;
+        max = INFINITY;
+    }
+    return (Range) {.kind = RANGE_FLOAT, .fmin = min, .fmax = max, .nonZero = min > 0 || max < 0};
+}
+
+// Returns the range of all the values of the type.
+static Range range_full(STDataType type) {
+    switch (type) {
+        case CF_INT:
+            return range_int(INT64_MIN, INT64_MAX);
+        case CF_FLOAT:
+            return range_float(-INFINITY, INFINITY);
+        default:
+            return (Range) {.kind = RANGE_OTHER};
+    }
+}
+
+// The bounds are never NaN, so comparing them is enough.
+static double range_min_float(double a, double b) {
+    return a < b ? a : b;
+}
+
+static double range_max_float(double a, double b) {
+    return a > b ? a : b;
+}
+
+static RangeKind range_kind_of(STDataType type) {
+    return type == CF_INT ? RANGE_INT : (type == CF_FLOAT ? RANGE_FLOAT : RANGE_OTHER);
+}
+
+// Checks whether the value may be zero (or whether it's unknown).
+static bool range_may_be_zero(const Range *range) {
+    switch (range->kind) {
+        case RANGE_INT:
+            return !range->nonZero && range->min <= 0 && range->max >= 0;
+        case RANGE_FLOAT:
+            return !range->nonZero && range->fmin <= 0 && range->fmax >= 0;
+        default:
+            return true;
+    }
+}
+
+// Moves the integer bounds off zero if the value is known not to be zero. Returns false if the range is empty.
+static bool range_normalise(Range *range) {
+    if (range->kind == RANGE_INT) {
+        if (range->nonZero && range->min == 0) {
+            range->min = 1;
+        }
+        if (range->nonZero && range->max == 0) {
+            range->max = -1;
+        }
+        range->nonZero |= range->min > 0 || range->max < 0;
+        return range->min <= range->max;
+    }
+    if (range->kind == RANGE_FLOAT) {
+        range->nonZero |= range->fmin > 0 || range->fmax < 0;
+        return range->fmin <= range->fmax;
+    }
+    return true;
+}
+
+static bool range_equal(const Range *a, const Range *b) {
+    if (a->kind != b->kind || a->nonZero != b->nonZero) {
+        return false;
+    }
+    switch (a->kind) {
+        case RANGE_INT:
+            return a->min == b->min && a->max == b->max;
+        case RANGE_FLOAT:
+            return a->fmin == b->fmin && a->fmax == b->fmax;
+        default:
+            return true;
+    }
+}
+
+// Returns the smallest range containing both ranges.
+static Range range_join(const Range *a, const Range *b) {
+    if (a->kind == RANGE_UNDEFINED) {
+        return *b;
+    }
+    if (b->kind == RANGE_UNDEFINED) {
+        return *a;
+    }
+    Range joined;
+    if (a->kind == RANGE_INT && b->kind == RANGE_INT) {
+        joined = range_int(a->min < b->min ? a->min : b->min, a->max > b->max ? a->max : b->max);
+    } else if (a->kind == RANGE_FLOAT && b->kind == RANGE_FLOAT) {
+        joined = range_float(range_min_float(a->fmin, b->fmin), range_max_float(a->fmax, b->fmax));
+    } else {
+        return (Range) {.kind = RANGE_OTHER};
+    }
+    joined.nonZero |= a->nonZero && b->nonZero;
+    return joined;
+}
+
+// Widens the bounds that grew to the full range, so that loops don't grow them one by one.
+static Range range_widen(const Range *old, const Range *grown) {
+    Range widened = *grown;
+    if (widened.kind == RANGE_INT) {
+        widened.min = grown->min < old->min ? INT64_MIN : grown->min;
+        widened.max = grown->max > old->max ? INT64_MAX : grown->max;
+    } else if (widened.kind == RANGE_FLOAT) {
+        widened.fmin = grown->fmin < old->fmin ? -INFINITY : grown->fmin;
+        widened.fmax = grown->fmax > old->fmax ? INFINITY : grown->fmax;
+    }
+    return widened;
+}
+
+// ---- Arithmetic ----
+
+static bool range_add_int(int64_t a, int64_t b, int64_t *result) {
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
+        return false;
+    }
+    *result = a + b;
+    return true;
+}
+
+static bool range_subtract_int(int64_t a, int64_t b, int64_t *result) {
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
+        return false;
+    }
+    *result = a - b;
+    return true;
+}
+
+static bool range_multiply_int(int64_t a, int64_t b, int64_t *result) {
+    bool overflows;
+    if (a > 0) {
+        overflows = b > 0 ? a > INT64_MAX / b : b < INT64_MIN / a;
+    } else if (a < 0) {
+        overflows = b > 0 ? a < INT64_MIN / b : b != 0 && b < INT64_MAX / a;
+    } else {
+        overflows = false;
+    }
+    if (overflows) {
+        return false;
+    }
+    *result = a * b;
+    return true;
+}
+
+static bool range_divide_int(int64_t a, int64_t b, int64_t *result) {
+    if (b == 0 || (a == INT64_MIN && b == -1)) {
+        return false;
+    }
+    *result = a / b;
+    return true;
+}
+
+static double range_add_float(double a, double b) {
+    return a + b;
+}
+
+static double range_subtract_float(double a, double b) {
+    return a - b;
+}
+
+static double range_multiply_float(double a, double b) {
+    return a * b;
+}
+
+static double range_divide_float(double a, double b) {
+    return a / b;
+}
+
+// Applies the operation to the bounds. The operations are monotonic in each operand, so the extremes are reached
+// at the bounds. Any overflow gives the full range.
+static Range range_corners_int(int64_t leftMin, int64_t leftMax, int64_t rightMin, int64_t rightMax,
+                               RangeIntOperation operation) {
+    int64_t corners[4];
+    if (!operation(leftMin, rightMin, &corners[0]) || !operation(leftMin, rightMax, &corners[1])
+        || !operation(leftMax, rightMin, &corners[2]) || !operation(leftMax, rightMax, &corners[3])) {
+        return range_full(CF_INT);
+    }
+    Range range = range_int(corners[0], corners[0]);
+    for (unsigned i = 1; i < 4; i++) {
+        range.min = corners[i] < range.min ? corners[i] : range.min;
+        range.max = corners[i] > range.max ? corners[i] : range.max;
+    }
+    range.nonZero = range.min > 0 || range.max < 0;
+    return range;
+}
+
+// The same for floats, the rounding is monotonic too. A NaN bound gives the full range.
+static Range range_corners_float(const Range *left, const Range *right, RangeFloatOperation operation) {
+    double corners[4] = {operation(left->fmin, right->fmin), operation(left->fmin, right->fmax),
+                         operation(left->fmax, right->fmin), operation(left->fmax, right->fmax)};
+    for (unsigned i = 0; i < 4; i++) {
+        if (isnan(corners[i])) {
+            return range_full(CF_FLOAT);
+        }
+    }
+    Range range = range_float(corners[0], corners[0]);
+    for (unsigned i = 1; i < 4; i++) {
+        range.fmin = range_min_float(range.fmin, corners[i]);
+        range.fmax = range_max_float(range.fmax, corners[i]);
+    }
+    range.nonZero = range.fmin > 0 || range.fmax < 0;
+    return range;
+}
+
+static Range range_divide(const Range *left, const Range *right) {
+    if (left->kind == RANGE_FLOAT) {
+        // A divisor close to zero makes the quotient unbounded
+        return right->fmin > 0 || right->fmax < 0 ? range_corners_float(left, right, range_divide_float)
+                                                  : range_full(CF_FLOAT);
+    }
+    if (right->min > 0 || right->max < 0) {
+        return range_corners_int(left->min, left->max, right->min, right->max, range_divide_int);
+    }
+    if (!right->nonZero) {
+        return range_full(CF_INT);
+    }
+    // The divisor is negative or positive, the quotients of both parts are merged
+    Range negative = range_corners_int(left->min, left->max, right->min, -1, range_divide_int);
+    Range positive = range_corners_int(left->min, left->max, 1, right->max, range_divide_int);
+    return range_join(&negative, &positive);
+}
+
+static Range range_arithmetic(ASTNodeType operator, const Range *left, const Range *right) {
+    if (left->kind == RANGE_FLOAT) {
+        switch (operator) {
+            case AST_ADD:
+                return range_corners_float(left, right, range_add_float);
+            case AST_SUBTRACT:
+                return range_corners_float(left, right, range_subtract_float);
+            case AST_MULTIPLY:
+                return range_corners_float(left, right, range_multiply_float);
+            default:
+                return range_divide(left, right);
+        }
+    }
+
+    Range range;
+    switch (operator) {
+        case AST_ADD:
+            return range_corners_int(left->min, left->max, right->min, right->max, range_add_int);
+        case AST_SUBTRACT:
+            return range_corners_int(left->min, left->max, right->min, right->max, range_subtract_int);
+        case AST_MULTIPLY:
+            // A product of non-zero integers is only zero if it overflows
+            range = range_corners_int(left->min, left->max, right->min, right->max, range_multiply_int);
+            if (range.min != INT64_MIN || range.max != INT64_MAX) {
+                range.nonZero |= left->nonZero && right->nonZero;
+                range_normalise(&range);
+            }
+            return range;
+        default:
+            return range_divide(left, right);
+    }
+}
+
+// ---- Evaluation ----
+
+static Range range_expression(RangeContext *ctx, const ASTNode *ast, const BBBlock *block, bool refine);
+
+// Checks whether the AST reads the value.
+static bool range_reads(const RangeContext *ctx, const ASTNode *ast, const SSAValue *value) {
+    return ast->actionType == AST_ID && ssa_value_of(ctx->ssa, ast) == value;
+}
+
+// Returns the operator with swapped operands (a < b is b > a).
+static ASTNodeType range_swap(ASTNodeType operator) {
+    switch (operator) {
+        case AST_LOG_LT:
+            return AST_LOG_GT;
+        case AST_LOG_GT:
+            return AST_LOG_LT;
+        case AST_LOG_LTE:
+            return AST_LOG_GTE;
+        case AST_LOG_GTE:
+            return AST_LOG_LTE;
+        default:
+            return operator;
+    }
+}
+
+// Returns the operator of the negated comparison (!(a < b) is a >= b).
+static ASTNodeType range_negate(ASTNodeType operator) {
+    switch (operator) {
+        case AST_LOG_EQ:
+            return AST_LOG_NEQ;
+        case AST_LOG_NEQ:
+            return AST_LOG_EQ;
+        case AST_LOG_LT:
+            return AST_LOG_GTE;
+        case AST_LOG_GTE:
+            return AST_LOG_LT;
+        case AST_LOG_GT:
+            return AST_LOG_LTE;
+        default:
+            return AST_LOG_GT;
+    }
+}
+
+// Narrows the range of a value compared to another one by the operator. Keeps the range if it would be empty.
+static Range range_constrain(const Range *range, ASTNodeType operator, const Range *bound) {
+    if (range->kind != bound->kind) {
+        return *range;
+    }
+
+    Range narrowed = *range;
+    if (range->kind == RANGE_INT) {
+        switch (operator) {
+            case AST_LOG_LT:
+                narrowed.max = bound->max == INT64_MIN || bound->max - 1 > range->max ? range->max : bound->max - 1;
+                break;
+            case AST_LOG_LTE:
+                narrowed.max = bound->max > range->max ? range->max : bound->max;
+                break;
+            case AST_LOG_GT:
+                narrowed.min = bound->min == INT64_MAX || bound->min + 1 < range->min ? range->min : bound->min + 1;
+                break;
+            case AST_LOG_GTE:
+                narrowed.min = bound->min < range->min ? range->min : bound->min;
+                break;
+            case AST_LOG_EQ:
+                narrowed.min = bound->min < range->min ? range->min : bound->min;
+                narrowed.max = bound->max > range->max ? range->max : bound->max;
+                narrowed.nonZero |= bound->nonZero;
+                break;
+            default:
+                // Only a single value can be excluded from an interval
+                if (bound->min == bound->max && bound->min == 0) {
+                    narrowed.nonZero = true;
+                } else if (bound->min == bound->max && bound->min == range->min && range->min < range->max) {
+                    narrowed.min++;
+                } else if (bound->min == bound->max && bound->min == range->max && range->min < range->max) {
+                    narrowed.max--;
+                }
+                break;
+        }
+    } else if (range->kind == RANGE_FLOAT) {
+        switch (operator) {
+            case AST_LOG_LT:
+            case AST_LOG_LTE:
+                narrowed.fmax = range_min_float(range->fmax, bound->fmax);
+                narrowed.nonZero |= operator == AST_LOG_LT && bound->fmax <= 0;
+                break;
+            case AST_LOG_GT:
+            case AST_LOG_GTE:
+                narrowed.fmin = range_max_float(range->fmin, bound->fmin);
+                narrowed.nonZero |= operator == AST_LOG_GT && bound->fmin >= 0;
+                break;
+            case AST_LOG_EQ:
+                narrowed.fmin = range_max_float(range->fmin, bound->fmin);
+                narrowed.fmax = range_min_float(range->fmax, bound->fmax);
+                narrowed.nonZero |= bound->nonZero;
+                break;
+            default:
+                narrowed.nonZero |= bound->fmin == 0 && bound->fmax == 0;
+                break;
+        }
+    }
+    return range_normalise(&narrowed) ? narrowed : *range;
+}
+
+// Narrows the range of the value by the condition of the block, which is known to be true or false.
+static Range range_refine(RangeContext *ctx, const Range *range, const SSAValue *value, const BBBlock *block,
+                          const ASTNode *condition, bool holds) {
+    switch (condition->actionType) {
+        case AST_LOG_NOT:
+            return range_refine(ctx, range, value, block, condition->left, !holds);
+        case AST_LOG_AND:
+        case AST_LOG_OR: {
+            // Both operands of a true conjunction hold, neither operand of a false disjunction does
+            if (holds != (condition->actionType == AST_LOG_AND)) {
+                return *range;
+            }
+            Range left = range_refine(ctx, range, value, block, condition->left, holds);
+            return range_refine(ctx, &left, value, block, condition->right, holds);
+        }
+        case AST_LOG_EQ:
+        case AST_LOG_NEQ:
+        case AST_LOG_LT:
+        case AST_LOG_GT:
+        case AST_LOG_LTE:
+        case AST_LOG_GTE: {
+            ASTNodeType operator = condition->actionType;
+            const ASTNode *other;
+            if (range_reads(ctx, condition->left, value)) {
+                other = condition->right;
+            } else if (range_reads(ctx, condition->right, value)) {
+                other = condition->left;
+                operator = range_swap(operator);
+            } else {
+                return *range;
+            }
+            if (!holds) {
+                // A failed ordered comparison of floats may have involved NaN
+                if (range->kind == RANGE_FLOAT && operator != AST_LOG_EQ && operator != AST_LOG_NEQ) {
+                    return *range;
+                }
+                operator = range_negate(operator);
+            }
+            // The other operand isn't narrowed by further conditions, which would make the evaluation exponential
+            Range bound = range_expression(ctx, other, block, false);
+            return range_constrain(range, operator, &bound);
+        }
+        default:
+            return *range;
+    }
+}
+
+// Returns the condition ending the block, NULL if it doesn't end with one.
+static const ASTNode *range_condition(const BBBlock *block) {
+    if (block->successorsCount != 2 || block->successors[0] == block->successors[1]
+        || block->instructionsCount == 0) {
+        return NULL;
+    }
+    const BBInstruction *last = &block->instructions[block->instructionsCount - 1];
+    if (last->target != CF_IF_CONDITIONAL && last->target != CF_FOR_CONDITIONAL) {
+        return NULL;
+    }
+    return *last->ast;
+}
+
+// Returns the range of the value read in the block, narrowed by the conditions of the edges that must have been
+// taken to get there: the edges to the blocks dominating it that can't be entered in another way.
+static Range range_of_read(RangeContext *ctx, const SSAValue *value, const BBBlock *block) {
+    Range range = ctx->ranges[value->id];
+    if (range.kind != RANGE_INT && range.kind != RANGE_FLOAT) {
+        return range;
+    }
+
+    const BBBlock *child = block;
+    for (const BBBlock *dominator = block->idom; dominator != NULL; child = dominator, dominator = dominator->idom) {
+        const ASTNode *condition = range_condition(dominator);
+        if (condition != NULL && child->predecessorsCount == 1) {
+            range = range_refine(ctx, &range, value, dominator, condition, dominator->successors[0] == child);
+        }
+    }
+    return range;
+}
+
+// Evaluates the range of an expression of the block. Unless refine is set, the variables aren't narrowed
+// by the conditions.
+static Range range_expression(RangeContext *ctx, const ASTNode *ast, const BBBlock *block, bool refine) {
+    switch (ast->actionType) {
+        case AST_CONST_INT:
+            return range_int(ast->data[0].intConstantValue, ast->data[0].intConstantValue);
+        case AST_CONST_FLOAT:
+            return range_float(ast->data[0].floatConstantValue, ast->data[0].floatConstantValue);
+        case AST_ID: {
+            const SSAValue *value = ssa_value_of(ctx->ssa, ast);
+            if (value == NULL) {
+                return range_full(ast->inheritedDataType);
+            }
+            return refine ? range_of_read(ctx, value, block) : ctx->ranges[value->id];
+        }
+        case AST_ADD:
+        case AST_SUBTRACT:
+        case AST_MULTIPLY:
+        case AST_DIVIDE: {
+            Range left = range_expression(ctx, ast->left, block, refine);
+            Range right = range_expression(ctx, ast->right, block, refine);
+            if (left.kind == RANGE_UNDEFINED || right.kind == RANGE_UNDEFINED) {
+                return (Range) {.kind = RANGE_UNDEFINED};
+            }
+            if (left.kind != right.kind || left.kind == RANGE_OTHER) {
+                return range_full(ast->inheritedDataType);
+            }
+            return range_arithmetic(ast->actionType, &left, &right);
+        }
+        case AST_AR_NEGATE: {
+            Range operand = range_expression(ctx, ast->left, block, refine);
+            Range negated = operand;
+            if (operand.kind == RANGE_INT) {
+                if (operand.min == INT64_MIN) {
+                    return range_full(CF_INT);
+                }
+                negated.min = -operand.max;
+                negated.max = -operand.min;
+            } else if (operand.kind == RANGE_FLOAT) {
+                negated.fmin = -operand.fmax;
+                negated.fmax = -operand.fmin;
+            }
+            return negated;
+        }
+        case AST_FUNC_CALL: {
+            const char *name = ast->left->data[0].symbolTableItemPtr->identifier;
+            if (strcmp(name, "len") == 0) {
+                return range_int(0, INT64_MAX);
+            }
+            if (strcmp(name, "int2float") == 0 && ast->right != NULL && ast->right->actionType != AST_LIST) {
+                Range operand = range_expression(ctx, ast->right, block, refine);
+                if (operand.kind != RANGE_INT) {
+                    return operand.kind == RANGE_UNDEFINED ? operand : range_full(CF_FLOAT);
+                }
+                // The conversion is monotonic and keeps non-zero integers non-zero
+                Range converted = range_float((double) operand.min, (double) operand.max);
+                converted.nonZero |= operand.nonZero;
+                return converted;
+            }
+            return range_full(ast->inheritedDataType);
+        }
+        default:
+            return range_full(ast->inheritedDataType);
+    }
+}
+
+// Evaluates the range of the value from its definition.
+static Range range_definition(RangeContext *ctx, const SSAValue *value) {
+    const STSymbol *symbol = ssa_symbol(ctx->ssa, value);
+    STDataType type = symbol->data.var_data.type;
+    if (range_kind_of(type) == RANGE_OTHER) {
+        return range_full(type);
+    }
+
+    switch (value->type) {
+        case SSA_VALUE_ENTRY:
+            // Named return values are initialised to zero, arguments are unknown
+            if (!symbol->data.var_data.is_return_val_variable) {
+                return range_full(type);
+            }
+            return type == CF_INT ? range_int(0, 0) : range_float(0, 0);
+        case SSA_VALUE_DEFINITION: {
+            const ASTNode *source = value->definition.source;
+            if (value->definition.resultIndex > 0 || (source->actionType == AST_FUNC_CALL
+                && source->left->data[0].symbolTableItemPtr->data.func_data.ret_types_count != 1)) {
+                return range_full(type);
+            }
+            Range range = range_expression(ctx, source, value->block, true);
+            return range.kind == RANGE_UNDEFINED || range.kind == range_kind_of(type) ? range : range_full(type);
+        }
+        default: {
+            // The operands of a phi are narrowed by the conditions of the edges they come through
+            Range range = {.kind = RANGE_UNDEFINED};
+            for (unsigned i = 0; i < value->block->predecessorsCount; i++) {
+                const BBBlock *predecessor = value->block->predecessors[i];
+                if (value->operands[i] == NULL) {
+                    continue;
+                }
+                Range operand = range_of_read(ctx, value->operands[i], predecessor);
+                const ASTNode *condition = range_condition(predecessor);
+                if (condition != NULL) {
+                    operand = range_refine(ctx, &operand, value->operands[i], predecessor, condition,
+                                           predecessor->successors[0] == value->block);
+                }
+                range = range_join(&range, &operand);
+            }
+            return range;
+        }
+    }
+}
+
+// Computes the ranges of all the values, until none of them grows.
+static void range_solve(RangeContext *ctx) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned i = 0; i < ctx->ssa->valuesCount; i++) {
+            const SSAValue *value = ctx->ssa->values[i];
+            Range old = ctx->ranges[value->id];
+            Range evaluated = range_definition(ctx, value);
+            Range grown = range_join(&old, &evaluated);
+            if (range_equal(&old, &grown)) {
+                continue;
+            }
+            if (old.kind != RANGE_UNDEFINED && ++ctx->updates[value->id] > RANGE_WIDENING_THRESHOLD) {
+                grown = range_widen(&old, &grown);
+            }
+            ctx->ranges[value->id] = grown;
+            changed = true;
+        }
+    }
+}
+
+// ---- Application ----
+
+// Decides an integer comparison using the ranges of its operands. Returns false if both results are possible.
+static bool range_decide(ASTNodeType operator, const Range *left, const Range *right, bool *result) {
+    if (left->kind != RANGE_INT || right->kind != RANGE_INT) {
+        return false;
+    }
+    switch (operator) {
+        case AST_LOG_LT:
+        case AST_LOG_LTE: {
+            bool strict = operator == AST_LOG_LT;
+            if (strict ? left->max < right->min : left->max <= right->min) {
+                *result = true;
+                return true;
+            }
+            if (strict ? left->min >= right->max : left->min > right->max) {
+                *result = false;
+                return true;
+            }
+            return false;
+        }
+        case AST_LOG_GT:
+        case AST_LOG_GTE:
+            return range_decide(range_swap(operator), right, left, result);
+        default: {
+            bool equal;
+            if (left->min == left->max && right->min == right->max && left->min == right->min) {
+                equal = true;
+            } else if (left->max < right->min || right->max < left->min
+                       || (left->nonZero && right->min == 0 && right->max == 0)
+                       || (right->nonZero && left->min == 0 && left->max == 0)) {
+                equal = false;
+            } else {
+                return false;
+            }
+            *result = operator == AST_LOG_EQ ? equal : !equal;
+            return true;
+        }
+    }
+}
+
+// Flags the divisions with non-zero divisors and folds the decided comparisons in the subtree in the slot.
+// root is the AST of the instruction.
+static void range_apply(RangeContext *ctx, ASTNode *root, ASTNode **slot, const BBBlock *block) {
+    ASTNode *ast = *slot;
+    if (ast == NULL || ctx->failed) {
+        return;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            range_apply(ctx, root, &ast->data[i].astPtr, block);
+        }
+        return;
+    }
+    if (ast->actionType != AST_ASSIGN && ast->actionType != AST_DEFINE && ast->actionType != AST_FUNC_CALL) {
+        range_apply(ctx, root, &ast->left, block);
+    }
+    range_apply(ctx, root, &ast->right, block);
+
+    if (ast->actionType == AST_DIVIDE && !ast->divisorNonZero) {
+        Range divisor = range_expression(ctx, ast->right, block, true);
+        if (!range_may_be_zero(&divisor)) {
+            ast->divisorNonZero = true;
+            ctx->divisions++;
+        }
+    } else if (ast->actionType >= AST_LOG_EQ && ast->actionType <= AST_LOG_GTE
+               && ast->left->inheritedDataType == CF_INT) {
+        Range left = range_expression(ctx, ast->left, block, true);
+        Range right = range_expression(ctx, ast->right, block, true);
+        bool result;
+        if (range_decide(ast->actionType, &left, &right, &result) && !tf_has_impure_call(ast) && !tf_may_fail(ast)) {
+            ASTNode *constant = ast_leaf_constb(result);
+            if (constant == NULL) {
+                ctx->failed = true;
+                return;
+            }
+            tf_replace(root, slot, constant);
+            ctx->comparisons++;
+        }
+    }
+}
+
+bool range_run(SSAForm *ssa, unsigned *divisions, unsigned *comparisons) {
+    *divisions = 0;
+    *comparisons = 0;
+    RangeContext ctx = {.ssa = ssa};
+    ctx.ranges = calloc(ssa->valuesCount + 1, sizeof(Range));
+    ctx.updates = calloc(ssa->valuesCount + 1, sizeof(unsigned));
+    if (ctx.ranges == NULL || ctx.updates == NULL) {
+        free(ctx.ranges);
+        free(ctx.updates);
+        return false;
+    }
+
+    range_solve(&ctx);
+    BBGraph *graph = ssa->graph;
+    for (unsigned i = 0; i < graph->reachableCount && !ctx.failed; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        for (unsigned j = 0; j < block->instructionsCount; j++) {
+            range_apply(&ctx, *block->instructions[j].ast, block->instructions[j].ast, block);
+        }
+    }
+
+    free(ctx.ranges);
+    free(ctx.updates);
+    *divisions = ctx.divisions;
+    *comparisons = ctx.comparisons;
+    return !ctx.failed;
+}
@@ -0,0 +1,28 @@
+/** @file range.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the value range analysis.
+ */
+
+#ifndef _RANGE_H
+#define _RANGE_H 1
+
+#include "ssa.h"
+
+/* Finds the ranges of the integer and float values of the function the SSA form was built for and uses them to
+ * remove the runtime checks of divisors and to fold comparisons.
+ *  - Each SSA value gets an interval of its possible values and a flag telling whether it's never zero. The
+ *    definitions are evaluated using the intervals of their operands, integer operations that may overflow give
+ *    the full range. Phis merge their operands; the ones that keep growing in loops are widened to the full range.
+ *  - A read of a value is narrowed by the conditions of the IFs and FORs it's guarded by: a block entered only
+ *    through the edge of a condition (e.g. the body of if d != 0 or of for i := 1; i < n; ...) may assume it holds.
+ *  - Divisions whose divisor is proven not to be zero are flagged, so that the code generator omits the check.
+ *  - Integer comparisons whose result is decided by the ranges of their operands are replaced with constants
+ *    (if they have no side effects and can't fail), the dead branches are left to be removed by the folding.
+ * The SSA form is invalid afterwards. Stores the number of proven divisors and folded comparisons, returns false
+ * if memory couldn't be allocated.
+ */
+bool range_run(SSAForm *ssa, unsigned *divisions, unsigned *comparisons);
+
+#endif // _RANGE_H
@@ -0,0 +1,465 @@
+/** @file reassoc.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the reassociation and canonicalisation of expressions.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reassoc.h"
+#include "transform.h"
+
+typedef enum reassoc_kind {
+    REASSOC_NONE,
+    REASSOC_SUM,     // Integer additions, subtractions and negations.
+    REASSOC_PRODUCT, // Integer multiplications.
+    REASSOC_CONCAT   // String concatenations.
+} ReassocKind;
+
+// An operand of a chain.
+typedef struct reassoc_term {
+    ASTNode **slot; // The slot holding the operand in the original chain.
+    ASTNode *ast;   // The operand, NULL for a constant that isn't created yet.
+    bool negated;   // Whether the operand is subtracted (sums only).
+} ReassocTerm;
+
+// A chain of operations of the same kind, flattened into a list of its operands.
+typedef struct reassoc_chain {
+    ReassocKind kind;
+    ReassocTerm *terms;
+    unsigned count;
+    unsigned capacity;
+    bool shaped;   // Whether the chain already is a left-deep tree (only the first operand may be negated).
+    bool negative; // Whether the product contains an odd number of negations.
+} ReassocChain;
+
+// The chain in the canonical order, with the removed operands left out.
+typedef struct reassoc_result {
+    ReassocTerm *terms;
+    unsigned count;
+    int64_t constant; // Value of the constant (NULL) operand.
+    char *string;     // Value of the constant operand of a concatenation.
+} ReassocResult;
+
+static ReassocKind reassoc_kind(const ASTNode *ast) {
+    if (ast->inheritedDataType == CF_INT) {
+        switch (ast->actionType) {
+            case AST_ADD:
+            case AST_SUBTRACT:
+            case AST_AR_NEGATE:
+                return REASSOC_SUM;
+            case AST_MULTIPLY:
+                return REASSOC_PRODUCT;
+            default:
+                return REASSOC_NONE;
+        }
+    }
+    return ast->inheritedDataType == CF_STRING && ast->actionType == AST_ADD ? REASSOC_CONCAT : REASSOC_NONE;
+}
+
+static bool reassoc_has_calls(const ASTNode *ast) {
+    return ast->actionType == AST_FUNC_CALL || ast->hasInnerFuncCalls;
+}
+
+// Checks whether the operand can be left out of the chain.
+static bool reassoc_is_removable(const ASTNode *ast) {
+    return !reassoc_has_calls(ast) && !tf_may_fail(ast);
+}
+
+static bool reassoc_add_term(ReassocChain *chain, ASTNode **slot, bool negated) {
+    if (!tf_reserve((void **) &chain->terms, &chain->capacity, chain->count, sizeof(ReassocTerm))) {
+        return false;
+    }
+    chain->terms[chain->count++] = (ReassocTerm) {.slot = slot, .ast = *slot, .negated = negated};
+    return true;
+}
+
+// Adds the operands of the chain in the slot (in their order of evaluation) to the list.
+static bool reassoc_flatten(ReassocChain *chain, ASTNode **slot, bool negated, bool leftmost) {
+    ASTNode *ast = *slot;
+    if (chain->kind == REASSOC_PRODUCT && ast->actionType == AST_AR_NEGATE && ast->inheritedDataType == CF_INT) {
+        // A negated factor negates the constant
+        chain->shaped = false;
+        chain->negative = !chain->negative;
+        return reassoc_flatten(chain, &ast->left, negated, leftmost);
+    }
+    if (reassoc_kind(ast) != chain->kind) {
+        return reassoc_add_term(chain, slot, negated);
+    }
+
+    if (ast->actionType == AST_AR_NEGATE) {
+        // A negation is only kept as the first operand of a sum
+        if (!leftmost || reassoc_kind(ast->left) == chain->kind) {
+            chain->shaped = false;
+        }
+        return reassoc_flatten(chain, &ast->left, !negated, leftmost);
+    }
+    if (reassoc_kind(ast->right) == chain->kind) {
+        chain->shaped = false;
+    }
+    return reassoc_flatten(chain, &ast->left, negated, leftmost)
+           && reassoc_flatten(chain, &ast->right, ast->actionType == AST_SUBTRACT ? !negated : negated, false);
+}
+
+// Orders the variables before the other operands, by their names. The sort is stable.
+static void reassoc_sort(ReassocTerm *terms, unsigned count) {
+    for (unsigned i = 1; i < count; i++) {
+        ReassocTerm term = terms[i];
+        unsigned j = i;
+        while (j > 0 && term.ast->actionType == AST_ID
+               && (terms[j - 1].ast->actionType != AST_ID
+                   || strcmp(terms[j - 1].ast->data[0].symbolTableItemPtr->identifier,
+                             term.ast->data[0].symbolTableItemPtr->identifier) > 0)) {
+            terms[j] = terms[j - 1];
+            j--;
+        }
+        terms[j] = term;
+    }
+}
+
+// Removes the pairs of equal operands that cancel out in a sum. They're freed with the original chain.
+static void reassoc_cancel(ReassocTerm *terms, unsigned *count) {
+    for (unsigned i = 0; i < *count; i++) {
+        if (!reassoc_is_removable(terms[i].ast)) {
+            continue;
+        }
+        for (unsigned j = i + 1; j < *count; j++) {
+            if (terms[j].negated != terms[i].negated && tf_equal(terms[i].ast, terms[j].ast)) {
+                memmove(&terms[j], &terms[j + 1], (*count - j - 1) * sizeof(ReassocTerm));
+                memmove(&terms[i], &terms[i + 1], (*count - i - 2) * sizeof(ReassocTerm));
+                *count -= 2;
+                i--;
+                break;
+            }
+        }
+    }
+}
+
+// Checks whether the operand is a constant with the value.
+static bool reassoc_is_constant(const ReassocTerm *term, int64_t value, bool negated) {
+    return term->ast->actionType == AST_CONST_INT && term->ast->data[0].intConstantValue == value
+           && term->negated == negated;
+}
+
+// Puts the operands of a sum into the canonical order: the terms that aren't constants (the first one not negated,
+// if possible) and then their sum.
+static void reassoc_sum(ReassocChain *chain, ReassocResult *result) {
+    uint64_t constant = 0;
+    for (unsigned i = 0; i < chain->count; i++) {
+        ReassocTerm *term = &chain->terms[i];
+        if (term->ast->actionType == AST_CONST_INT) {
+            uint64_t value = (uint64_t) term->ast->data[0].intConstantValue;
+            constant = term->negated ? constant - value : constant + value;
+        } else {
+            result->terms[result->count++] = *term;
+        }
+    }
+    reassoc_cancel(result->terms, &result->count);
+
+    bool ordered = true;
+    for (unsigned i = 0; i < result->count; i++) {
+        ordered &= !reassoc_has_calls(result->terms[i].ast);
+    }
+    if (ordered) {
+        reassoc_sort(result->terms, result->count);
+        for (unsigned i = 0; i < result->count; i++) {
+            if (!result->terms[i].negated) {
+                ReassocTerm first = result->terms[i];
+                memmove(&result->terms[1], &result->terms[0], i * sizeof(ReassocTerm));
+                result->terms[0] = first;
+                break;
+            }
+        }
+    }
+
+    result->constant = (int64_t) constant;
+    if (result->count > 0 && constant == 0) {
+        return;
+    }
+    // The constant goes first only if all the other terms are subtracted from it (5 - x)
+    bool first = ordered && result->count > 0 && result->terms[0].negated;
+    bool negated = !first && result->count > 0 && result->constant < 0 && result->constant != INT64_MIN;
+    ReassocTerm term = {.ast = NULL, .negated = negated};
+    if (negated) {
+        result->constant = -result->constant;
+    }
+    for (unsigned i = 0; i < chain->count; i++) {
+        if (reassoc_is_constant(&chain->terms[i], result->constant, negated)) {
+            term = chain->terms[i];
+            break;
+        }
+    }
+    if (first) {
+        memmove(&result->terms[1], &result->terms[0], result->count * sizeof(ReassocTerm));
+        result->terms[0] = term;
+        result->count++;
+    } else {
+        result->terms[result->count++] = term;
+    }
+}
+
+// Puts the operands of a product into the canonical order: the factors that aren't constants and then
+// their product.
+static void reassoc_product(ReassocChain *chain, ReassocResult *result) {
+    uint64_t constant = chain->negative ? (uint64_t) -1 : 1;
+    bool removable = true;
+    for (unsigned i = 0; i < chain->count; i++) {
+        ReassocTerm *term = &chain->terms[i];
+        if (term->ast->actionType == AST_CONST_INT) {
+            constant *= (uint64_t) term->ast->data[0].intConstantValue;
+        } else {
+            result->terms[result->count++] = *term;
+            removable &= reassoc_is_removable(term->ast);
+        }
+    }
+
+    result->constant = (int64_t) constant;
+    if (constant == 0 && removable) {
+        result->count = 0;
+    }
+
+    bool ordered = true;
+    for (unsigned i = 0; i < result->count; i++) {
+        ordered &= !reassoc_has_calls(result->terms[i].ast);
+    }
+    if (ordered) {
+        reassoc_sort(result->terms, result->count);
+    }
+
+    if (result->count > 0 && constant == 1) {
+        return;
+    }
+    ReassocTerm term = {.ast = NULL};
+    for (unsigned i = 0; i < chain->count && !chain->negative; i++) {
+        if (reassoc_is_constant(&chain->terms[i], result->constant, false)) {
+            term = chain->terms[i];
+            break;
+        }
+    }
+    result->terms[result->count++] = term;
+}
+
+// Concatenates the adjacent constants of a concatenation. The concatenated constants are NULL operands,
+// their value is kept in result->string (separated by zero bytes).
+static bool reassoc_concat(ReassocChain *chain, ReassocResult *result) {
+    size_t length = 0;
+    for (unsigned i = 0; i < chain->count; i++) {
+        if (chain->terms[i].ast->actionType == AST_CONST_STRING) {
+            length += strlen(chain->terms[i].ast->data[0].stringConstantValue) + 1;
+        }
+    }
+    result->string = malloc(length + 1);
+    if (result->string == NULL) {
+        return false;
+    }
+
+    char *string = result->string;
+    *string = '\0';
+    for (unsigned i = 0; i < chain->count; i++) {
+        ReassocTerm *term = &chain->terms[i];
+        if (term->ast->actionType != AST_CONST_STRING) {
+            if (*string != '\0') {
+                // The constants before the operand are kept as a single one
+                result->terms[result->count++] = (ReassocTerm) {.ast = NULL};
+                string += strlen(string) + 1;
+                *string = '\0';
+            }
+            result->terms[result->count++] = *term;
+            continue;
+        }
+        if (*string == '\0' && term->ast->data[0].stringConstantValue[0] != '\0'
+            && (i + 1 == chain->count || chain->terms[i + 1].ast->actionType != AST_CONST_STRING)) {
+            // A constant that doesn't need to be concatenated with others is kept
+            result->terms[result->count++] = *term;
+            continue;
+        }
+        strcat(string, term->ast->data[0].stringConstantValue);
+    }
+    if (*string != '\0' || result->count == 0) {
+        result->terms[result->count++] = (ReassocTerm) {.ast = NULL};
+    }
+    return true;
+}
+
+// Checks whether the canonical chain is the original one.
+static bool reassoc_is_unchanged(const ReassocChain *chain, const ReassocResult *result) {
+    if (!chain->shaped || chain->count != result->count) {
+        return false;
+    }
+    for (unsigned i = 0; i < result->count; i++) {
+        if (result->terms[i].ast != chain->terms[i].ast || result->terms[i].negated != chain->terms[i].negated) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static ASTNode *reassoc_node(ASTNodeType type, STDataType dataType) {
+    ASTNode *node = ast_node(type);
+    if (node != NULL) {
+        node->inheritedDataType = dataType;
+    }
+    return node;
+}
+
+// Creates the constant operands of the result. Returns false if memory couldn't be allocated.
+static bool reassoc_create_constants(ReassocChain *chain, ReassocResult *result) {
+    const char *string = result->string;
+    for (unsigned i = 0; i < result->count; i++) {
+        if (result->terms[i].ast != NULL) {
+            continue;
+        }
+        if (chain->kind == REASSOC_CONCAT) {
+            result->terms[i].ast = ast_leaf_consts(string);
+            string += strlen(string) + 1;
+        } else {
+            result->terms[i].ast = tf_const_int(result->constant);
+        }
+        if (result->terms[i].ast == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rebuilds the chain in the slot from the operands of the result as a left-deep tree.
+// Returns false if memory couldn't be allocated, the original chain is kept then.
+static bool reassoc_rebuild(ReassocChain *chain, ReassocResult *result, ASTNode **slot) {
+    STDataType type = chain->kind == REASSOC_CONCAT ? CF_STRING : CF_INT;
+    unsigned nodesCount = result->count;
+    ASTNode **nodes = calloc(nodesCount + 1, sizeof(ASTNode *));
+    bool failed = nodes == NULL;
+    for (unsigned i = 0; i < nodesCount && !failed; i++) {
+        const ReassocTerm *term = &result->terms[i];
+        ASTNodeType op = chain->kind == REASSOC_PRODUCT ? AST_MULTIPLY : (term->negated ? AST_SUBTRACT : AST_ADD);
+        if (i == 0) {
+            op = AST_AR_NEGATE;
+        }
+        // The first operand only needs a node if it's negated
+        nodes[i] = i > 0 || term->negated ? reassoc_node(op, type) : NULL;
+        failed = nodes[i] == NULL && (i > 0 || term->negated);
+    }
+    // The constants of the original chain that are kept are only taken out of it if nothing failed
+    failed = failed || !reassoc_create_constants(chain, result);
+    if (failed) {
+        for (unsigned i = 0; i < result->count; i++) {
+            bool original = false;
+            for (unsigned j = 0; j < chain->count && !original; j++) {
+                original = chain->terms[j].ast == result->terms[i].ast;
+            }
+            if (!original) {
+                clean_ast(result->terms[i].ast);
+            }
+        }
+        for (unsigned i = 0; nodes != NULL && i < nodesCount; i++) {
+            free(nodes[i]);
+        }
+        free(nodes);
+        return false;
+    }
+
+    // The operands are taken out of the original chain, the removed ones are freed with it
+    for (unsigned i = 0; i < chain->count; i++) {
+        for (unsigned j = 0; j < result->count; j++) {
+            if (result->terms[j].ast == chain->terms[i].ast) {
+                *chain->terms[i].slot = NULL;
+                break;
+            }
+        }
+    }
+    clean_ast(*slot);
+
+    ASTNode *tree = result->terms[0].ast;
+    if (nodes[0] != NULL) {
+        nodes[0]->left = tree;
+        tree = nodes[0];
+    }
+    for (unsigned i = 1; i < result->count; i++) {
+        nodes[i]->left = tree;
+        nodes[i]->right = result->terms[i].ast;
+        tree = nodes[i];
+    }
+    *slot = tree;
+    free(nodes);
+    return true;
+}
+
+static bool reassoc_subtree(ASTNode **slot, bool *changed);
+
+// Canonicalises the chain in the slot and the expressions of its operands.
+static bool reassoc_chain(ASTNode **slot, ReassocKind kind, bool *changed) {
+    ReassocChain chain = {.kind = kind, .shaped = true};
+    bool success = reassoc_flatten(&chain, slot, false, true);
+    for (unsigned i = 0; i < chain.count && success; i++) {
+        success = reassoc_subtree(chain.terms[i].slot, changed);
+        chain.terms[i].ast = *chain.terms[i].slot;
+    }
+
+    ReassocResult result = {.terms = success ? malloc((chain.count + 1) * sizeof(ReassocTerm)) : NULL};
+    success = success && result.terms != NULL;
+    if (success) {
+        if (kind == REASSOC_SUM) {
+            reassoc_sum(&chain, &result);
+        } else if (kind == REASSOC_PRODUCT) {
+            reassoc_product(&chain, &result);
+        } else {
+            success = reassoc_concat(&chain, &result);
+        }
+    }
+    if (success && !reassoc_is_unchanged(&chain, &result)) {
+        success = reassoc_rebuild(&chain, &result, slot);
+        *changed |= success;
+    }
+
+    free(result.terms);
+    free(result.string);
+    free(chain.terms);
+    return success;
+}
+
+static bool reassoc_subtree(ASTNode **slot, bool *changed) {
+    ASTNode *ast = *slot;
+    if (ast == NULL) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!reassoc_subtree(&ast->data[i].astPtr, changed)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ReassocKind kind = reassoc_kind(ast);
+    if (kind != REASSOC_NONE) {
+        return reassoc_chain(slot, kind, changed);
+    }
+    if (ast->actionType == AST_ID || ast->actionType == AST_FUNC_CALL) {
+        // The left child of a call identifies the function
+        return ast->actionType == AST_ID || reassoc_subtree(&ast->right, changed);
+    }
+    if (ast->actionType == AST_DIVIDE && ast->right->actionType != AST_CONST_INT) {
+        // A divisor whose terms cancel out isn't divided by in the source, its zero is left to the runtime check
+        if (!reassoc_subtree(&ast->left, changed) || !reassoc_subtree(&ast->right, changed)) {
+            return false;
+        }
+        ast->divisorChecked |= ast->right->actionType == AST_CONST_INT && ast->right->data[0].intConstantValue == 0;
+        return true;
+    }
+    return reassoc_subtree(&ast->left, changed) && reassoc_subtree(&ast->right, changed);
+}
+
+bool reassoc_ast(ASTNode **ast, bool *changed) {
+    if (*ast == NULL) {
+        return true;
+    }
+    // The operands may be moved anywhere in the value of a compound assignment
+    tf_count_compound_read(*ast);
+    bool success = (*ast)->actionType == AST_ASSIGN || (*ast)->actionType == AST_DEFINE
+                   ? reassoc_subtree(&(*ast)->right, changed) : reassoc_subtree(ast, changed);
+    tf_uncount_compound_read(*ast);
+    return success;
+}
@@ -0,0 +1,29 @@
+/** @file reassoc.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the reassociation and canonicalisation of expressions.
+ */
+
+#ifndef _REASSOC_H
+#define _REASSOC_H 1
+
+#include <stdbool.h>
+#include "ast.h"
+
+/* Rewrites the chains of associative operations in the AST (whose types have been inferred) into a canonical form,
+ * so that the folding and the value numbering see through them:
+ *  - Integer additions, subtractions and negations (e.g. (x + 1) - (2 - y)) are flattened into a list of terms,
+ *    the constants are summed up and the terms that cancel out (x - x, (a + b) - b) are removed. A divisor
+ *    that cancels out to zero is left to the runtime check (see ASTNode.divisorChecked).
+ *  - Integer multiplications (also of negated factors) are flattened the same way, the constants are multiplied.
+ *    A product with a zero constant is zero if the other factors have no side effects and can't fail.
+ *  - String concatenations are flattened and the adjacent constants are concatenated, empty strings are removed.
+ * The integer terms are ordered (variables first, by name) unless some of them calls a function, the constant goes
+ * last. The chain is then rebuilt as a left-deep tree (((a + b) - c) + 3). The integer arithmetic wraps around
+ * like the generated instructions. Terms are only removed if they have no side effects and can't fail.
+ * Sets changed if the AST was rewritten, returns false if memory couldn't be allocated.
+ */
+bool reassoc_ast(ASTNode **ast, bool *changed);
+
+#endif // _REASSOC_H
@@ -0,0 +1,513 @@
+/** @file sccp.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the sparse conditional constant propagation.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sccp.h"
+#include "stderr_message.h"
+#include "transform.h"
+
+static const SCCPValue sccpUndefined = {.state = SCCP_UNDEFINED};
+static const SCCPValue sccpOverdefined = {.state = SCCP_OVERDEFINED};
+
+// Worklists of the propagation: blocks reached by a newly executable edge and values whose lattice value changed.
+typedef struct sccp_solver {
+    SCCPResult *result;
+    BBBlock **blocks;
+    unsigned blocksCount;
+    unsigned blocksCapacity;
+    SSAValue **values;
+    unsigned valuesCount;
+    unsigned valuesCapacity;
+    bool *visited; // Blocks whose instructions have been evaluated at least once.
+    bool failed;
+} SCCPSolver;
+
+static SCCPValue sccp_constant(ASTNodeType type, ASTNodeData data) {
+    return (SCCPValue) {.state = SCCP_CONSTANT, .type = type, .data = data};
+}
+
+static SCCPValue sccp_bool(bool value) {
+    return sccp_constant(AST_CONST_BOOL, (ASTNodeData) {.boolConstantValue = value});
+}
+
+static bool sccp_equal(const SCCPValue *a, const SCCPValue *b) {
+    if (a->state != b->state) {
+        return false;
+    }
+    if (a->state != SCCP_CONSTANT) {
+        return true;
+    }
+    if (a->type != b->type) {
+        return false;
+    }
+
+    switch (a->type) {
+        case AST_CONST_INT:
+            return a->data.intConstantValue == b->data.intConstantValue;
+        case AST_CONST_FLOAT:
+            // Compare the representations, so that 0.0 and -0.0 differ
+            return memcmp(&a->data.floatConstantValue, &b->data.floatConstantValue, sizeof(double)) == 0;
+        case AST_CONST_STRING:
+            return strcmp(a->data.stringConstantValue, b->data.stringConstantValue) == 0;
+        case AST_CONST_BOOL:
+            return a->data.boolConstantValue == b->data.boolConstantValue;
+        default:
+            return false;
+    }
+}
+
+static bool sccp_is_int_zero(const SCCPValue *value) {
+    return value->state == SCCP_CONSTANT && value->type == AST_CONST_INT && value->data.intConstantValue == 0;
+}
+
+// The meet of two lattice values.
+static SCCPValue sccp_meet(SCCPValue a, SCCPValue b) {
+    if (a.state == SCCP_UNDEFINED) {
+        return b;
+    }
+    if (b.state == SCCP_UNDEFINED) {
+        return a;
+    }
+    if (a.state == SCCP_CONSTANT && sccp_equal(&a, &b)) {
+        return a;
+    }
+    return sccpOverdefined;
+}
+
+// Stores the concatenation of two strings in the result. Returns NULL if memory couldn't be allocated.
+static const char *sccp_concat(SCCPResult *result, const char *left, const char *right) {
+    if (!tf_reserve((void **) &result->strings, &result->stringsCapacity, result->stringsCount, sizeof(char *))) {
+        return NULL;
+    }
+    char *new = malloc(strlen(left) + strlen(right) + 1);
+    if (new == NULL) {
+        return NULL;
+    }
+    strcpy(new, left);
+    strcat(new, right);
+    result->strings[result->stringsCount++] = new;
+    return new;
+}
+
+// Compares two constants of the same type. Only == and != are defined for bools.
+static SCCPValue sccp_compare(ASTNodeType operator, const SCCPValue *left, const SCCPValue *right) {
+    int cmp;
+    switch (left->type) {
+        case AST_CONST_INT:
+            cmp = (left->data.intConstantValue > right->data.intConstantValue)
+                  - (left->data.intConstantValue < right->data.intConstantValue);
+            break;
+        case AST_CONST_FLOAT: {
+            double l = left->data.floatConstantValue;
+            double r = right->data.floatConstantValue;
+            // NaNs are unordered, evaluate the operators directly
+            switch (operator) {
+                case AST_LOG_EQ:
+                    return sccp_bool(l == r);
+                case AST_LOG_NEQ:
+                    return sccp_bool(l != r);
+                case AST_LOG_GT:
+                    return sccp_bool(l > r);
+                case AST_LOG_LT:
+                    return sccp_bool(l < r);
+                case AST_LOG_GTE:
+                    return sccp_bool(l >= r);
+                case AST_LOG_LTE:
+                    return sccp_bool(l <= r);
+                default:
+                    return sccpOverdefined;
+            }
+        }
+        case AST_CONST_STRING:
+            cmp = strcmp(left->data.stringConstantValue, right->data.stringConstantValue);
+            break;
+        case AST_CONST_BOOL:
+            if (operator != AST_LOG_EQ && operator != AST_LOG_NEQ) {
+                return sccpOverdefined;
+            }
+            cmp = left->data.boolConstantValue != right->data.boolConstantValue;
+            break;
+        default:
+            return sccpOverdefined;
+    }
+
+    switch (operator) {
+        case AST_LOG_EQ:
+            return sccp_bool(cmp == 0);
+        case AST_LOG_NEQ:
+            return sccp_bool(cmp != 0);
+        case AST_LOG_GT:
+            return sccp_bool(cmp > 0);
+        case AST_LOG_LT:
+            return sccp_bool(cmp < 0);
+        case AST_LOG_GTE:
+            return sccp_bool(cmp >= 0);
+        case AST_LOG_LTE:
+            return sccp_bool(cmp <= 0);
+        default:
+            return sccpOverdefined;
+    }
+}
+
+// Applies an arithmetic operator to two constants of the same type.
+// Integers wrap around like in the generated code; division by zero is left to the folding, which reports it.
+static SCCPValue sccp_arithmetic(SCCPResult *result, ASTNodeType operator, const SCCPValue *left,
+                                 const SCCPValue *right) {
+    if (left->type == AST_CONST_INT) {
+        uint64_t l = (uint64_t) left->data.intConstantValue;
+        uint64_t r = (uint64_t) right->data.intConstantValue;
+        int64_t value;
+        switch (operator) {
+            case AST_ADD:
+                value = (int64_t) (l + r);
+                break;
+            case AST_SUBTRACT:
+                value = (int64_t) (l - r);
+                break;
+            case AST_MULTIPLY:
+                value = (int64_t) (l * r);
+                break;
+            case AST_DIVIDE:
+                if (right->data.intConstantValue == 0
+                    || (left->data.intConstantValue == INT64_MIN && right->data.intConstantValue == -1)) {
+                    return sccpOverdefined;
+                }
+                value = left->data.intConstantValue / right->data.intConstantValue;
+                break;
+            default:
+                return sccpOverdefined;
+        }
+        return sccp_constant(AST_CONST_INT, (ASTNodeData) {.intConstantValue = value});
+    }
+
+    if (left->type == AST_CONST_FLOAT) {
+        double l = left->data.floatConstantValue;
+        double r = right->data.floatConstantValue;
+        double value;
+        switch (operator) {
+            case AST_ADD:
+                value = l + r;
+                break;
+            case AST_SUBTRACT:
+                value = l - r;
+                break;
+            case AST_MULTIPLY:
+                value = l * r;
+                break;
+            case AST_DIVIDE:
+                if (tf_is_float_zero(r)) {
+                    return sccpOverdefined;
+                }
+                value = l / r;
+                break;
+            default:
+                return sccpOverdefined;
+        }
+        return sccp_constant(AST_CONST_FLOAT, (ASTNodeData) {.floatConstantValue = value});
+    }
+
+    if (left->type == AST_CONST_STRING && operator == AST_ADD) {
+        const char *value = sccp_concat(result, left->data.stringConstantValue, right->data.stringConstantValue);
+        if (value == NULL) {
+            stderr_message("sccp", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+            return sccpOverdefined;
+        }
+        return sccp_constant(AST_CONST_STRING, (ASTNodeData) {.stringConstantValue = value});
+    }
+
+    return sccpOverdefined;
+}
+
+SCCPValue sccp_evaluate(SCCPResult *result, const ASTNode *ast) {
+    switch (ast->actionType) {
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_STRING:
+        case AST_CONST_BOOL:
+            return sccp_constant(ast->actionType, ast->data[0]);
+        case AST_ID: {
+            SSAValue *value = df_is_variable(ast) ? ssa_value_of(result->ssa, ast) : NULL;
+            return value == NULL ? sccpOverdefined : result->values[value->id];
+        }
+        case AST_AR_NEGATE: {
+            SCCPValue operand = sccp_evaluate(result, ast->left);
+            if (operand.state != SCCP_CONSTANT) {
+                return operand;
+            }
+            if (operand.type == AST_CONST_INT) {
+                operand.data.intConstantValue = (int64_t) (0 - (uint64_t) operand.data.intConstantValue);
+            } else if (operand.type == AST_CONST_FLOAT) {
+                operand.data.floatConstantValue = -operand.data.floatConstantValue;
+            } else {
+                return sccpOverdefined;
+            }
+            return operand;
+        }
+        case AST_LOG_NOT: {
+            SCCPValue operand = sccp_evaluate(result, ast->left);
+            if (operand.state != SCCP_CONSTANT) {
+                return operand;
+            }
+            return operand.type == AST_CONST_BOOL ? sccp_bool(!operand.data.boolConstantValue) : sccpOverdefined;
+        }
+        case AST_LOG_AND:
+        case AST_LOG_OR: {
+            // The right operand only matters if the left one doesn't decide the result
+            bool shortCircuit = ast->actionType == AST_LOG_OR;
+            SCCPValue left = sccp_evaluate(result, ast->left);
+            if (left.state != SCCP_CONSTANT) {
+                return left;
+            }
+            if (left.type != AST_CONST_BOOL) {
+                return sccpOverdefined;
+            }
+            if (left.data.boolConstantValue == shortCircuit) {
+                return left;
+            }
+            SCCPValue right = sccp_evaluate(result, ast->right);
+            if (right.state == SCCP_CONSTANT && right.type != AST_CONST_BOOL) {
+                return sccpOverdefined;
+            }
+            return right;
+        }
+        case AST_ADD:
+        case AST_SUBTRACT:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_LOG_EQ:
+        case AST_LOG_NEQ:
+        case AST_LOG_LT:
+        case AST_LOG_GT:
+        case AST_LOG_LTE:
+        case AST_LOG_GTE: {
+            SCCPValue left = sccp_evaluate(result, ast->left);
+            SCCPValue right = sccp_evaluate(result, ast->right);
+            // An integer multiplied by zero is zero whatever the other operand is, the folding drops it as well
+            if (ast->actionType == AST_MULTIPLY && (sccp_is_int_zero(&left) || sccp_is_int_zero(&right))) {
+                return sccp_constant(AST_CONST_INT, (ASTNodeData) {.intConstantValue = 0});
+            }
+            if (left.state == SCCP_OVERDEFINED || right.state == SCCP_OVERDEFINED) {
+                return sccpOverdefined;
+            }
+            if (left.state == SCCP_UNDEFINED || right.state == SCCP_UNDEFINED) {
+                return sccpUndefined;
+            }
+            if (left.type != right.type) {
+                return sccpOverdefined;
+            }
+            if (ast->actionType >= AST_LOG_EQ && ast->actionType <= AST_LOG_GTE) {
+                return sccp_compare(ast->actionType, &left, &right);
+            }
+            return sccp_arithmetic(result, ast->actionType, &left, &right);
+        }
+        default:
+            // Function calls and anything else that can't be evaluated at compile time
+            return sccpOverdefined;
+    }
+}
+
+bool sccp_is_executable(const SCCPResult *result, const BBBlock *block) {
+    return result->executableBlocks[block->id];
+}
+
+// Lowers the lattice value of an SSA value, queueing its users if it changed.
+static void sccp_lower(SCCPSolver *solver, SSAValue *value, SCCPValue new) {
+    SCCPValue *current = &solver->result->values[value->id];
+    SCCPValue lowered = sccp_meet(*current, new);
+    if (sccp_equal(current, &lowered)) {
+        return;
+    }
+
+    *current = lowered;
+    if (!tf_reserve((void **) &solver->values, &solver->valuesCapacity, solver->valuesCount,
+                    sizeof(SSAValue *))) {
+        solver->failed = true;
+        return;
+    }
+    solver->values[solver->valuesCount++] = value;
+}
+
+// Marks the edge from the block to its index-th successor as executable, queueing the successor if it's new.
+static void sccp_mark_edge(SCCPSolver *solver, BBBlock *block, unsigned index) {
+    if (solver->result->executableEdges[block->id][index]) {
+        return;
+    }
+
+    solver->result->executableEdges[block->id][index] = true;
+    if (!tf_reserve((void **) &solver->blocks, &solver->blocksCapacity, solver->blocksCount, sizeof(BBBlock *))) {
+        solver->failed = true;
+        return;
+    }
+    solver->blocks[solver->blocksCount++] = block->successors[index];
+}
+
+static bool sccp_edge_executable(const SCCPResult *result, const BBBlock *from, const BBBlock *to) {
+    for (unsigned s = 0; s < from->successorsCount; s++) {
+        if (from->successors[s] == to && result->executableEdges[from->id][s]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sccp_visit_phi(SCCPSolver *solver, SSAValue *phi) {
+    SCCPValue merged = sccpUndefined;
+    BBBlock *block = phi->block;
+    for (unsigned p = 0; p < block->predecessorsCount; p++) {
+        if (phi->operands[p] != NULL && sccp_edge_executable(solver->result, block->predecessors[p], block)) {
+            merged = sccp_meet(merged, solver->result->values[phi->operands[p]->id]);
+        }
+    }
+    sccp_lower(solver, phi, merged);
+}
+
+static void sccp_visit_instruction(SCCPSolver *solver, BBBlock *block, unsigned index) {
+    BBInstruction *instruction = &block->instructions[index];
+    ASTNode *ast = *instruction->ast;
+
+    if (instruction->target == CF_IF_CONDITIONAL || instruction->target == CF_FOR_CONDITIONAL) {
+        SCCPValue condition = sccp_evaluate(solver->result, ast);
+        if (condition.state == SCCP_CONSTANT && condition.type == AST_CONST_BOOL) {
+            sccp_mark_edge(solver, block, condition.data.boolConstantValue ? 0 : 1);
+        } else if (condition.state != SCCP_UNDEFINED) {
+            sccp_mark_edge(solver, block, 0);
+            sccp_mark_edge(solver, block, 1);
+        }
+        return;
+    }
+
+    DFTarget target;
+    for (unsigned t = 0; t < df_targets_count(ast); t++) {
+        if (!df_get_target(ast, t, &target)) {
+            continue;
+        }
+        SSAValue *value = ssa_value_of(solver->result->ssa, target.target);
+        if (value != NULL) {
+            sccp_lower(solver, value, target.source->actionType == AST_FUNC_CALL
+                                      ? sccpOverdefined : sccp_evaluate(solver->result, target.source));
+        }
+    }
+}
+
+static void sccp_visit_block(SCCPSolver *solver, BBBlock *block) {
+    SSAForm *ssa = solver->result->ssa;
+    for (unsigned i = 0; i < ssa->phisCounts[block->id]; i++) {
+        sccp_visit_phi(solver, ssa->phis[block->id][i]);
+    }
+
+    // The phis are evaluated again whenever another edge into the block becomes executable
+    if (solver->visited[block->id]) {
+        return;
+    }
+    solver->visited[block->id] = true;
+    solver->result->executableBlocks[block->id] = true;
+
+    for (unsigned j = 0; j < block->instructionsCount; j++) {
+        sccp_visit_instruction(solver, block, j);
+    }
+    if (block->successorsCount == 1) {
+        sccp_mark_edge(solver, block, 0);
+    }
+}
+
+// Sets the lattice values of the variables when the function is entered.
+static void sccp_init_entry_values(SCCPResult *result) {
+    SSAForm *ssa = result->ssa;
+    for (unsigned i = 0; i < ssa->valuesCount; i++) {
+        SSAValue *value = ssa->values[i];
+        if (value->type != SSA_VALUE_ENTRY) {
+            continue;
+        }
+
+        // Named return values are initialised to zero by the generated code, arguments are unknown
+        // and other variables are always defined before they're read
+        STSymbol *symbol = ssa_symbol(ssa, value);
+        SCCPValue *lattice = &result->values[value->id];
+        *lattice = sccpOverdefined;
+        if (symbol->type != ST_SYMBOL_VAR || !symbol->data.var_data.is_return_val_variable) {
+            continue;
+        }
+        switch (symbol->data.var_data.type) {
+            case CF_INT:
+                *lattice = sccp_constant(AST_CONST_INT, (ASTNodeData) {.intConstantValue = 0});
+                break;
+            case CF_FLOAT:
+                *lattice = sccp_constant(AST_CONST_FLOAT, (ASTNodeData) {.floatConstantValue = 0.0});
+                break;
+            case CF_STRING:
+                *lattice = sccp_constant(AST_CONST_STRING, (ASTNodeData) {.stringConstantValue = ""});
+                break;
+            case CF_BOOL:
+                *lattice = sccp_bool(false);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+bool sccp_run(SSAForm *ssa, SCCPResult *result) {
+    BBGraph *graph = ssa->graph;
+    *result = (SCCPResult) {.ssa = ssa};
+    result->values = calloc(ssa->valuesCount + 1, sizeof(SCCPValue));
+    result->executableBlocks = calloc(graph->blocksCount, sizeof(bool));
+    result->executableEdges = calloc(graph->blocksCount, sizeof(*result->executableEdges));
+
+    SCCPSolver solver = {.result = result};
+    solver.visited = calloc(graph->blocksCount, sizeof(bool));
+    solver.failed = result->values == NULL || result->executableBlocks == NULL || result->executableEdges == NULL
+                    || solver.visited == NULL;
+
+    if (!solver.failed) {
+        sccp_init_entry_values(result);
+        sccp_visit_block(&solver, graph->entry);
+    }
+
+    while (!solver.failed && (solver.blocksCount > 0 || solver.valuesCount > 0)) {
+        if (solver.blocksCount > 0) {
+            sccp_visit_block(&solver, solver.blocks[--solver.blocksCount]);
+            continue;
+        }
+
+        SSAValue *value = solver.values[--solver.valuesCount];
+        for (unsigned i = 0; i < value->usersCount && !solver.failed; i++) {
+            SSAUser *user = &value->users[i];
+            if (!solver.visited[user->block->id]) {
+                continue;
+            }
+            if (user->phi != NULL) {
+                sccp_visit_phi(&solver, user->phi);
+            } else {
+                sccp_visit_instruction(&solver, user->block, user->instruction);
+            }
+        }
+    }
+
+    free(solver.blocks);
+    free(solver.values);
+    free(solver.visited);
+
+    if (solver.failed) {
+        sccp_free(result);
+        stderr_message("sccp", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return false;
+    }
+    return true;
+}
+
+void sccp_free(SCCPResult *result) {
+    for (unsigned i = 0; i < result->stringsCount; i++) {
+        free(result->strings[i]);
+    }
+    free(result->strings);
+    free(result->values);
+    free(result->executableBlocks);
+    free(result->executableEdges);
+    *result = (SCCPResult) {0};
+}
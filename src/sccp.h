@@ -0,0 +1,57 @@
+/** @file sccp.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions and data types for the sparse conditional constant propagation.
+ */
+
+#ifndef _SCCP_H
+#define _SCCP_H 1
+
+#include "ssa.h"
+
+typedef enum sccp_state {
+    SCCP_UNDEFINED,  // No definition of the value has been executed (yet).
+    SCCP_CONSTANT,   // The value is always the same constant.
+    SCCP_OVERDEFINED // The value may differ between executions or can't be determined.
+} SCCPState;
+
+// An element of the constant lattice.
+typedef struct sccp_value {
+    SCCPState state;
+    ASTNodeType type;  // AST_CONST_INT, AST_CONST_FLOAT, AST_CONST_STRING or AST_CONST_BOOL (constants only).
+    ASTNodeData data;  // The constant (constants only).
+} SCCPValue;
+
+typedef struct sccp_result {
+    SSAForm *ssa;
+    SCCPValue *values;       // Lattice values of the SSA values, indexed by their ids.
+    bool *executableBlocks;  // Blocks that may be executed, indexed by block ids.
+    bool (*executableEdges)[2]; // Edges to the successors that may be taken, indexed by block ids.
+
+    char **strings;          // Strings created by concatenation, owned by the result.
+    unsigned stringsCount;
+    unsigned stringsCapacity;
+} SCCPResult;
+
+/* Runs the sparse conditional constant propagation (Wegman–Zadeck) on the SSA form.
+ *  - Each SSA value starts as undefined and is only lowered in the lattice, the definitions are evaluated using
+ *    the lattice values of the operands. Function calls are overdefined.
+ *  - Only edges leaving executed blocks are followed; a condition that is constant follows a single edge. Phis merge
+ *    the operands coming through executable edges only, so constants survive loops that don't modify them and
+ *    assignments in branches that are never taken.
+ *  - Arguments are overdefined, named return values start as the zero value of their type.
+ * Returns false if memory couldn't be allocated.
+ */
+bool sccp_run(SSAForm *ssa, SCCPResult *result);
+
+// Frees the result. The SSA form is not affected.
+void sccp_free(SCCPResult *result);
+
+// Evaluates an expression of an executable block using the lattice values of the variables it reads.
+SCCPValue sccp_evaluate(SCCPResult *result, const ASTNode *ast);
+
+// Checks whether the block may be executed.
+bool sccp_is_executable(const SCCPResult *result, const BBBlock *block);
+
+#endif // _SCCP_H
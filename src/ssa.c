@@ -0,0 +1,412 @@
+/** @file ssa.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the construction of the static single assignment form of functions.
+ */
+
+#include <stdlib.h>
+#include "ssa.h"
+#include "stderr_message.h"
+#include "transform.h"
+
+// A stack of the values of a variable during renaming.
+typedef struct ssa_stack {
+    SSAValue **values;
+    unsigned count;
+    unsigned capacity;
+} SSAStack;
+
+typedef struct ssa_builder {
+    SSAForm *ssa;
+    SSAStack *stacks;    // Current values of the variables, indexed by the variables.
+    unsigned *pushLog;   // Variables whose stacks have been pushed to, used to restore the stacks after a block.
+    unsigned pushLogCount;
+    unsigned pushLogCapacity;
+    BBBlock *block;      // Position of the renamed instruction.
+    unsigned instruction;
+    bool failed;
+} SSABuilder;
+
+static SSAValue *ssa_new_value(SSAForm *ssa, SSAValueType type, unsigned variable, BBBlock *block) {
+    if (!tf_reserve((void **) &ssa->values, &ssa->valuesCapacity, ssa->valuesCount, sizeof(SSAValue *))) {
+        return NULL;
+    }
+
+    SSAValue *value = calloc(1, sizeof(SSAValue));
+    if (value == NULL) {
+        return NULL;
+    }
+
+    value->id = ssa->valuesCount;
+    value->type = type;
+    value->variable = variable;
+    value->block = block;
+    ssa->values[ssa->valuesCount++] = value;
+    return value;
+}
+
+static bool ssa_add_user(SSAValue *value, BBBlock *block, unsigned instruction, SSAValue *phi) {
+    // An instruction reading the value more than once is recorded only once
+    if (value->usersCount > 0) {
+        SSAUser *last = &value->users[value->usersCount - 1];
+        if (last->block == block && last->instruction == instruction && last->phi == phi) {
+            return true;
+        }
+    }
+
+    if (!tf_reserve((void **) &value->users, &value->usersCapacity, value->usersCount, sizeof(SSAUser))) {
+        return false;
+    }
+    value->users[value->usersCount++] = (SSAUser) {.block = block, .instruction = instruction, .phi = phi};
+    return true;
+}
+
+static bool ssa_push(SSABuilder *builder, SSAValue *value) {
+    SSAStack *stack = &builder->stacks[value->variable];
+    if (!tf_reserve((void **) &stack->values, &stack->capacity, stack->count, sizeof(SSAValue *))
+        || !tf_reserve((void **) &builder->pushLog, &builder->pushLogCapacity, builder->pushLogCount,
+                        sizeof(unsigned))) {
+        return false;
+    }
+    stack->values[stack->count++] = value;
+    builder->pushLog[builder->pushLogCount++] = value->variable;
+    return true;
+}
+
+static SSAValue *ssa_top(SSABuilder *builder, unsigned variable) {
+    SSAStack *stack = &builder->stacks[variable];
+    return stack->values[stack->count - 1];
+}
+
+// Computes the dominance frontier of each reachable block as a set of block ids.
+static Bitset *ssa_dominance_frontiers(const BBGraph *graph) {
+    Bitset *frontiers = calloc(graph->blocksCount, sizeof(Bitset));
+    if (frontiers == NULL) {
+        return NULL;
+    }
+    for (unsigned i = 0; i < graph->blocksCount; i++) {
+        if (!bs_init(&frontiers[i], graph->blocksCount)) {
+            for (unsigned j = 0; j < i; j++) {
+                bs_free(&frontiers[j]);
+            }
+            free(frontiers);
+            return NULL;
+        }
+    }
+
+    // A join block is in the frontier of the blocks on the paths from its predecessors up to its immediate dominator
+    for (unsigned i = 0; i < graph->reachableCount; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        if (block->predecessorsCount < 2) {
+            continue;
+        }
+        for (unsigned p = 0; p < block->predecessorsCount; p++) {
+            BBBlock *runner = block->predecessors[p];
+            if (!bb_is_reachable(runner)) {
+                continue;
+            }
+            while (runner != block->idom) {
+                bs_set(&frontiers[runner->id], block->id);
+                runner = runner->idom;
+            }
+        }
+    }
+
+    return frontiers;
+}
+
+static void ssa_free_sets(Bitset *sets, unsigned count) {
+    if (sets == NULL) {
+        return;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        bs_free(&sets[i]);
+    }
+    free(sets);
+}
+
+static bool ssa_add_phi(SSAForm *ssa, BBBlock *block, unsigned variable, unsigned *phisCapacities) {
+    SSAValue *phi = ssa_new_value(ssa, SSA_VALUE_PHI, variable, block);
+    if (phi == NULL) {
+        return false;
+    }
+    phi->operands = calloc(block->predecessorsCount, sizeof(SSAValue *));
+    if (phi->operands == NULL || !tf_reserve((void **) &ssa->phis[block->id], &phisCapacities[block->id],
+                                              ssa->phisCounts[block->id], sizeof(SSAValue *))) {
+        return false;
+    }
+    ssa->phis[block->id][ssa->phisCounts[block->id]++] = phi;
+    return true;
+}
+
+// Places the phis of all variables at the iterated dominance frontiers of their assignments, where they're live.
+static bool ssa_place_phis(SSAForm *ssa) {
+    BBGraph *graph = ssa->graph;
+    DFVariables *variables = &ssa->variables;
+    bool success = false;
+
+    DFResult liveness = {.in = NULL, .out = NULL};
+    Bitset *frontiers = ssa_dominance_frontiers(graph);
+    Bitset *assigned = calloc(graph->blocksCount, sizeof(Bitset));
+    unsigned *phisCapacities = calloc(graph->blocksCount, sizeof(unsigned));
+    BBBlock **worklist = malloc(graph->blocksCount * sizeof(BBBlock *));
+    Bitset queued, hasPhi;
+    bs_init(&queued, graph->blocksCount);
+    bs_init(&hasPhi, graph->blocksCount);
+    if (frontiers == NULL || assigned == NULL || phisCapacities == NULL || worklist == NULL || queued.words == NULL
+        || hasPhi.words == NULL || !df_liveness(graph, variables, &liveness)) {
+        goto cleanup;
+    }
+
+    // Variables assigned in each block
+    for (unsigned i = 0; i < graph->blocksCount; i++) {
+        if (!bs_init(&assigned[i], variables->count)) {
+            goto cleanup;
+        }
+    }
+    for (unsigned i = 0; i < graph->reachableCount; i++) {
+        BBBlock *block = graph->reversePostorder[i];
+        for (unsigned j = 0; j < block->instructionsCount; j++) {
+            ASTNode *ast = *block->instructions[j].ast;
+            DFTarget target;
+            for (unsigned t = 0; t < df_targets_count(ast); t++) {
+                if (df_get_target(ast, t, &target)) {
+                    unsigned index = df_variable_index(variables, target.target->data[0].symbolTableItemPtr);
+                    bs_set(&assigned[block->id], index);
+                }
+            }
+        }
+    }
+
+    for (unsigned v = 0; v < variables->count; v++) {
+        unsigned count = 0;
+        bs_reset(&queued);
+        bs_reset(&hasPhi);
+
+        // The entry block assigns the initial values
+        for (unsigned i = 0; i < graph->reachableCount; i++) {
+            BBBlock *block = graph->reversePostorder[i];
+            if (block == graph->entry || bs_test(&assigned[block->id], v)) {
+                worklist[count++] = block;
+                bs_set(&queued, block->id);
+            }
+        }
+
+        while (count > 0) {
+            BBBlock *block = worklist[--count];
+            Bitset *frontier = &frontiers[block->id];
+            for (unsigned j = bs_next(frontier, 0); j < frontier->size; j = bs_next(frontier, j + 1)) {
+                BBBlock *join = graph->blocks[j];
+                if (bs_test(&hasPhi, join->id) || !bs_test(&liveness.in[join->id], v)) {
+                    continue;
+                }
+
+                if (!ssa_add_phi(ssa, join, v, phisCapacities)) {
+                    goto cleanup;
+                }
+                bs_set(&hasPhi, join->id);
+                // The phi is a new assignment
+                if (!bs_test(&queued, join->id)) {
+                    bs_set(&queued, join->id);
+                    worklist[count++] = join;
+                }
+            }
+        }
+    }
+    success = true;
+
+    cleanup:
+    df_free_result(&liveness);
+    ssa_free_sets(frontiers, graph->blocksCount);
+    ssa_free_sets(assigned, assigned == NULL ? 0 : graph->blocksCount);
+    free(phisCapacities);
+    free(worklist);
+    bs_free(&queued);
+    bs_free(&hasPhi);
+    return success;
+}
+
+static void ssa_rename_use(ASTNode **slot, STSymbol *symbol, void *data) {
+    SSABuilder *builder = data;
+    SSAForm *ssa = builder->ssa;
+    unsigned variable = df_variable_index(&ssa->variables, symbol);
+    if (builder->failed || variable == DF_NO_VARIABLE) {
+        return;
+    }
+
+    SSAValue *value = ssa_top(builder, variable);
+    if (!tf_reserve((void **) &ssa->uses, &ssa->usesCapacity, ssa->usesCount, sizeof(SSAUse))
+        || !ssa_add_user(value, builder->block, builder->instruction, NULL)
+        || (slot != NULL && !im_insert(&ssa->nodeValues, *slot, value->id))) {
+        builder->failed = true;
+        return;
+    }
+    ssa->uses[ssa->usesCount++] = (SSAUse) {.slot = slot, .value = value, .block = builder->block,
+                                            .instruction = builder->instruction};
+}
+
+// Renames the variables in the block and in the blocks it dominates, walking the dominator tree.
+static void ssa_rename(SSABuilder *builder, BBBlock *block) {
+    SSAForm *ssa = builder->ssa;
+    unsigned savedLog = builder->pushLogCount;
+
+    for (unsigned i = 0; i < ssa->phisCounts[block->id] && !builder->failed; i++) {
+        builder->failed = !ssa_push(builder, ssa->phis[block->id][i]);
+    }
+
+    for (unsigned j = 0; j < block->instructionsCount && !builder->failed; j++) {
+        BBInstruction *instruction = &block->instructions[j];
+        builder->block = block;
+        builder->instruction = j;
+
+        // The right side is evaluated before the targets are assigned
+        df_visit_uses(&ssa->variables, instruction, ssa_rename_use, builder);
+
+        ASTNode *ast = *instruction->ast;
+        DFTarget target;
+        for (unsigned t = 0; t < df_targets_count(ast) && !builder->failed; t++) {
+            if (!df_get_target(ast, t, &target)) {
+                continue;
+            }
+            unsigned variable = df_variable_index(&ssa->variables, target.target->data[0].symbolTableItemPtr);
+            SSAValue *value = ssa_new_value(ssa, SSA_VALUE_DEFINITION, variable, block);
+            if (value == NULL || !im_insert(&ssa->nodeValues, target.target, value->id) || !ssa_push(builder, value)) {
+                builder->failed = true;
+                break;
+            }
+            value->instruction = j;
+            value->definition = target;
+        }
+    }
+
+    // Fill in the operands of the successors' phis coming from this block
+    for (unsigned s = 0; s < block->successorsCount && !builder->failed; s++) {
+        BBBlock *succ = block->successors[s];
+        for (unsigned p = 0; p < succ->predecessorsCount; p++) {
+            if (succ->predecessors[p] != block) {
+                continue;
+            }
+            for (unsigned i = 0; i < ssa->phisCounts[succ->id] && !builder->failed; i++) {
+                SSAValue *phi = ssa->phis[succ->id][i];
+                SSAValue *value = ssa_top(builder, phi->variable);
+                phi->operands[p] = value;
+                builder->failed = !ssa_add_user(value, succ, 0, phi);
+            }
+        }
+    }
+
+    for (BBBlock *child = block->domChild; child != NULL && !builder->failed; child = child->domSibling) {
+        ssa_rename(builder, child);
+    }
+
+    while (builder->pushLogCount > savedLog) {
+        builder->stacks[builder->pushLog[--builder->pushLogCount]].count--;
+    }
+}
+
+SSAForm *ssa_build(BBGraph *graph) {
+    SSAForm *ssa = calloc(1, sizeof(SSAForm));
+    if (ssa == NULL) {
+        stderr_message("ssa", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return NULL;
+    }
+    ssa->graph = graph;
+    im_init(&ssa->nodeValues);
+
+    if (!df_collect_variables(graph, &ssa->variables)) {
+        free(ssa);
+        return NULL;
+    }
+
+    SSABuilder builder = {.ssa = ssa, .failed = false};
+    ssa->phis = calloc(graph->blocksCount, sizeof(SSAValue **));
+    ssa->phisCounts = calloc(graph->blocksCount, sizeof(unsigned));
+    builder.stacks = calloc(ssa->variables.count + 1, sizeof(SSAStack));
+    builder.failed = ssa->phis == NULL || ssa->phisCounts == NULL || builder.stacks == NULL || !ssa_place_phis(ssa);
+
+    // Every variable has a value when the function is entered (an argument, a zero return value or an undefined one)
+    for (unsigned v = 0; v < ssa->variables.count && !builder.failed; v++) {
+        SSAValue *value = ssa_new_value(ssa, SSA_VALUE_ENTRY, v, graph->entry);
+        builder.failed = value == NULL || !ssa_push(&builder, value);
+    }
+    builder.pushLogCount = 0;
+
+    if (!builder.failed) {
+        ssa_rename(&builder, graph->entry);
+    }
+
+    if (builder.stacks != NULL) {
+        for (unsigned v = 0; v < ssa->variables.count; v++) {
+            free(builder.stacks[v].values);
+        }
+    }
+    free(builder.stacks);
+    free(builder.pushLog);
+
+    if (builder.failed) {
+        ssa_free(ssa);
+        stderr_message("ssa", ERROR, COMPILER_RESULT_ERROR_INTERNAL, "Out of memory\n");
+        return NULL;
+    }
+    return ssa;
+}
+
+void ssa_free(SSAForm *ssa) {
+    if (ssa == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < ssa->valuesCount; i++) {
+        free(ssa->values[i]->operands);
+        free(ssa->values[i]->users);
+        free(ssa->values[i]);
+    }
+    if (ssa->phis != NULL) {
+        for (unsigned i = 0; i < ssa->graph->blocksCount; i++) {
+            free(ssa->phis[i]);
+        }
+    }
+    free(ssa->phis);
+    free(ssa->phisCounts);
+    free(ssa->values);
+    free(ssa->uses);
+    im_free(&ssa->nodeValues);
+    df_free_variables(&ssa->variables);
+    free(ssa);
+}
+
+SSAValue *ssa_value_of(const SSAForm *ssa, const ASTNode *id) {
+    unsigned index;
+    return im_find(&ssa->nodeValues, id, &index) ? ssa->values[index] : NULL;
+}
+
+STSymbol *ssa_symbol(const SSAForm *ssa, const SSAValue *value) {
+    return ssa->variables.symbols[value->variable];
+}
+
+bool ssa_is_invariant(const SSAForm *ssa, const ASTNode *ast, const BBLoop *loop) {
+    if (ast == NULL) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!ssa_is_invariant(ssa, ast->data[i].astPtr, loop)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (ast->actionType == AST_ID) {
+        SSAValue *value = ssa_value_of(ssa, ast);
+        if (value == NULL || bb_loop_contains(loop, value->block)) {
+            return false;
+        }
+        return value->type != SSA_VALUE_DEFINITION
+               || value->block->instructions[value->instruction].statement != loop->statement;
+    }
+    if (ast->actionType == AST_FUNC_CALL) {
+        return ssa_is_invariant(ssa, ast->right, loop);
+    }
+    return ssa_is_invariant(ssa, ast->left, loop) && ssa_is_invariant(ssa, ast->right, loop);
+}
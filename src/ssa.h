@@ -0,0 +1,96 @@
+/** @file ssa.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions and data types for the static single assignment form of functions.
+ */
+
+#ifndef _SSA_H
+#define _SSA_H 1
+
+#include "basic_blocks.h"
+#include "dataflow.h"
+#include "index_map.h"
+
+typedef enum ssa_value_type {
+    SSA_VALUE_ENTRY,      // The value the variable has when the function is entered.
+    SSA_VALUE_DEFINITION, // A value assigned by an instruction.
+    SSA_VALUE_PHI         // A value merged from the predecessors of a block.
+} SSAValueType;
+
+struct ssa_value;
+
+// An instruction or a phi reading a value.
+typedef struct ssa_user {
+    BBBlock *block;
+    unsigned instruction;   // Index of the instruction in the block (if phi is NULL).
+    struct ssa_value *phi;  // The phi reading the value, NULL if it's read by an instruction.
+} SSAUser;
+
+typedef struct ssa_value {
+    unsigned id;          // Index of the value in SSAForm.values.
+    SSAValueType type;
+    unsigned variable;    // Number of the variable in SSAForm.variables.
+    BBBlock *block;       // The block defining the value (the entry block for entry values).
+
+    unsigned instruction; // Index of the defining instruction in the block (definitions only).
+    DFTarget definition;  // The assignment target and the assigned expression (definitions only).
+
+    struct ssa_value **operands; // One operand for each predecessor of the block, in the same order (phis only).
+
+    SSAUser *users;
+    unsigned usersCount;
+    unsigned usersCapacity;
+} SSAValue;
+
+// A read of a variable in an instruction.
+typedef struct ssa_use {
+    ASTNode **slot;    // The slot holding the AST_ID node, NULL for the implicit reads by empty return statements.
+    SSAValue *value;   // The definition reaching the read.
+    BBBlock *block;
+    unsigned instruction;
+} SSAUse;
+
+typedef struct ssa_form {
+    BBGraph *graph;
+    DFVariables variables;
+
+    SSAValue **values;
+    unsigned valuesCount;
+    unsigned valuesCapacity;
+
+    SSAUse *uses; // Reads in the reachable blocks, in the order of the blocks and their instructions.
+    unsigned usesCount;
+    unsigned usesCapacity;
+
+    SSAValue ***phis;     // Phis of each block, indexed by block ids.
+    unsigned *phisCounts;
+
+    IndexMap nodeValues;  // SSA values of the AST_ID nodes (both reads and assignment targets).
+} SSAForm;
+
+/* Builds the pruned SSA form of the graph, without changing the ASTs:
+ *  - Each assignment of a variable defines a new value, each variable also has a value when the function is entered.
+ *  - Phis are placed at the iterated dominance frontiers of the assignments (IF joins and FOR headers),
+ *    but only where the variable is live.
+ *  - Each read of a variable is linked to the single value reaching it, each value keeps the list of its users.
+ * Unreachable blocks are left out. Returns NULL if memory couldn't be allocated.
+ */
+SSAForm *ssa_build(BBGraph *graph);
+
+// Frees the SSA form. The graph is not affected.
+void ssa_free(SSAForm *ssa);
+
+// Returns the value of an AST_ID node: the reaching definition for a read, the defined value for an assignment
+// target. NULL if the node isn't a variable access in a reachable block.
+SSAValue *ssa_value_of(const SSAForm *ssa, const ASTNode *id);
+
+// Returns the symbol of the value's variable.
+STSymbol *ssa_symbol(const SSAForm *ssa, const SSAValue *value);
+
+// Checks whether the values of all variables read by the AST are defined outside the loop, so the AST evaluates to
+// the same value in each iteration. The values defined by the FOR definition of the loop aren't invariant either,
+// as they're assigned after any code placed before the loop.
+bool ssa_is_invariant(const SSAForm *ssa, const ASTNode *ast, const BBLoop *loop);
+
+#endif // _SSA_H
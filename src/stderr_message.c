@@ -12,11 +12,21 @@
 
 #include "stderr_message.h"
 #include "compiler.h"
+#include "thread_pool.h"
 
 void stderr_message(const char *module, MessageType message_type, CompilerResult compiler_result_arg,
                     const char *fmt, ...) {
     set_compiler_result(compiler_result_arg);
 
+    va_list arguments;
+    va_start(arguments, fmt);
+
+    // Messages reported by tasks running in parallel are written out later in a deterministic order
+    if (thread_pool_defer_message(module, message_type, fmt, arguments)) {
+        va_end(arguments);
+        return;
+    }
+
     fprintf(stderr, "%s: ", module);
     if (message_type == ERROR) {
         fprintf(stderr, "error: ");
@@ -24,13 +34,15 @@ void stderr_message(const char *module, MessageType message_type, CompilerResult
         fprintf(stderr, "warning: ");
     }
 
-    va_list arguments;
-    va_start(arguments, fmt);
     vfprintf(stderr, fmt, arguments);
     va_end(arguments);
 }
 
 void set_compiler_result(CompilerResult compiler_result_arg) {
+    if (thread_pool_defer_result(compiler_result_arg)) {
+        return;
+    }
+
     if (compiler_result == COMPILER_RESULT_SUCCESS) {
         compiler_result = compiler_result_arg;
     }
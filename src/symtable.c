@@ -101,6 +101,7 @@ STItem *symtable_add(SymbolTable *table, const char *key, STType type) {
         new->data.data.func_data.ret_types = NULL;
         new->data.data.func_data.params = NULL;
         new->data.data.func_data.defined = false;
+        new->data.data.func_data.cf_function = NULL;
     } else {
         new->data.data.var_data.type = CF_UNKNOWN;
     }
@@ -128,29 +129,18 @@ void symtable_free(SymbolTable *table) {
 
             if (tmp->data.type == ST_SYMBOL_FUNC) {
 
-                STParam *param = tmp->data.data.func_data.params;
-                STParam *param_to_delete = NULL;
-                while (param != NULL) {
-                    param_to_delete = param;
-                    param = param->next;
-                    free(param_to_delete->id);
-                    param_to_delete->id = NULL;
-
-                    free(param_to_delete);
-                    param_to_delete = NULL;
+                STFunctionData *func_data = &tmp->data.data.func_data;
+                for (unsigned j = 0; j < func_data->params_count; j++) {
+                    free(func_data->params[j].id);
                 }
+                free(func_data->params);
+                func_data->params = NULL;
 
-                STParam *ret_type = tmp->data.data.func_data.ret_types;
-                STParam *ret_type_to_delete = NULL;
-                while (ret_type != NULL) {
-                    ret_type_to_delete = ret_type;
-                    ret_type = ret_type->next;
-                    free(ret_type_to_delete->id);
-                    ret_type_to_delete->id = NULL;
-
-                    free(ret_type_to_delete);
-                    ret_type_to_delete = NULL;
+                for (unsigned j = 0; j < func_data->ret_types_count; j++) {
+                    free(func_data->ret_types[j].id);
                 }
+                free(func_data->ret_types);
+                func_data->ret_types = NULL;
             }
 
             free(tmp);
@@ -163,21 +153,30 @@ void symtable_free(SymbolTable *table) {
     table = NULL;
 }
 
-bool symtable_add_param(STItem *item, const char *id, STDataType type) {
-    STParam *new = (STParam *) malloc(sizeof(STParam));
-    if (new == NULL) {
-        stderr_message("symbol_table", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
-                       "Malloc for a new parameter failed.\n");
-        return false;
+/** @brief Appends a new param to an array of params, growing it by ST_PARAMS_CHUNK items when it's full.
+ *
+ * @param array Pointer to the array to append to.
+ * @param count Pointer to the number of items in the array, incremented on success.
+ * @param id Id of the param to be added (can be NULL).
+ * @param type Type of the param to be added.
+ * @return True if the param was added successfully, false otherwise.
+ */
+static bool param_array_append(STParam **array, unsigned *count, const char *id, STDataType type) {
+    if (*count % ST_PARAMS_CHUNK == 0) {
+        STParam *new_array = (STParam *) realloc(*array, sizeof(STParam) * (*count + ST_PARAMS_CHUNK));
+        if (new_array == NULL) {
+            stderr_message("symbol_table", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
+                           "Malloc for a new parameter failed.\n");
+            return false;
+        }
+        *array = new_array;
     }
 
-    new->next = NULL;
+    STParam *new = &(*array)[*count];
     new->type = type;
     if (id != NULL) {
         new->id = (char *) malloc(sizeof(char) * (strlen(id) + 1));
         if (new->id == NULL) {
-            free(new);
-            new = NULL;
             return false;
         }
         strcpy(new->id, id);
@@ -185,55 +184,17 @@ bool symtable_add_param(STItem *item, const char *id, STDataType type) {
         new->id = NULL;
     }
 
-    if (item->data.data.func_data.params == NULL) {
-        item->data.data.func_data.params = new;
-    } else {
-        STParam *tmp = item->data.data.func_data.params;
-        while (tmp->next != NULL) {
-            tmp = tmp->next;
-        }
-        tmp->next = new;
-    }
-
-    item->data.data.func_data.params_count++;
+    (*count)++;
     return true;
 }
 
-bool symtable_add_ret_type(STItem *item, const char *id, STDataType type) {
-    STParam *new = (STParam *) malloc(sizeof(STParam));
-    if (new == NULL) {
-        stderr_message("symbol_table", ERROR, COMPILER_RESULT_ERROR_INTERNAL,
-                       "Malloc for a new parameter failed.\n");
-        return false;
-    }
-
-    new->next = NULL;
-    new->type = type;
-
-    if (id != NULL) {
-        new->id = (char *) malloc(sizeof(char) * (strlen(id) + 1));
-        if (new->id == NULL) {
-            free(new);
-            new = NULL;
-            return false;
-        }
-        strcpy(new->id, id);
-    } else {
-        new->id = NULL;
-    }
-
-    if (item->data.data.func_data.ret_types == NULL) {
-        item->data.data.func_data.ret_types = new;
-    } else {
-        STParam *tmp = item->data.data.func_data.ret_types;
-        while (tmp->next != NULL) {
-            tmp = tmp->next;
-        }
-        tmp->next = new;
-    }
+bool symtable_add_param(STItem *item, const char *id, STDataType type) {
+    return param_array_append(&item->data.data.func_data.params, &item->data.data.func_data.params_count, id, type);
+}
 
-    item->data.data.func_data.ret_types_count++;
-    return true;
+bool symtable_add_ret_type(STItem *item, const char *id, STDataType type) {
+    return param_array_append(&item->data.data.func_data.ret_types, &item->data.data.func_data.ret_types_count, id,
+                              type);
 }
 
 STItem *symtable_get_first_item(SymbolTable *table) {
@@ -261,3 +222,11 @@ STItem *symtable_get_next_item(SymbolTable *table, STItem *current_item) {
 
     return NULL;
 }
+
+void symtable_symbol_ref(STSymbol *symbol) {
+    __atomic_add_fetch(&symbol->reference_counter, 1, __ATOMIC_RELAXED);
+}
+
+void symtable_symbol_unref(STSymbol *symbol) {
+    __atomic_sub_fetch(&symbol->reference_counter, 1, __ATOMIC_RELAXED);
+}
@@ -14,6 +14,9 @@
 #include <string.h>
 #include <stdbool.h>
 
+/** Number of items the param and return type arrays are grown by. */
+#define ST_PARAMS_CHUNK 4
+
 typedef enum cfgraph_data_type {
     CF_UNKNOWN = 0,
     CF_UNKNOWN_UNINFERRABLE,
@@ -35,16 +38,18 @@ typedef enum st_type {
 typedef struct st_param {
     char *id;         /**< Id of the parameter (can be NULL if it is unnamed return type). */
     STDataType type;  /**< Type of the parameter. */
-    struct st_param *next;
 } STParam;
 
+struct cfgraph_function;
+
 /** A structure representing data for a symbol of type function. */
 typedef struct st_function_data {
     unsigned params_count;       /**< Number of params. */
-    STParam *params;             /**< Pointer to first param. */
+    STParam *params;             /**< Array of params (params_count items). */
     unsigned ret_types_count;    /**< Number of return types. */
-    STParam *ret_types;          /**< Pointer to first return type. */
+    STParam *ret_types;          /**< Array of return types (ret_types_count items). */
     bool defined;                /**< Whether the function has been defined. */
+    struct cfgraph_function *cf_function; /**< The function in the control flow graph (NULL for built-ins). */
 } STFunctionData;
 
 /** A structure representing data for a symbol of type variable. */
@@ -159,4 +164,19 @@ STItem *symtable_get_first_item(SymbolTable *table);
  */
 STItem *symtable_get_next_item(SymbolTable *table, STItem *current_item);
 
+/**
+ * @brief Atomically increments the reference counter of the given symbol.
+ * @details Symbols of functions are shared by all functions, which may be optimised in parallel.
+ *
+ * @param symbol Symbol to increment the reference counter of.
+ */
+void symtable_symbol_ref(STSymbol *symbol);
+
+/**
+ * @brief Atomically decrements the reference counter of the given symbol.
+ *
+ * @param symbol Symbol to decrement the reference counter of.
+ */
+void symtable_symbol_unref(STSymbol *symbol);
+
 #endif
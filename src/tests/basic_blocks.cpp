@@ -0,0 +1,1062 @@
+/** @file basic_blocks.cpp
+ *
+ * IFJ20 compiler tests
+ *
+ * @brief Contains tests for the analyses of functions: basic blocks, dominator trees, loops, dataflow, SSA
+ *        constant propagation, value numbering, loop transformations, inlining, interprocedural constant
+ *        propagation, compile-time evaluation of calls and built-ins, dead store elimination, copy propagation,
+ *        coalescing of variables, value range analysis and reassociation.
+ */
+
+#define VERBOSE 0
+
+#include <iostream>
+#include "gtest/gtest.h"
+#include "stdin_mock_test.h"
+
+extern "C" {
+#include "parser.h"
+#include "control_flow.h"
+#include "basic_blocks.h"
+#include "dataflow.h"
+#include "ssa.h"
+#include "sccp.h"
+#include "gvn.h"
+#include "licm.h"
+#include "induction.h"
+#include "unroll.h"
+#include "unswitch.h"
+#include "inline.h"
+#include "ipcp.h"
+#include "ctfe.h"
+#include "dse.h"
+#include "copyprop.h"
+#include "range.h"
+#include "reassoc.h"
+}
+
+class BasicBlocksTest : public StdinMockingScannerTest {
+protected:
+    BBGraph *graph = nullptr;
+    SSAForm *ssa = nullptr;
+    SCCPResult sccp = {};
+
+    // Parses the program and lowers the specified function.
+    void Build(const std::string &inputStr, const char *function) {
+        buffer->sputn(inputStr.c_str(), inputStr.length());
+        buffer->sputc(EOF);
+
+        ASSERT_EQ(parser_parse(), COMPILER_RESULT_SUCCESS);
+        CFFunction *fun = cf_get_function(function, false);
+        ASSERT_NE(fun, nullptr);
+
+        graph = bb_build(fun);
+        ASSERT_NE(graph, nullptr);
+    }
+
+    // Returns the first reachable block (in reverse postorder) containing an instruction of the specified kind.
+    BBBlock *FindBlock(CFASTTarget target) {
+        for (unsigned i = 0; i < graph->reachableCount; i++) {
+            BBBlock *block = graph->reversePostorder[i];
+            for (unsigned j = 0; j < block->instructionsCount; j++) {
+                if (block->instructions[j].target == target) {
+                    return block;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Returns the first use of the variable with the specified name in the block.
+    SSAUse *FindUse(BBBlock *block, const char *name) {
+        for (unsigned i = 0; i < ssa->usesCount; i++) {
+            SSAUse *use = &ssa->uses[i];
+            if (use->block == block && std::string(ssa_symbol(ssa, use->value)->identifier) == name) {
+                return use;
+            }
+        }
+        return nullptr;
+    }
+
+    // Returns the phi of the variable with the specified name in the block.
+    SSAValue *FindPhi(BBBlock *block, const char *name) {
+        for (unsigned i = 0; i < ssa->phisCounts[block->id]; i++) {
+            SSAValue *phi = ssa->phis[block->id][i];
+            if (std::string(ssa_symbol(ssa, phi)->identifier) == name) {
+                return phi;
+            }
+        }
+        return nullptr;
+    }
+
+    void TearDown() override {
+        sccp_free(&sccp);
+        ssa_free(ssa);
+        bb_free(graph);
+        cf_clean_all();
+        StdinMockingScannerTest::TearDown();
+    }
+};
+
+TEST_F(BasicBlocksTest, StraightLine) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a := 1\n"
+          "    a = a + 1\n"
+          "    print(a)\n"
+          "}\n", "main");
+
+    ASSERT_EQ(graph->reachableCount, 2u);
+    EXPECT_EQ(graph->reversePostorder[0], graph->entry);
+    EXPECT_EQ(graph->reversePostorder[1], graph->exit);
+    EXPECT_EQ(graph->entry->instructionsCount, 3u);
+    EXPECT_EQ(graph->exit->idom, graph->entry);
+    EXPECT_TRUE(bb_dominates(graph->entry, graph->exit));
+    EXPECT_FALSE(bb_dominates(graph->exit, graph->entry));
+    EXPECT_EQ(graph->loopsCount, 0u);
+}
+
+TEST_F(BasicBlocksTest, IfElseDiamond) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a := 3\n"
+          "    if a > 0 {\n"
+          "        print(1)\n"
+          "    } else {\n"
+          "        print(2)\n"
+          "    }\n"
+          "    print(a)\n"
+          "}\n", "main");
+
+    BBBlock *cond = FindBlock(CF_IF_CONDITIONAL);
+    ASSERT_NE(cond, nullptr);
+    ASSERT_EQ(cond->successorsCount, 2u);
+
+    BBBlock *thenBlock = cond->successors[0];
+    BBBlock *elseBlock = cond->successors[1];
+    ASSERT_EQ(thenBlock->successorsCount, 1u);
+    BBBlock *join = thenBlock->successors[0];
+    EXPECT_EQ(elseBlock->successors[0], join);
+    EXPECT_EQ(join->predecessorsCount, 2u);
+
+    EXPECT_EQ(join->idom, cond);
+    EXPECT_EQ(thenBlock->idom, cond);
+    EXPECT_FALSE(bb_dominates(thenBlock, join));
+    EXPECT_FALSE(bb_dominates(elseBlock, join));
+    EXPECT_TRUE(bb_dominates(cond, join));
+}
+
+TEST_F(BasicBlocksTest, NestedLoops) {
+    Build("package main\n"
+          "func main() {\n"
+          "    s := 0\n"
+          "    for i := 0; i < 10; i += 1 {\n"
+          "        for j := 0; j < i; j += 1 {\n"
+          "            s = s + j\n"
+          "        }\n"
+          "        if s > 100 {\n"
+          "            s = 0\n"
+          "        }\n"
+          "    }\n"
+          "    print(s)\n"
+          "}\n", "main");
+
+    ASSERT_EQ(graph->loopsCount, 2u);
+    BBLoop *outer = graph->loops[0];
+    BBLoop *inner = graph->loops[1];
+    EXPECT_EQ(outer->depth, 1u);
+    EXPECT_EQ(outer->parent, nullptr);
+    EXPECT_EQ(inner->depth, 2u);
+    EXPECT_EQ(inner->parent, outer);
+
+    ASSERT_NE(outer->statement, nullptr);
+    EXPECT_EQ(outer->statement->statementType, CF_FOR);
+    EXPECT_EQ(bb_find_loop(graph, outer->statement), outer);
+    EXPECT_EQ(bb_find_loop(graph, inner->statement), inner);
+
+    // The definitions end the preheaders, which lead to the headers only
+    ASSERT_NE(outer->preheader, nullptr);
+    ASSERT_NE(inner->preheader, nullptr);
+    EXPECT_EQ(outer->preheader->instructions[outer->preheader->instructionsCount - 1].target, CF_FOR_DEFINITION);
+    EXPECT_EQ(inner->preheader->loop, outer);
+
+    BBBlock *innerBody = inner->header->successors[0];
+    ASSERT_EQ(innerBody->instructionsCount, 2u);
+    EXPECT_EQ(innerBody->instructions[1].target, CF_FOR_AFTERTHOUGHT);
+    EXPECT_EQ(innerBody->successors[0], inner->header);
+    EXPECT_EQ(innerBody->loop, inner);
+    EXPECT_TRUE(bb_loop_contains(outer, innerBody));
+    EXPECT_TRUE(bb_dominates(inner->header, innerBody));
+    EXPECT_TRUE(bb_dominates(outer->header, inner->header));
+
+    BBBlock *ifBlock = FindBlock(CF_IF_CONDITIONAL);
+    ASSERT_NE(ifBlock, nullptr);
+    EXPECT_EQ(ifBlock->loop, outer);
+    EXPECT_FALSE(bb_loop_contains(inner, ifBlock));
+    EXPECT_EQ(graph->exit->loop, nullptr);
+}
+
+TEST_F(BasicBlocksTest, CodeAfterReturn) {
+    Build("package main\n"
+          "func foo(a int) int {\n"
+          "    if a > 0 {\n"
+          "        return 1\n"
+          "        print(a)\n"
+          "    }\n"
+          "    return 0\n"
+          "}\n"
+          "func main() {\n"
+          "    print(foo(1))\n"
+          "}\n", "foo");
+
+    EXPECT_EQ(graph->exit->predecessorsCount, 3u);
+
+    bool unreachableCode = false;
+    for (unsigned i = 0; i < graph->blocksCount; i++) {
+        BBBlock *block = graph->blocks[i];
+        if (!bb_is_reachable(block) && block->instructionsCount > 0) {
+            unreachableCode = true;
+            EXPECT_EQ(block->idom, nullptr);
+            EXPECT_FALSE(bb_dominates(graph->entry, block));
+        }
+    }
+    EXPECT_TRUE(unreachableCode);
+
+    BBBlock *ret = FindBlock(CF_RETURN_LIST);
+    ASSERT_NE(ret, nullptr);
+    EXPECT_EQ(ret->successors[0], graph->exit);
+}
+
+TEST(Bitset, Operations) {
+    Bitset a, b;
+    ASSERT_TRUE(bs_init(&a, 130));
+    ASSERT_TRUE(bs_init(&b, 130));
+
+    bs_set(&a, 3);
+    bs_set(&a, 64);
+    bs_set(&a, 129);
+    EXPECT_TRUE(bs_test(&a, 64));
+    EXPECT_FALSE(bs_test(&a, 65));
+
+    std::vector<unsigned> elements;
+    for (unsigned i = bs_next(&a, 0); i < a.size; i = bs_next(&a, i + 1)) {
+        elements.push_back(i);
+    }
+    EXPECT_EQ(elements, std::vector<unsigned>({3, 64, 129}));
+
+    bs_set(&b, 64);
+    EXPECT_TRUE(bs_union(&b, &a));
+    EXPECT_FALSE(bs_union(&b, &a));
+    EXPECT_TRUE(bs_equals(&a, &b));
+
+    bs_fill(&b);
+    EXPECT_EQ(bs_next(&b, 0), 0u);
+    EXPECT_FALSE(bs_intersect(&b, &b));
+    bs_difference(&b, &a);
+    EXPECT_FALSE(bs_test(&b, 64));
+    EXPECT_TRUE(bs_test(&b, 128));
+    EXPECT_TRUE(bs_intersect(&b, &a));
+    EXPECT_EQ(bs_next(&b, 0), b.size);
+
+    bs_free(&a);
+    bs_free(&b);
+}
+
+TEST_F(BasicBlocksTest, Liveness) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a := 1\n"
+          "    b := 2\n"
+          "    for i := 0; i < 10; i += 1 {\n"
+          "        b = a + i\n"
+          "    }\n"
+          "    print(a)\n"
+          "}\n", "main");
+
+    DFVariables variables;
+    ASSERT_TRUE(df_collect_variables(graph, &variables));
+    ASSERT_EQ(variables.count, 3u);
+
+    DFResult liveness;
+    ASSERT_TRUE(df_liveness(graph, &variables, &liveness));
+
+    BBLoop *loop = graph->loops[0];
+    unsigned a = variables.count, b = variables.count, i = variables.count;
+    for (unsigned v = 0; v < variables.count; v++) {
+        std::string name = variables.symbols[v]->identifier;
+        (name == "a" ? a : name == "b" ? b : i) = v;
+    }
+
+    EXPECT_TRUE(bs_test(&liveness.in[loop->header->id], a));
+    EXPECT_TRUE(bs_test(&liveness.in[loop->header->id], i));
+    EXPECT_FALSE(bs_test(&liveness.in[loop->header->id], b));
+    EXPECT_FALSE(bs_test(&liveness.out[graph->entry->id], b));
+    EXPECT_FALSE(bs_test(&liveness.in[graph->exit->id], a));
+
+    df_free_result(&liveness);
+    df_free_variables(&variables);
+}
+
+TEST_F(BasicBlocksTest, SSALoopPhis) {
+    Build("package main\n"
+          "func main() {\n"
+          "    s := 0\n"
+          "    for i := 0; i < 10; i += 1 {\n"
+          "        s = s + i\n"
+          "    }\n"
+          "    print(s)\n"
+          "}\n", "main");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+
+    BBLoop *loop = graph->loops[0];
+    BBBlock *header = loop->header;
+    ASSERT_EQ(ssa->phisCounts[header->id], 2u);
+    SSAValue *phi = FindPhi(header, "s");
+    ASSERT_NE(phi, nullptr);
+    ASSERT_EQ(header->predecessorsCount, 2u);
+
+    // The operand from the preheader is the definition, the one from the latch is the assignment in the body
+    unsigned fromPreheader = header->predecessors[0] == loop->preheader ? 0 : 1;
+    SSAValue *initial = phi->operands[fromPreheader];
+    SSAValue *updated = phi->operands[1 - fromPreheader];
+    ASSERT_NE(initial, nullptr);
+    ASSERT_NE(updated, nullptr);
+    EXPECT_EQ(initial->type, SSA_VALUE_DEFINITION);
+    EXPECT_EQ(initial->definition.source->actionType, AST_CONST_INT);
+    EXPECT_EQ(updated->type, SSA_VALUE_DEFINITION);
+    EXPECT_EQ(updated->block->loop, loop);
+    EXPECT_EQ(updated->definition.source->actionType, AST_ADD);
+
+    // Both the read in the body and the read after the loop see the phi
+    SSAUse *bodyUse = FindUse(updated->block, "s");
+    ASSERT_NE(bodyUse, nullptr);
+    EXPECT_EQ(bodyUse->value, phi);
+    EXPECT_EQ(ssa_value_of(ssa, *bodyUse->slot), phi);
+    SSAUse *afterUse = FindUse(header->successors[1], "s");
+    ASSERT_NE(afterUse, nullptr);
+    EXPECT_EQ(afterUse->value, phi);
+    EXPECT_EQ(ssa_value_of(ssa, updated->definition.target), updated);
+
+    // The phi is read by the body, the code after the loop
+    EXPECT_EQ(phi->usersCount, 2u);
+}
+
+TEST_F(BasicBlocksTest, SSAPrunedJoin) {
+    Build("package main\n"
+          "func foo(c bool) (r int) {\n"
+          "    a := 1\n"
+          "    b := 2\n"
+          "    if c {\n"
+          "        a = 2\n"
+          "        b = 3\n"
+          "        r = b\n"
+          "    }\n"
+          "    print(a)\n"
+          "    return\n"
+          "}\n"
+          "func main() {\n"
+          "    x := foo(true)\n"
+          "    print(x)\n"
+          "}\n", "foo");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+
+    BBBlock *cond = FindBlock(CF_IF_CONDITIONAL);
+    ASSERT_NE(cond, nullptr);
+    BBBlock *join = cond->successors[1];
+    EXPECT_NE(FindPhi(join, "a"), nullptr);
+    EXPECT_NE(FindPhi(join, "r"), nullptr);
+    EXPECT_EQ(FindPhi(join, "b"), nullptr);
+
+    // The argument is read with its entry value, the named return value is read implicitly by the return
+    SSAUse *argumentUse = FindUse(cond, "c");
+    ASSERT_NE(argumentUse, nullptr);
+    EXPECT_EQ(argumentUse->value->type, SSA_VALUE_ENTRY);
+    SSAUse *returnUse = FindUse(join, "r");
+    ASSERT_NE(returnUse, nullptr);
+    EXPECT_EQ(returnUse->slot, nullptr);
+    EXPECT_EQ(returnUse->value, FindPhi(join, "r"));
+}
+
+TEST_F(BasicBlocksTest, SCCPLoopAndDeadBranch) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a := 1\n"
+          "    b := 0\n"
+          "    for i := 0; i < 10; i += 1 {\n"
+          "        b = b + a\n"
+          "        if a > 5 {\n"
+          "            a = 7\n"
+          "        }\n"
+          "    }\n"
+          "    print(a, b)\n"
+          "}\n", "main");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+    ASSERT_TRUE(sccp_run(ssa, &sccp));
+
+    // The only assignment in the loop is never executed, so a keeps its value through the loop
+    BBBlock *cond = FindBlock(CF_IF_CONDITIONAL);
+    ASSERT_NE(cond, nullptr);
+    EXPECT_TRUE(sccp_is_executable(&sccp, cond));
+    EXPECT_FALSE(sccp_is_executable(&sccp, cond->successors[0]));
+    EXPECT_TRUE(sccp_is_executable(&sccp, cond->successors[1]));
+
+    BBBlock *after = graph->loops[0]->header->successors[1];
+    EXPECT_TRUE(sccp_is_executable(&sccp, after));
+    SSAUse *aUse = FindUse(after, "a");
+    ASSERT_NE(aUse, nullptr);
+    SCCPValue a = sccp.values[aUse->value->id];
+    EXPECT_EQ(a.state, SCCP_CONSTANT);
+    EXPECT_EQ(a.type, AST_CONST_INT);
+    EXPECT_EQ(a.data.intConstantValue, 1);
+
+    SSAUse *bUse = FindUse(after, "b");
+    ASSERT_NE(bUse, nullptr);
+    EXPECT_EQ(sccp.values[bUse->value->id].state, SCCP_OVERDEFINED);
+}
+
+TEST_F(BasicBlocksTest, GVNReusesComputations) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(a int, b int, s string) int {\n"
+          "    x := a * b + 1\n"
+          "    y := b * a + 1\n"
+          "    for i := 0; i < len(s); i += 1 {\n"
+          "        x = x + len(s)\n"
+          "    }\n"
+          "    return x + y\n"
+          "}\n", "foo");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+
+    unsigned eliminated = 0;
+    ASSERT_TRUE(gvn_run(ssa, &eliminated));
+    EXPECT_EQ(eliminated, 2u);
+
+    // The first computation is moved into a temporary defined before its statement
+    CFStatement *first = graph->function->rootStatement;
+    ASSERT_EQ(first->statementType, CF_BASIC);
+    ASSERT_EQ(first->data.bodyAst->actionType, AST_DEFINE);
+    STSymbol *product = first->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    EXPECT_EQ(product->identifier[0], '$');
+    EXPECT_EQ(product->reference_counter, 2u);
+
+    // The length is computed once before the loop
+    CFStatement *length = first->followingStatement->followingStatement->followingStatement;
+    ASSERT_EQ(length->statementType, CF_BASIC);
+    ASSERT_EQ(length->data.bodyAst->actionType, AST_DEFINE);
+    EXPECT_EQ(length->data.bodyAst->right->data[0].astPtr->actionType, AST_FUNC_CALL);
+    ASSERT_NE(length->followingStatement, nullptr);
+    EXPECT_EQ(length->followingStatement->statementType, CF_FOR);
+    EXPECT_EQ(length->followingStatement->data.forData->conditionalAst->right->actionType, AST_ID);
+}
+
+TEST_F(BasicBlocksTest, LICMHoistsInvariants) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(a int, b int, n int) int {\n"
+          "    t := 0\n"
+          "    for i := 0; i < n; i += 1 {\n"
+          "        for j := 0; j < n; j += 1 {\n"
+          "            t = t + a * b + i\n"
+          "        }\n"
+          "        if i != b {\n"
+          "            t = t + a / b\n"
+          "        }\n"
+          "    }\n"
+          "    return t\n"
+          "}\n", "foo");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+
+    unsigned hoisted = 0;
+    ASSERT_TRUE(licm_run(ssa, &hoisted));
+    // The division may fail, it stays in the conditional body
+    EXPECT_EQ(hoisted, 1u);
+
+    // The product is moved before the outer loop it's invariant in
+    CFStatement *definition = graph->function->rootStatement->followingStatement;
+    ASSERT_EQ(definition->statementType, CF_BASIC);
+    ASSERT_EQ(definition->data.bodyAst->actionType, AST_DEFINE);
+    STSymbol *product = definition->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    EXPECT_EQ(product->identifier[0], '$');
+    EXPECT_EQ(definition->data.bodyAst->right->data[0].astPtr->actionType, AST_MULTIPLY);
+    ASSERT_NE(definition->followingStatement, nullptr);
+    EXPECT_EQ(definition->followingStatement->statementType, CF_FOR);
+}
+
+TEST_F(BasicBlocksTest, InductionReducesMultiplications) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(n int) int {\n"
+          "    t := 0\n"
+          "    for i := 0; i < 10; i += 1 {\n"
+          "        t = t + i * 4\n"
+          "    }\n"
+          "    return t\n"
+          "}\n", "foo");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+
+    unsigned reduced = 0;
+    ASSERT_TRUE(induction_run(ssa, &reduced));
+    EXPECT_EQ(reduced, 1u);
+
+    // The product starts at zero before the loop
+    CFStatement *definition = graph->function->rootStatement->followingStatement;
+    ASSERT_EQ(definition->statementType, CF_BASIC);
+    ASSERT_EQ(definition->data.bodyAst->actionType, AST_DEFINE);
+    STSymbol *product = definition->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    EXPECT_EQ(product->identifier[0], '$');
+    ASSERT_EQ(definition->data.bodyAst->right->data[0].astPtr->actionType, AST_CONST_INT);
+    EXPECT_EQ(definition->data.bodyAst->right->data[0].astPtr->data[0].intConstantValue, 0);
+
+    // The loop counts the product instead of i
+    CFStatement *loop = definition->followingStatement;
+    ASSERT_EQ(loop->statementType, CF_FOR);
+    EXPECT_EQ(loop->data.forData->definitionAst, nullptr);
+    EXPECT_EQ(loop->data.forData->afterthoughtAst, nullptr);
+    ASTNode *condition = loop->data.forData->conditionalAst;
+    EXPECT_EQ(condition->left->data[0].symbolTableItemPtr, product);
+    ASSERT_EQ(condition->right->actionType, AST_CONST_INT);
+    EXPECT_EQ(condition->right->data[0].intConstantValue, 40);
+
+    // The body ends with adding 4 to the product
+    CFStatement *update = loop->data.forData->bodyStatement;
+    while (update->followingStatement != nullptr) {
+        update = update->followingStatement;
+    }
+    ASSERT_EQ(update->statementType, CF_BASIC);
+    ASSERT_EQ(update->data.bodyAst->actionType, AST_ASSIGN);
+    EXPECT_EQ(update->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr, product);
+    ASTNode *step = update->data.bodyAst->right->data[0].astPtr;
+    ASSERT_EQ(step->actionType, AST_ADD);
+    EXPECT_EQ(step->right->data[0].intConstantValue, 4);
+}
+
+TEST_F(BasicBlocksTest, UnrollsConstantLoops) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(n int) int {\n"
+          "    t := n\n"
+          "    for i := 0; i < 3; i += 1 {\n"
+          "        x := i * 2\n"
+          "        t = t + x\n"
+          "    }\n"
+          "    for j := 0; j < 100; j += 1 {\n"
+          "        t = t + j\n"
+          "    }\n"
+          "    return t\n"
+          "}\n", "foo");
+
+    unsigned unrolled = 0;
+    ASSERT_TRUE(unroll_run(graph->function, 64, &unrolled));
+    EXPECT_EQ(unrolled, 2u);
+
+    // The first loop is replaced with three copies of its body, x is replaced with a temporary in each of them
+    CFStatement *stat = graph->function->rootStatement->followingStatement;
+    STSymbol *previous = nullptr;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(stat->statementType, CF_BASIC);
+        ASSERT_EQ(stat->data.bodyAst->actionType, AST_DEFINE);
+        STSymbol *temporary = stat->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+        EXPECT_EQ(temporary->identifier[0], '$');
+        EXPECT_NE(temporary, previous);
+        previous = temporary;
+
+        ASTNode *product = stat->data.bodyAst->right->data[0].astPtr;
+        ASSERT_EQ(product->left->actionType, AST_CONST_INT);
+        EXPECT_EQ(product->left->data[0].intConstantValue, i);
+        stat = stat->followingStatement->followingStatement;
+    }
+
+    // The second loop repeats its body four times, advancing j between the copies
+    ASSERT_EQ(stat->statementType, CF_FOR);
+    unsigned statements = 0;
+    for (CFStatement *body = stat->data.forData->bodyStatement; body != nullptr; body = body->followingStatement) {
+        statements += body->data.bodyAst != nullptr;
+    }
+    EXPECT_EQ(statements, 7u);
+    EXPECT_EQ(stat->followingStatement->statementType, CF_RETURN);
+}
+
+TEST_F(BasicBlocksTest, InlinesSmallFunctions) {
+    Build("package main\n"
+          "func main() {\n"
+          "    x := twice(3) + 1\n"
+          "    show(x)\n"
+          "    print(fact(4))\n"
+          "}\n"
+          "func twice(a int) (int) {\n"
+          "    return a * 2\n"
+          "}\n"
+          "func show(n int) {\n"
+          "    print(n)\n"
+          "}\n"
+          "func fact(n int) (int) {\n"
+          "    if n <= 1 {\n"
+          "        return 1\n"
+          "    }\n"
+          "    return n * fact(n - 1)\n"
+          "}\n", "main");
+
+    unsigned inlined = 0;
+    ASSERT_TRUE(inline_run(get_program(), 40, &inlined));
+    EXPECT_EQ(inlined, 2u);
+
+    // The argument is assigned to a temporary replacing the parameter, the returned value to another one
+    CFStatement *stat = graph->function->rootStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_DEFINE);
+    STSymbol *parameter = stat->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    EXPECT_EQ(parameter->identifier[0], '$');
+    EXPECT_EQ(stat->data.bodyAst->right->data[0].astPtr->data[0].intConstantValue, 3);
+
+    stat = stat->followingStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_ASSIGN);
+    STSymbol *result = stat->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    ASTNode *product = stat->data.bodyAst->right->data[0].astPtr;
+    ASSERT_EQ(product->actionType, AST_MULTIPLY);
+    EXPECT_EQ(product->left->data[0].symbolTableItemPtr, parameter);
+
+    stat = stat->followingStatement;
+    ASTNode *sum = stat->data.bodyAst->right->data[0].astPtr;
+    ASSERT_EQ(sum->actionType, AST_ADD);
+    EXPECT_EQ(sum->left->data[0].symbolTableItemPtr, result);
+
+    // The call statement is replaced with the body of the function
+    stat = stat->followingStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_DEFINE);
+    stat = stat->followingStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_FUNC_CALL);
+    EXPECT_STREQ(stat->data.bodyAst->left->data[0].symbolTableItemPtr->identifier, "print");
+
+    // Recursive functions are kept
+    stat = stat->followingStatement;
+    ASTNode *call = stat->data.bodyAst->right->data[0].astPtr;
+    ASSERT_EQ(call->actionType, AST_FUNC_CALL);
+    EXPECT_STREQ(call->left->data[0].symbolTableItemPtr->identifier, "fact");
+    EXPECT_EQ(stat->followingStatement, nullptr);
+}
+
+TEST_F(BasicBlocksTest, InlinesArgumentsInEvaluationOrder) {
+    Build("package main\n"
+          "func main() {\n"
+          "    x := sum(show(1), show(2))\n"
+          "    print(x)\n"
+          "}\n"
+          "func sum(a int, b int) (int) {\n"
+          "    return a + b\n"
+          "}\n"
+          "func show(n int) (int) {\n"
+          "    print(n)\n"
+          "    return n\n"
+          "}\n", "main");
+
+    unsigned inlined = 0;
+    ASSERT_TRUE(inline_run(get_program(), 40, &inlined));
+    EXPECT_EQ(inlined, 1u);
+
+    // The code generator evaluates the arguments of sum from the last one, so b is defined first
+    CFStatement *stat = graph->function->rootStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_DEFINE);
+    ASTNode *values = stat->data.bodyAst->right;
+    ASSERT_EQ(values->dataCount, 2u);
+    ASSERT_EQ(values->data[0].astPtr->actionType, AST_FUNC_CALL);
+    EXPECT_EQ(values->data[0].astPtr->right->data[0].astPtr->data[0].intConstantValue, 2);
+    EXPECT_EQ(values->data[1].astPtr->right->data[0].astPtr->data[0].intConstantValue, 1);
+}
+
+TEST_F(BasicBlocksTest, PropagatesConstantArguments) {
+    Build("package main\n"
+          "func main() {\n"
+          "    print(offset(1, 5), offset(2, 5))\n"
+          "    for i := 0; i < 3; i = i + 1 {\n"
+          "        print(mode(i, 0), mode(i, 1))\n"
+          "    }\n"
+          "    print(mode(7, 2))\n"
+          "}\n"
+          "func offset(a int, k int) (int) {\n"
+          "    return a + k\n"
+          "}\n"
+          "func mode(x int, m int) (int) {\n"
+          "    if m == 0 {\n"
+          "        return x\n"
+          "    }\n"
+          "    return x * m\n"
+          "}\n", "main");
+
+    CFProgram *program = get_program();
+    unsigned functionsCount = program->functionsCount;
+    unsigned propagated = 0;
+    unsigned cloned = 0;
+    ASSERT_TRUE(ipcp_run(program, 256, &propagated, &cloned));
+    EXPECT_EQ(propagated, 1u);
+    EXPECT_EQ(cloned, 1u);
+
+    // Both calls pass the same constant, which is assigned to the parameter
+    CFFunction *offset = cf_get_function("offset", false);
+    ASSERT_EQ(offset->rootStatement->data.bodyAst->actionType, AST_ASSIGN);
+    ASTNode *assignment = offset->rootStatement->data.bodyAst;
+    EXPECT_STREQ(assignment->left->data[0].astPtr->data[0].symbolTableItemPtr->identifier, "k");
+    EXPECT_EQ(assignment->right->data[0].astPtr->data[0].intConstantValue, 5);
+
+    // The calls in the loop passing 1 call a specialised copy, the others keep calling the function
+    ASSERT_EQ(program->functionsCount, functionsCount + 1);
+    CFFunction *copy = program->functions[functionsCount];
+    EXPECT_STREQ(copy->name, "mode$0");
+    assignment = copy->rootStatement->data.bodyAst;
+    ASSERT_EQ(assignment->actionType, AST_ASSIGN);
+    EXPECT_STREQ(assignment->left->data[0].astPtr->data[0].symbolTableItemPtr->identifier, "m");
+    EXPECT_EQ(assignment->right->data[0].astPtr->data[0].intConstantValue, 1);
+
+    CFStatement *loop = graph->function->rootStatement->followingStatement;
+    ASSERT_EQ(loop->statementType, CF_FOR);
+    ASTNode *arguments = loop->data.forData->bodyStatement->followingStatement->data.bodyAst->right;
+    EXPECT_EQ(arguments->data[0].astPtr->left->data[0].symbolTableItemPtr, cf_get_function("mode", false)->symbol);
+    EXPECT_EQ(arguments->data[1].astPtr->left->data[0].symbolTableItemPtr, copy->symbol);
+    EXPECT_EQ(copy->symbol->reference_counter, 1u);
+}
+
+TEST_F(BasicBlocksTest, EvaluatesPureCalls) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a := fib(10) + 1\n"
+          "    q, r := divmod(17, 5)\n"
+          "    b := noisy(3)\n"
+          "    c := fib(a)\n"
+          "    print(a, q, r, b, c)\n"
+          "}\n"
+          "func fib(n int) (int) {\n"
+          "    if n < 2 {\n"
+          "        return n\n"
+          "    }\n"
+          "    return fib(n - 1) + fib(n - 2)\n"
+          "}\n"
+          "func divmod(a int, b int) (int, int) {\n"
+          "    return a / b, a - a / b * b\n"
+          "}\n"
+          "func noisy(x int) (int) {\n"
+          "    print(x)\n"
+          "    return x\n"
+          "}\n", "main");
+
+    CFProgram *program = get_program();
+    bool changed[5] = {false};
+    unsigned evaluated = 0;
+    ASSERT_TRUE(ctfe_run(program, 1000000, changed, &evaluated));
+    EXPECT_EQ(evaluated, 2u);
+    EXPECT_TRUE(changed[0]);
+
+    // The result of the call replaces it in the expression
+    ASTNode *sum = graph->function->rootStatement->data.bodyAst->right->data[0].astPtr;
+    ASSERT_EQ(sum->left->actionType, AST_CONST_INT);
+    EXPECT_EQ(sum->left->data[0].intConstantValue, 55);
+
+    // Multiple results replace the whole value list
+    ASTNode *values = graph->function->rootStatement->followingStatement->data.bodyAst->right;
+    ASSERT_EQ(values->dataCount, 2u);
+    EXPECT_EQ(values->data[0].astPtr->data[0].intConstantValue, 3);
+    EXPECT_EQ(values->data[1].astPtr->data[0].intConstantValue, 2);
+
+    // A function that prints isn't evaluated, neither is a call with a variable argument
+    CFStatement *third = graph->function->rootStatement->followingStatement->followingStatement;
+    EXPECT_EQ(third->data.bodyAst->right->data[0].astPtr->actionType, AST_FUNC_CALL);
+    EXPECT_EQ(third->followingStatement->data.bodyAst->right->data[0].astPtr->actionType, AST_FUNC_CALL);
+    EXPECT_EQ(cf_get_function("fib", false)->symbol->reference_counter, 3u);
+}
+
+TEST_F(BasicBlocksTest, FoldsBuiltinCalls) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a := len(\"abc\")\n"
+          "    s, e := substr(\"hello\", 1, 3)\n"
+          "    c, f := ord(\"A\", 5)\n"
+          "    print(a, s, e, c, f)\n"
+          "}\n", "main");
+
+    CFStatement *stat = graph->function->rootStatement;
+    bool failed = false;
+    ASTNode *constant = ctfe_fold_builtin(stat->data.bodyAst->right->data[0].astPtr, &failed);
+    ASSERT_NE(constant, nullptr);
+    EXPECT_EQ(constant->actionType, AST_CONST_INT);
+    EXPECT_EQ(constant->data[0].intConstantValue, 3);
+    clean_ast(constant);
+
+    // The value and the error code
+    stat = stat->followingStatement;
+    ASTNode *constants = ctfe_fold_builtin(stat->data.bodyAst->right->data[0].astPtr, &failed);
+    ASSERT_NE(constants, nullptr);
+    ASSERT_EQ(constants->dataCount, 2u);
+    EXPECT_STREQ(constants->data[0].astPtr->data[0].stringConstantValue, "ell");
+    EXPECT_EQ(constants->data[1].astPtr->data[0].intConstantValue, 0);
+    clean_ast(constants);
+
+    // The generated code doesn't return a value for an index out of the string
+    stat = stat->followingStatement;
+    EXPECT_EQ(ctfe_fold_builtin(stat->data.bodyAst->right->data[0].astPtr, &failed), nullptr);
+    EXPECT_FALSE(failed);
+}
+
+TEST_F(BasicBlocksTest, RemovesDeadStores) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a, _ := inputi()\n"
+          "    b := a * 2\n"
+          "    b = a + 1\n"
+          "    s := 0\n"
+          "    for i := 0; i < a; i = i + 1 {\n"
+          "        s = s + i\n"
+          "    }\n"
+          "    c := foo(a)\n"
+          "    d := a / b\n"
+          "    print(b)\n"
+          "}\n"
+          "func foo(x int) (int) {\n"
+          "    print(x)\n"
+          "    return x\n"
+          "}\n", "main");
+
+    CFFunction *fun = graph->function;
+    STSymbol *s = &symtable_find(fun->symbolTable, "s")->data;
+    unsigned removed = 0;
+    ASSERT_TRUE(dse_run(fun, &removed));
+    // b := a * 2, s := 0 and s = s + i, which is only read by itself
+    EXPECT_EQ(removed, 3u);
+    EXPECT_EQ(s->reference_counter, 0u);
+
+    CFStatement *stat = fun->rootStatement->followingStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_ASSIGN);
+    EXPECT_EQ(stat->data.bodyAst->right->data[0].astPtr->actionType, AST_ADD);
+
+    // The loop body is empty, the call and the division that may fail are kept
+    stat = stat->followingStatement;
+    ASSERT_EQ(stat->statementType, CF_FOR);
+    EXPECT_EQ(stat->data.forData->bodyStatement->followingStatement, nullptr);
+    EXPECT_EQ(stat->followingStatement->data.bodyAst->actionType, AST_DEFINE);
+    EXPECT_EQ(stat->followingStatement->followingStatement->data.bodyAst->actionType, AST_DEFINE);
+}
+
+TEST_F(BasicBlocksTest, KeepsStoresReadByUnreachableCode) {
+    Build("package main\n"
+          "func main() {\n"
+          "    print(foo(1))\n"
+          "}\n"
+          "func foo(a int) int {\n"
+          "    s := \"\"\n"
+          "    t := 1\n"
+          "    if a > 0 {\n"
+          "        return 1\n"
+          "        print(len(s))\n"
+          "    }\n"
+          "    return 0\n"
+          "}\n", "foo");
+
+    // The code generator still checks the unreachable print, so s stays defined
+    CFFunction *fun = graph->function;
+    unsigned removed = 0;
+    ASSERT_TRUE(dse_run(fun, &removed));
+    EXPECT_EQ(removed, 1u);
+    CFStatement *stat = fun->rootStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_DEFINE);
+    EXPECT_STREQ(stat->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr->identifier, "s");
+    EXPECT_EQ(stat->followingStatement->statementType, CF_IF);
+}
+
+TEST_F(BasicBlocksTest, PropagatesAndCoalescesCopies) {
+    Build("package main\n"
+          "func main() {\n"
+          "    a, _ := inputi()\n"
+          "    b := a\n"
+          "    print(b)\n"
+          "    c := b + 1\n"
+          "    print(c)\n"
+          "    d := c * 2\n"
+          "    print(d)\n"
+          "}\n", "main");
+
+    CFFunction *fun = graph->function;
+    STSymbol *a = &symtable_find(fun->symbolTable, "a")->data;
+    STSymbol *c = &symtable_find(fun->symbolTable, "c")->data;
+    STSymbol *d = &symtable_find(fun->symbolTable, "d")->data;
+    unsigned changes = 0;
+    ASSERT_TRUE(copyprop_run(fun, &changes));
+    // Both reads of b
+    EXPECT_EQ(changes, 2u);
+    ASSERT_TRUE(dse_run(fun, &changes));
+    EXPECT_EQ(changes, 1u);
+
+    // a, c and d are each live only until the next one is defined, so they share a single variable
+    ASSERT_TRUE(copyprop_coalesce(fun, &changes));
+    EXPECT_EQ(changes, 2u);
+    EXPECT_EQ(a->reference_counter, 0u);
+    EXPECT_EQ(d->reference_counter, 0u);
+    EXPECT_GT(c->reference_counter, 0u);
+
+    CFStatement *stat = fun->rootStatement->followingStatement->followingStatement;
+    ASSERT_EQ(stat->data.bodyAst->actionType, AST_DEFINE);
+    EXPECT_EQ(stat->data.bodyAst->left->data[0].astPtr->data[0].symbolTableItemPtr, c);
+    EXPECT_EQ(stat->data.bodyAst->right->data[0].astPtr->left->data[0].symbolTableItemPtr, c);
+}
+
+TEST_F(BasicBlocksTest, RemovesDivisionChecks) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(n int, d int) int {\n"
+          "    s := 0\n"
+          "    for i := 1; i < n; i += 1 {\n"
+          "        s = s + 100 / i\n"
+          "        if i > 0 {\n"
+          "            s = s + 1\n"
+          "        }\n"
+          "    }\n"
+          "    if d != 0 {\n"
+          "        s = s + n / d\n"
+          "    }\n"
+          "    return s + n / d\n"
+          "}\n", "foo");
+    ssa = ssa_build(graph);
+    ASSERT_NE(ssa, nullptr);
+
+    unsigned divisions = 0;
+    unsigned comparisons = 0;
+    ASSERT_TRUE(range_run(ssa, &divisions, &comparisons));
+    // i is at least 1 in the loop (i < n, so it doesn't overflow) and d isn't zero in the IF,
+    // the last division isn't guarded
+    EXPECT_EQ(divisions, 2u);
+    // i > 0
+    EXPECT_EQ(comparisons, 1u);
+
+    BBBlock *header = FindBlock(CF_FOR_CONDITIONAL);
+    ASSERT_NE(header, nullptr);
+    ASSERT_GT(header->successors[0]->instructionsCount, 1u);
+    ASTNode *sum = (*header->successors[0]->instructions[0].ast)->right->data[0].astPtr;
+    ASSERT_EQ(sum->right->actionType, AST_DIVIDE);
+    EXPECT_TRUE(sum->right->divisorNonZero);
+
+    // The IF condition ends the same block
+    BBBlock *body = header->successors[0];
+    ASSERT_EQ(body->instructions[body->instructionsCount - 1].target, CF_IF_CONDITIONAL);
+    ASTNode *folded = *body->instructions[body->instructionsCount - 1].ast;
+    ASSERT_EQ(folded->actionType, AST_CONST_BOOL);
+    EXPECT_TRUE(folded->data[0].boolConstantValue);
+
+    CFStatement *last = graph->function->rootStatement;
+    while (last->followingStatement != nullptr) {
+        last = last->followingStatement;
+    }
+    ASSERT_EQ(last->statementType, CF_RETURN);
+    EXPECT_FALSE(last->data.bodyAst->data[0].astPtr->right->divisorNonZero);
+}
+
+TEST_F(BasicBlocksTest, ReassociatesChains) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(x int, y int, s string) int {\n"
+          "    a := x + 1 + 2\n"
+          "    b := 2 * -x * 3\n"
+          "    c := (x + y) - y - x\n"
+          "    d := y + (x - 5)\n"
+          "    t := \"a\" + s + \"b\" + \"c\" + \"\"\n"
+          "    e := a + x - 1\n"
+          "    return a + b + c + d + e\n"
+          "}\n", "foo");
+
+    CFFunction *fun = graph->function;
+    STSymbol *x = &symtable_find(fun->symbolTable, "x")->data;
+    STSymbol *y = &symtable_find(fun->symbolTable, "y")->data;
+    unsigned xReads = x->reference_counter;
+    unsigned yReads = y->reference_counter;
+    bool changed[6] = {false};
+    ASTNode *values[6];
+    CFStatement *stat = fun->rootStatement;
+    for (unsigned i = 0; i < 6; i++, stat = stat->followingStatement) {
+        ASSERT_TRUE(ast_infer_node_type(stat->data.bodyAst));
+        ASSERT_TRUE(reassoc_ast(&stat->data.bodyAst, &changed[i]));
+        values[i] = stat->data.bodyAst->right->data[0].astPtr;
+    }
+
+    // x + 3
+    ASSERT_EQ(values[0]->actionType, AST_ADD);
+    EXPECT_EQ(values[0]->left->actionType, AST_ID);
+    EXPECT_EQ(values[0]->right->data[0].intConstantValue, 3);
+    // x * -6
+    ASSERT_EQ(values[1]->actionType, AST_MULTIPLY);
+    EXPECT_EQ(values[1]->left->actionType, AST_ID);
+    EXPECT_EQ(values[1]->right->data[0].intConstantValue, -6);
+    // The terms cancel out and their reads are no longer counted
+    ASSERT_EQ(values[2]->actionType, AST_CONST_INT);
+    EXPECT_EQ(values[2]->data[0].intConstantValue, 0);
+    EXPECT_EQ(x->reference_counter, xReads - 2);
+    EXPECT_EQ(y->reference_counter, yReads - 2);
+    // (x + y) - 5, the variables are ordered by their names
+    ASSERT_EQ(values[3]->actionType, AST_SUBTRACT);
+    ASSERT_EQ(values[3]->left->actionType, AST_ADD);
+    EXPECT_EQ(values[3]->left->left->data[0].symbolTableItemPtr, x);
+    EXPECT_EQ(values[3]->left->right->data[0].symbolTableItemPtr, y);
+    EXPECT_EQ(values[3]->right->data[0].intConstantValue, 5);
+    // ("a" + s) + "bc"
+    ASSERT_EQ(values[4]->actionType, AST_ADD);
+    EXPECT_STREQ(values[4]->left->left->data[0].stringConstantValue, "a");
+    EXPECT_STREQ(values[4]->right->data[0].stringConstantValue, "bc");
+    // Already canonical
+    EXPECT_FALSE(changed[5]);
+    EXPECT_TRUE(changed[0] && changed[1] && changed[2] && changed[3] && changed[4]);
+}
+
+TEST_F(BasicBlocksTest, UnswitchesLoops) {
+    Build("package main\n"
+          "func main() {\n"
+          "}\n"
+          "func foo(n int, flag bool) int {\n"
+          "    t := 0\n"
+          "    for i := 0; i < n; i += 1 {\n"
+          "        if flag {\n"
+          "            t = t + i\n"
+          "        }\n"
+          "        if t > 10 {\n"
+          "            t = 0\n"
+          "        }\n"
+          "    }\n"
+          "    return t\n"
+          "}\n", "foo");
+
+    // The copy doesn't fit
+    unsigned unswitched = 0;
+    ASSERT_TRUE(unswitch_run(graph->function, 10, &unswitched));
+    EXPECT_EQ(unswitched, 0u);
+
+    // t > 10 changes in the loop, only flag is moved out
+    ASSERT_TRUE(unswitch_run(graph->function, 256, &unswitched));
+    EXPECT_EQ(unswitched, 1u);
+
+    CFStatement *stat = graph->function->rootStatement->followingStatement;
+    ASSERT_EQ(stat->statementType, CF_IF);
+    ASSERT_EQ(stat->data.ifData->conditionalAst->actionType, AST_ID);
+    EXPECT_STREQ(stat->data.ifData->conditionalAst->data[0].symbolTableItemPtr->identifier, "flag");
+    EXPECT_EQ(stat->followingStatement->statementType, CF_RETURN);
+
+    // The THEN branch keeps the loop, the ELSE branch has a copy with a new loop variable
+    CFStatement *original = stat->data.ifData->thenStatement->followingStatement;
+    CFStatement *copy = stat->data.ifData->elseStatement->followingStatement;
+    ASSERT_EQ(original->statementType, CF_FOR);
+    ASSERT_EQ(copy->statementType, CF_FOR);
+    STSymbol *i = original->data.forData->definitionAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    STSymbol *j = copy->data.forData->definitionAst->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    EXPECT_STREQ(i->identifier, "i");
+    EXPECT_EQ(j->identifier[0], '$');
+
+    ASTNode *originalCondition = original->data.forData->bodyStatement->followingStatement->data.ifData->conditionalAst;
+    ASTNode *copyCondition = copy->data.forData->bodyStatement->followingStatement->data.ifData->conditionalAst;
+    ASSERT_EQ(originalCondition->actionType, AST_CONST_BOOL);
+    ASSERT_EQ(copyCondition->actionType, AST_CONST_BOOL);
+    EXPECT_TRUE(originalCondition->data[0].boolConstantValue);
+    EXPECT_FALSE(copyCondition->data[0].boolConstantValue);
+}
@@ -100,9 +100,8 @@ void ParserScannerTest::ComplexTest(std::string &inputStr, CompilerResult expect
             CFProgram *prog = get_program();
             ASSERT_NE(prog, nullptr);
 
-            CFFuncListNode *fn = prog->functionList;
-            while (fn != NULL) {
-                CFFunction *f = &fn->fun;
+            for (unsigned i = 0; i < prog->functionsCount; i++) {
+                CFFunction *f = prog->functions[i];
                 ASSERT_NE(f, nullptr);
 
                 CFStatement *st = f->rootStatement;
@@ -111,8 +110,6 @@ void ParserScannerTest::ComplexTest(std::string &inputStr, CompilerResult expect
                     CheckStatementRecursively(st);
                     st = st->followingStatement;
                 }
-
-                fn = fn->next;
             }
         }
 
@@ -5618,3 +5615,394 @@ TEST_F(ParserScannerTest, LineCommentEOF) {
 
     ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
 }
+
+TEST_F(ParserScannerTest, ParallelOptimisation) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a := 2 * 3\n"
+        "    print(foo(a), bar(a), baz(a))\n"
+        "}\n"
+        "func foo(x int) int {\n"
+        "    y := 4\n"
+        "    if y > 3 {\n"
+        "        return x + y\n"
+        "    }\n"
+        "    return x\n"
+        "}\n"
+        "func bar(x int) int {\n"
+        "    for i := 0; i < 3; i += 1 {\n"
+        "        x = x * 2\n"
+        "    }\n"
+        "    return x\n"
+        "}\n"
+        "func baz(x int) int {\n"
+        "    z := 10 / 2\n"
+        "    return x - z\n"
+        "}\n";
+
+    optimiser_set_jobs(4);
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    optimiser_set_jobs(1);
+}
+
+TEST_F(ParserScannerTest, MissingNamedReturn) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    print(g(1))\n"
+        "}\n"
+        "func g(x int) (r int) {\n"
+        "    r = x * 2\n"
+        "}\n";
+
+    ComplexTest(inputStr, COMPILER_RESULT_ERROR_WRONG_PARAMETER_OR_RETURN_VALUE);
+}
+
+TEST_F(ParserScannerTest, StatementAfterEmptyReturn) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a := 1\n"
+        "    if a > 0 {\n"
+        "        return\n"
+        "        print(a)\n"
+        "    }\n"
+        "}\n";
+
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    EXPECT_EQ(tcg_get_stats()->unreachableStatements, 1u);
+}
+
+TEST_F(ParserScannerTest, OptimisationLevelNone) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    j := 2\n"
+        "    for i, j := 1, j; i < 4; i += 1 {\n"
+        "        print(i, j)\n"
+        "    }\n"
+        "    for k := 0; k < 3; k += 1 {\n"
+        "        print(k)\n"
+        "    }\n"
+        "    print(foo(j))\n"
+        "}\n"
+        "func foo(x int) int {\n"
+        "    return x * 0 + len(\"a\" + \"b\")\n"
+        "}\n";
+
+    // Only the folding runs at -O0, the unrolling is enabled on its own
+    optimiser_set_level(OPTIMISER_LEVEL_NONE);
+    EXPECT_TRUE(optimiser_set_pass_enabled("unroll", true));
+    EXPECT_FALSE(optimiser_set_pass_enabled("unknown", true));
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    optimiser_set_level(OPTIMISER_LEVEL_FULL);
+
+    const OptimiserStats *stats = optimiser_get_stats();
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_INLINE].runs, 0u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_SCCP].runs, 0u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_CTFE].runs, 0u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_UNROLL].runs, 2u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_UNROLL].rewrittenNodes, 1u);
+    EXPECT_GT(stats->passes[OPTIMISER_PASS_FOLD].visitedNodes, 0u);
+    EXPECT_GT(stats->passes[OPTIMISER_PASS_FOLD].rewrittenNodes, 0u);
+    EXPECT_EQ(stats->unrolledLoops, 1u);
+}
+
+TEST_F(ParserScannerTest, OptimisationLevelBasic) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a, _ := inputi()\n"
+        "    for i := 0; i < 2; i += 1 {\n"
+        "        print(foo(a + i))\n"
+        "    }\n"
+        "}\n"
+        "func foo(x int) int {\n"
+        "    return x * 2\n"
+        "}\n";
+
+    // Neither the calls are inlined nor the loops unrolled at -O1
+    optimiser_set_level(OPTIMISER_LEVEL_BASIC);
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    optimiser_set_level(OPTIMISER_LEVEL_FULL);
+
+    const OptimiserStats *stats = optimiser_get_stats();
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_INLINE].runs, 0u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_UNROLL].runs, 0u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_GVN].runs, 2u);
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_FOLD].runs, 2u);
+    // The chains are reassociated once in each folding of a function, not in each expression
+    EXPECT_EQ(stats->passes[OPTIMISER_PASS_REASSOC].runs, 2u);
+    EXPECT_EQ(stats->inlinedCalls, 0u);
+    EXPECT_EQ(stats->unrolledLoops, 0u);
+}
+
+TEST_F(ParserScannerTest, LenOfComputedString) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    s := \"ab\"\n"
+        "    t := s + \"c\"\n"
+        "    print(len(t + s))\n"
+        "}\n";
+
+    // The length of a string that isn't a constant is computed at runtime
+    optimiser_set_level(OPTIMISER_LEVEL_NONE);
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+    optimiser_set_level(OPTIMISER_LEVEL_FULL);
+
+    EXPECT_NE(output.find("STRLEN GF@$r1 GF@$r1\nPUSHS GF@$r1\n"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, MultiDefinitionReadsPreviousVariable) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    j := 2\n"
+        "    for i, j := 1, j; i < 3; i += 1 {\n"
+        "        print(i, j)\n"
+        "    }\n"
+        "}\n";
+
+    // The j on the right side is the one defined before the FOR, not the one the definition defines
+    optimiser_set_level(OPTIMISER_LEVEL_NONE);
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+    optimiser_set_level(OPTIMISER_LEVEL_FULL);
+
+    EXPECT_NE(output.find("PUSHS LF@$1_j\nPOPS LF@$2_j\n"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, MultiplicationByZeroKeepsCalls) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    print(f() * 0)\n"
+        "}\n"
+        "func f() int {\n"
+        "    print(\"f\")\n"
+        "    return 3\n"
+        "}\n";
+
+    // The product is zero, but the call prints, so it must stay
+    optimiser_set_level(OPTIMISER_LEVEL_NONE);
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+    optimiser_set_level(OPTIMISER_LEVEL_FULL);
+
+    EXPECT_NE(output.find("CALL f\n"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, ConstantsThroughBuiltinCalls) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a := \"abc\"\n"
+        "    b := len(a)\n"
+        "    c := b * 2\n"
+        "    d := int2float(c)\n"
+        "    print(float2int(d * 1.5))\n"
+        "}\n";
+
+    // Each folded call defines a constant for the next round of the propagation
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find("WRITE int@9\n"), std::string::npos);
+    EXPECT_EQ(output.find("INT2FLOAT"), std::string::npos);
+    EXPECT_EQ(output.find("FLOAT2INT"), std::string::npos);
+
+    // A round for each of the three calls and the last one that finds nothing new
+    const OptimiserStats *stats = optimiser_get_stats();
+    EXPECT_GE(stats->propagationRounds, 4u);
+    EXPECT_EQ(stats->roundCapHits, 0u);
+}
+
+TEST_F(ParserScannerTest, BuiltinAssignmentsOfPropagatedVariables) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    s := \"hello\"\n"
+        "    i := 1\n"
+        "    t, e := substr(s, i, 3)\n"
+        "    c, f := ord(t, 0)\n"
+        "    print(c, e + f)\n"
+        "}\n";
+
+    // The value and the error code of the substring are both propagated into the next call
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find("WRITE int@101\nWRITE int@0\n"), std::string::npos);
+    EXPECT_EQ(output.find("GETCHAR"), std::string::npos);
+    EXPECT_EQ(output.find("STRI2INT"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, CancelledDivisorCheckedAtRuntime) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    n, _ := inputi()\n"
+        "    if n > 100 {\n"
+        "        print(10 / (n - n))\n"
+        "    }\n"
+        "    print(n)\n"
+        "}\n";
+
+    // The division only fails if the branch is executed, so the zero is checked by the generated code
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find("JUMPIFEQ $$zero_div"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, UnrolledDivisorCheckedAtRuntime) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    n, _ := inputi()\n"
+        "    if n > 100 {\n"
+        "        for i := -2; i < 3; i += 1 {\n"
+        "            print(10 / i)\n"
+        "        }\n"
+        "    }\n"
+        "    x := 1.0\n"
+        "    for j := 0; j < 3; j += 1 {\n"
+        "        x = x * 1e-16\n"
+        "    }\n"
+        "    print(1.0 / x)\n"
+        "}\n";
+
+    // The copy for i == 0 divides by zero only if the branch is executed, the tiny x isn't zero at all
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(optimiser_get_stats()->unrolledLoops, 2u);
+    EXPECT_NE(output.find("JUMPIFEQ $$zero_div"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, PropagatedArgumentDivisorCheckedAtRuntime) {
+    std::string inputStr = \
+        "package main\n"
+        "func f(a int) int {\n"
+        "    x := 10 / a\n"
+        "    return x + 1\n"
+        "}\n"
+        "func g(b int) {\n"
+        "    if b > 3 {\n"
+        "        print(f(0))\n"
+        "    }\n"
+        "}\n"
+        "func main() {\n"
+        "    n, _ := inputi()\n"
+        "    if n > 100 {\n"
+        "        print(f(0))\n"
+        "    }\n"
+        "    g(n)\n"
+        "}\n";
+
+    // All the calls pass zero, but none of them has to run, so f checks its divisor at runtime
+    optimiser_set_level(OPTIMISER_LEVEL_SIZE);
+    testing::internal::CaptureStdout();
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+    optimiser_set_level(OPTIMISER_LEVEL_FULL);
+
+    EXPECT_GT(optimiser_get_stats()->propagatedArguments, 0u);
+    EXPECT_NE(output.find("JUMPIFEQ $$zero_div"), std::string::npos);
+}
+
+TEST_F(ParserScannerTest, UnreachableFunctionsOmitted) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a, _ := inputi()\n"
+        "    print(foo(a))\n"
+        "}\n"
+        "func foo(n int) int {\n"
+        "    if n > 0 {\n"
+        "        return foo(n - 1) + 1\n"
+        "    }\n"
+        "    return 0\n"
+        "}\n"
+        "func bar(n int) int {\n"
+        "    return baz(n) / 2\n"
+        "}\n"
+        "func baz(n int) int {\n"
+        "    return bar(n)\n"
+        "}\n";
+
+    // bar and baz only call each other
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    EXPECT_EQ(tcg_get_stats()->droppedFunctions, 2u);
+}
+
+TEST_F(ParserScannerTest, TailCallsAsJumps) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a, _ := inputi()\n"
+        "    print(sum(a, 0), swap(1, 2, a), fact(a))\n"
+        "}\n"
+        "func sum(n int, acc int) int {\n"
+        "    if n == 0 {\n"
+        "        return acc\n"
+        "    }\n"
+        "    return sum(n - 1, acc + n)\n"
+        "}\n"
+        "func swap(a int, b int, k int) int {\n"
+        "    if k > 0 {\n"
+        "        return swap(b, a, k - 1)\n"
+        "    }\n"
+        "    return a\n"
+        "}\n"
+        "func fact(n int) int {\n"
+        "    if n > 1 {\n"
+        "        return n * fact(n - 1)\n"
+        "    }\n"
+        "    return 1\n"
+        "}\n";
+
+    // The call in fact isn't in tail position
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    EXPECT_EQ(tcg_get_stats()->tailCalls, 2u);
+}
+
+TEST_F(ParserScannerTest, UnreachableStatementsOmitted) {
+    std::string inputStr = \
+        "package main\n"
+        "func main() {\n"
+        "    a, _ := inputi()\n"
+        "    print(sign(a), early(a))\n"
+        "}\n"
+        "func sign(x int) int {\n"
+        "    if x > 0 {\n"
+        "        return 1\n"
+        "    } else {\n"
+        "        if x < 0 {\n"
+        "            return -1\n"
+        "        }\n"
+        "        return 0\n"
+        "        print(x)\n"
+        "    }\n"
+        "    x = x + 1\n"
+        "    return x\n"
+        "}\n"
+        "func early(x int) int {\n"
+        "    return x * 2\n"
+        "    print(\"dead\")\n"
+        "}\n";
+
+    // The IF in sign always returns
+    ComplexTest(inputStr, COMPILER_RESULT_SUCCESS);
+    EXPECT_EQ(tcg_get_stats()->unreachableStatements, 4u);
+}
@@ -247,11 +247,11 @@ TEST(SymTable, STComplex) {
 
     item->data.data.func_data.defined = true;
     symtable_add_param(item, "gre", CF_INT);
-    ASSERT_EQ(item->data.data.func_data.params->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.params->id, "gre");
+    ASSERT_EQ(item->data.data.func_data.params[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.params[0].id, "gre");
     symtable_add_ret_type(item, "fre", CF_BOOL);
-    ASSERT_EQ(item->data.data.func_data.ret_types->type, CF_BOOL);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->id, "fre");
+    ASSERT_EQ(item->data.data.func_data.ret_types[0].type, CF_BOOL);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[0].id, "fre");
 
     symtable_free(table);
 }
@@ -263,8 +263,8 @@ TEST(SymTable, STAddParam1) {
     symtable_add_param(item, "param1", CF_INT);
 
     item = symtable_find(table, "a");
-    ASSERT_EQ(item->data.data.func_data.params->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.params->id, "param1");
+    ASSERT_EQ(item->data.data.func_data.params[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.params[0].id, "param1");
     symtable_free(table);
 }
 
@@ -277,12 +277,12 @@ TEST(SymTable, STAddParam2) {
     symtable_add_param(item, "param3", CF_UNKNOWN);
 
     item = symtable_find(table, "a");
-    ASSERT_EQ(item->data.data.func_data.params->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.params->id, "param1");
-    ASSERT_EQ(item->data.data.func_data.params->next->type, CF_BOOL);
-    ASSERT_STREQ(item->data.data.func_data.params->next->id, "param2");
-    ASSERT_EQ(item->data.data.func_data.params->next->next->type, CF_UNKNOWN);
-    ASSERT_STREQ(item->data.data.func_data.params->next->next->id, "param3");
+    ASSERT_EQ(item->data.data.func_data.params[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.params[0].id, "param1");
+    ASSERT_EQ(item->data.data.func_data.params[1].type, CF_BOOL);
+    ASSERT_STREQ(item->data.data.func_data.params[1].id, "param2");
+    ASSERT_EQ(item->data.data.func_data.params[2].type, CF_UNKNOWN);
+    ASSERT_STREQ(item->data.data.func_data.params[2].id, "param3");
 
     symtable_free(table);
 }
@@ -296,12 +296,31 @@ TEST(SymTable, STAddParam3) {
     symtable_add_param(item, NULL, CF_UNKNOWN);
 
     item = symtable_find(table, "a");
-    ASSERT_EQ(item->data.data.func_data.params->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.params->id, "param1");
-    ASSERT_EQ(item->data.data.func_data.params->next->type, CF_BOOL);
-    ASSERT_STREQ(item->data.data.func_data.params->next->id, NULL);
-    ASSERT_EQ(item->data.data.func_data.params->next->next->type, CF_UNKNOWN);
-    ASSERT_STREQ(item->data.data.func_data.params->next->next->id, NULL);
+    ASSERT_EQ(item->data.data.func_data.params[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.params[0].id, "param1");
+    ASSERT_EQ(item->data.data.func_data.params[1].type, CF_BOOL);
+    ASSERT_STREQ(item->data.data.func_data.params[1].id, NULL);
+    ASSERT_EQ(item->data.data.func_data.params[2].type, CF_UNKNOWN);
+    ASSERT_STREQ(item->data.data.func_data.params[2].id, NULL);
+
+    symtable_free(table);
+}
+
+TEST(SymTable, STAddParamMany) {
+    SymbolTable *table = symtable_init(ARR_SIZE);
+    STItem *item = symtable_add(table, "a", ST_SYMBOL_FUNC);
+
+    const char *names[] = {"p0", "p1", "p2", "p3", "p4", "p5", "p6", "p7", "p8", "p9"};
+    for (unsigned i = 0; i < 10; i++) {
+        ASSERT_TRUE(symtable_add_param(item, names[i], i % 2 == 0 ? CF_INT : CF_STRING));
+    }
+
+    item = symtable_find(table, "a");
+    ASSERT_EQ(item->data.data.func_data.params_count, 10);
+    for (unsigned i = 0; i < 10; i++) {
+        ASSERT_EQ(item->data.data.func_data.params[i].type, i % 2 == 0 ? CF_INT : CF_STRING);
+        ASSERT_STREQ(item->data.data.func_data.params[i].id, names[i]);
+    }
 
     symtable_free(table);
 }
@@ -313,8 +332,8 @@ TEST(SymTable, STAddRetType1) {
     symtable_add_ret_type(item, "ret_type1", CF_INT);
 
     item = symtable_find(table, "a");
-    ASSERT_EQ(item->data.data.func_data.ret_types->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->id, "ret_type1");
+    ASSERT_EQ(item->data.data.func_data.ret_types[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[0].id, "ret_type1");
 
     symtable_free(table);
 }
@@ -328,12 +347,12 @@ TEST(SymTable, STAddRetType2) {
     symtable_add_ret_type(item, "ret_type3", CF_UNKNOWN);
 
     item = symtable_find(table, "a");
-    ASSERT_EQ(item->data.data.func_data.ret_types->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->id, "ret_type1");
-    ASSERT_EQ(item->data.data.func_data.ret_types->next->type, CF_BOOL);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->next->id, "ret_type2");
-    ASSERT_EQ(item->data.data.func_data.ret_types->next->next->type, CF_UNKNOWN);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->next->next->id, "ret_type3");
+    ASSERT_EQ(item->data.data.func_data.ret_types[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[0].id, "ret_type1");
+    ASSERT_EQ(item->data.data.func_data.ret_types[1].type, CF_BOOL);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[1].id, "ret_type2");
+    ASSERT_EQ(item->data.data.func_data.ret_types[2].type, CF_UNKNOWN);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[2].id, "ret_type3");
 
     symtable_free(table);
 }
@@ -347,12 +366,12 @@ TEST(SymTable, STAddRetType3) {
     symtable_add_ret_type(item, NULL, CF_UNKNOWN);
 
     item = symtable_find(table, "a");
-    ASSERT_EQ(item->data.data.func_data.ret_types->type, CF_INT);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->id, "ret_type1");
-    ASSERT_EQ(item->data.data.func_data.ret_types->next->type, CF_BOOL);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->next->id, NULL);
-    ASSERT_EQ(item->data.data.func_data.ret_types->next->next->type, CF_UNKNOWN);
-    ASSERT_STREQ(item->data.data.func_data.ret_types->next->next->id, NULL);
+    ASSERT_EQ(item->data.data.func_data.ret_types[0].type, CF_INT);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[0].id, "ret_type1");
+    ASSERT_EQ(item->data.data.func_data.ret_types[1].type, CF_BOOL);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[1].id, NULL);
+    ASSERT_EQ(item->data.data.func_data.ret_types[2].type, CF_UNKNOWN);
+    ASSERT_STREQ(item->data.data.func_data.ret_types[2].id, NULL);
 
     symtable_free(table);
 }
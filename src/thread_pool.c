@@ -0,0 +1,173 @@
+/** @file thread_pool.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements running independent tasks on multiple threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "thread_pool.h"
+
+// Messages and the result reported by a single task.
+typedef struct thread_pool_task_state {
+    char *messages;
+    size_t length;
+    size_t capacity;
+    CompilerResult result;
+} TaskState;
+
+typedef struct thread_pool {
+    pthread_mutex_t lock;
+    unsigned nextIndex;
+    unsigned count;
+    ThreadPoolTask task;
+    void *data;
+    TaskState *states;
+} ThreadPool;
+
+// State of the task running on the current thread, NULL outside of tasks.
+static _Thread_local TaskState *currentTask = NULL;
+
+static bool append_message(TaskState *state, const char *text, size_t length) {
+    if (state->length + length + 1 > state->capacity) {
+        size_t newCapacity = state->capacity == 0 ? 256 : state->capacity * 2;
+        while (newCapacity < state->length + length + 1) {
+            newCapacity *= 2;
+        }
+        char *newMessages = realloc(state->messages, newCapacity);
+        if (newMessages == NULL) {
+            return false;
+        }
+        state->messages = newMessages;
+        state->capacity = newCapacity;
+    }
+    memcpy(state->messages + state->length, text, length);
+    state->length += length;
+    state->messages[state->length] = '\0';
+    return true;
+}
+
+static void *worker(void *arg) {
+    ThreadPool *pool = arg;
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        unsigned index = pool->nextIndex++;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (index >= pool->count) {
+            break;
+        }
+
+        currentTask = &pool->states[index];
+        pool->task(index, pool->data);
+        currentTask = NULL;
+    }
+    return NULL;
+}
+
+bool thread_pool_run(unsigned threadsCount, unsigned count, ThreadPoolTask task, void *data) {
+    if (threadsCount > count) {
+        threadsCount = count;
+    }
+    if (threadsCount == 0) {
+        return true;
+    }
+
+    ThreadPool pool = {.nextIndex = 0, .count = count, .task = task, .data = data};
+    pool.states = calloc(count, sizeof(TaskState));
+    pthread_t *threads = malloc(threadsCount * sizeof(pthread_t));
+    if (pool.states == NULL || threads == NULL || pthread_mutex_init(&pool.lock, NULL) != 0) {
+        free(pool.states);
+        free(threads);
+        return false;
+    }
+
+    unsigned started = 0;
+    while (started < threadsCount && pthread_create(&threads[started], NULL, worker, &pool) == 0) {
+        started++;
+    }
+
+    if (started == 0) {
+        pthread_mutex_destroy(&pool.lock);
+        free(pool.states);
+        free(threads);
+        return false;
+    }
+
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Replay the reported messages in the order of the tasks
+    bool failed = false;
+    for (unsigned i = 0; i < count; i++) {
+        if (!failed) {
+            if (pool.states[i].messages != NULL) {
+                fputs(pool.states[i].messages, stderr);
+            }
+            if (pool.states[i].result != COMPILER_RESULT_SUCCESS) {
+                set_compiler_result(pool.states[i].result);
+                failed = true;
+            }
+        }
+        free(pool.states[i].messages);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.states);
+    free(threads);
+    return true;
+}
+
+CompilerResult thread_pool_result() {
+    if (currentTask != NULL) {
+        return currentTask->result;
+    }
+    return compiler_result;
+}
+
+bool thread_pool_defer_message(const char *module, MessageType message_type, const char *fmt, va_list arguments) {
+    if (currentTask == NULL) {
+        return false;
+    }
+
+    char header[128];
+    int headerLength = snprintf(header, sizeof(header), "%s: %s", module,
+                                message_type == ERROR ? "error: " : "warning: ");
+    if (headerLength < 0) {
+        return true;
+    }
+
+    va_list argumentsCopy;
+    va_copy(argumentsCopy, arguments);
+    int length = vsnprintf(NULL, 0, fmt, argumentsCopy);
+    va_end(argumentsCopy);
+    if (length < 0) {
+        return true;
+    }
+
+    char *text = malloc((size_t) length + 1);
+    if (text == NULL) {
+        return true;
+    }
+    vsnprintf(text, (size_t) length + 1, fmt, arguments);
+
+    append_message(currentTask, header, (size_t) headerLength);
+    append_message(currentTask, text, (size_t) length);
+    free(text);
+    return true;
+}
+
+bool thread_pool_defer_result(CompilerResult result) {
+    if (currentTask == NULL) {
+        return false;
+    }
+
+    if (currentTask->result == COMPILER_RESULT_SUCCESS) {
+        currentTask->result = result;
+    }
+    return true;
+}
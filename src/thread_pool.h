@@ -0,0 +1,37 @@
+/** @file thread_pool.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for running independent tasks on multiple threads.
+ */
+
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H 1
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include "compiler.h"
+#include "stderr_message.h"
+
+// A task run by the pool, index is the number of the task.
+typedef void (*ThreadPoolTask)(unsigned index, void *data);
+
+// Runs the task for all indices from 0 to count - 1 on at most threadsCount threads and waits for all of them.
+// Messages and results reported using stderr_message() in the tasks are held back and, when all the tasks finish,
+// replayed in the order of their indices. As if the tasks ran serially until the first error, the messages of the
+// tasks following the first failed one are discarded.
+// Returns false if no thread could be started (in which case no task has been run).
+bool thread_pool_run(unsigned threadsCount, unsigned count, ThreadPoolTask task, void *data);
+
+// Returns the result of the task running on the calling thread or the global compiler result when called
+// outside of a task.
+CompilerResult thread_pool_result();
+
+// Stores a message reported in a task. Returns false when called outside of a task, the message should be
+// written out directly then.
+bool thread_pool_defer_message(const char *module, MessageType message_type, const char *fmt, va_list arguments);
+
+// Stores a compiler result reported in a task. Returns false when called outside of a task.
+bool thread_pool_defer_result(CompilerResult result);
+
+#endif // _THREAD_POOL_H
@@ -0,0 +1,944 @@
+/** @file transform.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements helper functions for the optimisations that rewrite the statements of functions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "transform.h"
+
+// Size of the symbol tables created for the scopes of copied statements.
+#define TF_TABLE_SIZE 16
+// Initial capacity of the arrays grown by tf_reserve().
+#define TF_CHUNK 8
+
+bool tf_can_insert_before(const CFStatement *stat) {
+    const CFStatement *parent = stat->parentStatement;
+    if (parent == NULL || parent->followingStatement == stat || parent->statementType != CF_IF) {
+        return true;
+    }
+    return stat->statementType != CF_IF || parent->data.ifData->elseStatement != stat;
+}
+
+// Returns the pointer that links the statement to the statement tree.
+static CFStatement **tf_statement_link(CFStatement *stat) {
+    CFStatement *parent = stat->parentStatement;
+    if (parent == NULL) {
+        return &stat->parentFunction->rootStatement;
+    }
+    if (parent->followingStatement == stat) {
+        return &parent->followingStatement;
+    }
+    if (parent->statementType == CF_IF) {
+        return parent->data.ifData->thenStatement == stat ? &parent->data.ifData->thenStatement
+                                                          : &parent->data.ifData->elseStatement;
+    }
+    return &parent->data.forData->bodyStatement;
+}
+
+SymbolTable *tf_scope_table(CFStatement *stat) {
+    if (stat->statementType != CF_FOR) {
+        return stat->localSymbolTable;
+    }
+
+    CFStatement *previous = stat->parentStatement;
+    while (previous != NULL && previous->statementType == CF_FOR && previous->followingStatement == stat) {
+        stat = previous;
+        previous = previous->parentStatement;
+    }
+    if (previous == NULL) {
+        return stat->parentFunction->symbolTable;
+    }
+    if (previous->followingStatement != stat) {
+        // The first statement of a branch is never a FOR, this is only a fallback
+        return stat->parentFunction->symbolTable;
+    }
+    return previous->localSymbolTable;
+}
+
+CFStatement *tf_insert_before(CFStatement *stat, ASTNode *body) {
+    CFStatement *newStat = calloc(1, sizeof(CFStatement));
+    if (newStat == NULL) {
+        return NULL;
+    }
+
+    newStat->parentFunction = stat->parentFunction;
+    newStat->parentBranchStatement = stat->parentBranchStatement;
+    newStat->localSymbolTable = tf_scope_table(stat);
+    newStat->statementType = CF_BASIC;
+    newStat->data.bodyAst = body;
+
+    *tf_statement_link(stat) = newStat;
+    newStat->parentStatement = stat->parentStatement;
+    newStat->followingStatement = stat;
+    stat->parentStatement = newStat;
+    return newStat;
+}
+
+CFStatement *tf_insert_after(CFStatement *stat, ASTNode *body) {
+    CFStatement *newStat = calloc(1, sizeof(CFStatement));
+    if (newStat == NULL) {
+        return NULL;
+    }
+
+    newStat->parentFunction = stat->parentFunction;
+    newStat->parentBranchStatement = stat->parentBranchStatement;
+    newStat->localSymbolTable = tf_scope_table(stat);
+    newStat->statementType = CF_BASIC;
+    newStat->data.bodyAst = body;
+
+    newStat->parentStatement = stat;
+    newStat->followingStatement = stat->followingStatement;
+    if (stat->followingStatement != NULL) {
+        stat->followingStatement->parentStatement = newStat;
+    }
+    stat->followingStatement = newStat;
+    return newStat;
+}
+
+void tf_insert_statements_before(CFStatement *stat, CFStatement *first) {
+    CFStatement *last = first;
+    for (CFStatement *next = first; next != NULL; next = next->followingStatement) {
+        next->parentBranchStatement = stat->parentBranchStatement;
+        last = next;
+    }
+
+    *tf_statement_link(stat) = first;
+    first->parentStatement = stat->parentStatement;
+    last->followingStatement = stat;
+    stat->parentStatement = last;
+}
+
+bool tf_is_visible(CFStatement *stat, const STSymbol *variable) {
+    while (stat != NULL) {
+        // The variables defined by a FOR definition are visible in its header and body
+        if (stat->statementType == CF_FOR) {
+            STItem *item = symtable_find(stat->localSymbolTable, variable->identifier);
+            if (item != NULL) {
+                return &item->data == variable;
+            }
+        }
+
+        // The statements of a chain share the scope of its first statement
+        CFStatement *first = stat;
+        while (first->parentStatement != NULL && first->parentStatement->followingStatement == first) {
+            first = first->parentStatement;
+        }
+        SymbolTable *scope = first->statementType == CF_FOR ? first->parentFunction->symbolTable
+                                                            : first->localSymbolTable;
+        STItem *item = symtable_find(scope, variable->identifier);
+        if (item != NULL) {
+            return &item->data == variable;
+        }
+        stat = first->parentStatement;
+    }
+    return false;
+}
+
+bool tf_can_remove_statement(const CFStatement *stat) {
+    if (stat->parentStatement != NULL) {
+        return true;
+    }
+    const CFStatement *next = stat->followingStatement;
+    return next != NULL && (next->statementType == CF_RETURN
+                            || (next->statementType == CF_BASIC && next->data.bodyAst != NULL));
+}
+
+void tf_remove_statement(CFStatement *stat) {
+    *tf_statement_link(stat) = stat->followingStatement;
+    if (stat->followingStatement != NULL) {
+        stat->followingStatement->parentStatement = stat->parentStatement;
+    }
+
+    stat->followingStatement = NULL;
+    clean_stat(stat, stat->localSymbolTable);
+}
+
+// Copies a single statement (without the following ones), see tf_copy_statements().
+static CFStatement *tf_copy_statement(const CFStatement *stat, CFFunction *fun, SymbolTable *table,
+                                      const TFReplacement *replacements, unsigned count);
+
+CFStatement *tf_copy_statements(const CFStatement *first, CFFunction *fun, SymbolTable *table,
+                                const TFReplacement *replacements, unsigned count) {
+    CFStatement *copy = NULL;
+    CFStatement *last = NULL;
+    for (const CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        CFStatement *statCopy = tf_copy_statement(stat, fun, table, replacements, count);
+        if (statCopy == NULL) {
+            clean_stat(copy, table);
+            return NULL;
+        }
+
+        if (last == NULL) {
+            copy = statCopy;
+        } else {
+            last->followingStatement = statCopy;
+            statCopy->parentStatement = last;
+            statCopy->parentBranchStatement = last->parentBranchStatement;
+        }
+        last = statCopy;
+    }
+    return copy;
+}
+
+// Copies the branch of an IF or the body of a FOR (owner) into a new scope.
+static bool tf_copy_branch(const CFStatement *branch, CFStatement *owner, CFStatement **slot,
+                           const TFReplacement *replacements, unsigned count) {
+    if (branch == NULL) {
+        return true;
+    }
+
+    SymbolTable *table = symtable_init(TF_TABLE_SIZE);
+    if (table == NULL) {
+        return false;
+    }
+    CFStatement *copy = tf_copy_statements(branch, owner->parentFunction, table, replacements, count);
+    if (copy == NULL) {
+        symtable_free(table);
+        return false;
+    }
+
+    for (CFStatement *stat = copy; stat != NULL; stat = stat->followingStatement) {
+        stat->parentBranchStatement = owner;
+    }
+    copy->parentStatement = owner;
+    *slot = copy;
+    return true;
+}
+
+static CFStatement *tf_copy_statement(const CFStatement *stat, CFFunction *fun, SymbolTable *table,
+                                      const TFReplacement *replacements, unsigned count) {
+    CFStatement *copy = calloc(1, sizeof(CFStatement));
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy->parentFunction = fun;
+    copy->localSymbolTable = table;
+    copy->statementType = stat->statementType;
+
+    bool copied = true;
+    switch (stat->statementType) {
+        case CF_BASIC:
+        case CF_RETURN:
+            copy->data.bodyAst = tf_copy_replacing(stat->data.bodyAst, replacements, count);
+            copied = stat->data.bodyAst == NULL || copy->data.bodyAst != NULL;
+            break;
+        case CF_IF: {
+            const CFStatementIf *ifData = stat->data.ifData;
+            copy->data.ifData = calloc(1, sizeof(CFStatementIf));
+            if (copy->data.ifData == NULL) {
+                copied = false;
+                break;
+            }
+            copy->data.ifData->conditionalAst = tf_copy_replacing(ifData->conditionalAst, replacements, count);
+            copied = copy->data.ifData->conditionalAst != NULL
+                     && tf_copy_branch(ifData->thenStatement, copy, &copy->data.ifData->thenStatement,
+                                       replacements, count);
+            if (copied && ifData->elseStatement != NULL && ifData->elseStatement->statementType == CF_IF) {
+                // An else-if belongs to the scope of its IF
+                CFStatement *elseIf = tf_copy_statement(ifData->elseStatement, fun, table, replacements, count);
+                if (elseIf != NULL) {
+                    elseIf->parentStatement = copy;
+                    elseIf->parentBranchStatement = copy;
+                    copy->data.ifData->elseStatement = elseIf;
+                }
+                copied = elseIf != NULL;
+            } else if (copied) {
+                copied = tf_copy_branch(ifData->elseStatement, copy, &copy->data.ifData->elseStatement,
+                                        replacements, count);
+            }
+            break;
+        }
+        case CF_FOR: {
+            const CFStatementFor *forData = stat->data.forData;
+            copy->localSymbolTable = symtable_init(TF_TABLE_SIZE);
+            copy->data.forData = calloc(1, sizeof(CFStatementFor));
+            if (copy->localSymbolTable == NULL || copy->data.forData == NULL) {
+                copied = false;
+                break;
+            }
+            copy->data.forData->definitionAst = tf_copy_replacing(forData->definitionAst, replacements, count);
+            copy->data.forData->conditionalAst = tf_copy_replacing(forData->conditionalAst, replacements, count);
+            copy->data.forData->afterthoughtAst = tf_copy_replacing(forData->afterthoughtAst, replacements, count);
+            copied = (forData->definitionAst == NULL || copy->data.forData->definitionAst != NULL)
+                     && copy->data.forData->conditionalAst != NULL
+                     && (forData->afterthoughtAst == NULL || copy->data.forData->afterthoughtAst != NULL)
+                     && tf_copy_branch(forData->bodyStatement, copy, &copy->data.forData->bodyStatement,
+                                       replacements, count);
+            break;
+        }
+    }
+
+    if (!copied && stat->statementType == CF_FOR && copy->data.forData == NULL) {
+        // clean_stat() would only free the header table together with the FOR data
+        if (copy->localSymbolTable != NULL) {
+            symtable_free(copy->localSymbolTable);
+        }
+        free(copy);
+        return NULL;
+    }
+    if (!copied) {
+        clean_stat(copy, table);
+        return NULL;
+    }
+    return copy;
+}
+
+// Creates an empty statement with a new scope, the first statement of a branch of the IF.
+static CFStatement *tf_new_branch(CFStatement *owner) {
+    CFStatement *first = calloc(1, sizeof(CFStatement));
+    SymbolTable *table = first == NULL ? NULL : symtable_init(TF_TABLE_SIZE);
+    if (table == NULL) {
+        free(first);
+        return NULL;
+    }
+
+    first->parentFunction = owner->parentFunction;
+    first->parentStatement = owner;
+    first->parentBranchStatement = owner;
+    first->localSymbolTable = table;
+    first->statementType = CF_BASIC;
+    return first;
+}
+
+// Frees the first statement of a branch created by tf_new_branch() together with its scope.
+static void tf_free_branch(CFStatement *first) {
+    if (first != NULL) {
+        symtable_free(first->localSymbolTable);
+        free(first);
+    }
+}
+
+CFStatement *tf_split_statement(CFStatement *stat, ASTNode *condition, const TFReplacement *replacements,
+                                unsigned count) {
+    CFStatement *ifStat = calloc(1, sizeof(CFStatement));
+    CFStatementIf *ifData = calloc(1, sizeof(CFStatementIf));
+    CFStatement *thenFirst = ifStat == NULL ? NULL : tf_new_branch(ifStat);
+    CFStatement *elseFirst = ifStat == NULL ? NULL : tf_new_branch(ifStat);
+    CFStatement *copy = NULL;
+    if (elseFirst != NULL) {
+        // Only the statement is copied, without the following ones
+        CFStatement *following = stat->followingStatement;
+        stat->followingStatement = NULL;
+        copy = tf_copy_statements(stat, stat->parentFunction, elseFirst->localSymbolTable, replacements, count);
+        stat->followingStatement = following;
+    }
+    if (ifData == NULL || thenFirst == NULL || copy == NULL) {
+        tf_free_branch(thenFirst);
+        tf_free_branch(elseFirst);
+        free(ifData);
+        free(ifStat);
+        return NULL;
+    }
+
+    ifStat->parentFunction = stat->parentFunction;
+    ifStat->localSymbolTable = tf_scope_table(stat);
+    ifStat->statementType = CF_IF;
+    ifStat->data.ifData = ifData;
+    ifData->conditionalAst = condition;
+    ifData->thenStatement = thenFirst;
+    ifData->elseStatement = elseFirst;
+
+    // The IF takes the place of the statement
+    *tf_statement_link(stat) = ifStat;
+    ifStat->parentStatement = stat->parentStatement;
+    ifStat->parentBranchStatement = stat->parentBranchStatement;
+    ifStat->followingStatement = stat->followingStatement;
+    if (stat->followingStatement != NULL) {
+        stat->followingStatement->parentStatement = ifStat;
+    }
+
+    thenFirst->followingStatement = stat;
+    stat->parentStatement = thenFirst;
+    stat->parentBranchStatement = ifStat;
+    stat->followingStatement = NULL;
+    elseFirst->followingStatement = copy;
+    copy->parentStatement = elseFirst;
+    copy->parentBranchStatement = ifStat;
+    return ifStat;
+}
+
+bool tf_reserve(void **array, unsigned *capacity, unsigned count, size_t itemSize) {
+    if (count < *capacity) {
+        return true;
+    }
+
+    unsigned newCapacity = *capacity == 0 ? TF_CHUNK : *capacity * 2;
+    while (newCapacity <= count) {
+        newCapacity *= 2;
+    }
+    void *newArray = realloc(*array, newCapacity * itemSize);
+    if (newArray == NULL) {
+        return false;
+    }
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Adds the variables of the symbol table to the array.
+static bool tf_add_table_variables(TFVariables *variables, SymbolTable *table) {
+    for (STItem *item = symtable_get_first_item(table); item != NULL; item = symtable_get_next_item(table, item)) {
+        if (item->data.type != ST_SYMBOL_VAR) {
+            continue;
+        }
+        if (!tf_reserve((void **) &variables->items, &variables->capacity, variables->count, sizeof(STSymbol *))) {
+            return false;
+        }
+        variables->items[variables->count++] = &item->data;
+    }
+    return true;
+}
+
+// Adds the variables of the scopes nested in the statements of the chain.
+static bool tf_add_nested_variables(TFVariables *variables, CFStatement *first) {
+    for (CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        bool added = true;
+        if (stat->statementType == CF_IF) {
+            CFStatementIf *ifData = stat->data.ifData;
+            added = ifData->thenStatement == NULL || tf_add_scope_variables(variables, ifData->thenStatement);
+            if (added && ifData->elseStatement != NULL && ifData->elseStatement->statementType == CF_IF) {
+                // An else-if belongs to the scope of its IF
+                added = tf_add_nested_variables(variables, ifData->elseStatement);
+            } else if (added && ifData->elseStatement != NULL) {
+                added = tf_add_scope_variables(variables, ifData->elseStatement);
+            }
+        } else if (stat->statementType == CF_FOR) {
+            CFStatement *body = stat->data.forData->bodyStatement;
+            added = tf_add_table_variables(variables, stat->localSymbolTable)
+                    && (body == NULL || tf_add_scope_variables(variables, body));
+        }
+        if (!added) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool tf_add_scope_variables(TFVariables *variables, CFStatement *first) {
+    return tf_add_table_variables(variables, tf_scope_table(first)) && tf_add_nested_variables(variables, first);
+}
+
+STSymbol *tf_new_temporary(CFFunction *fun, const char *prefix, STDataType type) {
+    char name[64];
+    unsigned number = 0;
+    do {
+        snprintf(name, sizeof(name), "$%s%u", prefix, number++);
+    } while (symtable_find(fun->symbolTable, name) != NULL);
+
+    STItem *item = symtable_add(fun->symbolTable, name, ST_SYMBOL_VAR);
+    if (item == NULL) {
+        return NULL;
+    }
+    item->data.data.var_data.type = type;
+    return &item->data;
+}
+
+bool tf_is_pure_builtin_call(const ASTNode *call) {
+    static const char *pureBuiltins[] = {"len", "ord", "chr", "substr", "int2float", "float2int"};
+
+    const STSymbol *function = call->left->data[0].symbolTableItemPtr;
+    if (function == NULL || function->data.func_data.cf_function != NULL) {
+        return false;
+    }
+    for (unsigned i = 0; i < sizeof(pureBuiltins) / sizeof(pureBuiltins[0]); i++) {
+        if (strcmp(function->identifier, pureBuiltins[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool tf_is_computation(const ASTNode *node) {
+    if (node->actionType == AST_FUNC_CALL) {
+        return tf_is_pure_builtin_call(node)
+               && node->left->data[0].symbolTableItemPtr->data.func_data.ret_types_count == 1;
+    }
+    return node->actionType < AST_CONTROL;
+}
+
+unsigned long tf_ast_size(const ASTNode *ast) {
+    if (ast == NULL) {
+        return 0;
+    }
+    if (ast->actionType == AST_LIST) {
+        unsigned long size = 1;
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            size += tf_ast_size(ast->data[i].astPtr);
+        }
+        return size;
+    }
+    return 1 + tf_ast_size(ast->left) + tf_ast_size(ast->right);
+}
+
+unsigned long tf_statements_size(const CFStatement *first) {
+    unsigned long size = 0;
+    for (const CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        size++;
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                size += tf_ast_size(stat->data.bodyAst);
+                break;
+            case CF_IF:
+                size += tf_ast_size(stat->data.ifData->conditionalAst)
+                        + tf_statements_size(stat->data.ifData->thenStatement)
+                        + tf_statements_size(stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR: {
+                const CFStatementFor *forData = stat->data.forData;
+                size += tf_ast_size(forData->definitionAst) + tf_ast_size(forData->conditionalAst)
+                        + tf_ast_size(forData->afterthoughtAst) + tf_statements_size(forData->bodyStatement);
+                break;
+            }
+        }
+    }
+    return size;
+}
+
+bool tf_has_impure_call(const ASTNode *ast) {
+    if (ast == NULL) {
+        return false;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (tf_has_impure_call(ast->data[i].astPtr)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (ast->actionType == AST_FUNC_CALL) {
+        return !tf_is_pure_builtin_call(ast) || tf_has_impure_call(ast->right);
+    }
+    return tf_has_impure_call(ast->left) || tf_has_impure_call(ast->right);
+}
+
+bool tf_is_float_zero(double value) {
+    return value > -1e-10 && value < 1e-10;
+}
+
+bool tf_may_fail(const ASTNode *ast) {
+    if (ast == NULL) {
+        return false;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (tf_may_fail(ast->data[i].astPtr)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (ast->actionType == AST_DIVIDE) {
+        // Only a constant divisor other than zero (and -1, which overflows the smallest integer) is safe
+        const ASTNode *divisor = ast->right;
+        bool safe = false;
+        if (divisor->actionType == AST_CONST_INT) {
+            safe = divisor->data[0].intConstantValue != 0 && divisor->data[0].intConstantValue != -1;
+        } else if (divisor->actionType == AST_CONST_FLOAT) {
+            safe = !tf_is_float_zero(divisor->data[0].floatConstantValue);
+        }
+        return !safe || tf_may_fail(ast->left);
+    }
+    if (ast->actionType == AST_FUNC_CALL) {
+        return strcmp(ast->left->data[0].symbolTableItemPtr->identifier, "float2int") == 0
+               || tf_may_fail(ast->right);
+    }
+    return tf_may_fail(ast->left) || tf_may_fail(ast->right);
+}
+
+bool tf_equal(const ASTNode *a, const ASTNode *b) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (a->actionType != b->actionType || a->dataCount != b->dataCount) {
+        return false;
+    }
+
+    switch (a->actionType) {
+        case AST_LIST:
+            for (unsigned i = 0; i < a->dataCount; i++) {
+                if (!tf_equal(a->data[i].astPtr, b->data[i].astPtr)) {
+                    return false;
+                }
+            }
+            return true;
+        case AST_ID:
+            return a->inheritedDataType != CF_BLACK_HOLE && b->inheritedDataType != CF_BLACK_HOLE
+                   && a->data[0].symbolTableItemPtr == b->data[0].symbolTableItemPtr;
+        case AST_CONST_INT:
+            return a->data[0].intConstantValue == b->data[0].intConstantValue;
+        case AST_CONST_FLOAT:
+            return memcmp(&a->data[0].floatConstantValue, &b->data[0].floatConstantValue, sizeof(double)) == 0;
+        case AST_CONST_STRING:
+            return strcmp(a->data[0].stringConstantValue, b->data[0].stringConstantValue) == 0;
+        case AST_CONST_BOOL:
+            return a->data[0].boolConstantValue == b->data[0].boolConstantValue;
+        default:
+            return tf_equal(a->left, b->left) && tf_equal(a->right, b->right);
+    }
+}
+
+bool tf_assigns(const ASTNode *ast, const STSymbol *variable) {
+    if (ast == NULL || (ast->actionType != AST_ASSIGN && ast->actionType != AST_DEFINE)) {
+        return false;
+    }
+    if (ast->left->actionType == AST_ID) {
+        return ast->left->data[0].symbolTableItemPtr == variable;
+    }
+    for (unsigned i = 0; i < ast->left->dataCount; i++) {
+        const ASTNode *target = ast->left->data[i].astPtr;
+        if (target->inheritedDataType != CF_BLACK_HOLE && target->data[0].symbolTableItemPtr == variable) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool tf_statements_assign(const CFStatement *first, const STSymbol *variable) {
+    for (const CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        switch (stat->statementType) {
+            case CF_BASIC:
+                if (tf_assigns(stat->data.bodyAst, variable)) {
+                    return true;
+                }
+                break;
+            case CF_IF:
+                if (tf_statements_assign(stat->data.ifData->thenStatement, variable)
+                    || tf_statements_assign(stat->data.ifData->elseStatement, variable)) {
+                    return true;
+                }
+                break;
+            case CF_FOR:
+                if (tf_assigns(stat->data.forData->definitionAst, variable)
+                    || tf_assigns(stat->data.forData->afterthoughtAst, variable)
+                    || tf_statements_assign(stat->data.forData->bodyStatement, variable)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+static void tf_check_ast_divisors(ASTNode *ast) {
+    if (ast == NULL) {
+        return;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            tf_check_ast_divisors(ast->data[i].astPtr);
+        }
+        return;
+    }
+    if (ast->actionType == AST_DIVIDE) {
+        ast->divisorChecked = true;
+    }
+    if (ast->actionType != AST_ID) {
+        tf_check_ast_divisors(ast->left);
+        tf_check_ast_divisors(ast->right);
+    }
+}
+
+void tf_check_divisors(CFStatement *first) {
+    for (CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        switch (stat->statementType) {
+            case CF_BASIC:
+            case CF_RETURN:
+                tf_check_ast_divisors(stat->data.bodyAst);
+                break;
+            case CF_IF:
+                tf_check_ast_divisors(stat->data.ifData->conditionalAst);
+                tf_check_divisors(stat->data.ifData->thenStatement);
+                tf_check_divisors(stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                tf_check_ast_divisors(stat->data.forData->definitionAst);
+                tf_check_ast_divisors(stat->data.forData->conditionalAst);
+                tf_check_ast_divisors(stat->data.forData->afterthoughtAst);
+                tf_check_divisors(stat->data.forData->bodyStatement);
+                break;
+        }
+    }
+}
+
+ASTNode *tf_read(STSymbol *variable) {
+    ASTNode *node = ast_leaf_id(variable);
+    if (node != NULL) {
+        symtable_symbol_ref(variable);
+    }
+    return node;
+}
+
+// Returns the variable read of a compound assignment that isn't counted as a reference: its target
+// on the left side of the operation (or the whole value if the operation has been folded to it).
+static ASTNode *tf_uncounted_read(ASTNode *root) {
+    if (root == NULL || root->actionType != AST_ASSIGN || root->left == NULL || root->left->actionType != AST_ID
+        || root->right == NULL) {
+        return NULL;
+    }
+
+    STSymbol *target = root->left->data[0].symbolTableItemPtr;
+    ASTNode *value = root->right;
+    if (value->actionType == AST_ID) {
+        return value->data[0].symbolTableItemPtr == target ? value : NULL;
+    }
+    if (value->left != NULL && value->left->actionType == AST_ID
+        && value->left->data[0].symbolTableItemPtr == target) {
+        return value->left;
+    }
+    return NULL;
+}
+
+// Finds the replacement of the variable, returns NULL if it's kept.
+static const TFReplacement *tf_find_replacement(const STSymbol *variable, const TFReplacement *replacements,
+                                                unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        if (replacements[i].variable == variable) {
+            return &replacements[i];
+        }
+    }
+    return NULL;
+}
+
+// Copies the AST. The targets of assignments and the uncounted read of a compound assignment aren't counted
+// as references (see tf_detach()), all the other variable reads are.
+static ASTNode *tf_copy_node(const ASTNode *ast, const TFReplacement *replacements, unsigned count,
+                             bool counted, const ASTNode *uncounted) {
+    if (ast == NULL) {
+        return NULL;
+    }
+
+    if (ast->actionType == AST_ID && ast->inheritedDataType != CF_BLACK_HOLE) {
+        const TFReplacement *replacement = tf_find_replacement(ast->data[0].symbolTableItemPtr, replacements, count);
+        if (replacement != NULL && replacement->value != NULL) {
+            return tf_copy_node(replacement->value, NULL, 0, true, NULL);
+        }
+    }
+
+    ASTNode *copy = ast_node_data(ast->actionType, ast->dataCount);
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy->inheritedDataType = ast->inheritedDataType;
+    copy->hasInnerFuncCalls = ast->hasInnerFuncCalls;
+    copy->divisorNonZero = ast->divisorNonZero;
+    copy->divisorChecked = ast->divisorChecked;
+    for (unsigned i = 0; i < count && ast->actionType == AST_DIVIDE; i++) {
+        // The copy may be specialised for a value that the original division never divides by
+        copy->divisorChecked |= replacements[i].value != NULL;
+    }
+    copy->dataPointerIndex = ast->dataPointerIndex;
+
+    switch (ast->actionType) {
+        case AST_LIST:
+            for (unsigned i = 0; i < ast->dataCount; i++) {
+                if (ast->data[i].astPtr == NULL) {
+                    continue;
+                }
+                copy->data[i].astPtr = tf_copy_node(ast->data[i].astPtr, replacements, count, counted, uncounted);
+                if (copy->data[i].astPtr == NULL) {
+                    clean_ast(copy);
+                    return NULL;
+                }
+                copy->data[i].astPtr->parent = copy;
+            }
+            return copy;
+        case AST_CONST_STRING: {
+            char *string = malloc(strlen(ast->data[0].stringConstantValue) + 1);
+            if (string == NULL) {
+                free(copy);
+                return NULL;
+            }
+            strcpy(string, ast->data[0].stringConstantValue);
+            copy->data[0].stringConstantValue = string;
+            return copy;
+        }
+        case AST_ID:
+            copy->data[0] = ast->data[0];
+            if (ast->inheritedDataType != CF_BLACK_HOLE) {
+                const TFReplacement *replacement = tf_find_replacement(ast->data[0].symbolTableItemPtr,
+                                                                       replacements, count);
+                if (replacement != NULL) {
+                    copy->data[0].symbolTableItemPtr = replacement->replacement;
+                }
+                if (counted && ast != uncounted) {
+                    symtable_symbol_ref(copy->data[0].symbolTableItemPtr);
+                }
+            }
+            return copy;
+        case AST_CONST_INT:
+        case AST_CONST_FLOAT:
+        case AST_CONST_BOOL:
+            copy->data[0] = ast->data[0];
+            return copy;
+        case AST_ASSIGN:
+        case AST_DEFINE:
+            copy->left = tf_copy_node(ast->left, replacements, count, false, NULL);
+            copy->right = tf_copy_node(ast->right, replacements, count, true,
+                                       tf_uncounted_read((ASTNode *) ast));
+            break;
+        default:
+            copy->left = tf_copy_node(ast->left, replacements, count, counted, uncounted);
+            copy->right = tf_copy_node(ast->right, replacements, count, counted, uncounted);
+            break;
+    }
+
+    if ((ast->left != NULL && copy->left == NULL) || (ast->right != NULL && copy->right == NULL)) {
+        clean_ast(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+ASTNode *tf_copy(const ASTNode *ast) {
+    return tf_copy_node(ast, NULL, 0, true, NULL);
+}
+
+ASTNode *tf_copy_replacing(const ASTNode *ast, const TFReplacement *replacements, unsigned count) {
+    return tf_copy_node(ast, replacements, count, true, NULL);
+}
+
+ASTNode *tf_const_int(int64_t value) {
+    return ast_leaf_single_data(AST_CONST_INT, (ASTNodeData) {.intConstantValue = value});
+}
+
+// Creates a definition or an assignment of the value list to the variables, see tf_define().
+static ASTNode *tf_assignment(ASTNodeType type, STSymbol **variables, unsigned count, ASTNode *values) {
+    ASTNode *assignment = ast_node(type);
+    ASTNode *targets = ast_node_list(count);
+    if (assignment == NULL || targets == NULL) {
+        free(assignment);
+        free(targets);
+        clean_ast(values);
+        return NULL;
+    }
+
+    assignment->left = targets;
+    assignment->right = values;
+    for (unsigned i = 0; i < count; i++) {
+        ASTNode *target = ast_leaf_id(variables[i]);
+        if (target == NULL) {
+            clean_ast(assignment);
+            return NULL;
+        }
+        ast_push_to_list(targets, target);
+    }
+
+    ast_infer_node_type(assignment);
+    return assignment;
+}
+
+ASTNode *tf_define(STSymbol **variables, unsigned count, ASTNode *values) {
+    return tf_assignment(AST_DEFINE, variables, count, values);
+}
+
+ASTNode *tf_assign_list(STSymbol **variables, unsigned count, ASTNode *values) {
+    return tf_assignment(AST_ASSIGN, variables, count, values);
+}
+
+ASTNode *tf_assign(STSymbol *variable, ASTNode *value) {
+    ASTNode *assign = ast_node(AST_ASSIGN);
+    ASTNode *targets = ast_node_list(1);
+    ASTNode *values = ast_node_list(1);
+    ASTNode *target = ast_leaf_id(variable);
+    if (assign == NULL || targets == NULL || values == NULL || target == NULL) {
+        free(assign);
+        free(targets);
+        free(values);
+        free(target);
+        clean_ast(value);
+        return NULL;
+    }
+
+    ast_push_to_list(targets, target);
+    ast_push_to_list(values, value);
+    assign->left = targets;
+    assign->right = values;
+    ast_infer_node_type(assign);
+    return assign;
+}
+
+static bool tf_contains(const ASTNode *ast, const ASTNode *node) {
+    if (ast == NULL) {
+        return false;
+    }
+    if (ast == node) {
+        return true;
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (tf_contains(ast->data[i].astPtr, node)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return tf_contains(ast->left, node) || tf_contains(ast->right, node);
+}
+
+ASTNode *tf_detach(ASTNode *root, ASTNode **slot, ASTNode *replacement) {
+    ASTNode *subtree = *slot;
+    ASTNode *uncounted = tf_uncounted_read(root);
+    if (uncounted != NULL && tf_contains(subtree, uncounted)) {
+        symtable_symbol_ref(uncounted->data[0].symbolTableItemPtr);
+    }
+
+    *slot = replacement;
+    return subtree;
+}
+
+void tf_replace(ASTNode *root, ASTNode **slot, ASTNode *replacement) {
+    clean_ast(tf_detach(root, slot, replacement));
+}
+
+void tf_count_compound_read(ASTNode *root) {
+    ASTNode *uncounted = tf_uncounted_read(root);
+    if (uncounted != NULL) {
+        symtable_symbol_ref(uncounted->data[0].symbolTableItemPtr);
+    }
+}
+
+void tf_uncount_compound_read(ASTNode *root) {
+    ASTNode *uncounted = tf_uncounted_read(root);
+    if (uncounted != NULL) {
+        symtable_symbol_unref(uncounted->data[0].symbolTableItemPtr);
+    }
+}
+
+// Recomputes the flags of the subtree, returns whether the subtree is a call or contains one.
+static bool tf_update_subtree_calls(ASTNode *ast) {
+    if (ast == NULL) {
+        return false;
+    }
+
+    bool hasCalls = false;
+    if (ast->actionType == AST_LIST) {
+        // A list is only flagged if its items contain calls, not if they are calls
+        bool flagged = false;
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            ASTNode *item = ast->data[i].astPtr;
+            hasCalls |= tf_update_subtree_calls(item);
+            flagged |= item != NULL && item->hasInnerFuncCalls;
+        }
+        ast->hasInnerFuncCalls = flagged;
+        return hasCalls;
+    }
+
+    if (ast->actionType != AST_FUNC_CALL) {
+        hasCalls |= tf_update_subtree_calls(ast->left);
+    }
+    hasCalls |= tf_update_subtree_calls(ast->right);
+    ast->hasInnerFuncCalls = hasCalls;
+    return hasCalls || ast->actionType == AST_FUNC_CALL;
+}
+
+void tf_update_calls(ASTNode *ast) {
+    tf_update_subtree_calls(ast);
+}
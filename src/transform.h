@@ -0,0 +1,173 @@
+/** @file transform.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of helper functions for the optimisations that rewrite the statements of functions.
+ */
+
+#ifndef _TRANSFORM_H
+#define _TRANSFORM_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+// Checks whether a new statement may be inserted before the statement. It's not possible for an IF that is
+// the ELSE branch of another IF (else if), as the ELSE branch would no longer be an IF.
+bool tf_can_insert_before(const CFStatement *stat);
+
+// Inserts a new basic statement with the specified body before the statement, in the same scope.
+// Returns NULL if memory couldn't be allocated (the body is not freed in this case).
+CFStatement *tf_insert_before(CFStatement *stat, ASTNode *body);
+
+// Inserts a new basic statement with the specified body after the statement, in the same scope.
+// Returns NULL if memory couldn't be allocated (the body is not freed in this case).
+CFStatement *tf_insert_after(CFStatement *stat, ASTNode *body);
+
+// Returns the symbol table of the scope the statement belongs to. A FOR statement has its own table
+// for the variables of its definition, so the scope of the closest preceding non-FOR statement is used.
+SymbolTable *tf_scope_table(CFStatement *stat);
+
+// Inserts the chain of statements (linked by their followingStatement) before the statement, in the same scope.
+// The statements must already use the symbol table of the scope.
+void tf_insert_statements_before(CFStatement *stat, CFStatement *first);
+
+// Checks whether the variable's name refers to the variable in the statement: the variable is in one of the scopes
+// enclosing the statement and no closer scope has a variable of the same name. The code generator finds
+// the variables by their names.
+bool tf_is_visible(CFStatement *stat, const STSymbol *variable);
+
+// Takes the statement out of the statement tree and frees it. It must not be the only statement of a branch.
+void tf_remove_statement(CFStatement *stat);
+
+// Checks whether the basic statement may be removed by tf_remove_statement(). The first statement of a function
+// determines the scope of its variables and whether the code generator considers the function empty, so it may only
+// be replaced with the following statement if that one is a non-empty basic statement or a return.
+bool tf_can_remove_statement(const CFStatement *stat);
+
+// A variable replaced in the copies made by tf_copy_replacing() and tf_copy_statements(). If the value is set,
+// the reads of the variable are replaced with copies of it (the variable must not be assigned in the copied code)
+// and the zero divisors of the copied divisions are left to the runtime check (see ASTNode.divisorChecked).
+// Otherwise, all the occurrences of the variable are replaced with the replacement variable.
+typedef struct tf_replacement {
+    STSymbol *variable;
+    STSymbol *replacement;
+    const ASTNode *value;
+} TFReplacement;
+
+// Creates a deep copy of the statement chain (linked by their followingStatement) in the function. The copied
+// statements use the specified symbol table, the nested branches and FOR statements get new empty tables, so
+// the variables defined in them must be replaced. Returns NULL if memory couldn't be allocated.
+CFStatement *tf_copy_statements(const CFStatement *first, CFFunction *fun, SymbolTable *table,
+                                const TFReplacement *replacements, unsigned count);
+
+// Replaces the statement with a new IF statement with the condition. The statement is moved into its THEN branch and
+// its copy (see tf_copy_statements()) is put into its ELSE branch. Both branches are new scopes that start with
+// an empty statement, like the branches created by the parser. Returns NULL if memory couldn't be allocated
+// (the statement tree is unchanged and the condition is not freed in this case).
+CFStatement *tf_split_statement(CFStatement *stat, ASTNode *condition, const TFReplacement *replacements,
+                                unsigned count);
+
+// Grows the array so that it can hold more than count items (at least up to the index count), doubling
+// its capacity. Returns false if memory couldn't be allocated (the array is unchanged in this case).
+bool tf_reserve(void **array, unsigned *capacity, unsigned count, size_t itemSize);
+
+// A growing array of variables.
+typedef struct tf_variables {
+    STSymbol **items;
+    unsigned count;
+    unsigned capacity;
+} TFVariables;
+
+// Adds the variables defined in the scopes of the statement chain to the array: the scope of the first statement,
+// the branches of the IFs and the headers and bodies of the FORs in it (recursively). Returns false if memory
+// couldn't be allocated.
+bool tf_add_scope_variables(TFVariables *variables, CFStatement *first);
+
+// Adds a new variable of the specified type to the top-level symbol table of the function. Its name starts with
+// a '$' so it can't collide with variables of the program. Returns NULL if memory couldn't be allocated.
+STSymbol *tf_new_temporary(CFFunction *fun, const char *prefix, STDataType type);
+
+// Checks whether the AST_FUNC_CALL node calls a built-in function without side effects (len, ord, chr, substr,
+// int2float or float2int). The result of such a call only depends on its arguments.
+bool tf_is_pure_builtin_call(const ASTNode *call);
+
+// Checks whether the node computes a single value without side effects: an operation or a call of a pure built-in
+// function with one return value.
+bool tf_is_computation(const ASTNode *node);
+
+// Returns the number of nodes of the AST.
+unsigned long tf_ast_size(const ASTNode *ast);
+
+// Returns the number of statements and AST nodes of the statement chain (linked by their followingStatement),
+// including the nested ones.
+unsigned long tf_statements_size(const CFStatement *first);
+
+// Checks whether the AST calls a function other than the pure built-ins.
+bool tf_has_impure_call(const ASTNode *ast);
+
+// Checks whether the float constant is zero for the folding of the optimiser, which reports the division by it
+// as an error. Its value is not folded by the other passes either.
+bool tf_is_float_zero(double value);
+
+// Checks whether evaluating the AST may stop the program with a runtime error (division by a variable
+// or float2int).
+bool tf_may_fail(const ASTNode *ast);
+
+// Checks whether the ASTs are the same: the same operations on the same variables and constants.
+bool tf_equal(const ASTNode *a, const ASTNode *b);
+
+// Checks whether the assignment (or definition) assigns the variable. Returns false for other ASTs (or NULL).
+bool tf_assigns(const ASTNode *ast, const STSymbol *variable);
+
+// Checks whether a statement of the chain (linked by their followingStatement) or a statement nested in them
+// assigns the variable.
+bool tf_statements_assign(const CFStatement *first, const STSymbol *variable);
+
+// Leaves the zero divisors of the divisions in the statement chain (and in the statements nested in them) to
+// the runtime check, as the code was specialised for values it may never run with (see ASTNode.divisorChecked).
+void tf_check_divisors(CFStatement *first);
+
+// Creates an AST_ID node reading the variable and counts the reference.
+ASTNode *tf_read(STSymbol *variable);
+
+// Creates a deep copy of the AST, counting the references of the variables it reads. Returns NULL if memory
+// couldn't be allocated.
+ASTNode *tf_copy(const ASTNode *ast);
+
+// Creates a deep copy of the AST with the variables replaced (see TFReplacement).
+ASTNode *tf_copy_replacing(const ASTNode *ast, const TFReplacement *replacements, unsigned count);
+
+// Creates an integer constant node (ast_leaf_consti() only takes an int).
+ASTNode *tf_const_int(int64_t value);
+
+// Creates a definition (AST_DEFINE) of the variables from the value list and infers its type.
+// The value list is owned by the definition, even if it couldn't be created.
+ASTNode *tf_define(STSymbol **variables, unsigned count, ASTNode *values);
+
+// Creates an assignment (AST_ASSIGN) of the value list to the variables and infers its type.
+// The value list is owned by the assignment, even if it couldn't be created.
+ASTNode *tf_assign_list(STSymbol **variables, unsigned count, ASTNode *values);
+
+// Creates an assignment (AST_ASSIGN) of the value to the variable and infers its type.
+// The value is owned by the assignment, even if it couldn't be created.
+ASTNode *tf_assign(STSymbol *variable, ASTNode *value);
+
+// Takes the subtree in the slot out of the AST of an instruction (root) and puts the replacement into the slot.
+// Returns the subtree. The variable read by a compound assignment (e.g. a += 1) isn't counted as a reference,
+// so it gets counted when it leaves the assignment.
+ASTNode *tf_detach(ASTNode *root, ASTNode **slot, ASTNode *replacement);
+
+// Replaces the subtree in the slot of an instruction's AST (root) and frees it.
+void tf_replace(ASTNode *root, ASTNode **slot, ASTNode *replacement);
+
+// Counts the variable read by a compound assignment (see tf_detach()) as a reference, so that the value of the
+// instruction's AST (root) can be restructured freely. tf_uncount_compound_read() must be called afterwards.
+void tf_count_compound_read(ASTNode *root);
+
+// Stops counting the variable read by a compound assignment once the value has been restructured.
+void tf_uncount_compound_read(ASTNode *root);
+
+// Recomputes the hasInnerFuncCalls flags of the AST after its subtrees have been replaced.
+void tf_update_calls(ASTNode *ast);
+
+#endif // _TRANSFORM_H
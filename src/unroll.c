@@ -0,0 +1,489 @@
+/** @file unroll.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the unrolling of FOR loops with constant trip counts.
+ */
+
+#include <stdlib.h>
+#include "unroll.h"
+#include "transform.h"
+
+// Numbers of copies of the body tried when the loop can't be unrolled fully, the largest first.
+static const unsigned unrollFactors[] = {4, 2};
+
+// A loop whose number of iterations is known.
+typedef struct unroll_loop {
+    CFStatement *statement;
+    STSymbol *variable; // The variable defined by the FOR definition.
+    int64_t initial;
+    int64_t step;
+    uint64_t trips;
+} UnrollLoop;
+
+// The body of a loop.
+typedef struct unroll_body {
+    unsigned long size;   // Number of AST nodes (and statements) in the body.
+    bool assignsVariable; // Whether the body assigns the loop variable.
+    bool hasReturn;
+
+    TFVariables locals;          // Variables defined in the scopes of the body.
+    TFReplacement *replacements; // The replacements of the locals (and the loop variable) in a copy of the body.
+} UnrollBody;
+
+typedef struct unroll_context {
+    CFFunction *fun;
+    unsigned budget;
+    unsigned unrolled;
+    bool failed;
+} UnrollContext;
+
+// Returns the constant added to the variable by the value of its assignment (i + c, c + i or i - c).
+static bool unroll_step(const ASTNode *value, const STSymbol *variable, int64_t *step) {
+    if (value == NULL || (value->actionType != AST_ADD && value->actionType != AST_SUBTRACT)) {
+        return false;
+    }
+
+    const ASTNode *read = value->left;
+    const ASTNode *constant = value->right;
+    if (value->actionType == AST_ADD && read->actionType == AST_CONST_INT) {
+        read = value->right;
+        constant = value->left;
+    }
+    if (read->actionType != AST_ID || read->data[0].symbolTableItemPtr != variable
+        || constant->actionType != AST_CONST_INT) {
+        return false;
+    }
+
+    int64_t c = constant->data[0].intConstantValue;
+    if (value->actionType == AST_SUBTRACT) {
+        if (c == INT64_MIN) {
+            return false;
+        }
+        c = -c;
+    }
+    *step = c;
+    return c != 0;
+}
+
+// Evaluates the relation of two integers.
+static bool unroll_compare(ASTNodeType relation, int64_t a, int64_t b) {
+    switch (relation) {
+        case AST_LOG_LT:
+            return a < b;
+        case AST_LOG_LTE:
+            return a <= b;
+        case AST_LOG_GT:
+            return a > b;
+        case AST_LOG_GTE:
+            return a >= b;
+        case AST_LOG_EQ:
+            return a == b;
+        default:
+            return a != b;
+    }
+}
+
+// Returns the relation with swapped operands (c < i is the same as i > c).
+static ASTNodeType unroll_mirror(ASTNodeType relation) {
+    switch (relation) {
+        case AST_LOG_LT:
+            return AST_LOG_GT;
+        case AST_LOG_LTE:
+            return AST_LOG_GTE;
+        case AST_LOG_GT:
+            return AST_LOG_LT;
+        case AST_LOG_GTE:
+            return AST_LOG_LTE;
+        default:
+            return relation;
+    }
+}
+
+// Computes the number of iterations of the loop whose variable is compared with the limit by the relation.
+// Returns false if it can't be determined or the variable would overflow.
+static bool unroll_trip_count(UnrollLoop *loop, ASTNodeType relation, int64_t limit) {
+    int64_t step = loop->step;
+    int64_t distance;
+    if (__builtin_sub_overflow(limit, loop->initial, &distance)) {
+        return false;
+    }
+
+    uint64_t trips;
+    if (!unroll_compare(relation, loop->initial, limit)) {
+        trips = 0;
+    } else {
+        switch (relation) {
+            case AST_LOG_LT:
+            case AST_LOG_GT:
+                // The distance is non-zero and has the same sign as the step
+                if ((relation == AST_LOG_LT) != (step > 0)) return false;
+                trips = (uint64_t) ((distance + (step > 0 ? -1 : 1)) / step) + 1;
+                break;
+            case AST_LOG_LTE:
+            case AST_LOG_GTE:
+                if ((relation == AST_LOG_LTE) != (step > 0)) return false;
+                trips = (uint64_t) (distance / step) + 1;
+                break;
+            case AST_LOG_EQ:
+                trips = 1;
+                break;
+            default:
+                // The variable must hit the limit exactly
+                if (distance % step != 0 || distance / step <= 0) return false;
+                trips = (uint64_t) (distance / step);
+                break;
+        }
+    }
+
+    // The variable must not overflow in the last afterthought
+    int64_t offset, final;
+    if (trips > INT64_MAX || __builtin_mul_overflow((int64_t) trips, step, &offset)
+        || __builtin_add_overflow(loop->initial, offset, &final)) {
+        return false;
+    }
+    loop->trips = trips;
+    return true;
+}
+
+// Checks whether the FOR statement has a constant number of iterations and fills the loop description.
+static bool unroll_analyse_header(CFStatement *stat, UnrollLoop *loop) {
+    CFStatementFor *forData = stat->data.forData;
+    const ASTNode *definition = forData->definitionAst;
+    const ASTNode *afterthought = forData->afterthoughtAst;
+    const ASTNode *condition = forData->conditionalAst;
+    if (definition == NULL || afterthought == NULL || condition == NULL) {
+        return false;
+    }
+
+    // i := c
+    if (definition->left->dataCount != 1 || definition->right->dataCount != 1
+        || definition->left->data[0].astPtr->inheritedDataType == CF_BLACK_HOLE
+        || definition->right->data[0].astPtr->actionType != AST_CONST_INT) {
+        return false;
+    }
+    loop->statement = stat;
+    loop->variable = definition->left->data[0].astPtr->data[0].symbolTableItemPtr;
+    loop->initial = definition->right->data[0].astPtr->data[0].intConstantValue;
+
+    // i += c, i -= c, i = i + c or i = i - c
+    const ASTNode *target = afterthought->left;
+    const ASTNode *value = afterthought->right;
+    if (target->actionType == AST_LIST) {
+        if (target->dataCount != 1 || value->dataCount != 1) {
+            return false;
+        }
+        target = target->data[0].astPtr;
+        value = value->data[0].astPtr;
+    }
+    if (target->actionType != AST_ID || target->data[0].symbolTableItemPtr != loop->variable
+        || !unroll_step(value, loop->variable, &loop->step)) {
+        return false;
+    }
+
+    // i REL c or c REL i
+    if (condition->actionType < AST_LOG_EQ || condition->actionType > AST_LOG_GTE) {
+        return false;
+    }
+    ASTNodeType relation = condition->actionType;
+    const ASTNode *read = condition->left;
+    const ASTNode *limit = condition->right;
+    if (limit->actionType == AST_ID) {
+        read = condition->right;
+        limit = condition->left;
+        relation = unroll_mirror(relation);
+    }
+    if (read->actionType != AST_ID || read->data[0].symbolTableItemPtr != loop->variable
+        || limit->actionType != AST_CONST_INT) {
+        return false;
+    }
+
+    return unroll_trip_count(loop, relation, limit->data[0].intConstantValue);
+}
+
+static void unroll_analyse_scope(UnrollBody *body, const CFStatement *first, const STSymbol *variable);
+
+// Analyses a statement of the loop body (without the following ones).
+static void unroll_analyse_statement(UnrollBody *body, const CFStatement *stat, const STSymbol *variable) {
+    body->size++;
+    switch (stat->statementType) {
+        case CF_BASIC:
+            body->size += tf_ast_size(stat->data.bodyAst);
+            body->assignsVariable |= tf_assigns(stat->data.bodyAst, variable);
+            break;
+        case CF_RETURN:
+            body->size += tf_ast_size(stat->data.bodyAst);
+            body->hasReturn = true;
+            break;
+        case CF_IF: {
+            const CFStatementIf *ifData = stat->data.ifData;
+            body->size += tf_ast_size(ifData->conditionalAst);
+            unroll_analyse_scope(body, ifData->thenStatement, variable);
+            if (ifData->elseStatement != NULL && ifData->elseStatement->statementType == CF_IF) {
+                // An else-if belongs to the scope of its IF
+                unroll_analyse_statement(body, ifData->elseStatement, variable);
+            } else {
+                unroll_analyse_scope(body, ifData->elseStatement, variable);
+            }
+            break;
+        }
+        case CF_FOR: {
+            const CFStatementFor *forData = stat->data.forData;
+            body->size += tf_ast_size(forData->definitionAst) + tf_ast_size(forData->conditionalAst)
+                          + tf_ast_size(forData->afterthoughtAst);
+            body->assignsVariable |= tf_assigns(forData->definitionAst, variable)
+                                     || tf_assigns(forData->afterthoughtAst, variable);
+            unroll_analyse_scope(body, forData->bodyStatement, variable);
+            break;
+        }
+    }
+}
+
+// Analyses the statements of a scope (a branch or a FOR body) in the loop body.
+static void unroll_analyse_scope(UnrollBody *body, const CFStatement *first, const STSymbol *variable) {
+    if (first == NULL) {
+        return;
+    }
+    for (const CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        unroll_analyse_statement(body, stat, variable);
+    }
+}
+
+// Creates a copy of the loop body with new temporaries for its locals. If the value isn't NULL, it replaces
+// the reads of the loop variable. The copied statements use the specified symbol table.
+static CFStatement *unroll_copy_body(UnrollContext *ctx, UnrollLoop *loop, UnrollBody *body, SymbolTable *table,
+                                     const ASTNode *value) {
+    unsigned count = 0;
+    if (value != NULL) {
+        body->replacements[count++] = (TFReplacement) {loop->variable, NULL, value};
+    }
+    for (unsigned i = 0; i < body->locals.count; i++) {
+        STSymbol *local = body->locals.items[i];
+        STSymbol *temporary = tf_new_temporary(ctx->fun, "u", local->data.var_data.type);
+        if (temporary == NULL) {
+            return NULL;
+        }
+        body->replacements[count++] = (TFReplacement) {local, temporary, NULL};
+    }
+
+    CFStatementFor *forData = loop->statement->data.forData;
+    return tf_copy_statements(forData->bodyStatement, ctx->fun, table, body->replacements, count);
+}
+
+// Creates a copy of the loop body for the specified iteration, with the loop variable replaced by its value.
+static CFStatement *unroll_copy_iteration(UnrollContext *ctx, UnrollLoop *loop, UnrollBody *body,
+                                          SymbolTable *table, uint64_t iteration) {
+    ASTNode *value = tf_const_int(loop->initial + (int64_t) iteration * loop->step);
+    if (value == NULL) {
+        return NULL;
+    }
+    CFStatement *copy = unroll_copy_body(ctx, loop, body, table, value);
+    clean_ast(value);
+    return copy;
+}
+
+// Appends the statements of the chain after the last statement of the chain starting with first. The empty
+// statements (the first statements of the copied branches) are freed instead.
+static void unroll_append(CFStatement **first, CFStatement **last, CFStatement *chain) {
+    while (chain != NULL) {
+        CFStatement *next = chain->followingStatement;
+        chain->followingStatement = NULL;
+        if (chain->statementType == CF_BASIC && chain->data.bodyAst == NULL) {
+            free(chain);
+        } else {
+            if (*first == NULL) {
+                *first = chain;
+                chain->parentStatement = NULL;
+            } else {
+                (*last)->followingStatement = chain;
+                chain->parentStatement = *last;
+            }
+            *last = chain;
+        }
+        chain = next;
+    }
+}
+
+// Creates copies of the body for the iterations from first to last (excluding), linked in a chain.
+// Stores NULL if there are none, returns false if memory couldn't be allocated.
+static bool unroll_copy_iterations(UnrollContext *ctx, UnrollLoop *loop, UnrollBody *body, SymbolTable *table,
+                                   uint64_t first, uint64_t last, CFStatement **copies) {
+    CFStatement *chainLast = NULL;
+    *copies = NULL;
+    for (uint64_t i = first; i < last; i++) {
+        CFStatement *copy = unroll_copy_iteration(ctx, loop, body, table, i);
+        if (copy == NULL) {
+            clean_stat(*copies, table);
+            *copies = NULL;
+            return false;
+        }
+        unroll_append(copies, &chainLast, copy);
+    }
+    return true;
+}
+
+// Replaces the loop with copies of its body for all the iterations.
+static bool unroll_fully(UnrollContext *ctx, UnrollLoop *loop, UnrollBody *body) {
+    CFStatement *copies;
+    if (!unroll_copy_iterations(ctx, loop, body, tf_scope_table(loop->statement), 0, loop->trips, &copies)) {
+        return false;
+    }
+
+    if (copies != NULL) {
+        tf_insert_statements_before(loop->statement, copies);
+    }
+    tf_remove_statement(loop->statement);
+    return true;
+}
+
+// Creates a statement advancing the loop variable by one step.
+static CFStatement *unroll_advance(UnrollContext *ctx, UnrollLoop *loop, SymbolTable *table) {
+    ASTNode *add = ast_node(AST_ADD);
+    if (add != NULL) {
+        add->left = tf_read(loop->variable);
+        add->right = tf_const_int(loop->step);
+    }
+    if (add == NULL || add->left == NULL || add->right == NULL) {
+        clean_ast(add);
+        return NULL;
+    }
+
+    ASTNode *assignment = tf_assign(loop->variable, add);
+    CFStatement *stat = assignment == NULL ? NULL : calloc(1, sizeof(CFStatement));
+    if (stat == NULL) {
+        clean_ast(assignment);
+        return NULL;
+    }
+
+    stat->parentFunction = ctx->fun;
+    stat->localSymbolTable = table;
+    stat->statementType = CF_BASIC;
+    stat->data.bodyAst = assignment;
+    return stat;
+}
+
+// Repeats the body of the loop factor times and moves the remaining iterations before the loop.
+static bool unroll_partially(UnrollContext *ctx, UnrollLoop *loop, UnrollBody *body, unsigned factor) {
+    CFStatement *stat = loop->statement;
+    CFStatementFor *forData = stat->data.forData;
+    SymbolTable *bodyTable = forData->bodyStatement->localSymbolTable;
+    uint64_t remainder = loop->trips % factor;
+
+    // The body starts with an empty statement, like the bodies created by the parser
+    CFStatement *newBody = calloc(1, sizeof(CFStatement));
+    if (newBody == NULL) {
+        return false;
+    }
+    newBody->parentFunction = ctx->fun;
+    newBody->localSymbolTable = bodyTable;
+    newBody->statementType = CF_BASIC;
+
+    CFStatement *last = newBody;
+    for (unsigned i = 0; i < factor; i++) {
+        CFStatement *copy = unroll_copy_body(ctx, loop, body, bodyTable, NULL);
+        CFStatement *advance = i + 1 < factor ? unroll_advance(ctx, loop, bodyTable) : NULL;
+        if (copy == NULL || (i + 1 < factor && advance == NULL)) {
+            clean_stat(copy, bodyTable);
+            clean_stat(advance, bodyTable);
+            clean_stat(newBody, bodyTable);
+            return false;
+        }
+        unroll_append(&newBody, &last, copy);
+        if (advance != NULL) {
+            unroll_append(&newBody, &last, advance);
+        }
+    }
+
+    CFStatement *peeled;
+    if (!unroll_copy_iterations(ctx, loop, body, tf_scope_table(stat), 0, remainder, &peeled)) {
+        clean_stat(newBody, bodyTable);
+        return false;
+    }
+
+    clean_stat(forData->bodyStatement, bodyTable);
+    for (CFStatement *next = newBody; next != NULL; next = next->followingStatement) {
+        next->parentBranchStatement = stat;
+    }
+    newBody->parentStatement = stat;
+    forData->bodyStatement = newBody;
+
+    if (peeled != NULL) {
+        tf_insert_statements_before(stat, peeled);
+    }
+    ASTNode *initial = forData->definitionAst->right->data[0].astPtr;
+    initial->data[0].intConstantValue = loop->initial + (int64_t) remainder * loop->step;
+    return true;
+}
+
+// Unrolls the FOR statement if its trip count is known and the copies fit in the budget.
+static void unroll_loop(UnrollContext *ctx, CFStatement *stat) {
+    UnrollLoop loop;
+    if (!unroll_analyse_header(stat, &loop) || stat->data.forData->bodyStatement == NULL) {
+        return;
+    }
+
+    UnrollBody body = {0};
+    unroll_analyse_scope(&body, stat->data.forData->bodyStatement, loop.variable);
+    bool collected = tf_add_scope_variables(&body.locals, stat->data.forData->bodyStatement);
+    body.replacements = collected ? malloc((body.locals.count + 1) * sizeof(TFReplacement)) : NULL;
+    if (body.replacements == NULL) {
+        free(body.locals.items);
+        ctx->failed = true;
+        return;
+    }
+
+    // Removing a loop that never runs could leave the function without its only return statement
+    if (!body.assignsVariable && !(body.hasReturn && loop.trips == 0)) {
+        bool unrolled = false;
+        if (loop.trips <= ctx->budget && loop.trips * body.size <= ctx->budget) {
+            ctx->failed = !unroll_fully(ctx, &loop, &body);
+            unrolled = true;
+        } else {
+            for (unsigned i = 0; i < sizeof(unrollFactors) / sizeof(unrollFactors[0]); i++) {
+                unsigned factor = unrollFactors[i];
+                if (loop.trips >= factor && (factor + loop.trips % factor) * body.size <= ctx->budget) {
+                    ctx->failed = !unroll_partially(ctx, &loop, &body, factor);
+                    unrolled = true;
+                    break;
+                }
+            }
+        }
+        if (unrolled && !ctx->failed) {
+            ctx->unrolled++;
+        }
+    }
+
+    free(body.replacements);
+    free(body.locals.items);
+}
+
+// Unrolls the loops in the statement chain, the innermost first.
+static void unroll_statements(UnrollContext *ctx, CFStatement *stat) {
+    while (stat != NULL && !ctx->failed) {
+        CFStatement *next = stat->followingStatement;
+        switch (stat->statementType) {
+            case CF_IF:
+                unroll_statements(ctx, stat->data.ifData->thenStatement);
+                unroll_statements(ctx, stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                unroll_statements(ctx, stat->data.forData->bodyStatement);
+                if (!ctx->failed) {
+                    unroll_loop(ctx, stat);
+                }
+                break;
+            default:
+                break;
+        }
+        stat = next;
+    }
+}
+
+bool unroll_run(CFFunction *fun, unsigned budget, unsigned *unrolled) {
+    UnrollContext ctx = {.fun = fun, .budget = budget};
+    if (budget > 0) {
+        unroll_statements(&ctx, fun->rootStatement);
+    }
+    *unrolled = ctx.unrolled;
+    return !ctx.failed;
+}
@@ -0,0 +1,28 @@
+/** @file unroll.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the unrolling of FOR loops with constant trip counts.
+ */
+
+#ifndef _UNROLL_H
+#define _UNROLL_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Unrolls the FOR loops of the function whose number of iterations is known at compile time, the innermost first.
+ *  - The loop must define a single int variable with a constant (i := c), only change it in its afterthought
+ *    by adding or subtracting a constant (i += c, i -= c, i = i + c, i = i - c) and compare it with a constant
+ *    in its condition (i < c, c >= i, i != c, ...).
+ *  - If the copies of the body for all the iterations have at most budget AST nodes, the loop is replaced
+ *    with them. The reads of the loop variable are replaced with its value in each iteration, a division by
+ *    a zero it yields is left to the runtime check, as the iteration may never run.
+ *  - Otherwise, the body is repeated four (or two) times in the loop if the copies fit in the budget, advancing
+ *    the variable between them, and the remaining iterations are moved before the loop.
+ * The variables defined in the unrolled bodies are replaced with new temporary variables in each copy.
+ * Stores the number of unrolled loops, returns false if memory couldn't be allocated.
+ */
+bool unroll_run(CFFunction *fun, unsigned budget, unsigned *unrolled);
+
+#endif // _UNROLL_H
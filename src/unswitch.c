@@ -0,0 +1,197 @@
+/** @file unswitch.c
+ *
+ * IFJ20 compiler
+ *
+ * @brief Implements the unswitching of FOR loops.
+ */
+
+#include <stdlib.h>
+#include "unswitch.h"
+#include "transform.h"
+
+typedef struct unswitch_context {
+    CFFunction *fun;
+    unsigned long budget; // Remaining number of AST nodes (and statements) of the copies.
+    unsigned unswitched;
+    bool failed;
+} UnswitchContext;
+
+// Checks whether the variables read by the AST keep their values in the loop.
+static bool unswitch_reads_invariant(CFStatement *loop, const ASTNode *ast) {
+    if (ast == NULL) {
+        return true;
+    }
+    if (ast->actionType == AST_ID) {
+        const STSymbol *variable = ast->data[0].symbolTableItemPtr;
+        CFStatementFor *forData = loop->data.forData;
+        return tf_is_visible(loop, variable) && !tf_assigns(forData->definitionAst, variable)
+               && !tf_assigns(forData->afterthoughtAst, variable)
+               && !tf_statements_assign(forData->bodyStatement, variable);
+    }
+    if (ast->actionType == AST_LIST) {
+        for (unsigned i = 0; i < ast->dataCount; i++) {
+            if (!unswitch_reads_invariant(loop, ast->data[i].astPtr)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (ast->actionType == AST_FUNC_CALL) {
+        return unswitch_reads_invariant(loop, ast->right);
+    }
+    return unswitch_reads_invariant(loop, ast->left) && unswitch_reads_invariant(loop, ast->right);
+}
+
+// Finds an IF in the chain (or in the branches of the IFs in it) whose condition is invariant in the loop.
+static CFStatement *unswitch_find_condition(CFStatement *loop, CFStatement *first) {
+    for (CFStatement *stat = first; stat != NULL; stat = stat->followingStatement) {
+        if (stat->statementType != CF_IF) {
+            continue;
+        }
+
+        const ASTNode *condition = stat->data.ifData->conditionalAst;
+        if (condition->actionType != AST_CONST_BOOL && !tf_has_impure_call(condition) && !tf_may_fail(condition)
+            && unswitch_reads_invariant(loop, condition)) {
+            return stat;
+        }
+
+        CFStatement *found = unswitch_find_condition(loop, stat->data.ifData->thenStatement);
+        if (found == NULL) {
+            found = unswitch_find_condition(loop, stat->data.ifData->elseStatement);
+        }
+        if (found != NULL) {
+            return found;
+        }
+    }
+    return NULL;
+}
+
+// Returns the number of AST nodes (and statements) of the FOR statement.
+static unsigned long unswitch_loop_size(const CFStatement *loop) {
+    const CFStatementFor *forData = loop->data.forData;
+    return 1 + tf_ast_size(forData->definitionAst) + tf_ast_size(forData->conditionalAst)
+           + tf_ast_size(forData->afterthoughtAst) + tf_statements_size(forData->bodyStatement);
+}
+
+// Collects the variables defined in the header and the body of the loop and creates the replacements
+// of them with new temporaries. Returns false if memory couldn't be allocated.
+static bool unswitch_replacements(UnswitchContext *ctx, CFStatement *loop, TFReplacement **replacements,
+                                  unsigned *count) {
+    TFVariables locals = {0};
+    CFStatement *body = loop->data.forData->bodyStatement;
+    if (body != NULL && !tf_add_scope_variables(&locals, body)) {
+        free(locals.items);
+        return false;
+    }
+
+    unsigned headerCount = 0;
+    SymbolTable *header = loop->localSymbolTable;
+    for (STItem *item = symtable_get_first_item(header); item != NULL; item = symtable_get_next_item(header, item)) {
+        headerCount += item->data.type == ST_SYMBOL_VAR;
+    }
+
+    *count = 0;
+    *replacements = malloc((locals.count + headerCount + 1) * sizeof(TFReplacement));
+    bool replaced = *replacements != NULL;
+    for (STItem *item = symtable_get_first_item(header); item != NULL && replaced;
+         item = symtable_get_next_item(header, item)) {
+        if (item->data.type == ST_SYMBOL_VAR) {
+            STSymbol *temporary = tf_new_temporary(ctx->fun, "s", item->data.data.var_data.type);
+            (*replacements)[(*count)++] = (TFReplacement) {&item->data, temporary, NULL};
+            replaced = temporary != NULL;
+        }
+    }
+    for (unsigned i = 0; i < locals.count && replaced; i++) {
+        STSymbol *temporary = tf_new_temporary(ctx->fun, "s", locals.items[i]->data.var_data.type);
+        (*replacements)[(*count)++] = (TFReplacement) {locals.items[i], temporary, NULL};
+        replaced = temporary != NULL;
+    }
+
+    free(locals.items);
+    return replaced;
+}
+
+static void unswitch_loop(UnswitchContext *ctx, CFStatement *loop);
+
+// Replaces the loop with an IF choosing between the loop and its copy by the invariant condition of the IF statement.
+static void unswitch_on(UnswitchContext *ctx, CFStatement *loop, CFStatement *target) {
+    TFReplacement *replacements = NULL;
+    unsigned count = 0;
+    ASTNode *constant = ast_leaf_constb(false);
+    if (constant == NULL || !unswitch_replacements(ctx, loop, &replacements, &count)) {
+        clean_ast(constant);
+        free(replacements);
+        ctx->failed = true;
+        return;
+    }
+
+    // The copy in the ELSE branch gets the IF with a false condition, the original loop is then switched to true
+    CFStatementIf *ifData = target->data.ifData;
+    ASTNode *condition = ifData->conditionalAst;
+    ifData->conditionalAst = constant;
+    CFStatement *split = tf_split_statement(loop, condition, replacements, count);
+    free(replacements);
+    if (split == NULL) {
+        ifData->conditionalAst = condition;
+        clean_ast(constant);
+        ctx->failed = true;
+        return;
+    }
+    constant->data[0].boolConstantValue = true;
+    ctx->unswitched++;
+
+    unswitch_loop(ctx, loop);
+    if (!ctx->failed) {
+        unswitch_loop(ctx, split->data.ifData->elseStatement->followingStatement);
+    }
+}
+
+// Unswitches the loop on the first IF with an invariant condition if its copy fits in the budget.
+static void unswitch_loop(UnswitchContext *ctx, CFStatement *loop) {
+    // The first statement of a function determines the scope of its variables, it can't be replaced
+    if (loop->parentStatement == NULL) {
+        return;
+    }
+
+    unsigned long size = unswitch_loop_size(loop);
+    if (size > ctx->budget) {
+        return;
+    }
+
+    CFStatement *target = unswitch_find_condition(loop, loop->data.forData->bodyStatement);
+    if (target != NULL) {
+        ctx->budget -= size;
+        unswitch_on(ctx, loop, target);
+    }
+}
+
+// Unswitches the loops in the statement chain, the innermost first.
+static void unswitch_statements(UnswitchContext *ctx, CFStatement *stat) {
+    while (stat != NULL && !ctx->failed) {
+        CFStatement *next = stat->followingStatement;
+        switch (stat->statementType) {
+            case CF_IF:
+                unswitch_statements(ctx, stat->data.ifData->thenStatement);
+                unswitch_statements(ctx, stat->data.ifData->elseStatement);
+                break;
+            case CF_FOR:
+                unswitch_statements(ctx, stat->data.forData->bodyStatement);
+                if (!ctx->failed) {
+                    unswitch_loop(ctx, stat);
+                }
+                break;
+            default:
+                break;
+        }
+        stat = next;
+    }
+}
+
+bool unswitch_run(CFFunction *fun, unsigned budget, unsigned *unswitched) {
+    UnswitchContext ctx = {.fun = fun, .budget = budget};
+    if (budget > 0) {
+        unswitch_statements(&ctx, fun->rootStatement);
+    }
+    *unswitched = ctx.unswitched;
+    return !ctx.failed;
+}
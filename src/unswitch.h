@@ -0,0 +1,26 @@
+/** @file unswitch.h
+ *
+ * IFJ20 compiler
+ *
+ * @brief Contains declarations of functions for the unswitching of FOR loops.
+ */
+
+#ifndef _UNSWITCH_H
+#define _UNSWITCH_H 1
+
+#include <stdbool.h>
+#include "control_flow.h"
+
+/* Moves the IF statements whose conditions don't change in a FOR loop out of the loop, the innermost loops first.
+ *  - A condition is invariant in a loop if it has no calls with side effects, can't fail at runtime and the loop
+ *    (its header and body) never assigns the variables it reads. The IFs in the nested loops are not considered.
+ *  - The loop is replaced with an IF with the condition, whose THEN branch contains the loop and whose ELSE branch
+ *    contains its copy. The IF in the loop is replaced with true and in the copy with false, so that folding removes
+ *    the dead branches and propagates the constants in each version. Both versions are unswitched again.
+ *  - The copies of all the loops of the function have at most budget AST nodes (and statements).
+ * The variables defined in the copies are replaced with new temporary variables. Stores the number of unswitched
+ * loops, returns false if memory couldn't be allocated.
+ */
+bool unswitch_run(CFFunction *fun, unsigned budget, unsigned *unswitched);
+
+#endif // _UNSWITCH_H